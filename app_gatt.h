@@ -169,11 +169,4 @@ extern bool AppIsDeviceBonded(void);
  */
 extern void ReportPanic(app_panic_code panic_code);
 
-#ifdef NVM_TYPE_FLASH
-/* This function writes the application data to NVM. This function should 
- * be called on getting nvm_status_needs_erase
- */
-extern void WriteApplicationAndServiceDataToNVM(void);
-#endif /* NVM_TYPE_FLASH */
-
 #endif /* __APP_GATT_H__ */
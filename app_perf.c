@@ -0,0 +1,355 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      app_perf.c
+ *
+ *  DESCRIPTION
+ *      This file defines the application performance counters and the key
+ *      report latency statistics.
+ *
+ *      The latency of a key report runs from the PIO changed event it is
+ *      built from to the GATT_CHAR_VAL_NOT_CFM of its notification, which
+ *      the firmware sends once the notification has been processed. The
+ *      firmware confirms notifications in the order they were sent, so the
+ *      time stamps of the reports in flight are kept in a FIFO.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <mem.h>
+#include <time.h>
+#include <bt_event_types.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "app_perf.h"
+
+#ifdef ENABLE_PERF_COUNTERS
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Number of key reports in flight whose time stamps are kept. Must be a
+ * power of two.
+ */
+#define APP_PERF_IN_FLIGHT_SIZE     (4)
+
+/* Mask used to wrap the FIFO indices */
+#define APP_PERF_IN_FLIGHT_MASK     (APP_PERF_IN_FLIGHT_SIZE - 1)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Key reports in flight */
+typedef struct
+{
+    /* Time of the last PIO changed event */
+    uint32                  key_time;
+
+    /* Boolean flag set if the report being built carries a high priority
+     * key
+     */
+    bool                    key_high;
+
+    /* Time stamps of the oldest reports in flight */
+    uint32                  times[APP_PERF_IN_FLIGHT_SIZE];
+
+    /* Index of the oldest time stamp and number of time stamps held */
+    uint16                  head;
+    uint16                  count;
+
+    /* Time stamps of high priority reports, one bit per entry of times[] */
+    uint16                  high_mask;
+
+    /* Number of reports in flight sent while the FIFO was full. They are
+     * newer than the ones time stamped, and are not measured.
+     */
+    uint16                  untracked;
+
+} APP_PERF_IN_FLIGHT_T;
+
+/*============================================================================*
+ *  Public Data
+ *============================================================================*/
+
+/* Performance counters. They live in RAM only and start from zero on every
+ * power cycle.
+ */
+uint16 g_app_perf_counters[app_perf_max];
+
+/* Key report latency statistics, reset with the counters */
+APP_PERF_LATENCY_T g_app_perf_latency;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Key reports in flight */
+static APP_PERF_IN_FLIGHT_T g_app_perf_in_flight;
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppPerfReset
+ *
+ *  DESCRIPTION
+ *      This function resets all the performance counters.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void AppPerfReset(void)
+{
+    MemSet(g_app_perf_counters, 0, sizeof(g_app_perf_counters));
+    MemSet(&g_app_perf_latency, 0, sizeof(g_app_perf_latency));
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppPerfCountDisconnect
+ *
+ *  DESCRIPTION
+ *      This function counts a disconnection against its HCI error reason.
+ *      Key reports still in flight are never confirmed, so they are
+ *      forgotten.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void AppPerfCountDisconnect(uint16 reason)
+{
+    g_app_perf_in_flight.count = 0;
+    g_app_perf_in_flight.untracked = 0;
+
+    switch(reason)
+    {
+        case HCI_ERROR_CONN_TIMEOUT:
+            /* Link loss */
+            APP_PERF_INC(app_perf_disc_conn_timeout);
+        break;
+
+        case HCI_ERROR_CONN_TERM_LOCAL_HOST:
+            APP_PERF_INC(app_perf_disc_local_host);
+        break;
+
+        case HCI_ERROR_OETC_USER:
+        case HCI_ERROR_OETC_LOW_RESOURCE:
+        case HCI_ERROR_OETC_POWERING_OFF:
+            APP_PERF_INC(app_perf_disc_remote);
+        break;
+
+        default:
+            APP_PERF_INC(app_perf_disc_other);
+        break;
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppPerfKeyEvent
+ *
+ *  DESCRIPTION
+ *      This function time stamps a PIO changed event as it is decoded.
+ *      'time' is the time the event was received, so the time it spent
+ *      queued counts towards the latency.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void AppPerfKeyEvent(uint32 time)
+{
+    g_app_perf_in_flight.key_time = time;
+    g_app_perf_in_flight.key_high = FALSE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppPerfKeyHigh
+ *
+ *  DESCRIPTION
+ *      This function marks the key report being built from the last PIO
+ *      changed event as carrying a high priority key, so its latency is
+ *      also kept apart.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void AppPerfKeyHigh(void)
+{
+    g_app_perf_in_flight.key_high = TRUE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppPerfReportSent
+ *
+ *  DESCRIPTION
+ *      This function records that the key report built from the last PIO
+ *      changed event has been handed to the firmware.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void AppPerfReportSent(void)
+{
+    APP_PERF_IN_FLIGHT_T *p_fifo = &g_app_perf_in_flight;
+    uint32 handler_time = TimeGet32() - p_fifo->key_time;
+    uint16 tail;
+
+    if(handler_time > g_app_perf_latency.max_handler_time)
+    {
+        g_app_perf_latency.max_handler_time = (handler_time > 0xffff) ?
+                                              0xffff : (uint16)handler_time;
+    }
+
+    /* A report can only be time stamped if all the reports before it are */
+    if((p_fifo->untracked == 0) && (p_fifo->count < APP_PERF_IN_FLIGHT_SIZE))
+    {
+        tail = (p_fifo->head + p_fifo->count) & APP_PERF_IN_FLIGHT_MASK;
+
+        p_fifo->times[tail] = p_fifo->key_time;
+
+        if(p_fifo->key_high)
+        {
+            p_fifo->high_mask |= (0x0001 << tail);
+        }
+        else
+        {
+            p_fifo->high_mask &= ~(0x0001 << tail);
+        }
+
+        ++ p_fifo->count;
+    }
+    else
+    {
+        ++ p_fifo->untracked;
+    }
+
+    /* A report sent later without a new PIO changed event, such as a
+     * report held back, is not high priority
+     */
+    p_fifo->key_high = FALSE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppPerfReportCfm
+ *
+ *  DESCRIPTION
+ *      This function records that the firmware has confirmed the oldest key
+ *      report in flight, and adds its latency to the statistics if it was
+ *      sent successfully.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void AppPerfReportCfm(bool success)
+{
+    APP_PERF_IN_FLIGHT_T *p_fifo = &g_app_perf_in_flight;
+    uint32 latency;
+    uint32 latency_ms;
+    uint16 bucket = 0;
+    bool high;
+
+    if(p_fifo->count == 0)
+    {
+        if(p_fifo->untracked != 0)
+        {
+            -- p_fifo->untracked;
+        }
+
+        return;
+    }
+
+    latency = TimeGet32() - p_fifo->times[p_fifo->head];
+    high = ((p_fifo->high_mask & (0x0001 << p_fifo->head)) != 0);
+    p_fifo->head = (p_fifo->head + 1) & APP_PERF_IN_FLIGHT_MASK;
+    -- p_fifo->count;
+
+    if(!success)
+    {
+        return;
+    }
+
+    if(latency > g_app_perf_latency.max_latency)
+    {
+        g_app_perf_latency.max_latency = latency;
+    }
+
+    if(high && (latency > g_app_perf_latency.max_high_latency))
+    {
+        g_app_perf_latency.max_high_latency = latency;
+    }
+
+    for(latency_ms = latency / MILLISECOND;
+        (latency_ms != 0) && (bucket < APP_PERF_LATENCY_BUCKETS - 1);
+        latency_ms >>= 1)
+    {
+        ++ bucket;
+    }
+
+    ++ g_app_perf_latency.buckets[bucket];
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppPerfEventQueued
+ *
+ *  DESCRIPTION
+ *      This function is called as the PIO changed event handler returns,
+ *      having queued the event received at 'time'. 'depth' is the number of
+ *      events then waiting to be decoded.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void AppPerfEventQueued(uint32 time, uint16 depth)
+{
+    uint32 event_time = TimeGet32() - time;
+
+    if(event_time > g_app_perf_latency.max_event_time)
+    {
+        g_app_perf_latency.max_event_time = (event_time > 0xffff) ?
+                                            0xffff : (uint16)event_time;
+    }
+
+    if(depth > g_app_perf_latency.max_queue_depth)
+    {
+        g_app_perf_latency.max_queue_depth = depth;
+    }
+}
+
+#endif /* ENABLE_PERF_COUNTERS */
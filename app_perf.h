@@ -0,0 +1,253 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      app_perf.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the application performance counters
+ *
+ *****************************************************************************/
+
+#ifndef __APP_PERF_H__
+#define __APP_PERF_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Performance counters. The order of this enumeration is the order in which
+ * the counters are reported in the Counters characteristic, so new counters
+ * must only be added at the end.
+ */
+typedef enum
+{
+    /* PIO changed events received */
+    app_perf_pio_events = 0,
+
+    /* Key reports generated */
+    app_perf_reports,
+
+    /* Notifications handed to the firmware */
+    app_perf_notify_sent,
+
+    /* Notifications dropped, or confirmed with a failure by the firmware */
+    app_perf_notify_failed,
+
+    /* Battery voltage ADC reads */
+    app_perf_battery_reads,
+
+    /* NVM read, write and erase operations */
+    app_perf_nvm_reads,
+    app_perf_nvm_writes,
+    app_perf_nvm_erases,
+
+    /* NVM writes skipped as the NVM already held the words */
+    app_perf_nvm_writes_skipped,
+
+    /* Connection parameter update requests sent and accepted */
+    app_perf_conn_param_reqs,
+    app_perf_conn_param_accepts,
+
+    /* Connections accepted from the bonded host */
+    app_perf_reconnects,
+
+    /* Disconnections by HCI error reason: HCI_ERROR_CONN_TIMEOUT (link loss),
+     * HCI_ERROR_CONN_TERM_LOCAL_HOST, HCI_ERROR_OETC_* and anything else
+     */
+    app_perf_disc_conn_timeout,
+    app_perf_disc_local_host,
+    app_perf_disc_remote,
+    app_perf_disc_other,
+
+    /* Keys moved from PIO changed events to polling, and polls made */
+    app_perf_input_storms,
+    app_perf_input_polls,
+
+    /* Key reports held back and merged into a later report */
+    app_perf_reports_coalesced,
+
+    /* Key reports of high priority keys, and low latency connection
+     * parameter requests they made
+     */
+    app_perf_high_prio_reports,
+    app_perf_low_latency_reqs,
+
+    /* PIO changed events merged into the newest queued one as the event
+     * queue was full
+     */
+    app_perf_input_queue_full,
+
+    /* Transmit power steps down and up, and link degradations which
+     * restored the full power at once
+     */
+    app_perf_tx_power_downs,
+    app_perf_tx_power_ups,
+    app_perf_tx_power_degraded,
+
+    /* Relaxed connection parameter requests and disconnections after no key
+     * was used, and key events which started fast advertising
+     */
+    app_perf_ladder_relaxes,
+    app_perf_ladder_disconnects,
+    app_perf_key_wakes,
+
+    /* Throttle samples taken, and those reported */
+    app_perf_throttle_samples,
+    app_perf_throttle_reports,
+
+    /* Commands written by the host, and those ignored as malformed */
+    app_perf_host_cmds,
+    app_perf_host_cmd_errors,
+
+    /* Pairing windows opened, pairing requests rejected outside them, and
+     * bonds evicted to make room for a new one
+     */
+    app_perf_pairing_windows,
+    app_perf_pairings_rejected,
+    app_perf_bond_evictions,
+
+    /* Number of counters. This must always be the last entry. */
+    app_perf_max
+
+} app_perf_counter;
+
+/* Number of buckets of the key report latency histogram. Bucket 0 counts
+ * latencies below 1ms, bucket n latencies from 2^(n-1) to 2^n ms, and the
+ * last bucket everything above.
+ */
+#define APP_PERF_LATENCY_BUCKETS    (12)
+
+/* Key report latency statistics */
+typedef struct
+{
+    /* Highest latency, in microseconds, from a PIO changed event to the
+     * confirmation of the key report built from it
+     */
+    uint32                  max_latency;
+
+    /* Highest time, in microseconds, from a PIO changed event to the key
+     * report being handed to the firmware
+     */
+    uint16                  max_handler_time;
+
+    /* Latency histogram, see APP_PERF_LATENCY_BUCKETS */
+    uint16                  buckets[APP_PERF_LATENCY_BUCKETS];
+
+    /* Highest latency, in microseconds, of the key reports of high priority
+     * keys. These are counted in the histogram too.
+     */
+    uint32                  max_high_latency;
+
+    /* Highest time, in microseconds, spent in the PIO changed event handler
+     * queueing an event
+     */
+    uint16                  max_event_time;
+
+    /* Highest number of PIO changed events queued at once */
+    uint16                  max_queue_depth;
+
+} APP_PERF_LATENCY_T;
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+#ifdef ENABLE_PERF_COUNTERS
+
+/* Increment a performance counter. Counters are 16 bits wide and wrap, the
+ * host is expected to work on differences between two reads.
+ */
+#define APP_PERF_INC(counter)   (++ g_app_perf_counters[(counter)])
+
+/* Time stamp the PIO changed event a key report is built from, with the
+ * time the event was received
+ */
+#define APP_PERF_KEY_EVENT(time) \
+                                AppPerfKeyEvent(time)
+
+/* Mark the key report being built as carrying a high priority key */
+#define APP_PERF_KEY_HIGH()     AppPerfKeyHigh()
+
+/* Record that the key report has been handed to the firmware */
+#define APP_PERF_REPORT_SENT()  AppPerfReportSent()
+
+/* Record that the firmware has confirmed the oldest key report in flight */
+#define APP_PERF_REPORT_CFM(success) \
+                                AppPerfReportCfm(success)
+
+/* Record that a PIO changed event received at 'time' has been queued,
+ * leaving 'depth' events in the queue
+ */
+#define APP_PERF_EVENT_QUEUED(time, depth) \
+                                AppPerfEventQueued((time), (depth))
+
+#else
+
+#define APP_PERF_INC(counter)
+#define APP_PERF_KEY_EVENT(time)
+#define APP_PERF_KEY_HIGH()
+#define APP_PERF_REPORT_SENT()
+#define APP_PERF_REPORT_CFM(success)
+#define APP_PERF_EVENT_QUEUED(time, depth)
+
+#endif /* ENABLE_PERF_COUNTERS */
+
+#ifdef ENABLE_PERF_COUNTERS
+
+/*============================================================================*
+ *  Public Data Declarations
+ *============================================================================*/
+
+/* Performance counters, indexed by app_perf_counter */
+extern uint16 g_app_perf_counters[app_perf_max];
+
+/* Key report latency statistics */
+extern APP_PERF_LATENCY_T g_app_perf_latency;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* This function resets all the performance counters and the latency
+ * statistics
+ */
+extern void AppPerfReset(void);
+
+/* This function counts a disconnection against its HCI error reason */
+extern void AppPerfCountDisconnect(uint16 reason);
+
+/* This function time stamps a PIO changed event */
+extern void AppPerfKeyEvent(uint32 time);
+
+/* This function marks the key report being built as high priority */
+extern void AppPerfKeyHigh(void);
+
+/* This function records that a key report has been handed to the firmware */
+extern void AppPerfReportSent(void);
+
+/* This function records that the firmware has confirmed a key report */
+extern void AppPerfReportCfm(bool success);
+
+/* This function records the time taken to queue a PIO changed event and the
+ * depth of the queue
+ */
+extern void AppPerfEventQueued(uint32 time, uint16 depth);
+
+#endif /* ENABLE_PERF_COUNTERS */
+
+#endif /* __APP_PERF_H__ */
@@ -0,0 +1,298 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      app_sched.c
+ *
+ *  DESCRIPTION
+ *      This file defines routines used to run low priority jobs, such as
+ *      the steps of a signal pattern, off a single application timer. The
+ *      timer is always armed for the job falling due first, so the jobs
+ *      take only one of the MAX_APP_TIMERS timers between them.
+ *
+ *      Jobs run from the timer callback, never from the handler of the
+ *      event which scheduled them, so a job cannot delay a key event.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <timer.h>
+#include <time.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "app_sched.h"
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Scheduled job data type */
+typedef struct
+{
+    /* Function to call when the job falls due, NULL if the job is not
+     * pending
+     */
+    app_sched_handler       handler;
+
+    /* Time at which the job falls due */
+    uint32                  due;
+
+} APP_SCHED_JOB_T;
+
+/* Scheduler data type */
+typedef struct
+{
+    /* Timer armed for the job falling due first, and the time it expires */
+    timer_id                tid;
+    uint32                  armed_due;
+
+    /* Boolean flag set while the jobs falling due are being run. The timer
+     * is re-armed once they have all run.
+     */
+    bool                    running;
+
+    /* Scheduled jobs, indexed by app_sched_job */
+    APP_SCHED_JOB_T         jobs[app_sched_job_max];
+
+} APP_SCHED_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Scheduler data instance */
+static APP_SCHED_DATA_T g_app_sched;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void appSchedArm(void);
+static void appSchedTimerHandler(timer_id tid);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appSchedArm
+ *
+ *  DESCRIPTION
+ *      This function arms the scheduler timer for the pending job falling
+ *      due first, or leaves it stopped if no job is pending.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void appSchedArm(void)
+{
+    uint32 now = TimeGet32();
+    int32 delay;
+    int32 next_delay = 0;
+    bool pending = FALSE;
+    uint16 job;
+
+    TimerDelete(g_app_sched.tid);
+    g_app_sched.tid = TIMER_INVALID;
+
+    for(job = 0; job < app_sched_job_max; job ++)
+    {
+        if(g_app_sched.jobs[job].handler == NULL)
+        {
+            continue;
+        }
+
+        /* The difference is taken modulo 2^32, which handles the time
+         * wrapping round
+         */
+        delay = (int32)(g_app_sched.jobs[job].due - now);
+
+        if(!pending || (delay < next_delay))
+        {
+            next_delay = delay;
+            pending = TRUE;
+        }
+    }
+
+    if(pending)
+    {
+        g_app_sched.armed_due = now + (uint32)next_delay;
+        g_app_sched.tid = TimerCreate((next_delay > 0) ?
+                                      (uint32)next_delay : 0,
+                                      TRUE, appSchedTimerHandler);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appSchedTimerHandler
+ *
+ *  DESCRIPTION
+ *      This function runs the jobs which have fallen due and re-arms the
+ *      timer for the next one.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void appSchedTimerHandler(timer_id tid)
+{
+    app_sched_handler handler;
+    uint32 now;
+    uint16 job;
+
+    if(tid != g_app_sched.tid)
+    {
+        /* Timer was deleted after it had expired */
+        return;
+    }
+
+    g_app_sched.tid = TIMER_INVALID;
+    g_app_sched.running = TRUE;
+
+    now = TimeGet32();
+
+    for(job = 0; job < app_sched_job_max; job ++)
+    {
+        handler = g_app_sched.jobs[job].handler;
+
+        if((handler != NULL) &&
+           ((int32)(g_app_sched.jobs[job].due - now) <= 0))
+        {
+            /* The job may schedule itself again */
+            g_app_sched.jobs[job].handler = NULL;
+            handler();
+        }
+    }
+
+    g_app_sched.running = FALSE;
+
+    appSchedArm();
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppSchedInit
+ *
+ *  DESCRIPTION
+ *      This function initialises the scheduler. TimerInit() discards all the
+ *      timers, so any job pending is dropped.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void AppSchedInit(void)
+{
+    uint16 job;
+
+    g_app_sched.tid = TIMER_INVALID;
+    g_app_sched.running = FALSE;
+
+    for(job = 0; job < app_sched_job_max; job ++)
+    {
+        g_app_sched.jobs[job].handler = NULL;
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppSchedStart
+ *
+ *  DESCRIPTION
+ *      This function schedules a job to run after the given delay, in
+ *      microseconds, replacing any pending run of the same job.
+ *
+ *      The pending jobs are only scanned again when the job moves later and
+ *      may have been the one the timer is armed for. Otherwise the timer is
+ *      kept if it already expires first, or armed for the job if not.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void AppSchedStart(app_sched_job job, uint32 delay,
+                          app_sched_handler handler)
+{
+    APP_SCHED_JOB_T *p_job = &g_app_sched.jobs[job];
+    uint32 due = TimeGet32() + delay;
+    bool was_first = (p_job->handler != NULL) &&
+                     (p_job->due == g_app_sched.armed_due);
+
+    p_job->handler = handler;
+    p_job->due = due;
+
+    if(g_app_sched.running)
+    {
+        /* The timer is armed once the jobs falling due have run */
+        return;
+    }
+
+    if(g_app_sched.tid == TIMER_INVALID)
+    {
+        /* No other job is pending */
+        g_app_sched.armed_due = due;
+        g_app_sched.tid = TimerCreate(delay, TRUE, appSchedTimerHandler);
+    }
+    else if((int32)(due - g_app_sched.armed_due) < 0)
+    {
+        /* The job falls due first */
+        TimerDelete(g_app_sched.tid);
+        g_app_sched.armed_due = due;
+        g_app_sched.tid = TimerCreate(delay, TRUE, appSchedTimerHandler);
+    }
+    else if(was_first)
+    {
+        appSchedArm();
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppSchedStop
+ *
+ *  DESCRIPTION
+ *      This function cancels a pending job. It does nothing if the job is
+ *      not pending.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void AppSchedStop(app_sched_job job)
+{
+    if(g_app_sched.jobs[job].handler == NULL)
+    {
+        return;
+    }
+
+    g_app_sched.jobs[job].handler = NULL;
+
+    if(!g_app_sched.running)
+    {
+        appSchedArm();
+    }
+}
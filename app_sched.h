@@ -0,0 +1,88 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      app_sched.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the low priority job scheduler
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SCHED_H__
+#define __APP_SCHED_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Low priority jobs sharing the scheduler timer. Each job can be pending at
+ * most once.
+ */
+typedef enum
+{
+    /* Next step of the signal pattern being played */
+    app_sched_job_signal = 0,
+
+    /* Poll of the pulses counted by the PIO controller */
+    app_sched_job_pulse_poll,
+
+    /* Poll of the keys changing too often for PIO changed events */
+    app_sched_job_input_poll,
+
+    /* Decoding of the queued PIO changed events */
+    app_sched_job_input_events,
+
+    /* Send of the key report holding back low priority changes */
+    app_sched_job_report_flush,
+
+    /* End of the low latency connection parameters */
+    app_sched_job_low_latency,
+
+    /* Sample of the link RSSI for the transmit power control */
+    app_sched_job_tx_power,
+
+    /* Next step of the inactivity power ladder */
+    app_sched_job_ladder,
+
+    /* Sample of the analog throttle */
+    app_sched_job_throttle,
+
+    /* End of the pairing window */
+    app_sched_job_pairing_window,
+
+    /* Number of jobs. This must always be the last entry. */
+    app_sched_job_max
+
+} app_sched_job;
+
+/* Function called when a job falls due */
+typedef void (*app_sched_handler)(void);
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* This function initialises the scheduler. It must be called after the
+ * application timers have been initialised.
+ */
+extern void AppSchedInit(void);
+
+/* This function schedules a job to run after the given delay, replacing any
+ * pending run of the same job
+ */
+extern void AppSchedStart(app_sched_job job, uint32 delay,
+                          app_sched_handler handler);
+
+/* This function cancels a pending job */
+extern void AppSchedStop(app_sched_job job);
+
+#endif /* __APP_SCHED_H__ */
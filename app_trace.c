@@ -0,0 +1,315 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      app_trace.c
+ *
+ *  DESCRIPTION
+ *      This file defines a time stamped trace ring of application events and
+ *      the routines used to send it to the connected host.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <gatt.h>
+#include <time.h>
+#include <buf_utils.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "app_gatt.h"
+#include "app_trace.h"
+
+#ifdef ENABLE_APP_TRACE
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Mask used to wrap the ring indices */
+#define APP_TRACE_RING_MASK          (APP_TRACE_RING_SIZE - 1)
+
+/* Size of a record in a notification: time stamp (4 octets), type (1 octet)
+ * and data (2 octets)
+ */
+#define APP_TRACE_RECORD_OCTETS      (7)
+
+/* Size of the page header: page sequence number and record count */
+#define APP_TRACE_PAGE_HEADER_OCTETS (2)
+
+/* Number of records sent in each notification. A notification can carry at
+ * most (DEFAULT_ATT_MTU - 3 = 20) octets.
+ */
+#define APP_TRACE_RECORDS_PER_PAGE   ((20 - APP_TRACE_PAGE_HEADER_OCTETS) / \
+                                      APP_TRACE_RECORD_OCTETS)
+
+/* Size of the last page, which carries the total number of records logged
+ * since the ring was last cleared
+ */
+#define APP_TRACE_LAST_PAGE_OCTETS   (APP_TRACE_PAGE_HEADER_OCTETS + 2)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Trace record */
+typedef struct
+{
+    /* Time at which the record was logged */
+    uint32                  time;
+
+    /* Record type */
+    app_trace_type          type;
+
+    /* Record data. See app_trace_type. */
+    uint16                  data;
+
+} APP_TRACE_RECORD_T;
+
+/* Trace ring data type */
+typedef struct
+{
+    /* Records */
+    APP_TRACE_RECORD_T      ring[APP_TRACE_RING_SIZE];
+
+    /* Index at which the next record will be logged */
+    uint16                  head;
+
+    /* Number of records logged since the ring was last cleared, modulo
+     * 65536. Only the last APP_TRACE_RING_SIZE of them are held in the ring.
+     */
+    uint16                  total;
+
+    /* Boolean flag set once the ring has been filled, after which the
+     * oldest record is the one at head. 'total' cannot tell, as it wraps.
+     */
+    bool                    wrapped;
+
+    /* Boolean flag set while the ring is being sent to the host. Logging is
+     * suspended in the meantime so that the host reads a consistent ring.
+     */
+    bool                    dumping;
+
+    /* UCID and attribute handle on which the ring is being sent */
+    uint16                  dump_ucid;
+    uint16                  dump_handle;
+
+    /* Index of the next record to be sent and number of records left */
+    uint16                  dump_index;
+    uint16                  dump_left;
+
+    /* Sequence number of the next page */
+    uint8                   dump_page;
+
+} APP_TRACE_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Trace ring instance */
+static APP_TRACE_DATA_T g_app_trace;
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppTraceRecord
+ *
+ *  DESCRIPTION
+ *      This function logs a time stamped record in the trace ring, overwriting
+ *      the oldest record once the ring is full.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void AppTraceRecord(app_trace_type type, uint16 data)
+{
+    APP_TRACE_RECORD_T *p_rec;
+
+    if(g_app_trace.dumping)
+    {
+        return;
+    }
+
+    p_rec = &g_app_trace.ring[g_app_trace.head];
+
+    p_rec->time = TimeGet32();
+    p_rec->type = type;
+    p_rec->data = data;
+
+    g_app_trace.head = (g_app_trace.head + 1) & APP_TRACE_RING_MASK;
+    ++ g_app_trace.total;
+
+    if(g_app_trace.head == 0)
+    {
+        g_app_trace.wrapped = TRUE;
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppTraceClear
+ *
+ *  DESCRIPTION
+ *      This function discards all the records held in the trace ring.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void AppTraceClear(void)
+{
+    g_app_trace.head = 0;
+    g_app_trace.total = 0;
+    g_app_trace.wrapped = FALSE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppTraceStartDump
+ *
+ *  DESCRIPTION
+ *      This function starts sending the trace ring, oldest record first, to
+ *      the connected host. The ring is sent as a sequence of notifications on
+ *      the given characteristic. Each notification carries a page sequence
+ *      number, the number of records in the page and the records themselves.
+ *      The last page carries no record but the total number of records logged
+ *      since the ring was last cleared, so the host can tell how many records
+ *      have been overwritten.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void AppTraceStartDump(uint16 ucid, uint16 handle)
+{
+    g_app_trace.dumping = TRUE;
+    g_app_trace.dump_ucid = ucid;
+    g_app_trace.dump_handle = handle;
+    g_app_trace.dump_page = 0;
+
+    if(!g_app_trace.wrapped)
+    {
+        /* The records held are the first ones logged, from index 0 */
+        g_app_trace.dump_index = 0;
+        g_app_trace.dump_left = g_app_trace.head;
+    }
+    else
+    {
+        /* Ring has wrapped, the oldest record is the next to be overwritten */
+        g_app_trace.dump_index = g_app_trace.head;
+        g_app_trace.dump_left = APP_TRACE_RING_SIZE;
+    }
+
+    AppTraceContinueDump();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppTraceContinueDump
+ *
+ *  DESCRIPTION
+ *      This function sends the next page of an on-going trace dump. It is
+ *      called once the firmware has confirmed the previous page.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if a page has been sent, FALSE if no dump is on-going.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool AppTraceContinueDump(void)
+{
+    uint8 page[APP_TRACE_PAGE_HEADER_OCTETS +
+               (APP_TRACE_RECORDS_PER_PAGE * APP_TRACE_RECORD_OCTETS)];
+    uint8 *p_page = page + APP_TRACE_PAGE_HEADER_OCTETS;
+    APP_TRACE_RECORD_T *p_rec;
+    uint16 num_records = 0;
+
+    if(!g_app_trace.dumping)
+    {
+        return FALSE;
+    }
+
+    page[0] = g_app_trace.dump_page ++;
+
+    if(g_app_trace.dump_left == 0)
+    {
+        /* All the records have been sent. Send the last page and resume
+         * logging.
+         */
+        page[1] = 0;
+        BufWriteUint16(&p_page, g_app_trace.total);
+
+        GattCharValueNotification(g_app_trace.dump_ucid,
+                                  g_app_trace.dump_handle,
+                                  APP_TRACE_LAST_PAGE_OCTETS, page);
+
+        g_app_trace.dumping = FALSE;
+
+        return TRUE;
+    }
+
+    while(num_records < APP_TRACE_RECORDS_PER_PAGE &&
+          g_app_trace.dump_left != 0)
+    {
+        p_rec = &g_app_trace.ring[g_app_trace.dump_index];
+
+        BufWriteUint16(&p_page, (uint16)(p_rec->time & 0xffff));
+        BufWriteUint16(&p_page, (uint16)(p_rec->time >> 16));
+        BufWriteUint8(&p_page, (uint8)p_rec->type);
+        BufWriteUint16(&p_page, p_rec->data);
+
+        g_app_trace.dump_index = (g_app_trace.dump_index + 1) &
+                                                        APP_TRACE_RING_MASK;
+        -- g_app_trace.dump_left;
+        ++ num_records;
+    }
+
+    page[1] = (uint8)num_records;
+
+    GattCharValueNotification(g_app_trace.dump_ucid,
+                              g_app_trace.dump_handle,
+                              APP_TRACE_PAGE_HEADER_OCTETS +
+                              (num_records * APP_TRACE_RECORD_OCTETS),
+                              page);
+
+    return TRUE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppTraceStopDump
+ *
+ *  DESCRIPTION
+ *      This function aborts an on-going trace dump and resumes logging. It is
+ *      called when the link to the host is lost.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void AppTraceStopDump(void)
+{
+    g_app_trace.dumping = FALSE;
+}
+
+#endif /* ENABLE_APP_TRACE */
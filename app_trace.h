@@ -0,0 +1,130 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      app_trace.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the application event trace ring
+ *
+ *****************************************************************************/
+
+#ifndef __APP_TRACE_H__
+#define __APP_TRACE_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Types of the records logged in the trace ring */
+typedef enum
+{
+    /* Application state transition. Data: (old state << 8) | new state */
+    app_trace_state = 1,
+
+    /* LM event received by AppProcessLmEvent. Data: lm_event_code */
+    app_trace_lm_event,
+
+    /* PIO changed event. Data: low 16 bits of the PIO cause mask */
+    app_trace_pio_event,
+
+    /* Notification handed to the firmware. Data: attribute handle */
+    app_trace_notify_sent,
+
+    /* Notification failed or dropped. Data: attribute handle */
+    app_trace_notify_failed,
+
+    /* Connection parameter update request sent. Data: attempt number */
+    app_trace_conn_param_req,
+
+    /* Connection parameters changed. Data: connection interval */
+    app_trace_conn_params,
+
+    /* Keys moved to or from polling. Data: low 16 bits of the mask of the
+     * keys being polled
+     */
+    app_trace_input_mode,
+
+    /* Low latency connection parameters requested or released. Data: 1 if
+     * requested, 0 if released
+     */
+    app_trace_low_latency,
+
+    /* Transmit power level changed while connected. Data: new level in the
+     * high octet, smoothed RSSI of the link (signed) in the low octet
+     */
+    app_trace_tx_power,
+
+    /* Step of the inactivity power ladder. Data: 0 key event while
+     * relaxed, 1 relaxed parameters requested, 2 link closed, 3 dormant,
+     * 4 key event while idle or advertising slowly
+     */
+    app_trace_ladder,
+
+    /* Throttle position reported. Data: position */
+    app_trace_throttle,
+
+    /* Command written by the host. Data: command (high octet), 0 if run or
+     * 1 if ignored (low octet)
+     */
+    app_trace_host_cmd
+
+} app_trace_type;
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+#ifdef ENABLE_APP_TRACE
+
+/* Log a record in the trace ring */
+#define APP_TRACE(type, data)   AppTraceRecord((type), (uint16)(data))
+
+#else
+
+#define APP_TRACE(type, data)
+
+#endif /* ENABLE_APP_TRACE */
+
+#ifdef ENABLE_APP_TRACE
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* This function logs a time stamped record in the trace ring */
+extern void AppTraceRecord(app_trace_type type, uint16 data);
+
+/* This function discards all the records held in the trace ring */
+extern void AppTraceClear(void);
+
+/* This function starts sending the trace ring to the connected host as a
+ * sequence of notifications on the given characteristic
+ */
+extern void AppTraceStartDump(uint16 ucid, uint16 handle);
+
+/* This function sends the next page of an on-going trace dump. It returns
+ * FALSE if no dump is on-going.
+ */
+extern bool AppTraceContinueDump(void);
+
+/* This function aborts an on-going trace dump */
+extern void AppTraceStopDump(void);
+
+#endif /* ENABLE_APP_TRACE */
+
+#endif /* __APP_TRACE_H__ */
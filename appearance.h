@@ -15,6 +15,12 @@
 #ifndef __APPEARANCE_H__
 #define __APPEARANCE_H__
 
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+
 /*============================================================================*
  *  Public Definitions
  *============================================================================*/
@@ -43,5 +49,11 @@
 /* Thermometer appearance value */
 #define APPEARANCE_THERMOMETER_VALUE            0x0300
 
+/* Appearance of the application, advertised and read from the GAP service */
+#ifdef ENABLE_HID_MODE
+#define APP_APPEARANCE_VALUE                    APPEARANCE_KEYBOARD_VALUE
+#else
+#define APP_APPEARANCE_VALUE                    APPEARANCE_THERMOMETER_VALUE
+#endif /* ENABLE_HID_MODE */
 
 #endif /* __APPEARANCE_H__ */
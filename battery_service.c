@@ -9,6 +9,11 @@
  * DESCRIPTION
  *     This file defines routines for using Battery service.
  *
+ *     The battery voltage is read three times and the median is kept, which
+ *     drops the samples disturbed by radio activity. The medians are then
+ *     smoothed by an exponentially weighted moving average and converted to
+ *     a level through the discharge curve of the cell.
+ *
  ****************************************************************************/
 
 /*============================================================================*
@@ -26,8 +31,10 @@
 
 #include "app_gatt.h"
 #include "battery_service.h"
-#include "nvm_access.h"
+#include "bond_table.h"
 #include "app_gatt_db.h"
+#include "app_perf.h"
+#include "counter_store.h"
 
 /*============================================================================*
  *  Private Data Types
@@ -39,14 +46,35 @@ typedef struct
     /* Battery Level in percent */
     uint8   level;
 
+    /* Battery level in percent of the last voltage sample, reported with 
+     * the keys
+     */
+    uint8   sampled_level;
+
     /* Client configurate for Battery Level characteristic */
     gatt_client_config level_client_config;
 
-    /* NVM Offset at which Battery data is stored */
-    uint16 nvm_offset;
+    /* Filtered battery voltage in mV, scaled by 2^BATTERY_EWMA_SHIFT. Zero 
+     * until the first voltage has been read.
+     */
+    uint16 voltage_ewma;
 
 } BATT_DATA_T;
 
+/* Segment of the battery discharge curve, over which the level is linear */
+typedef struct
+{
+    /* Voltage in mV at the start of the segment */
+    uint16 voltage;
+
+    /* Battery level in percent at the start of the segment */
+    uint8  level;
+
+    /* Level increase per mV, scaled by 2^BATTERY_SLOPE_SHIFT */
+    uint16 slope;
+
+} BATT_CURVE_SEGMENT_T;
+
 /*============================================================================*
  *  Private Data
  *===========================================================================*/
@@ -65,69 +93,192 @@ static BATT_DATA_T g_batt_data;
 #define BATTERY_CRITICAL_LEVEL                        (10)
 
 /*
- * Battery minimum and maximum voltages in mV
+ * Battery minimum and maximum voltages in mV, the ends of the discharge 
+ * curve
  */
 #define BATTERY_FULL_BATTERY_VOLTAGE                  (3000) /* 3.0V */
-#define BATTERY_FLAT_BATTERY_VOLTAGE                  (1800) /* 1.8V */
+#define BATTERY_FLAT_BATTERY_VOLTAGE                  (2100) /* 2.1V */
+
+/* Number of voltage samples read for each battery level, of which the 
+ * median is kept
+ */
+#define BATTERY_VOLTAGE_SAMPLES                       (3)
 
-/* Number of words of NVM memory used by Battery service */
-#define BATTERY_SERVICE_NVM_MEMORY_WORDS              (1)
+/* Weight of a new voltage in the moving average, 1 / 2^BATTERY_EWMA_SHIFT */
+#define BATTERY_EWMA_SHIFT                            (2)
 
-/* The offset of data being stored in NVM for Battery service. This offset is 
- * added to Battery service offset to NVM region (see g_batt_data.nvm_offset) 
- * to get the absolute offset at which this data is stored in NVM
+/* Fixed point scaling of the discharge curve slopes */
+#define BATTERY_SLOPE_SHIFT                           (10)
+
+/* Discharge curve segment from (voltage, level) to (next_voltage, 
+ * next_level). The slope is worked out by the compiler, so converting a 
+ * voltage takes no division.
+ */
+#define BATTERY_CURVE_SEGMENT(voltage, level, next_voltage, next_level)     \
+    { (voltage), (level),                                                   \
+      (((next_level) - (level)) << BATTERY_SLOPE_SHIFT) /                   \
+                                            ((next_voltage) - (voltage)) }
+
+/* Minimum change of the battery level, in percent, which is notified. 
+ * Smaller changes are held back so that a voltage hovering around a step 
+ * does not send notifications back and forth.
  */
-#define BATTERY_NVM_LEVEL_CLIENT_CONFIG_OFFSET        (0)
+#define BATTERY_LEVEL_HYSTERESIS                      (2)
+
+/* Battery level value which is not valid, used to force a notification */
+#define BATTERY_LEVEL_INVALID                         (0xFF)
+
+/* Discharge curve of a CR2032 coin cell under light load, in ascending 
+ * voltage order. The level is 0 below the first segment and 
+ * BATTERY_LEVEL_FULL from BATTERY_FULL_BATTERY_VOLTAGE. The slopes must keep
+ * (voltage - segment voltage) * slope within 16 bits.
+ */
+static const BATT_CURVE_SEGMENT_T battery_curve[] =
+{
+    BATTERY_CURVE_SEGMENT(BATTERY_FLAT_BATTERY_VOLTAGE, 0, 2440, 6),
+    BATTERY_CURVE_SEGMENT(2440, 6, 2740, 18),
+    BATTERY_CURVE_SEGMENT(2740, 18, 2900, 42),
+    BATTERY_CURVE_SEGMENT(2900, 42, BATTERY_FULL_BATTERY_VOLTAGE, 
+                          BATTERY_LEVEL_FULL)
+};
+
+/* Number of segments in the discharge curve */
+#define BATTERY_CURVE_SEGMENTS                        (sizeof(battery_curve) / \
+                                                   sizeof(battery_curve[0]))
 
 /*============================================================================*
  *   Private Function Prototypes
- *===========================================================================
+ *===========================================================================*/
 
-extern uint8 readBatteryLevel(void);
-*/
+static uint8 readBatteryLevel(void);
+static uint16 readBatteryVoltage(void);
+static uint8 batteryLevelFromVoltage(uint16 voltage);
 /*============================================================================*
  *  Private Function Implementations
  *===========================================================================*/
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      readBatteryLevel
+ *      readBatteryVoltage
+ *
+ *  DESCRIPTION
+ *      This function reads the battery voltage BATTERY_VOLTAGE_SAMPLES times
+ *      and returns the median of the samples.
+ *
+ *  RETURNS
+ *      uint16 - Battery voltage in mV
+ *
+ *---------------------------------------------------------------------------*/
+
+static uint16 readBatteryVoltage(void)
+{
+    uint16 samples[BATTERY_VOLTAGE_SAMPLES];
+    uint16 sample;
+    uint16 index;
+    uint16 sorted;
+
+    /* Insertion sort, the samples are few */
+    for(index = 0; index < BATTERY_VOLTAGE_SAMPLES; index ++)
+    {
+        APP_PERF_INC(app_perf_battery_reads);
+
+        sample = BatteryReadVoltage();
+
+        for(sorted = index; sorted > 0 && samples[sorted - 1] > sample;
+            sorted --)
+        {
+            samples[sorted] = samples[sorted - 1];
+        }
+
+        samples[sorted] = sample;
+    }
+
+    return samples[BATTERY_VOLTAGE_SAMPLES / 2];
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      batteryLevelFromVoltage
  *
  *  DESCRIPTION
- *      This function reads the battery level 
+ *      This function converts a battery voltage to a level through the 
+ *      discharge curve of the cell.
  *
  *  RETURNS
  *      uint8 - Battery Level in percent
  *
  *---------------------------------------------------------------------------*/
 
-extern uint8 readBatteryLevel(void)
+static uint8 batteryLevelFromVoltage(uint16 voltage)
 {
-    uint32 bat_voltage;
-    uint32 bat_level;
+    const BATT_CURVE_SEGMENT_T *p_segment;
+    uint16 index = BATTERY_CURVE_SEGMENTS;
 
-    /* Read battery voltage and level it with minimum voltage */
-    bat_voltage = BatteryReadVoltage();
+    if(voltage >= BATTERY_FULL_BATTERY_VOLTAGE)
+    {
+        return BATTERY_LEVEL_FULL;
+    }
 
-    /* Level the read battery voltage to the minimum value */
-    if(bat_voltage < BATTERY_FLAT_BATTERY_VOLTAGE)
+    /* Find the segment the voltage falls in, from the top of the curve */
+    while(index -- != 0)
     {
-        bat_voltage = BATTERY_FLAT_BATTERY_VOLTAGE;
+        p_segment = &battery_curve[index];
+
+        if(voltage >= p_segment->voltage)
+        {
+            return p_segment->level +
+                   (uint8)(((voltage - p_segment->voltage) * 
+                            p_segment->slope) >> BATTERY_SLOPE_SHIFT);
+        }
     }
 
-    bat_voltage -= BATTERY_FLAT_BATTERY_VOLTAGE;
-    
-    /* Get battery level in percent */
-    bat_level = (bat_voltage * 100) / (BATTERY_FULL_BATTERY_VOLTAGE - 
-                                                  BATTERY_FLAT_BATTERY_VOLTAGE);
+    /* Below the flat battery voltage */
+    return 0;
+}
+
 
-    /* Check the precision errors */
-    if(bat_level > 100)
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readBatteryLevel
+ *
+ *  DESCRIPTION
+ *      This function reads the battery level. The median of the voltage 
+ *      samples is added to the moving average, which is converted to a 
+ *      level. The level is kept for BatteryGetLevel().
+ *
+ *  RETURNS
+ *      uint8 - Battery Level in percent
+ *
+ *---------------------------------------------------------------------------*/
+
+static uint8 readBatteryLevel(void)
+{
+    uint16 bat_voltage;
+    uint8 bat_level;
+
+    bat_voltage = readBatteryVoltage();
+
+    if(g_batt_data.voltage_ewma == 0)
+    {
+        /* First voltage read, start the average from it */
+        g_batt_data.voltage_ewma = bat_voltage << BATTERY_EWMA_SHIFT;
+    }
+    else
     {
-        bat_level = 100;
+        g_batt_data.voltage_ewma += bat_voltage - 
+                        (g_batt_data.voltage_ewma >> BATTERY_EWMA_SHIFT);
     }
 
-    return (uint8)bat_level;
+    bat_level = batteryLevelFromVoltage(
+                        g_batt_data.voltage_ewma >> BATTERY_EWMA_SHIFT);
+
+    /* Checkpoint every counter increment while the battery is low */
+    CounterStoreSetLowBattery(bat_level <= BATTERY_CRITICAL_LEVEL);
+
+    g_batt_data.sampled_level = bat_level;
+
+    return bat_level;
 }
 
 /*============================================================================*
@@ -149,13 +300,12 @@ extern uint8 readBatteryLevel(void)
 
 extern void BatteryDataInit(void)
 {
-    if(!AppIsDeviceBonded())
-    {
-        /* Initialise battery level client configuration characterisitic
-         * descriptor value only if device is not bonded
-         */
-        g_batt_data.level_client_config = gatt_client_config_none;
-    }
+    /* Initialise battery level client configuration characterisitic
+     * descriptor value with the one stored for the connected device if it is
+     * bonded
+     */
+    g_batt_data.level_client_config = 
+                            BondTableGetClientConfig(bond_cccd_batt_level);
 
 }
 
@@ -179,6 +329,10 @@ extern void BatteryInitChipReset(void)
      * the first time after power cycle.
      */
     g_batt_data.level = 0;
+
+    /* Restart the moving average from the next voltage read */
+    g_batt_data.voltage_ewma = 0;
+    g_batt_data.sampled_level = 0;
 }
 
 
@@ -275,16 +429,11 @@ extern void BatteryHandleAccessWrite(GATT_ACCESS_IND_T *p_ind)
             {
                 g_batt_data.level_client_config = client_config;
 
-                /* Write battery level client configuration to NVM if the 
-                 * device is bonded.
+                /* Store battery level client configuration with the bond 
+                 * if the device is bonded.
                  */
-                if(AppIsDeviceBonded())
-                {
-                    Nvm_Write(&client_config,
-                          sizeof(client_config),
-                          g_batt_data.nvm_offset + 
-                          BATTERY_NVM_LEVEL_CLIENT_CONFIG_OFFSET);
-                }
+                BondTableSetClientConfig(bond_cccd_batt_level, 
+                                         (gatt_client_config)client_config);
             }
             else
             {
@@ -313,7 +462,7 @@ extern void BatteryHandleAccessWrite(GATT_ACCESS_IND_T *p_ind)
         /* Reset current battery level to an invalid value so that it 
          * triggers notifications on reading the current battery level 
          */
-        g_batt_data.level = 0xFF; /* 0 to 100: Valid value range */
+        g_batt_data.level = BATTERY_LEVEL_INVALID;
 
         BatteryUpdateLevel(p_ind->cid);
     }
@@ -344,10 +493,13 @@ extern void BatteryUpdateLevel(uint16 ucid)
 
     old_vbat = (g_batt_data.level);
 
-    /* If the current and old battery level are not same, update the 
-     * connected host if notifications are configured.
+    /* If the current and old battery level differ by at least the 
+     * hysteresis, update the connected host if notifications are configured.
+     * The old level is invalid when an update is forced.
      */
-    if(old_vbat != cur_bat_level)
+    if((old_vbat == BATTERY_LEVEL_INVALID) ||
+       (old_vbat >= cur_bat_level + BATTERY_LEVEL_HYSTERESIS) ||
+       (cur_bat_level >= old_vbat + BATTERY_LEVEL_HYSTERESIS))
     {
 
         if((ucid != GATT_INVALID_UCID) &&
@@ -359,6 +511,8 @@ extern void BatteryUpdateLevel(uint16 ucid)
                                       HANDLE_BATT_LEVEL, 
                                       1, &cur_bat_level);
 
+            APP_PERF_INC(app_perf_notify_sent);
+
             /* Update Battery Level characteristic in database */
             g_batt_data.level = cur_bat_level;
 
@@ -367,13 +521,41 @@ extern void BatteryUpdateLevel(uint16 ucid)
 }
 
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BatteryGetLevel
+ *
+ *  DESCRIPTION
+ *      This function returns the battery level of the last voltage sample 
+ *      taken by BatteryUpdateLevel() or a read of the Battery Level 
+ *      characteristic, without sampling the voltage again, so that it can 
+ *      be sent with every key report. The voltage is only sampled here if 
+ *      it has not been since the chip reset.
+ *
+ *  RETURNS
+ *      uint8 - Battery Level in percent
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint8 BatteryGetLevel(void)
+{
+    if(g_batt_data.voltage_ewma == 0)
+    {
+        /* Nothing sampled yet */
+        return readBatteryLevel();
+    }
+
+    return g_batt_data.sampled_level;
+}
+
+
 /*----------------------------------------------------------------------------*
  *  NAME
  *      BatteryReadDataFromNVM
  *
  *  DESCRIPTION
- *      This function is used to read battery service specific data stored in 
- *      NVM
+ *      This function is used to skip the NVM words reserved for battery 
+ *      service. The client configuration is read with the bond table.
  *
  *  RETURNS
  *      Nothing.
@@ -383,18 +565,6 @@ extern void BatteryUpdateLevel(uint16 ucid)
 extern void BatteryReadDataFromNVM(uint16 *p_offset)
 {
 
-    g_batt_data.nvm_offset = *p_offset;
-
-    /* Read NVM only if devices are bonded */
-    if(AppIsDeviceBonded())
-    {
-        /* Read battery level client configuration descriptor */
-        Nvm_Read((uint16*)&g_batt_data.level_client_config,
-                 sizeof(g_batt_data.level_client_config),
-                 *p_offset + 
-                 BATTERY_NVM_LEVEL_CLIENT_CONFIG_OFFSET);
-    }
-
     /* Increment the offset by the number of words of NVM memory required 
      * by battery service 
      */
@@ -440,42 +610,10 @@ extern bool BatteryCheckHandleRange(uint16 handle)
 extern void BatteryBondingNotify(void)
 {
 
-    /* Write data to NVM if bond is established */
-    if(AppIsDeviceBonded())
-    {
-        /* Write to NVM the client configuration value of battery level 
-         * that was configured prior to bonding 
-         */
-        Nvm_Write((uint16*)&g_batt_data.level_client_config, 
-                  sizeof(g_batt_data.level_client_config), 
-                  g_batt_data.nvm_offset + 
-                  BATTERY_NVM_LEVEL_CLIENT_CONFIG_OFFSET);
-    }
-
-}
-
-#ifdef NVM_TYPE_FLASH
-/*----------------------------------------------------------------------------*
- *  NAME
- *      WriteBatteryServiceDataInNvm
- *
- *  DESCRIPTION
- *      This function writes Battery service data in NVM
- *
- *  RETURNS
- *      Nothing.
- *
- *---------------------------------------------------------------------------*/
-
-extern void WriteBatteryServiceDataInNvm(void)
-{
-    /* Write to NVM the client configuration value of battery level 
-     * that was configured prior to bonding 
+    /* Store with the new bond the client configuration value of battery 
+     * level that was configured prior to bonding 
      */
-    Nvm_Write((uint16*)&g_batt_data.level_client_config, 
-                  sizeof(g_batt_data.level_client_config), 
-                  g_batt_data.nvm_offset + 
-                  BATTERY_NVM_LEVEL_CLIENT_CONFIG_OFFSET);
-}
-#endif /* NVM_TYPE_FLASH */
+    BondTableSetClientConfig(bond_cccd_batt_level, 
+                             g_batt_data.level_client_config);
 
+}
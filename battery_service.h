@@ -21,6 +21,16 @@
 #include <types.h>
 #include <bt_event_types.h>
 
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Number of words of NVM memory reserved for Battery service. The battery 
+ * level client configuration used to be stored there, it is now stored for 
+ * each bond by the bond table.
+ */
+#define BATTERY_SERVICE_NVM_MEMORY_WORDS              (1)
+
 /*============================================================================*
  *  Public Function Prototypes
  *============================================================================*/
@@ -49,7 +59,8 @@ extern void BatteryHandleAccessWrite(GATT_ACCESS_IND_T *p_ind);
  */
 extern void BatteryUpdateLevel(uint16 ucid);
 
-extern uint8 readBatteryLevel(void);
+/* This function returns the battery level last sampled */
+extern uint8 BatteryGetLevel(void);
 
 /* This function is used to read battery service specific data stored in 
  * NVM
@@ -66,9 +77,4 @@ extern bool BatteryCheckHandleRange(uint16 handle);
  */
 extern void BatteryBondingNotify(void);
 
-#ifdef NVM_TYPE_FLASH
-/* This function writes Battery service data in NVM */
-extern void WriteBatteryServiceDataInNvm(void);
-#endif /* NVM_TYPE_FLASH */
-
 #endif /* __BATT_SERVICE_H__ */
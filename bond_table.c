@@ -0,0 +1,777 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      bond_table.c
+ *
+ *  DESCRIPTION
+ *      This file defines the table of central devices the application is
+ *      bonded with. Each bond holds the address, diversifier and IRK of the
+ *      central device and the client configurations it wrote. Up to
+ *      MAX_BONDED_DEVICES bonds are kept, the least recently used one is
+ *      evicted to make room for a new one. Once there are bonds, a new one
+ *      can only be made in the pairing window (see PAIRING_WINDOW_TIME).
+ *
+ *      Each bond is stored in NVM as a separate record group, so a corrupt
+ *      entry only loses that bond. The IRKs of the bonds using resolvable
+ *      random addresses are also kept packed in RAM, so that a reconnecting
+ *      central device is resolved against all of them with a single
+ *      SMPrivacyMatchAddress() call.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <mem.h>
+#include <ls_app_if.h>
+#include <security.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+#include "bond_table.h"
+#include "health_thermometer.h"
+#include "ht_gatt.h"
+#include "nvm_access.h"
+#include "app_perf.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Layout version of the bond entry record groups */
+#define BOND_TABLE_VERSION                  (1)
+
+/* Highest LRU stamp, the stamps are renumbered when it is reached */
+#define BOND_TABLE_MAX_STAMP                (0xffff)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Bond table data type */
+typedef struct
+{
+    /* Bond entries */
+    BOND_ENTRY_T            entries[MAX_BONDED_DEVICES];
+
+    /* IRKs of the bonds using resolvable random addresses, packed for
+     * SMPrivacyMatchAddress()
+     */
+    uint16                  irks[MAX_BONDED_DEVICES * MAX_WORDS_IRK];
+
+    /* Index of the bond each IRK in irks belongs to */
+    uint16                  irk_bond[MAX_BONDED_DEVICES];
+
+    /* Number of IRKs in irks */
+    uint16                  num_irks;
+
+    /* Last LRU stamp issued */
+    uint16                  clock;
+
+    /* Bond of the connected central device, BOND_TABLE_INVALID if the
+     * central device is not bonded
+     */
+    uint16                  active;
+
+    /* NVM offset at which the bond table is stored */
+    uint16                  nvm_offset;
+
+} BOND_TABLE_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Bond table instance */
+static BOND_TABLE_T g_bond_table;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static bool bondEntryInUse(uint16 index);
+static bool bondEntryResolvable(uint16 index);
+static void bondTableWriteEntry(uint16 index);
+static void bondTableBuildIrkList(void);
+static void bondTableRenumber(void);
+static void bondTableStamp(uint16 index);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      bondEntryInUse
+ *
+ *  DESCRIPTION
+ *      This function checks whether a bond entry holds a bond.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if the entry is in use.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool bondEntryInUse(uint16 index)
+{
+    return (g_bond_table.entries[index].last_used != 0);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      bondEntryResolvable
+ *
+ *  DESCRIPTION
+ *      This function checks whether a bond was made with a resolvable random
+ *      address, in which case the central device is identified by its IRK.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if the bond uses a resolvable random address.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool bondEntryResolvable(uint16 index)
+{
+    return GattIsAddressResolvableRandom(&g_bond_table.entries[index].addr);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      bondTableWriteEntry
+ *
+ *  DESCRIPTION
+ *      This function writes a bond entry to NVM.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void bondTableWriteEntry(uint16 index)
+{
+    Nvm_WriteGroup((uint16*)&g_bond_table.entries[index],
+                   sizeof(BOND_ENTRY_T),
+                   g_bond_table.nvm_offset +
+                   (index * BOND_TABLE_ENTRY_NVM_WORDS),
+                   BOND_TABLE_VERSION);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      bondTableBuildIrkList
+ *
+ *  DESCRIPTION
+ *      This function packs the IRKs of the bonds using resolvable random
+ *      addresses. It is called whenever a bond is added or removed.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void bondTableBuildIrkList(void)
+{
+    uint16 index;
+
+    g_bond_table.num_irks = 0;
+
+    for(index = 0; index < MAX_BONDED_DEVICES; index ++)
+    {
+        if(bondEntryInUse(index) && bondEntryResolvable(index))
+        {
+            MemCopy(&g_bond_table.irks[g_bond_table.num_irks * MAX_WORDS_IRK],
+                    g_bond_table.entries[index].irk,
+                    MAX_WORDS_IRK);
+
+            g_bond_table.irk_bond[g_bond_table.num_irks ++] = index;
+        }
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      bondTableRenumber
+ *
+ *  DESCRIPTION
+ *      This function renumbers the LRU stamps of the bonds from 1 upwards,
+ *      keeping their order, once the stamps have run out.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void bondTableRenumber(void)
+{
+    uint16 rank[MAX_BONDED_DEVICES];
+    uint16 index;
+    uint16 other;
+
+    for(index = 0; index < MAX_BONDED_DEVICES; index ++)
+    {
+        rank[index] = 1;
+
+        for(other = 0; other < MAX_BONDED_DEVICES; other ++)
+        {
+            if(bondEntryInUse(other) &&
+               (g_bond_table.entries[other].last_used <
+                g_bond_table.entries[index].last_used))
+            {
+                ++ rank[index];
+            }
+        }
+    }
+
+    g_bond_table.clock = 0;
+
+    Nvm_BeginBatch();
+
+    for(index = 0; index < MAX_BONDED_DEVICES; index ++)
+    {
+        if(bondEntryInUse(index))
+        {
+            g_bond_table.entries[index].last_used = rank[index];
+            bondTableWriteEntry(index);
+
+            if(rank[index] > g_bond_table.clock)
+            {
+                g_bond_table.clock = rank[index];
+            }
+        }
+    }
+
+    Nvm_EndBatch();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      bondTableStamp
+ *
+ *  DESCRIPTION
+ *      This function gives a bond the next LRU stamp. The entry is not
+ *      written to NVM.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void bondTableStamp(uint16 index)
+{
+    if(g_bond_table.clock == BOND_TABLE_MAX_STAMP)
+    {
+        bondTableRenumber();
+    }
+
+    g_bond_table.entries[index].last_used = ++ g_bond_table.clock;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BondTableReadDataFromNVM
+ *
+ *  DESCRIPTION
+ *      This function reads the bond table from NVM and updates the offset
+ *      with the number of words of NVM used by the table. An entry that
+ *      fails its CRC check is dropped.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void BondTableReadDataFromNVM(uint16 *p_offset)
+{
+    BOND_ENTRY_T *p_entry;
+    uint16 index;
+
+    g_bond_table.nvm_offset = *p_offset;
+    g_bond_table.active = BOND_TABLE_INVALID;
+    g_bond_table.clock = 0;
+
+    for(index = 0; index < MAX_BONDED_DEVICES; index ++)
+    {
+        p_entry = &g_bond_table.entries[index];
+
+        if(!Nvm_ReadGroup((uint16*)p_entry, sizeof(BOND_ENTRY_T),
+                          *p_offset + (index * BOND_TABLE_ENTRY_NVM_WORDS),
+                          BOND_TABLE_VERSION))
+        {
+            MemSet(p_entry, 0, sizeof(BOND_ENTRY_T));
+        }
+
+        if(p_entry->last_used > g_bond_table.clock)
+        {
+            g_bond_table.clock = p_entry->last_used;
+        }
+    }
+
+    bondTableBuildIrkList();
+
+    *p_offset += BOND_TABLE_NVM_MEMORY_WORDS;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BondTableInitWriteDataToNVM
+ *
+ *  DESCRIPTION
+ *      This function writes an empty bond table to NVM for the first time
+ *      and updates the offset with the number of words of NVM used by the
+ *      table.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void BondTableInitWriteDataToNVM(uint16 *p_offset)
+{
+    uint16 index;
+
+    g_bond_table.nvm_offset = *p_offset;
+    g_bond_table.active = BOND_TABLE_INVALID;
+    g_bond_table.clock = 0;
+
+    MemSet(g_bond_table.entries, 0, sizeof(g_bond_table.entries));
+
+    Nvm_BeginBatch();
+
+    for(index = 0; index < MAX_BONDED_DEVICES; index ++)
+    {
+        bondTableWriteEntry(index);
+    }
+
+    Nvm_EndBatch();
+
+    bondTableBuildIrkList();
+
+    *p_offset += BOND_TABLE_NVM_MEMORY_WORDS;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BondTableFind
+ *
+ *  DESCRIPTION
+ *      This function looks up a central device in the bond table. A
+ *      resolvable random address is resolved against the IRKs of all the
+ *      bonds with a single SMPrivacyMatchAddress() call, any other address
+ *      is compared with the addresses of the bonds.
+ *
+ *  RETURNS
+ *      Index of the bond, BOND_TABLE_INVALID if the device is not bonded.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint16 BondTableFind(TYPED_BD_ADDR_T *p_addr)
+{
+    int16 match;
+    uint16 index;
+
+    if(GattIsAddressResolvableRandom(p_addr))
+    {
+        if(g_bond_table.num_irks == 0)
+        {
+            return BOND_TABLE_INVALID;
+        }
+
+        match = SMPrivacyMatchAddress(p_addr, g_bond_table.irks,
+                                      g_bond_table.num_irks, MAX_WORDS_IRK);
+
+        return (match < 0) ? BOND_TABLE_INVALID :
+                             g_bond_table.irk_bond[match];
+    }
+
+    for(index = 0; index < MAX_BONDED_DEVICES; index ++)
+    {
+        if(bondEntryInUse(index) && !bondEntryResolvable(index) &&
+           (MemCmp(&g_bond_table.entries[index].addr, p_addr,
+                   sizeof(TYPED_BD_ADDR_T)) == 0))
+        {
+            return index;
+        }
+    }
+
+    return BOND_TABLE_INVALID;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BondTableFindDiversifier
+ *
+ *  DESCRIPTION
+ *      This function looks up the bond to which a diversifier was issued.
+ *      It is used to approve the encryption requests of bonded devices.
+ *
+ *  RETURNS
+ *      Index of the bond, BOND_TABLE_INVALID if no bond holds the
+ *      diversifier.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint16 BondTableFindDiversifier(uint16 diversifier)
+{
+    uint16 index;
+
+    for(index = 0; index < MAX_BONDED_DEVICES; index ++)
+    {
+        if(bondEntryInUse(index) &&
+           (g_bond_table.entries[index].diversifier == diversifier))
+        {
+            return index;
+        }
+    }
+
+    return BOND_TABLE_INVALID;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BondTableAdd
+ *
+ *  DESCRIPTION
+ *      This function adds a newly bonded central device to the bond table
+ *      and makes it the connected bond. If the connected device was already
+ *      bonded its entry is replaced. Otherwise a free entry is used if there
+ *      is one, or else the least recently used bond is evicted. The IRK is
+ *      only needed if the device uses a resolvable random address.
+ *
+ *  RETURNS
+ *      Index of the new bond.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint16 BondTableAdd(TYPED_BD_ADDR_T *p_addr, uint16 diversifier,
+                           uint16 *p_irk)
+{
+    BOND_ENTRY_T *p_entry;
+    uint16 index;
+    uint16 chosen = 0;
+    uint16 cccd;
+
+    if(g_bond_table.active != BOND_TABLE_INVALID)
+    {
+        /* Bonding again, replace the previous bond */
+        chosen = g_bond_table.active;
+    }
+    else
+    {
+        for(index = 0; index < MAX_BONDED_DEVICES; index ++)
+        {
+            if(!bondEntryInUse(index))
+            {
+                /* Free entry */
+                chosen = index;
+                break;
+            }
+
+            if(g_bond_table.entries[index].last_used <
+               g_bond_table.entries[chosen].last_used)
+            {
+                chosen = index;
+            }
+        }
+
+        if(bondEntryInUse(chosen))
+        {
+            /* Only possible in the pairing window, see PAIRING_WINDOW_TIME */
+            APP_PERF_INC(app_perf_bond_evictions);
+        }
+    }
+
+    p_entry = &g_bond_table.entries[chosen];
+
+    p_entry->addr = *p_addr;
+    p_entry->diversifier = diversifier;
+
+    if(p_irk != NULL)
+    {
+        MemCopy(p_entry->irk, p_irk, MAX_WORDS_IRK);
+    }
+    else
+    {
+        MemSet(p_entry->irk, 0, MAX_WORDS_IRK);
+    }
+
+    for(cccd = 0; cccd < bond_cccd_max; cccd ++)
+    {
+        p_entry->client_config[cccd] = gatt_client_config_none;
+    }
+
+    bondTableStamp(chosen);
+    bondTableWriteEntry(chosen);
+
+    bondTableBuildIrkList();
+
+    g_bond_table.active = chosen;
+
+    return chosen;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BondTableRemoveAll
+ *
+ *  DESCRIPTION
+ *      This function removes all the bonds from the table and from NVM.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void BondTableRemoveAll(void)
+{
+    uint16 index;
+
+    Nvm_BeginBatch();
+
+    for(index = 0; index < MAX_BONDED_DEVICES; index ++)
+    {
+        if(bondEntryInUse(index))
+        {
+            MemSet(&g_bond_table.entries[index], 0, sizeof(BOND_ENTRY_T));
+            bondTableWriteEntry(index);
+        }
+    }
+
+    Nvm_EndBatch();
+
+    bondTableBuildIrkList();
+
+    g_bond_table.active = BOND_TABLE_INVALID;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BondTableSetActive
+ *
+ *  DESCRIPTION
+ *      This function sets the bond of the connected central device, once it
+ *      has been identified. BOND_TABLE_INVALID is set for a central device
+ *      which is not bonded and on disconnection.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void BondTableSetActive(uint16 index)
+{
+    g_bond_table.active = index;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BondTableGetActive
+ *
+ *  DESCRIPTION
+ *      This function returns the bond of the connected central device.
+ *
+ *  RETURNS
+ *      Index of the bond, BOND_TABLE_INVALID if the connected device is not
+ *      bonded.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint16 BondTableGetActive(void)
+{
+    return g_bond_table.active;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BondTableTouch
+ *
+ *  DESCRIPTION
+ *      This function marks the bond of the connected central device as the
+ *      most recently used one. Nothing is written if it already was, so a
+ *      central device reconnecting over and over does not wear the NVM.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void BondTableTouch(void)
+{
+    uint16 index = g_bond_table.active;
+
+    if((index != BOND_TABLE_INVALID) &&
+       (g_bond_table.entries[index].last_used != g_bond_table.clock))
+    {
+        bondTableStamp(index);
+        bondTableWriteEntry(index);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BondTableCount
+ *
+ *  DESCRIPTION
+ *      This function returns the number of bonds held in the table.
+ *
+ *  RETURNS
+ *      Number of bonds.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint16 BondTableCount(void)
+{
+    uint16 index;
+    uint16 count = 0;
+
+    for(index = 0; index < MAX_BONDED_DEVICES; index ++)
+    {
+        if(bondEntryInUse(index))
+        {
+            ++ count;
+        }
+    }
+
+    return count;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BondTableGetClientConfig
+ *
+ *  DESCRIPTION
+ *      This function returns a client configuration written by the connected
+ *      bonded central device.
+ *
+ *  RETURNS
+ *      The client configuration, gatt_client_config_none if the connected
+ *      device is not bonded.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern gatt_client_config BondTableGetClientConfig(bond_cccd cccd)
+{
+    if(g_bond_table.active == BOND_TABLE_INVALID)
+    {
+        return gatt_client_config_none;
+    }
+
+    return (gatt_client_config)
+            g_bond_table.entries[g_bond_table.active].client_config[cccd];
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BondTableSetClientConfig
+ *
+ *  DESCRIPTION
+ *      This function stores a client configuration written by the connected
+ *      central device, if it is bonded. The bond is only written to NVM if
+ *      the configuration has changed.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void BondTableSetClientConfig(bond_cccd cccd,
+                                     gatt_client_config client_config)
+{
+    BOND_ENTRY_T *p_entry;
+
+    if(g_bond_table.active == BOND_TABLE_INVALID)
+    {
+        return;
+    }
+
+    p_entry = &g_bond_table.entries[g_bond_table.active];
+
+    if(p_entry->client_config[cccd] != (uint16)client_config)
+    {
+        p_entry->client_config[cccd] = (uint16)client_config;
+        bondTableWriteEntry(g_bond_table.active);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BondTablePopulateWhiteList
+ *
+ *  DESCRIPTION
+ *      This function resets the white list and adds the addresses of all the
+ *      bonds which do not use resolvable random addresses. It must not be
+ *      called while advertising with the white list.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void BondTablePopulateWhiteList(void)
+{
+    uint16 index;
+
+    LsResetWhiteList();
+
+    for(index = 0; index < MAX_BONDED_DEVICES; index ++)
+    {
+        /* It is important to note that this application doesn't support
+         * reconnection address. In future, if the application is enhanced
+         * to support Reconnection Address, make sure that we don't add
+         * reconnection address to white list
+         */
+        if(bondEntryInUse(index) && !bondEntryResolvable(index) &&
+           (LsAddWhiteListDevice(&g_bond_table.entries[index].addr) !=
+            ls_err_none))
+        {
+            ReportPanic(app_panic_add_whitelist);
+        }
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BondTableWhiteListUsable
+ *
+ *  DESCRIPTION
+ *      This function checks whether advertising can be restricted to the
+ *      white list: there must be bonds, and none of them may use a
+ *      resolvable random address as the white list cannot hold those.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if the white list can be used.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool BondTableWhiteListUsable(void)
+{
+    return (BondTableCount() != 0) && (g_bond_table.num_irks == 0);
+}
@@ -0,0 +1,155 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      bond_table.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the table of bonded central devices
+ *
+ *****************************************************************************/
+
+#ifndef __BOND_TABLE_H__
+#define __BOND_TABLE_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <bluetooth.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "app_gatt.h"
+#include "user_config.h"
+#include "nvm_access.h"
+#include "health_thermometer.h"
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Index returned when no bond matches */
+#define BOND_TABLE_INVALID                  (0xffff)
+
+/* Number of words of NVM used by a bond entry */
+#define BOND_TABLE_ENTRY_NVM_WORDS          (NVM_GROUP_HEADER_WORDS + \
+                                             sizeof(BOND_ENTRY_T))
+
+/* Number of words of NVM memory used by the bond table */
+#define BOND_TABLE_NVM_MEMORY_WORDS         (BOND_TABLE_ENTRY_NVM_WORDS * \
+                                             MAX_BONDED_DEVICES)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Client characteristic configurations stored for each bond */
+typedef enum
+{
+    /* Temperature Measurement characteristic of Health Thermometer service */
+    bond_cccd_temp_meas = 0,
+
+    /* Battery Level characteristic of Battery service */
+    bond_cccd_batt_level,
+
+#ifdef ENABLE_HID_MODE
+    /* Keyboard, counters and boot keyboard input reports of HID service */
+    bond_cccd_hid_keys,
+    bond_cccd_hid_counters,
+    bond_cccd_hid_boot_keys,
+#endif /* ENABLE_HID_MODE */
+
+    /* Number of client configurations. This must always be the last entry
+     * as it is used to size the bond entries.
+     */
+    bond_cccd_max
+
+} bond_cccd;
+
+/* Bond entry, stored as is in NVM */
+typedef struct
+{
+    /* Typed address the central device bonded with */
+    TYPED_BD_ADDR_T         addr;
+
+    /* Diversifier of the LTK distributed to the central device */
+    uint16                  diversifier;
+
+    /* IRK of the central device. Only used if it bonded with a resolvable
+     * random address.
+     */
+    uint16                  irk[MAX_WORDS_IRK];
+
+    /* Client configurations written by the central device, indexed by
+     * bond_cccd
+     */
+    uint16                  client_config[bond_cccd_max];
+
+    /* LRU stamp, higher for more recently used bonds. Zero if the entry is
+     * free.
+     */
+    uint16                  last_used;
+
+} BOND_ENTRY_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* This function reads the bond table from NVM */
+extern void BondTableReadDataFromNVM(uint16 *p_offset);
+
+/* This function writes an empty bond table to NVM */
+extern void BondTableInitWriteDataToNVM(uint16 *p_offset);
+
+/* This function looks up a central device in the bond table */
+extern uint16 BondTableFind(TYPED_BD_ADDR_T *p_addr);
+
+/* This function looks up the bond to which a diversifier was issued */
+extern uint16 BondTableFindDiversifier(uint16 diversifier);
+
+/* This function adds a newly bonded central device to the bond table,
+ * evicting the least recently used bond if the table is full
+ */
+extern uint16 BondTableAdd(TYPED_BD_ADDR_T *p_addr, uint16 diversifier,
+                           uint16 *p_irk);
+
+/* This function removes all the bonds */
+extern void BondTableRemoveAll(void);
+
+/* This function sets the bond of the connected central device */
+extern void BondTableSetActive(uint16 index);
+
+/* This function returns the bond of the connected central device */
+extern uint16 BondTableGetActive(void);
+
+/* This function marks the bond of the connected central device as the most
+ * recently used one
+ */
+extern void BondTableTouch(void);
+
+/* This function returns the number of bonds held in the table */
+extern uint16 BondTableCount(void);
+
+/* This function returns a client configuration of the connected bond */
+extern gatt_client_config BondTableGetClientConfig(bond_cccd cccd);
+
+/* This function stores a client configuration of the connected bond */
+extern void BondTableSetClientConfig(bond_cccd cccd,
+                                     gatt_client_config client_config);
+
+/* This function adds all the bonds using a fixed address to the white list */
+extern void BondTablePopulateWhiteList(void);
+
+/* This function returns TRUE if all the bonded devices can be found through
+ * the white list
+ */
+extern bool BondTableWhiteListUsable(void);
+
+#endif /* __BOND_TABLE_H__ */
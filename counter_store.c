@@ -0,0 +1,403 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      counter_store.c
+ *
+ *  DESCRIPTION
+ *      This file defines routines used to checkpoint the GHG, BP and send
+ *      counters to NVM, so that they resume from where they were after a
+ *      reset.
+ *
+ *      Checkpoints are written to a ring of NVM slots in turn, which spreads
+ *      the wear over COUNTER_CHECKPOINT_SLOTS locations. A checkpoint is
+ *      written every COUNTER_CHECKPOINT_INTERVAL increments, on every
+ *      increment while the battery is low and at disconnection. A slot
+ *      written while counting goes on is marked open: if the newest slot is
+ *      open at start-up, increments counted after it may have been lost.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+#include "nvm_access.h"
+#include "counter_store.h"
+#include "ht_hw.h"
+#include "health_thermo_service.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Flag set in the send word of a slot written while counting goes on */
+#define COUNTER_SLOT_OPEN               (0x0100)
+
+/* Mask of the send count in the send word of a slot */
+#define COUNTER_SLOT_SEND_MASK          (0x00ff)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Counter store data type */
+typedef struct
+{
+    /* Boolean flag set once the NVM offset of the checkpoints is known */
+    bool                    nvm_ready;
+
+    /* NVM offset at which the checkpoint slots are stored */
+    uint16                  nvm_offset;
+
+    /* Index and sequence number of the newest slot */
+    uint16                  slot;
+    uint16                  sequence;
+
+    /* Number of increments since the newest slot was written */
+    uint16                  pending;
+
+    /* Boolean flag set if the newest slot is open */
+    bool                    open;
+
+    /* Boolean flag set while the battery is low */
+    bool                    low_battery;
+
+    /* Boolean flag set if increments may have been lost by the last reset */
+    bool                    possibly_lost;
+
+} COUNTER_STORE_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Counter store data instance */
+static COUNTER_STORE_DATA_T g_counter_store;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static bool counterSlotValid(const COUNTER_SLOT_T *p_slot);
+static void counterStoreWrite(bool open);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      counterSlotValid
+ *
+ *  DESCRIPTION
+ *      This function checks whether a checkpoint slot read from NVM has been
+ *      completely written.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if the slot is valid.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool counterSlotValid(const COUNTER_SLOT_T *p_slot)
+{
+    return ((p_slot->check ^ p_slot->sequence) == 0xffff);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      counterStoreWrite
+ *
+ *  DESCRIPTION
+ *      This function writes the current counter values to the slot
+ *      following the newest one.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void counterStoreWrite(bool open)
+{
+    COUNTER_SLOT_T slot;
+
+    if(!g_counter_store.nvm_ready)
+    {
+        return;
+    }
+
+    g_counter_store.slot = (g_counter_store.slot + 1) %
+                                                COUNTER_CHECKPOINT_SLOTS;
+    ++ g_counter_store.sequence;
+
+    slot.sequence = g_counter_store.sequence;
+    slot.counts = ((uint16)ghg_count << 8) | bp_count;
+    slot.send = send_count | (open ? COUNTER_SLOT_OPEN : 0);
+    slot.check = (uint16)~slot.sequence;
+
+    Nvm_Write((uint16*)&slot, sizeof(slot),
+              g_counter_store.nvm_offset +
+              (g_counter_store.slot * sizeof(COUNTER_SLOT_T)));
+
+    g_counter_store.pending = 0;
+    g_counter_store.open = open;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CounterStoreReadDataFromNVM
+ *
+ *  DESCRIPTION
+ *      This function restores the counters from the newest valid checkpoint
+ *      slot and updates the offset with the number of words of NVM used by
+ *      the checkpoints. If no slot is valid the counters start from zero
+ *      and are flagged as possibly lost.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void CounterStoreReadDataFromNVM(uint16 *p_offset)
+{
+    COUNTER_SLOT_T slots[COUNTER_CHECKPOINT_SLOTS];
+    COUNTER_SLOT_T *p_newest = NULL;
+    uint16 index;
+    uint16 next;
+
+    g_counter_store.nvm_offset = *p_offset;
+    g_counter_store.nvm_ready = TRUE;
+
+    Nvm_Read((uint16*)slots, sizeof(slots), *p_offset);
+
+    for(index = 0; index < COUNTER_CHECKPOINT_SLOTS; index ++)
+    {
+        if(!counterSlotValid(&slots[index]))
+        {
+            continue;
+        }
+
+        next = (index + 1) % COUNTER_CHECKPOINT_SLOTS;
+
+        if(!counterSlotValid(&slots[next]) ||
+           (slots[next].sequence != (uint16)(slots[index].sequence + 1)))
+        {
+            p_newest = &slots[index];
+            break;
+        }
+    }
+
+    if(p_newest != NULL)
+    {
+        g_counter_store.slot = index;
+        g_counter_store.sequence = p_newest->sequence;
+
+        ghg_count = (uint8)(p_newest->counts >> 8);
+        bp_count = (uint8)(p_newest->counts & 0xff);
+        send_count = (uint8)(p_newest->send & COUNTER_SLOT_SEND_MASK);
+
+        g_counter_store.possibly_lost =
+                            ((p_newest->send & COUNTER_SLOT_OPEN) != 0);
+    }
+    else
+    {
+        /* Fresh NVM or checkpoints never written */
+        g_counter_store.slot = COUNTER_CHECKPOINT_SLOTS - 1;
+        g_counter_store.sequence = 0;
+
+        ghg_count = 0;
+        bp_count = 0;
+        send_count = 0;
+
+        g_counter_store.possibly_lost = TRUE;
+    }
+
+    /* The next increment opens a new slot */
+    g_counter_store.pending = 0;
+    g_counter_store.open = FALSE;
+
+    *p_offset += COUNTER_STORE_NVM_MEMORY_WORDS;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CounterStoreIncrement
+ *
+ *  DESCRIPTION
+ *      This function is called each time one of the counters is
+ *      incremented.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void CounterStoreIncrement(void)
+{
+    CounterStoreAdd(1);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CounterStoreAdd
+ *
+ *  DESCRIPTION
+ *      This function is called when the counters have been incremented
+ *      'increments' times in all. The first increment after a closed
+ *      checkpoint writes an open one straight away, so that a reset is known
+ *      to have lost counts. Further increments are checkpointed every
+ *      COUNTER_CHECKPOINT_INTERVAL increments, or at once while the battery
+ *      is low.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void CounterStoreAdd(uint16 increments)
+{
+    if(increments == 0)
+    {
+        return;
+    }
+
+    g_counter_store.pending += increments;
+
+    if(!g_counter_store.open || g_counter_store.low_battery ||
+       (g_counter_store.pending >= COUNTER_CHECKPOINT_INTERVAL))
+    {
+        counterStoreWrite(TRUE);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CounterStoreCheckpoint
+ *
+ *  DESCRIPTION
+ *      This function writes a closed checkpoint if counting has gone on
+ *      since the last one. It is called where counting is expected to
+ *      pause, such as a disconnection.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void CounterStoreCheckpoint(void)
+{
+    if(g_counter_store.open)
+    {
+        counterStoreWrite(FALSE);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CounterStoreSetLowBattery
+ *
+ *  DESCRIPTION
+ *      This function sets whether the battery is low. While it is, every
+ *      increment is checkpointed as the device may lose power at any time.
+ *      Increments not checkpointed yet are written when the battery gets
+ *      low.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void CounterStoreSetLowBattery(bool low_battery)
+{
+    if(low_battery && !g_counter_store.low_battery &&
+       (g_counter_store.pending != 0))
+    {
+        counterStoreWrite(TRUE);
+    }
+
+    g_counter_store.low_battery = low_battery;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CounterStorePossiblyLost
+ *
+ *  DESCRIPTION
+ *      This function tells whether increments counted before the last reset
+ *      may not have been checkpointed, in which case the counters resumed
+ *      from a value lower than the one the host last saw.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if increments may have been lost.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool CounterStorePossiblyLost(void)
+{
+    return g_counter_store.possibly_lost;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CounterStoreClearLost
+ *
+ *  DESCRIPTION
+ *      This function clears the possibly lost flag, once the host has
+ *      reconciled the counters.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void CounterStoreClearLost(void)
+{
+    g_counter_store.possibly_lost = FALSE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CounterStoreReset
+ *
+ *  DESCRIPTION
+ *      This function resets the GHG, BP and send counts to zero at the
+ *      request of the host, and writes a closed checkpoint of them straight
+ *      away so that a reset does not bring the old counts back. Any lost
+ *      counts no longer matter.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void CounterStoreReset(void)
+{
+    ghg_count = 0;
+    bp_count = 0;
+    send_count = 0;
+
+    g_counter_store.possibly_lost = FALSE;
+
+    counterStoreWrite(FALSE);
+}
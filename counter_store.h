@@ -0,0 +1,99 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      counter_store.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the NVM checkpoints of the GHG, BP and send
+ *      counters
+ *
+ *****************************************************************************/
+
+#ifndef __COUNTER_STORE_H__
+#define __COUNTER_STORE_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Number of words of NVM memory used by the counter checkpoints */
+#define COUNTER_STORE_NVM_MEMORY_WORDS  (sizeof(COUNTER_SLOT_T) * \
+                                         COUNTER_CHECKPOINT_SLOTS)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Checkpoint slot, stored as is in NVM. The check word is written last, so
+ * a slot cut short by a power failure fails the check.
+ */
+typedef struct
+{
+    /* Incremented for each checkpoint, the newest slot is the one that is
+     * not followed by the next sequence number
+     */
+    uint16                  sequence;
+
+    /* GHG count (high octet) and BP count (low octet) */
+    uint16                  counts;
+
+    /* Send count (low octet) and COUNTER_SLOT_OPEN */
+    uint16                  send;
+
+    /* One's complement of the sequence number */
+    uint16                  check;
+
+} COUNTER_SLOT_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* This function restores the counters from the last checkpoint in NVM */
+extern void CounterStoreReadDataFromNVM(uint16 *p_offset);
+
+/* This function is called each time one of the counters is incremented */
+extern void CounterStoreIncrement(void);
+
+/* This function is called when the counters have been incremented several
+ * times at once
+ */
+extern void CounterStoreAdd(uint16 increments);
+
+/* This function writes a checkpoint at a point where counting is expected
+ * to pause, such as a disconnection
+ */
+extern void CounterStoreCheckpoint(void);
+
+/* This function sets whether the battery is low, in which case every
+ * increment is checkpointed
+ */
+extern void CounterStoreSetLowBattery(bool low_battery);
+
+/* This function returns TRUE if increments may have been lost by the reset
+ * before the counters were restored
+ */
+extern bool CounterStorePossiblyLost(void);
+
+/* This function clears the flag returned by CounterStorePossiblyLost() */
+extern void CounterStoreClearLost(void);
+
+/* This function resets the counters to zero and checkpoints them */
+extern void CounterStoreReset(void);
+
+#endif /* __COUNTER_STORE_H__ */
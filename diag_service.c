@@ -0,0 +1,763 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      diag_service.c
+ *
+ *  DESCRIPTION
+ *      This file defines routines for using the vendor specific Diagnostics 
+ *      service.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <gatt.h>
+#include <gatt_prim.h>
+#include <buf_utils.h>
+#include <mem.h>
+#include <time.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "app_gatt.h"
+#include "diag_service.h"
+#include "app_gatt_db.h"
+#include "nvm_access.h"
+#include "app_trace.h"
+#include "app_perf.h"
+#include "counter_store.h"
+#include "ht_hw.h"
+#include "health_thermo_service.h"
+#include "signal_seq.h"
+#include "tx_power.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Commands written to the Trace characteristic */
+#define DIAG_TRACE_CMD_DUMP                 (0x01)
+#define DIAG_TRACE_CMD_CLEAR                (0x02)
+
+/* Command written to the Counters characteristic */
+#define DIAG_COUNTERS_CMD_RESET             (0x00)
+
+/* Command written to the Counter State characteristic */
+#define DIAG_COUNTER_STATE_CMD_CLEAR        (0x00)
+
+/* Commands written to the Command characteristic, in the first octet */
+#define DIAG_CMD_BEEP                       (0x01)
+#define DIAG_CMD_SIGNAL_PATTERN             (0x02)
+#define DIAG_CMD_COUNTER_RESET              (0x03)
+#define DIAG_CMD_SNAPSHOT                   (0x04)
+#define DIAG_CMD_REPORT_MODE                (0x05)
+
+/* Values of the first word of the panic record in NVM. Any other value 
+ * means that no panic has ever been recorded.
+ */
+#define DIAG_PANIC_RECORD_NEW               (0xDA01)
+#define DIAG_PANIC_RECORD_READ              (0xDA00)
+
+/* The offset of data being stored in NVM for Diagnostics service. This 
+ * offset is added to Diagnostics service offset to NVM region (see 
+ * g_diag_data.nvm_offset) to get the absolute offset at which this data is 
+ * stored in NVM
+ */
+#define DIAG_NVM_PANIC_RECORD_OFFSET        (0)
+
+/* Size of the Panic Record characteristic value: valid flag (1 octet), panic
+ * code (2 octets), application state (1 octet), last LM event (2 octets),
+ * time stamp (4 octets) and reset counter (2 octets)
+ */
+#define DIAG_PANIC_RECORD_OCTETS            (12)
+
+/* Size of the Counter State characteristic value: possibly lost flag, GHG 
+ * count, BP count and send count (1 octet each)
+ */
+#define DIAG_COUNTER_STATE_OCTETS           (4)
+
+/* Size of the Counters characteristic value, two octets per counter */
+#define DIAG_COUNTERS_OCTETS                (app_perf_max * 2)
+
+/* Size of the Latency characteristic value: highest latency (4 octets), 
+ * highest handler time (2 octets), two octets per histogram bucket, 
+ * highest latency of the high priority keys (4 octets), highest PIO event 
+ * time (2 octets) and highest event queue depth (2 octets)
+ */
+#define DIAG_LATENCY_OCTETS                 (6 + \
+                                             APP_PERF_LATENCY_BUCKETS * 2 + \
+                                             8)
+
+/* Size of the TX Power characteristic value: level, transmit power and
+ * RSSI (1 octet each) and energy per key report (2 octets)
+ */
+#define DIAG_TX_POWER_OCTETS                (5)
+
+/* Size of the buffer used to build read responses */
+#ifdef ENABLE_PERF_COUNTERS
+#define DIAG_READ_BUFFER_SIZE               ((DIAG_COUNTERS_OCTETS > \
+                                              DIAG_LATENCY_OCTETS) ? \
+                                             DIAG_COUNTERS_OCTETS : \
+                                             DIAG_LATENCY_OCTETS)
+#else
+#define DIAG_READ_BUFFER_SIZE               (DIAG_PANIC_RECORD_OCTETS)
+#endif /* ENABLE_PERF_COUNTERS */
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Diagnostics service data type */
+typedef struct
+{
+    /* Copy of the panic record held in NVM */
+    DIAG_PANIC_RECORD_T     panic_record;
+
+    /* Boolean flag set once the NVM offset of the service is known. A panic 
+     * raised before that is not recorded.
+     */
+    bool                    nvm_ready;
+
+    /* NVM offset at which Diagnostics service data is stored */
+    uint16                  nvm_offset;
+
+#ifdef ENABLE_APP_TRACE
+    /* Client configuration for Trace characteristic */
+    gatt_client_config      trace_client_config;
+
+    /* UCID of the connection on which the service is being used */
+    uint16                  ucid;
+#endif /* ENABLE_APP_TRACE */
+
+} DIAG_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Diagnostics service data instance */
+static DIAG_DATA_T g_diag_data;
+
+#ifdef ENABLE_HOST_COMMANDS
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static sys_status diagRunCommand(uint8 *p_value, uint16 size_value);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      diagRunCommand
+ *
+ *  DESCRIPTION
+ *      This function runs a command written to the Command characteristic.
+ *      The command is written without response, so the status returned is
+ *      not seen by the host and a malformed command is only counted.
+ *
+ *  RETURNS
+ *      Status of the command.
+ *
+ *---------------------------------------------------------------------------*/
+
+static sys_status diagRunCommand(uint8 *p_value, uint16 size_value)
+{
+    sys_status rc = sys_status_success;
+    uint8 cmd = (size_value != 0) ? p_value[0] : 0;
+
+    APP_PERF_INC(app_perf_host_cmds);
+
+    switch(cmd)
+    {
+        case DIAG_CMD_BEEP:
+        {
+            if(size_value != 2)
+            {
+                rc = gatt_status_invalid_length;
+            }
+            else if((p_value[1] == buzzer_beep_off) ||
+                    (p_value[1] > buzzer_beep_thrice))
+            {
+                rc = gatt_status_att_val_oor;
+            }
+            else
+            {
+                SoundBuzzer((buzzer_beep_type)p_value[1]);
+            }
+        }
+        break;
+
+#ifdef ENABLE_BUZZER
+        case DIAG_CMD_SIGNAL_PATTERN:
+        {
+            if((size_value == 1) ||
+               ((size_value - 1) % SIGNAL_STEP_OCTETS != 0) ||
+               (size_value - 1 > SIGNAL_HOST_STEPS_MAX * SIGNAL_STEP_OCTETS))
+            {
+                rc = gatt_status_invalid_length;
+            }
+            else if(!SignalSeqPlayHost(&p_value[1],
+                                (size_value - 1) / SIGNAL_STEP_OCTETS))
+            {
+                rc = gatt_status_att_val_oor;
+            }
+        }
+        break;
+#endif /* ENABLE_BUZZER */
+
+        case DIAG_CMD_COUNTER_RESET:
+        {
+            if(size_value != 1)
+            {
+                rc = gatt_status_invalid_length;
+            }
+            else
+            {
+                CounterStoreReset();
+            }
+        }
+        break;
+
+        case DIAG_CMD_SNAPSHOT:
+        {
+            if(size_value != 1)
+            {
+                rc = gatt_status_invalid_length;
+            }
+            else
+            {
+                HtHwSendSnapshot();
+            }
+        }
+        break;
+
+        case DIAG_CMD_REPORT_MODE:
+        {
+            if(size_value != 2)
+            {
+                rc = gatt_status_invalid_length;
+            }
+            else if(p_value[1] >= report_mode_max)
+            {
+                rc = gatt_status_att_val_oor;
+            }
+            else
+            {
+                HtHwSetReportMode((report_mode)p_value[1]);
+            }
+        }
+        break;
+
+        default:
+            rc = gatt_status_att_val_oor;
+        break;
+    }
+
+    APP_TRACE(app_trace_host_cmd, ((uint16)cmd << 8) |
+                                  ((rc == sys_status_success) ? 0 : 1));
+
+    if(rc != sys_status_success)
+    {
+        APP_PERF_INC(app_perf_host_cmd_errors);
+    }
+
+    return rc;
+}
+#endif /* ENABLE_HOST_COMMANDS */
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      DiagDataInit
+ *
+ *  DESCRIPTION
+ *      This function is used to initialise Diagnostics service data 
+ *      structure. Diagnostics configuration is not retained across 
+ *      connections, so it is not stored in NVM.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void DiagDataInit(void)
+{
+#ifdef ENABLE_APP_TRACE
+    g_diag_data.trace_client_config = gatt_client_config_none;
+    g_diag_data.ucid = GATT_INVALID_UCID;
+
+    /* Abort any trace dump left over from the previous connection */
+    AppTraceStopDump();
+#endif /* ENABLE_APP_TRACE */
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      DiagReadDataFromNVM
+ *
+ *  DESCRIPTION
+ *      This function is used to read Diagnostics service specific data 
+ *      stored in NVM. It is called at application start-up, so the panic 
+ *      record left by the previous power cycle, if any, is available as 
+ *      soon as a host connects.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void DiagReadDataFromNVM(uint16 *p_offset)
+{
+    g_diag_data.nvm_offset = *p_offset;
+
+    Nvm_Read((uint16*)&g_diag_data.panic_record,
+             sizeof(g_diag_data.panic_record),
+             *p_offset + 
+             DIAG_NVM_PANIC_RECORD_OFFSET);
+
+    if((g_diag_data.panic_record.status != DIAG_PANIC_RECORD_NEW) &&
+       (g_diag_data.panic_record.status != DIAG_PANIC_RECORD_READ))
+    {
+        /* Fresh NVM, or NVM written by an older application: nothing has 
+         * been recorded yet
+         */
+        MemSet(&g_diag_data.panic_record, 0, 
+               sizeof(g_diag_data.panic_record));
+        g_diag_data.panic_record.status = DIAG_PANIC_RECORD_READ;
+    }
+
+    g_diag_data.nvm_ready = TRUE;
+
+    /* Increment the offset by the number of words of NVM memory required 
+     * by Diagnostics service 
+     */
+    *p_offset += DIAG_SERVICE_NVM_MEMORY_WORDS;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      DiagWritePanicRecord
+ *
+ *  DESCRIPTION
+ *      This function writes the panic post-mortem record to NVM. It is called 
+ *      by ReportPanic() just before the chip is reset, so it is kept to a 
+ *      single NVM write. Nvm_WriteDirect() is used as Nvm_Write() would 
+ *      report a panic on failure and may leave the words in a write batch; 
+ *      if the write fails the record is lost. On SPI flash the record goes 
+ *      to the NVM record log like any other write, so it is replayed at 
+ *      start-up and read back by DiagReadDataFromNVM().
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void DiagWritePanicRecord(uint16 panic_code, uint16 state, 
+                                 uint16 lm_event)
+{
+    DIAG_PANIC_RECORD_T *p_rec = &g_diag_data.panic_record;
+
+    if(!g_diag_data.nvm_ready)
+    {
+        return;
+    }
+
+    p_rec->status = DIAG_PANIC_RECORD_NEW;
+    p_rec->panic_code = panic_code;
+    p_rec->state = state;
+    p_rec->lm_event = lm_event;
+    p_rec->time = TimeGet32();
+    ++ p_rec->reset_count;
+
+    Nvm_WriteDirect((uint16*)p_rec, sizeof(DIAG_PANIC_RECORD_T),
+                    g_diag_data.nvm_offset + DIAG_NVM_PANIC_RECORD_OFFSET);
+}
+
+
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      DiagHandleAccessRead
+ *
+ *  DESCRIPTION
+ *      This function handles read operation on Diagnostics service 
+ *      attributes maintained by the application and responds with the 
+ *      GATT_ACCESS_RSP message.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void DiagHandleAccessRead(GATT_ACCESS_IND_T *p_ind)
+{
+    uint16 length = 0;
+    uint8  value[DIAG_READ_BUFFER_SIZE];
+    uint8  *p_rsp = value;
+    sys_status rc = sys_status_success;
+    uint8  *p_value = value;
+#ifdef ENABLE_PERF_COUNTERS
+    uint16 counter;
+    uint16 bucket;
+#endif /* ENABLE_PERF_COUNTERS */
+
+    switch(p_ind->handle)
+    {
+        case HANDLE_DIAG_PANIC_RECORD:
+        {
+            length = DIAG_PANIC_RECORD_OCTETS;
+
+            BufWriteUint8(&p_value, (g_diag_data.panic_record.status == 
+                                    DIAG_PANIC_RECORD_NEW) ? 1 : 0);
+            BufWriteUint16(&p_value, g_diag_data.panic_record.panic_code);
+            BufWriteUint8(&p_value, (uint8)g_diag_data.panic_record.state);
+            BufWriteUint16(&p_value, g_diag_data.panic_record.lm_event);
+            BufWriteUint16(&p_value, 
+                        (uint16)(g_diag_data.panic_record.time & 0xffff));
+            BufWriteUint16(&p_value, 
+                        (uint16)(g_diag_data.panic_record.time >> 16));
+            BufWriteUint16(&p_value, g_diag_data.panic_record.reset_count);
+
+            /* The record is cleared once it has been read */
+            if(g_diag_data.panic_record.status == DIAG_PANIC_RECORD_NEW)
+            {
+                g_diag_data.panic_record.status = DIAG_PANIC_RECORD_READ;
+
+                Nvm_Write(&g_diag_data.panic_record.status,
+                          sizeof(g_diag_data.panic_record.status),
+                          g_diag_data.nvm_offset + 
+                          DIAG_NVM_PANIC_RECORD_OFFSET);
+            }
+        }
+        break;
+
+        case HANDLE_DIAG_COUNTER_STATE:
+        {
+            length = DIAG_COUNTER_STATE_OCTETS;
+
+            BufWriteUint8(&p_value, CounterStorePossiblyLost() ? 1 : 0);
+            BufWriteUint8(&p_value, ghg_count);
+            BufWriteUint8(&p_value, bp_count);
+            BufWriteUint8(&p_value, send_count);
+        }
+        break;
+
+#ifdef ENABLE_APP_TRACE
+        case HANDLE_DIAG_TRACE_C_CFG:
+        {
+            length = 2; /* Two Octets */
+
+            BufWriteUint16(&p_value, g_diag_data.trace_client_config);
+        }
+        break;
+#endif /* ENABLE_APP_TRACE */
+
+#ifdef ENABLE_PERF_COUNTERS
+        case HANDLE_DIAG_COUNTERS:
+        {
+            /* Validate offset against length as the value does not fit in 
+             * a single ATT_MTU and is read with Read Blob requests
+             */
+            if(p_ind->offset < DIAG_COUNTERS_OCTETS)
+            {
+                for(counter = 0; counter < app_perf_max; counter ++)
+                {
+                    BufWriteUint16(&p_value, g_app_perf_counters[counter]);
+                }
+
+                length = DIAG_COUNTERS_OCTETS - p_ind->offset;
+                p_rsp = value + p_ind->offset;
+            }
+            else
+            {
+                rc = gatt_status_invalid_offset;
+            }
+        }
+        break;
+
+        case HANDLE_DIAG_LATENCY:
+        {
+            /* Read with Read Blob requests too */
+            if(p_ind->offset < DIAG_LATENCY_OCTETS)
+            {
+                BufWriteUint16(&p_value, (uint16)
+                               (g_app_perf_latency.max_latency & 0xffff));
+                BufWriteUint16(&p_value, (uint16)
+                               (g_app_perf_latency.max_latency >> 16));
+                BufWriteUint16(&p_value, 
+                               g_app_perf_latency.max_handler_time);
+
+                for(bucket = 0; bucket < APP_PERF_LATENCY_BUCKETS; bucket ++)
+                {
+                    BufWriteUint16(&p_value, 
+                                   g_app_perf_latency.buckets[bucket]);
+                }
+
+                BufWriteUint16(&p_value, (uint16)
+                               (g_app_perf_latency.max_high_latency & 0xffff));
+                BufWriteUint16(&p_value, (uint16)
+                               (g_app_perf_latency.max_high_latency >> 16));
+                BufWriteUint16(&p_value, 
+                               g_app_perf_latency.max_event_time);
+                BufWriteUint16(&p_value, 
+                               g_app_perf_latency.max_queue_depth);
+
+                length = DIAG_LATENCY_OCTETS - p_ind->offset;
+                p_rsp = value + p_ind->offset;
+            }
+            else
+            {
+                rc = gatt_status_invalid_offset;
+            }
+        }
+        break;
+#endif /* ENABLE_PERF_COUNTERS */
+
+#ifdef ENABLE_TX_POWER_CONTROL
+        case HANDLE_DIAG_TX_POWER:
+        {
+            length = DIAG_TX_POWER_OCTETS;
+
+            BufWriteUint8(&p_value, TxPowerGetLevel());
+            BufWriteUint8(&p_value, (uint8)TxPowerGetDbm());
+            BufWriteUint8(&p_value, (uint8)TxPowerGetRssi());
+            BufWriteUint16(&p_value, TxPowerReportEnergy());
+        }
+        break;
+#endif /* ENABLE_TX_POWER_CONTROL */
+
+        default:
+            /* No more IRQ characteristics */
+            rc = gatt_status_read_not_permitted;
+        break;
+    }
+
+    GattAccessRsp(p_ind->cid, p_ind->handle, rc, length, p_rsp);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      DiagHandleAccessWrite
+ *
+ *  DESCRIPTION
+ *      This function handles write operation on Diagnostics service 
+ *      attributes maintained by the application and responds with the 
+ *      GATT_ACCESS_RSP message.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void DiagHandleAccessWrite(GATT_ACCESS_IND_T *p_ind)
+{
+    sys_status rc = sys_status_success;
+    uint8 *p_value = p_ind->value;
+#ifdef ENABLE_APP_TRACE
+    uint16 client_config;
+    bool start_dump = FALSE;
+#endif /* ENABLE_APP_TRACE */
+
+    switch(p_ind->handle)
+    {
+#ifdef ENABLE_APP_TRACE
+        case HANDLE_DIAG_TRACE:
+        {
+            if(p_ind->size_value != 1)
+            {
+                rc = gatt_status_invalid_length;
+            }
+            else if(p_value[0] == DIAG_TRACE_CMD_DUMP)
+            {
+                /* The trace ring can only be sent if notifications are 
+                 * configured
+                 */
+                if(g_diag_data.trace_client_config & 
+                                            gatt_client_config_notification)
+                {
+                    g_diag_data.ucid = p_ind->cid;
+                    start_dump = TRUE;
+                }
+                else
+                {
+                    rc = gatt_status_desc_improper_config;
+                }
+            }
+            else if(p_value[0] == DIAG_TRACE_CMD_CLEAR)
+            {
+                AppTraceClear();
+            }
+            else
+            {
+                rc = gatt_status_att_val_oor;
+            }
+        }
+        break;
+
+        case HANDLE_DIAG_TRACE_C_CFG:
+        {
+            if(p_ind->size_value != 2)
+            {
+                rc = gatt_status_invalid_length;
+            }
+            else
+            {
+                client_config = BufReadUint16(&p_value);
+
+                if((client_config == gatt_client_config_notification) ||
+                   (client_config == gatt_client_config_none))
+                {
+                    g_diag_data.trace_client_config = client_config;
+                }
+                else
+                {
+                    /* Return error as only notifications are supported */
+                    rc = gatt_status_desc_improper_config;
+                }
+            }
+        }
+        break;
+#endif /* ENABLE_APP_TRACE */
+
+#ifdef ENABLE_PERF_COUNTERS
+        case HANDLE_DIAG_COUNTERS:
+        {
+            if(p_ind->size_value != 1)
+            {
+                rc = gatt_status_invalid_length;
+            }
+            else if(p_value[0] == DIAG_COUNTERS_CMD_RESET)
+            {
+                AppPerfReset();
+            }
+            else
+            {
+                rc = gatt_status_att_val_oor;
+            }
+        }
+        break;
+#endif /* ENABLE_PERF_COUNTERS */
+
+#ifdef ENABLE_BUZZER
+        case HANDLE_DIAG_SIGNAL_PATTERN:
+        {
+            if((p_ind->size_value == 0) ||
+               (p_ind->size_value % SIGNAL_STEP_OCTETS != 0) ||
+               (p_ind->size_value > 
+                            SIGNAL_HOST_STEPS_MAX * SIGNAL_STEP_OCTETS))
+            {
+                rc = gatt_status_invalid_length;
+            }
+            else if(!SignalSeqPlayHost(p_value, 
+                                p_ind->size_value / SIGNAL_STEP_OCTETS))
+            {
+                rc = gatt_status_att_val_oor;
+            }
+        }
+        break;
+#endif /* ENABLE_BUZZER */
+
+#ifdef ENABLE_HOST_COMMANDS
+        case HANDLE_DIAG_COMMAND:
+        {
+            rc = diagRunCommand(p_value, p_ind->size_value);
+        }
+        break;
+#endif /* ENABLE_HOST_COMMANDS */
+
+        case HANDLE_DIAG_COUNTER_STATE:
+        {
+            if(p_ind->size_value != 1)
+            {
+                rc = gatt_status_invalid_length;
+            }
+            else if(p_value[0] == DIAG_COUNTER_STATE_CMD_CLEAR)
+            {
+                CounterStoreClearLost();
+            }
+            else
+            {
+                rc = gatt_status_att_val_oor;
+            }
+        }
+        break;
+
+        default:
+            rc = gatt_status_write_not_permitted;
+        break;
+    }
+
+    /* Send ACCESS RESPONSE */
+    GattAccessRsp(p_ind->cid, p_ind->handle, rc, 0, NULL);
+
+#ifdef ENABLE_APP_TRACE
+    /* Send the first page only after the write has been responded to */
+    if(start_dump)
+    {
+        AppTraceStartDump(g_diag_data.ucid, HANDLE_DIAG_TRACE);
+    }
+#endif /* ENABLE_APP_TRACE */
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      DiagHandleNotificationCfm
+ *
+ *  DESCRIPTION
+ *      This function is called when the firmware confirms a notification sent 
+ *      on a Diagnostics service characteristic. It sends the next page of an 
+ *      on-going trace dump.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void DiagHandleNotificationCfm(uint16 handle)
+{
+#ifdef ENABLE_APP_TRACE
+    if(handle == HANDLE_DIAG_TRACE)
+    {
+        AppTraceContinueDump();
+    }
+#endif /* ENABLE_APP_TRACE */
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      DiagCheckHandleRange
+ *
+ *  DESCRIPTION
+ *      This function is used to check if the handle belongs to the 
+ *      Diagnostics service
+ *
+ *  RETURNS
+ *      Boolean - Indicating whether handle falls in range or not.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool DiagCheckHandleRange(uint16 handle)
+{
+    return ((handle >= HANDLE_DIAG_SERVICE) &&
+            (handle <= HANDLE_DIAG_SERVICE_END))
+            ? TRUE : FALSE;
+}
@@ -0,0 +1,96 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      diag_service.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the vendor specific Diagnostics service
+ *
+ *****************************************************************************/
+
+#ifndef __DIAG_SERVICE_H__
+#define __DIAG_SERVICE_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <bt_event_types.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Number of words of NVM memory used by Diagnostics service */
+#define DIAG_SERVICE_NVM_MEMORY_WORDS       (sizeof(DIAG_PANIC_RECORD_T))
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Panic post-mortem record, stored as is in NVM */
+typedef struct
+{
+    /* DIAG_PANIC_RECORD_NEW if the record has not been read yet, 
+     * DIAG_PANIC_RECORD_READ otherwise
+     */
+    uint16                  status;
+
+    /* Panic code passed to ReportPanic() */
+    uint16                  panic_code;
+
+    /* Application state at the time of the panic */
+    uint16                  state;
+
+    /* Last LM event received before the panic */
+    uint16                  lm_event;
+
+    /* Time at which the panic was raised, since the last reset */
+    uint32                  time;
+
+    /* Number of panic resets recorded since the NVM was initialised */
+    uint16                  reset_count;
+
+} DIAG_PANIC_RECORD_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* This function is used to initialise Diagnostics service data structure */
+extern void DiagDataInit(void);
+
+/* This function is used to read Diagnostics service specific data stored in 
+ * NVM
+ */
+extern void DiagReadDataFromNVM(uint16 *p_offset);
+
+/* This function writes the panic post-mortem record to NVM */
+extern void DiagWritePanicRecord(uint16 panic_code, uint16 state, 
+                                 uint16 lm_event);
+
+/* This function handles read operation on Diagnostics service attributes
+ * maintained by the application
+ */
+extern void DiagHandleAccessRead(GATT_ACCESS_IND_T *p_ind);
+
+/* This function handles write operation on Diagnostics service attributes
+ * maintained by the application
+ */
+extern void DiagHandleAccessWrite(GATT_ACCESS_IND_T *p_ind);
+
+/* This function is called when the firmware confirms a notification sent 
+ * on a Diagnostics service characteristic
+ */
+extern void DiagHandleNotificationCfm(uint16 handle);
+
+/* This function is used to check if the handle belongs to the Diagnostics 
+ * service
+ */
+extern bool DiagCheckHandleRange(uint16 handle);
+
+#endif /* __DIAG_SERVICE_H__ */
@@ -0,0 +1,47 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      diag_uuids.h
+ *
+ *  DESCRIPTION
+ *      UUID MACROs for the vendor specific Diagnostics service
+ *
+ *****************************************************************************/
+
+#ifndef __DIAG_UUIDS_H__
+#define __DIAG_UUIDS_H__
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Brackets should not be used around the value of a macro. The parser 
+ * which creates .c and .h files from .db file doesn't understand brackets 
+ * and will raise syntax errors.
+ */
+
+/* The Diagnostics service is a vendor specific service, so 128-bit UUIDs 
+ * are used for the service and its characteristics.
+ */
+
+#define UUID_DIAG_SERVICE                  0x7d4a0001e9c54b5c9e3c2a1f6b8d0c11
+
+#define UUID_DIAG_TRACE                    0x7d4a0002e9c54b5c9e3c2a1f6b8d0c11
+
+#define UUID_DIAG_COUNTERS                 0x7d4a0003e9c54b5c9e3c2a1f6b8d0c11
+
+#define UUID_DIAG_PANIC_RECORD             0x7d4a0004e9c54b5c9e3c2a1f6b8d0c11
+
+#define UUID_DIAG_COUNTER_STATE            0x7d4a0005e9c54b5c9e3c2a1f6b8d0c11
+
+#define UUID_DIAG_SIGNAL_PATTERN           0x7d4a0006e9c54b5c9e3c2a1f6b8d0c11
+
+#define UUID_DIAG_LATENCY                  0x7d4a0007e9c54b5c9e3c2a1f6b8d0c11
+
+#define UUID_DIAG_TX_POWER                 0x7d4a0008e9c54b5c9e3c2a1f6b8d0c11
+#define UUID_DIAG_COMMAND                  0x7d4a0009e9c54b5c9e3c2a1f6b8d0c11
+
+#endif /* __DIAG_UUIDS_H__ */
@@ -86,4 +86,31 @@
 /* Supervision timeout (ms) = PREFERRED_SUPERVISION_TIMEOUT * 10 ms */
 #define APPLE_SUPERVISION_TIMEOUT           0x0258 /* 6 seconds */
 
+/* Low latency connection parameters, requested for a while after a high
+ * priority key event such as the brake. They are within the APPLE compliant
+ * range.
+ */
+/* Minimum and maximum connection interval in number of frames. */
+#define LOW_LATENCY_MAX_CON_INTERVAL        0x0008 /* 10ms */
+#define LOW_LATENCY_MIN_CON_INTERVAL        0x0006 /* 7.5ms */
+
+/* Slave latency in number of connection intervals. */
+#define LOW_LATENCY_SLAVE_LATENCY           0x0000
+
+/* Supervision timeout (ms) = LOW_LATENCY_SUPERVISION_TIMEOUT * 10 ms */
+#define LOW_LATENCY_SUPERVISION_TIMEOUT     0x0258 /* 6 seconds */
+
+/* Relaxed connection parameters, requested once no key has been used for a
+ * while (see ENABLE_POWER_LADDER). The device only wakes every second.
+ */
+/* Minimum and maximum connection interval in number of frames. */
+#define RELAXED_MAX_CON_INTERVAL            0x0050 /* 100ms */
+#define RELAXED_MIN_CON_INTERVAL            0x0050 /* 100ms */
+
+/* Slave latency in number of connection intervals. */
+#define RELAXED_SLAVE_LATENCY               0x0009 /* 9 conn_intervals */
+
+/* Supervision timeout (ms) = RELAXED_SUPERVISION_TIMEOUT * 10 ms */
+#define RELAXED_SUPERVISION_TIMEOUT         0x0258 /* 6 seconds */
+
 #endif /* __GAP_CONN_PARAMS_H__ */
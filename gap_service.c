@@ -17,8 +17,6 @@
 
 #include <gatt.h>
 #include <gatt_prim.h>
-#include <mem.h>
-#include <string.h>
 #include <buf_utils.h>
 
 /*============================================================================*
@@ -29,6 +27,7 @@
 #include "gap_service.h"
 #include "app_gatt_db.h"
 #include "nvm_access.h"
+#include "packed_buf.h"
 
 /*============================================================================*
  *  Private Data Types
@@ -40,9 +39,6 @@ typedef struct
     /* Name length in Bytes */
     uint16  length;
 
-    /* Pointer to hold device name used by the application */
-    uint8   *p_dev_name;
-
     /* NVM offset at which GAP service data is stored */
     uint16  nvm_offset;
 
@@ -55,21 +51,18 @@ typedef struct
 /* GAP service data instance */
 static GAP_DATA_T g_gap_data;
 
-/* Default device name - Added two for storing AD Type and Null ('\0') */ 
-uint8 g_device_name[DEVICE_NAME_MAX_LENGTH + 2] = {
-AD_TYPE_LOCAL_NAME_COMPLETE, 
-'C', 'S', 'R', ' ', 
-'T', 'h', 'e', 'r', 'm', 'o', 'm', 'e', 't', 'e', 'r', '\0'};
+/* Device name, packed two octets per word (see packed_buf.h) - Added one
+ * for storing Null ('\0')
+ */
+static uint16 g_device_name[PACKED_BUF_WORDS(DEVICE_NAME_MAX_LENGTH + 1)] = {
+PACKED_OCTETS('C', 'S'), PACKED_OCTETS('R', ' '), 
+PACKED_OCTETS('T', 'h'), PACKED_OCTETS('e', 'r'), PACKED_OCTETS('m', 'o'), 
+PACKED_OCTETS('m', 'e'), PACKED_OCTETS('t', 'e'), PACKED_OCTETS('r', '\0')};
 
 /*============================================================================*
  *  Private Definitions
  *============================================================================*/
 
-/* Number of words of NVM memory used by GAP service */
-
-/* Add space for Device Name Length and Device Name */
-#define GAP_SERVICE_NVM_MEMORY_WORDS  (1 + DEVICE_NAME_MAX_LENGTH)
-
 /* The offset of data being stored in NVM for GAP service. This offset is 
  * added to GAP service offset to NVM region (see g_gap_data.nvm_offset) 
  * to get the absolute offset at which this data is stored in NVM
@@ -103,17 +96,21 @@ static void updateDeviceName(uint16 length, uint8 *name);
 
 static void gapWriteDeviceNameToNvm(void)
 {
+    /* NVM holds the device name one octet per word */
+    uint8 name[DEVICE_NAME_MAX_LENGTH];
 
     /* Write device name length to NVM */
     Nvm_Write(&g_gap_data.length, sizeof(g_gap_data.length), 
               g_gap_data.nvm_offset + 
               GAP_NVM_DEVICE_LENGTH_OFFSET);
 
+    PackedBufUnpack(name, g_device_name, 0, g_gap_data.length);
+
     /* Write device name to NVM 
      * Typecast of uint8 to uint16 or vice-versa shall not have any side 
      * affects as both types (uint8 and uint16) take one word memory on XAP
      */
-    Nvm_Write((uint16*)g_gap_data.p_dev_name, g_gap_data.length, 
+    Nvm_Write((uint16*)name, g_gap_data.length, 
               g_gap_data.nvm_offset + 
               GAP_NVM_DEVICE_NAME_OFFSET);
 
@@ -134,18 +131,16 @@ static void gapWriteDeviceNameToNvm(void)
 
 static void updateDeviceName(uint16 length, uint8 *name)
 {
-    uint8   *p_name = g_gap_data.p_dev_name;
-    
     /* Update Device Name length to the maximum of DEVICE_NAME_MAX_LENGTH  */
     if(length < DEVICE_NAME_MAX_LENGTH)
         g_gap_data.length = length;
     else
         g_gap_data.length = DEVICE_NAME_MAX_LENGTH;
 
-    MemCopy(p_name, name, g_gap_data.length);
+    PackedBufPack(g_device_name, name, g_gap_data.length);
 
     /* Null terminate the device name string */
-    p_name[g_gap_data.length] = '\0';
+    PackedBufSet(g_device_name, g_gap_data.length, '\0');
 
     gapWriteDeviceNameToNvm();
 
@@ -170,9 +165,15 @@ static void updateDeviceName(uint16 length, uint8 *name)
 
 extern void GapDataInit(void)
 {
-    /* Skip 1st byte to move over AD Type field and point to device name */
-    g_gap_data.p_dev_name = (g_device_name + 1);
-    g_gap_data.length = StrLen((char *)g_gap_data.p_dev_name);
+    uint16 length = 0;
+
+    while((length < DEVICE_NAME_MAX_LENGTH) &&
+          (PACKED_BUF_GET(g_device_name, length) != '\0'))
+    {
+        ++ length;
+    }
+
+    g_gap_data.length = length;
 }
 
 
@@ -194,6 +195,7 @@ extern void GapHandleAccessRead(GATT_ACCESS_IND_T *p_ind)
 {
     uint16 length = 0;
     uint8  *p_value = NULL;
+    uint8  name[DEVICE_NAME_MAX_LENGTH];
     sys_status rc = sys_status_success;
 
     switch(p_ind->handle)
@@ -207,7 +209,8 @@ extern void GapHandleAccessRead(GATT_ACCESS_IND_T *p_ind)
             if(p_ind -> offset < g_gap_data.length)
             {
                 length = g_gap_data.length - p_ind -> offset;
-                p_value = (g_gap_data.p_dev_name + p_ind -> offset);
+                PackedBufUnpack(name, g_device_name, p_ind -> offset, length);
+                p_value = name;
             }
             else
             {
@@ -281,6 +284,8 @@ extern void GapHandleAccessWrite(GATT_ACCESS_IND_T *p_ind)
 
 extern void GapReadDataFromNVM(uint16 *p_offset)
 {
+    /* NVM holds the device name one octet per word */
+    uint8 name[DEVICE_NAME_MAX_LENGTH];
 
     g_gap_data.nvm_offset = *p_offset;
 
@@ -289,16 +294,23 @@ extern void GapReadDataFromNVM(uint16 *p_offset)
              *p_offset + 
              GAP_NVM_DEVICE_LENGTH_OFFSET);
 
+    if(g_gap_data.length > DEVICE_NAME_MAX_LENGTH)
+    {
+        g_gap_data.length = DEVICE_NAME_MAX_LENGTH;
+    }
+
     /* Read Device Name 
      * Typecast of uint8 to uint16 or vice-versa shall not have any side 
      * affects as both types (uint8 and uint16) take one word memory on XAP
      */
-    Nvm_Read((uint16*)g_gap_data.p_dev_name, g_gap_data.length, 
+    Nvm_Read((uint16*)name, g_gap_data.length, 
              *p_offset + 
              GAP_NVM_DEVICE_NAME_OFFSET);
 
+    PackedBufPack(g_device_name, name, g_gap_data.length);
+
     /* Add NULL character to terminate the device name string */
-    g_gap_data.p_dev_name[g_gap_data.length] = '\0';
+    PackedBufSet(g_device_name, g_gap_data.length, '\0');
 
     /* Increase NVM offset for maximum device name length. Add 1 for
      * 'device name length' field as well
@@ -360,42 +372,23 @@ extern bool GapCheckHandleRange(uint16 handle)
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      GapGetNameAndLength
+ *      GapGetNameAdData
  *
  *  DESCRIPTION
- *      This function is used to get the reference to the 'g_device_name' array, 
- *      which contains AD Type and device name. This function also returns the 
- *      AD Type and device name length.
+ *      This function is used to unpack the device name into 'p_ad_data', 
+ *      after a first octet holding the AD Type. 'p_ad_data' must hold
+ *      DEVICE_NAME_MAX_LENGTH + 1 octets.
  *
  *  RETURNS
- *      Pointer to device name array.
+ *      AD Type and device name length.
  *
  *---------------------------------------------------------------------------*/
 
-extern uint8 *GapGetNameAndLength(uint16 *p_name_length)
+extern uint16 GapGetNameAdData(uint8 *p_ad_data)
 {
-    *p_name_length = StrLen((char *)g_device_name);
-    return (g_device_name);
-}
+    p_ad_data[0] = AD_TYPE_LOCAL_NAME_COMPLETE;
 
+    PackedBufUnpack(p_ad_data + 1, g_device_name, 0, g_gap_data.length);
 
-#ifdef NVM_TYPE_FLASH
-/*----------------------------------------------------------------------------*
- *  NAME
- *      WriteGapServiceDataInNVM
- *
- *  DESCRIPTION
- *      This function writes the GAP service data in NVM
- *
- *  RETURNS
- *      Nothing
- *
- *---------------------------------------------------------------------------*/
-
-extern void WriteGapServiceDataInNVM(void)
-{
-    /* Gap Service has only device name to write into NVM */
-    gapWriteDeviceNameToNvm();
+    return g_gap_data.length + 1;
 }
-#endif /* NVM_TYPE_FLASH */
-
@@ -26,6 +26,16 @@
  *============================================================================*/
 
 #include "gap_conn_params.h"
+#include "app_gatt.h"
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Number of words of NVM memory used by GAP service */
+
+/* Add space for Device Name Length and Device Name */
+#define GAP_SERVICE_NVM_MEMORY_WORDS  (1 + DEVICE_NAME_MAX_LENGTH)
 
 /*============================================================================*
  *  Public Function Prototypes
@@ -57,14 +67,9 @@ extern void GapInitWriteDataToNVM(uint16 *p_offset);
  */
 extern bool GapCheckHandleRange(uint16 handle);
 
-/* This function is used to get the reference to the 'g_device_name' 
- * array, which contains AD Type and device name
+/* This function is used to get the AD Type and device name, unpacked into
+ * an array of DEVICE_NAME_MAX_LENGTH + 1 octets
  */
-extern uint8 *GapGetNameAndLength(uint16 *p_name_length);
-
-#ifdef NVM_TYPE_FLASH
-/* This function writes the GAP service data in NVM */
-extern void WriteGapServiceDataInNVM(void);
-#endif /* NVM_TYPE_FLASH */
+extern uint16 GapGetNameAdData(uint8 *p_ad_data);
 
 #endif /* __GAP_SERVICE_H__ */
@@ -25,8 +25,28 @@
 
 #include "app_gatt.h"
 #include "health_thermo_service.h"
-#include "nvm_access.h"
+#include "bond_table.h"
 #include "app_gatt_db.h"
+#include "app_trace.h"
+#include "app_perf.h"
+#include "counter_store.h"
+#include "packed_buf.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *===========================================================================*/
+
+/* Flags for Temp measurement information.
+ * For details on these values, refer to http://developer.bluetooth.org/gatt/
+ * characteristics/Pages/CharacteristicViewer.aspx?u=org.bluetooth.
+ * characteristic.temperature_measurement.xml
+ */
+#define TEMP_MEAS_FLAGS_NONE                        (0x00)
+
+#define TEMP_MEAS_UNIT_CELSIUS                      (0x00)
+#define TEMP_MEAS_UNIT_FAHRENHEIT                   (0x01)
+#define TEMP_MEAS_TIME_STAMP_PRESENT                (0x02)
+#define TEMP_MEAS_TEMP_TYPE_PRESENT                 (0x04)
 
 /*============================================================================*
  *  Private Data Types
@@ -42,19 +62,8 @@ typedef struct
     /* Client configuration for Temperature Measurement characteristic */
     gatt_client_config      temp_client_config;
 
-    /* Offset at which Health Thermometer data is stored in NVM */
-    uint16                  nvm_offset;
-
 } HT_SERV_DATA_T;
 
-typedef struct
-{
-   uint8 sendcnt;
-   uint8 heartcnt;
-   uint8 ghgcnt;
-   uint8 anjstate;
-   uint8 batlevel;
-} HT_SR_DATA;
 /*============================================================================*
  *  Private Data
  *============================================================================*/
@@ -64,40 +73,10 @@ static HT_SERV_DATA_T g_ht_serv_data;
 
 uint8 send_count=0;
 
-static HT_SR_DATA g_ht_sr_data;
-/*============================================================================*
- *  Private Definitions
- *===========================================================================*/
-
-/* Number of words of NVM memory used by Health Thermometer service */
-#define HEALTH_THERMO_SERVICE_NVM_MEMORY_WORDS      (1)
-
-/* The offset of data being stored in NVM for Health Thermometer service.
- * This offset is added to Health Thermometer service offset to NVM region 
- * to get the absolute offset at which this data is stored in NVM
- */
-#define HEALTH_THERMO_NVM_TEMP_CLIENT_CONFIG_OFFSET (0)
-
-
-/* Maximum Temperature Measurement size - This application is not 
- * supporting time stamp and uses separate characteristic for 
- * temperature type 
+/* Last report sent: send count, BP count, GHG count, switch states and
+ * battery level, packed two octets per word (see packed_buf.h)
  */
-#define MAX_TEMP_MEAS_SIZE                          (5)
-
-/* Flags for Temp measurement information.
- * For details on these values, refer to http://developer.bluetooth.org/gatt/
- * characteristics/Pages/CharacteristicViewer.aspx?u=org.bluetooth.
- * characteristic.temperature_measurement.xml
- */
-#define TEMP_MEAS_FLAGS_NONE                        (0x00)
-
-#define TEMP_MEAS_UNIT_CELSIUS                      (0x00)
-#define TEMP_MEAS_UNIT_FAHRENHEIT                   (0x01)
-#define TEMP_MEAS_TIME_STAMP_PRESENT                (0x02)
-#define TEMP_MEAS_TEMP_TYPE_PRESENT                 (0x04)
-
-
+static uint16 g_ht_last_report[PACKED_BUF_WORDS(MAX_TEMP_MEAS_SIZE)];
 
 /*============================================================================*
  *  Public Function Implementations
@@ -118,13 +97,11 @@ static HT_SR_DATA g_ht_sr_data;
 
 extern void HealthThermoDataInit(void)
 {
-    if(!AppIsDeviceBonded())
-    {
-        /* Initialise Temperature Characteristic Client Configuration 
-         * only if device is not bonded
-         */
-        g_ht_serv_data.temp_client_config = gatt_client_config_none;
-    }
+    /* Initialise Temperature Characteristic Client Configuration with the 
+     * one stored for the connected device if it is bonded
+     */
+    g_ht_serv_data.temp_client_config = 
+                            BondTableGetClientConfig(bond_cccd_temp_meas);
 /*(modification  ɾ)
     g_ht_serv_data.ind_cfm_pending =FALSE;
 */
@@ -148,7 +125,7 @@ extern void HealthThermoDataInit(void)
 extern void HealthThermoHandleAccessRead(GATT_ACCESS_IND_T *p_ind)
 {
     uint16 length = 0;
-    uint8  val[5]; 
+    uint8  val[MAX_TEMP_MEAS_SIZE]; 
     uint8 *p_value = NULL;
     sys_status rc = sys_status_success;
 
@@ -157,12 +134,8 @@ extern void HealthThermoHandleAccessRead(GATT_ACCESS_IND_T *p_ind)
         case HANDLE_HT_TEMP_MEASUREMENT:
         {
             /* Reading TEMP level */
-            length = 5; /* 5 Octet */
-            val[0] = g_ht_sr_data.sendcnt;
-            val[1] = g_ht_sr_data.heartcnt;            
-            val[2] = g_ht_sr_data.ghgcnt;
-            val[3] = g_ht_sr_data.anjstate;
-            val[4] = g_ht_sr_data.batlevel;
+            length = MAX_TEMP_MEAS_SIZE;
+            PackedBufUnpack(val, g_ht_last_report, 0, MAX_TEMP_MEAS_SIZE);
         }
         break;
         case HANDLE_HT_TEMP_MEAS_C_CFG:
@@ -229,16 +202,11 @@ extern void HealthThermoHandleAccessWrite(GATT_ACCESS_IND_T *p_ind)
             {
                 g_ht_serv_data.temp_client_config = client_config;
 
-                /* Write Temperature Client configuration to NVM if the 
-                 * device is bonded.
+                /* Store Temperature Client configuration with the bond if 
+                 * the device is bonded.
                  */
-                if(AppIsDeviceBonded())
-                {
-                     Nvm_Write(&client_config,
-                              sizeof(client_config),
-                              g_ht_serv_data.nvm_offset + 
-                              HEALTH_THERMO_NVM_TEMP_CLIENT_CONFIG_OFFSET);
-                }
+                BondTableSetClientConfig(bond_cccd_temp_meas, 
+                                         (gatt_client_config)client_config);
             }
             else
             {
@@ -280,6 +248,8 @@ extern void HealthThermoHandleAccessWrite(GATT_ACCESS_IND_T *p_ind)
 
 extern bool HealthThermoSendTempReading(uint16 ucid, uint8 *value)
 {
+    APP_PERF_INC(app_perf_reports);
+
     if(send_count==0xFF)
     {
         send_count=0;
@@ -288,12 +258,11 @@ extern bool HealthThermoSendTempReading(uint16 ucid, uint8 *value)
     {
         send_count+=1;
     }
+
+    CounterStoreIncrement();
+
     value[0]=send_count;
-    g_ht_sr_data.sendcnt = send_count;
-    g_ht_sr_data.heartcnt = value[1];
-    g_ht_sr_data.ghgcnt = value[2];
-    g_ht_sr_data.anjstate = value[3];
-    g_ht_sr_data.batlevel = value[4];
+    PackedBufPack(g_ht_last_report, value, MAX_TEMP_MEAS_SIZE);
     if((ucid != GATT_INVALID_UCID) &&
        (g_ht_serv_data.temp_client_config & gatt_client_config_notification))
     {
@@ -301,10 +270,18 @@ extern bool HealthThermoSendTempReading(uint16 ucid, uint8 *value)
                 HANDLE_HT_TEMP_MEASUREMENT, 
                 MAX_TEMP_MEAS_SIZE, value);
 
+        APP_TRACE(app_trace_notify_sent, HANDLE_HT_TEMP_MEASUREMENT);
+        APP_PERF_INC(app_perf_notify_sent);
+        APP_PERF_REPORT_SENT();
+
         return TRUE;
 
      }
 
+    /* Reading dropped as notifications are not configured */
+    APP_TRACE(app_trace_notify_failed, HANDLE_HT_TEMP_MEASUREMENT);
+    APP_PERF_INC(app_perf_notify_failed);
+
     return FALSE;
 }
 
@@ -333,8 +310,9 @@ extern void HealthThermoRegIndicationCfm(bool ind_state)
  *      HealthThermoReadDataFromNVM
  *
  *  DESCRIPTION
- *      This function is used to read health thermometer service specific data 
- *      stored in NVM
+ *      This function is used to skip the NVM words reserved for health 
+ *      thermometer service. The client configuration is read with the bond 
+ *      table.
  *
  *  RETURNS
  *      Nothing.
@@ -344,20 +322,6 @@ extern void HealthThermoRegIndicationCfm(bool ind_state)
 extern void HealthThermoReadDataFromNVM(uint16 *p_offset)
 {
 
-    g_ht_serv_data.nvm_offset = *p_offset;
-
-    /* Read NVM only if devices are bonded */
-    if(AppIsDeviceBonded())
-    {
-
-        /* Read Termperature Client Configuration */
-        Nvm_Read((uint16*)&g_ht_serv_data.temp_client_config,
-                 sizeof(g_ht_serv_data.temp_client_config),
-                 *p_offset + 
-                 HEALTH_THERMO_NVM_TEMP_CLIENT_CONFIG_OFFSET);
-
-    }
-
     /* Increment the offset by the number of words of NVM memory required 
      * by Health Thermometer service 
      */
@@ -403,15 +367,11 @@ extern bool HealthThermoCheckHandleRange(uint16 handle)
 extern void HealthThermoBondingNotify(void)
 {
 
-    /* Write data to NVM if bond is established */
-    if(AppIsDeviceBonded())
-    {
-        /* Write to NVM the client configuration value of temperature */
-        Nvm_Write((uint16*)&g_ht_serv_data.temp_client_config,
-                  sizeof(g_ht_serv_data.temp_client_config),
-                  g_ht_serv_data.nvm_offset + 
-                  HEALTH_THERMO_NVM_TEMP_CLIENT_CONFIG_OFFSET);
-    }
+    /* Store with the new bond the client configuration value of 
+     * temperature written while pairing
+     */
+    BondTableSetClientConfig(bond_cccd_temp_meas, 
+                             g_ht_serv_data.temp_client_config);
 
 }
 
@@ -440,25 +400,3 @@ extern bool HealthThermoMeasIndConfigStatus(void)
 }
 
 */
-#ifdef NVM_TYPE_FLASH
-/*----------------------------------------------------------------------------*
- *  NAME
- *      WriteHealthThermometerServiceDataInNvm
- *
- *  DESCRIPTION
- *      This function writes Health Thermometer service data in NVM
- *
- *  RETURNS
- *      Nothing
- *
- *---------------------------------------------------------------------------*/
-
-extern void WriteHealthThermometerServiceDataInNvm(void)
-{
-    /* Write to NVM the client configuration value of temperature */
-    Nvm_Write((uint16*)&g_ht_serv_data.temp_client_config,
-                  sizeof(g_ht_serv_data.temp_client_config),
-                  g_ht_serv_data.nvm_offset + 
-                  HEALTH_THERMO_NVM_TEMP_CLIENT_CONFIG_OFFSET);
-}
-#endif /* NVM_TYPE_FLASH */
\ No newline at end of file
@@ -21,6 +21,39 @@
 #include <types.h>
 #include <bt_event_types.h>
 
+/*============================================================================*
+ *  Local Header Files
+ *===========================================================================*/
+
+#include "user_config.h"
+
+/*============================================================================*
+ *  Public Definitions
+ *===========================================================================*/
+
+/* Size of the key report sent as the Temperature Measurement: send count,
+ * BP count, GHG count, switch states, battery level and, with
+ * ENABLE_THROTTLE, the throttle position
+ */
+#ifdef ENABLE_THROTTLE
+#define MAX_TEMP_MEAS_SIZE                          (6)
+#else
+#define MAX_TEMP_MEAS_SIZE                          (5)
+#endif /* ENABLE_THROTTLE */
+
+/* Number of words of NVM memory reserved for Health Thermometer service. 
+ * The Temperature Client Configuration used to be stored there, it is now 
+ * stored for each bond by the bond table.
+ */
+#define HEALTH_THERMO_SERVICE_NVM_MEMORY_WORDS      (1)
+
+/*============================================================================*
+ *  Public Data Declarations
+ *===========================================================================*/
+
+/* Number of reports sent to the host */
+extern uint8 send_count;
+
 /*============================================================================*
  *  Public Function Prototypes
  *===========================================================================*/
@@ -70,9 +103,5 @@ extern void HealthThermoBondingNotify(void);
 
 extern bool HealthThermoMeasIndConfigStatus(void);
  */
-#ifdef NVM_TYPE_FLASH
-/* This function writes Health Thermometer service data in NVM */
-extern void WriteHealthThermometerServiceDataInNvm(void);
-#endif /* NVM_TYPE_FLASH */
 
 #endif /* __HEALTH_THERMO_SERVICE_H__ */
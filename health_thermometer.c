@@ -29,6 +29,7 @@
 #include <security.h>
 #include <panic.h>
 #include <nvm.h>
+#include <sleep.h>
 #include <thermometer.h>
 
 /*============================================================================*
@@ -44,44 +45,106 @@
 #include "gap_service.h"
 #include "health_thermo_service.h"
 #include "battery_service.h"
+#include "diag_service.h"
+#include "hid_service.h"
+#include "tx_power.h"
+#include "app_trace.h"
+#include "app_perf.h"
+#include "counter_store.h"
+#include "bond_table.h"
+#include "app_sched.h"
 
 /*============================================================================*
  *  Private Definitions
  *============================================================================*/
 
-/* Maximum number of timers */
+/* Maximum number of timers. The low priority jobs, such as the steps of the
+ * buzzer patterns, share a single one of them (see app_sched.c).
+ */
 #define MAX_APP_TIMERS                 (5)
 
-/*Number of IRKs that application can store */
-#define MAX_NUMBER_IRK_STORED          (1)
-
 /* Magic value to check the sanity of NVM region used by the application */
 #define NVM_SANITY_MAGIC               (0xAB08)
 
 /* NVM offset for NVM sanity word */
 #define NVM_OFFSET_SANITY_WORD         (0)
 
-/* NVM offset for bonded flag */
-#define NVM_OFFSET_BONDED_FLAG         (NVM_OFFSET_SANITY_WORD + 1)
-
-/* NVM offset for bonded device bluetooth address */
-#define NVM_OFFSET_BONDED_ADDR         (NVM_OFFSET_BONDED_FLAG + \
-                                        sizeof(g_ht_data.bonded))
+/* NVM offset for the application record group. The group holds the last
+ * diversifier issued behind a header carrying the layout version and a CRC16.
+ * The bonds themselves are kept by the bond table.
+ */
+#define NVM_OFFSET_APP_GROUP           (NVM_OFFSET_SANITY_WORD + 1)
 
-/* NVM offset for diversifier */
-#define NVM_OFFSET_SM_DIV              (NVM_OFFSET_BONDED_ADDR + \
-                                        sizeof(g_ht_data.bonded_bd_addr))
+/* Number of words in the application record group */
+#define NVM_APP_GROUP_WORDS            (sizeof(g_ht_data.diversifier))
 
-/* NVM offset for IRK */
-#define NVM_OFFSET_SM_IRK              (NVM_OFFSET_SM_DIV + \
-                                        sizeof(g_ht_data.diversifier))
+/* NVM offsets used by the layout version 1 application record group, which
+ * held the single bond of the application: bonded flag, bonded device 
+ * bluetooth address, diversifier and IRK
+ */
+#define NVM_V1_OFFSET_BONDED_FLAG      (NVM_OFFSET_APP_GROUP + \
+                                        NVM_GROUP_HEADER_WORDS)
+#define NVM_V1_OFFSET_BONDED_ADDR      (NVM_V1_OFFSET_BONDED_FLAG + 1)
+#define NVM_V1_OFFSET_SM_DIV           (NVM_V1_OFFSET_BONDED_ADDR + \
+                                        sizeof(TYPED_BD_ADDR_T))
+#define NVM_V1_OFFSET_SM_IRK           (NVM_V1_OFFSET_SM_DIV + 1)
 
 /* Number of words of NVM used by application. Memory used by supported 
- * services is not taken into consideration here.
+ * services is not taken into consideration here. The words of the layout 
+ * version 1 group are kept reserved, so the services data does not move.
  */
-#define NVM_MAX_APP_MEMORY_WORDS       (NVM_OFFSET_SM_IRK + \
+#define NVM_MAX_APP_MEMORY_WORDS       (NVM_V1_OFFSET_SM_IRK + \
                                         MAX_WORDS_IRK)
 
+/* Number of words in the layout version 1 application record group */
+#define NVM_V1_APP_GROUP_WORDS         (NVM_MAX_APP_MEMORY_WORDS - \
+                                        NVM_V1_OFFSET_BONDED_FLAG)
+
+/* Index in the layout version 1 application record group of the word stored
+ * at the given NVM offset
+ */
+#define NVM_V1_APP_GROUP_INDEX(offset) ((offset) - NVM_V1_OFFSET_BONDED_FLAG)
+
+/* Version of the NVM layout. Version 0 is the original layout, where the 
+ * application data followed the sanity word without a group header. Its 
+ * bonded flag, stored where the group header now is, reads as version 0.
+ * Version 1 added the group header. Version 2 moved the bond to the bond 
+ * table.
+ */
+#define NVM_LAYOUT_VERSION             (2)
+#define NVM_LAYOUT_VERSION_V1          (1)
+
+/* Number of words moved at a time while migrating an older layout */
+#define NVM_MIGRATE_CHUNK_WORDS        (8)
+
+/* Number of words of NVM the layout version 0 was written to. This was the 
+ * nvm_size set in the .keyr files at the time.
+ */
+#define NVM_V0_MEMORY_WORDS            (0x40)
+
+/* The layout version 0 words following the sanity word are copied into a 
+ * record group past the words they are moved to before being moved, so 
+ * that a migration cut short can be finished from the copy. The copy is 
+ * within the RAM shadow of the NVM, which on SPI flash holds the whole 
+ * logical NVM.
+ */
+#define NVM_V0_COPY_WORDS              (NVM_V0_MEMORY_WORDS - \
+                                        NVM_OFFSET_APP_GROUP)
+#define NVM_V0_COPY_OFFSET             (NVM_V0_MEMORY_WORDS + \
+                                        NVM_GROUP_HEADER_WORDS)
+#define NVM_V0_COPY_VERSION            (0x7f)
+
+/* Number of words of NVM used by the application, the supported services and 
+ * the bond table, laid out in this order by readPersistentStore()
+ */
+#define NVM_LAYOUT_WORDS               (NVM_MAX_APP_MEMORY_WORDS + \
+                                    GAP_SERVICE_NVM_MEMORY_WORDS + \
+                                    HEALTH_THERMO_SERVICE_NVM_MEMORY_WORDS + \
+                                    BATTERY_SERVICE_NVM_MEMORY_WORDS + \
+                                    DIAG_SERVICE_NVM_MEMORY_WORDS + \
+                                    COUNTER_STORE_NVM_MEMORY_WORDS + \
+                                    BOND_TABLE_NVM_MEMORY_WORDS)
+
 /* Slave device is not allowed to transmit another Connection Parameter 
  * Update request till time TGAP(conn_param_timeout). Refer to section 9.3.9.2,
  * Vol 3, Part C of the Core 4.0 BT spec. The application should retry the 
@@ -110,6 +173,58 @@
  */
 #define HT_TEMP_MEAS_TIME              (40 * SECOND)
 
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Application events dispatched through the application state table. Each
+ * event corresponds to one LM event code handled by the application.
+ */
+typedef enum
+{
+    app_event_gatt_add_db_cfm = 0,
+    app_event_gatt_cancel_connect_cfm,
+    app_event_lm_connection_complete,
+    app_event_gatt_connect_cfm,
+    app_event_sm_keys_ind,
+    app_event_sm_pairing_auth_ind,
+    app_event_sm_simple_pairing_complete_ind,
+    app_event_lm_encryption_change,
+    app_event_sm_div_approve_ind,
+    app_event_ls_conn_param_update_cfm,
+    app_event_lm_connection_update,
+    app_event_ls_conn_param_update_ind,
+    app_event_gatt_access_ind,
+    app_event_lm_disconnect_complete,
+    app_event_gatt_char_val_not_cfm,
+
+    /* Number of application events. This must always be the last entry */
+    app_event_max
+
+} app_event;
+
+/* Action for an application event. It returns the application state to
+ * move to once the event has been handled.
+ */
+typedef app_state (*APP_EVENT_ACTION_T)(LM_EVENT_T *p_event_data);
+
+/* Functions called upon entering and exiting an application state */
+typedef struct
+{
+    void (*entry)(void);
+
+    void (*exit)(void);
+
+} APP_STATE_HOOKS_T;
+
+/* The NVM layout, and the copy of the layout version 0 words made while 
+ * migrating them, must be held by the RAM shadow of the NVM. If the first 
+ * check fails, MAX_BONDED_DEVICES is too high (see user_config.h).
+ */
+NVM_STATIC_ASSERT(NVM_LAYOUT_WORDS <= NVM_SHADOW_WORDS, NVM_LAYOUT_FITS_T);
+NVM_STATIC_ASSERT(NVM_V0_COPY_OFFSET + NVM_V0_COPY_WORDS <= NVM_SHADOW_WORDS,
+                  NVM_V0_COPY_FITS_T);
+
 /*============================================================================*
  *  Private Data
  *============================================================================*/
@@ -132,17 +247,200 @@ HT_DATA_T g_ht_data;
 
 static void htDataInit(void);
 static void readPersistentStore(void);
+static bool readAppGroup(void);
+static void writeAppGroup(void);
+static void migrateNvmLayoutV0(bool copied);
+static void migrateNvmLayoutV1(void);
+static void eraseNvmLayoutV1(void);
+static bool resumeNvmLayoutV1(void);
 static void requestConnParamUpdate(timer_id tid);
+static void releaseLowLatency(void);
+static void requestPreferredParams(void);
+#ifdef ENABLE_POWER_LADDER
+static void ladderStep(void);
+#ifdef LADDER_DORMANT
+static void ladderDormant(void);
+#endif /* LADDER_DORMANT */
+#endif /* ENABLE_POWER_LADDER */
+static void openPairingWindow(void);
+static void closePairingWindow(void);
 static void htTempMeasTimerHandler(timer_id tid);
 static void appInitExit(void);
 static void appAdvertisingExit(void);
-static void handleSignalSmPairingAuthInd(SM_PAIRING_AUTH_IND_T *p_event_data);
+static void appDisconnectingExit(void);
+static void appFastAdvertisingEntry(void);
+static void appSlowAdvertisingEntry(void);
+static void appConnectedEntry(void);
+static void appConnectedExit(void);
+static void appDisconnectingEntry(void);
+static void appIdleEntry(void);
+static app_state handleInvalidEvent(LM_EVENT_T *p_event_data);
+static app_state handleIgnoredEvent(LM_EVENT_T *p_event_data);
+static app_state handleSignalGattAddDbCfm(LM_EVENT_T *p_event_data);
+static app_state handleSignalGattCancelConnectCfm(LM_EVENT_T *p_event_data);
+static app_state handleSignalLmEvConnectionComplete(LM_EVENT_T *p_event_data);
+static app_state handleSignalGattConnectCfm(LM_EVENT_T *p_event_data);
+static app_state handleSignalSmKeysInd(LM_EVENT_T *p_event_data);
+static app_state handleSignalSmPairingAuthInd(LM_EVENT_T *p_event_data);
+static app_state handleSignalSmSimplePairingCompleteInd(
+                                                 LM_EVENT_T *p_event_data);
+static app_state handleSignalLMEncryptionChange(LM_EVENT_T *p_event_data);
+static app_state handleSignalSmDivApproveInd(LM_EVENT_T *p_event_data);
+static app_state handleSignalLsConnParamUpdateCfm(LM_EVENT_T *p_event_data);
+static app_state handleSignalLmConnectionUpdate(LM_EVENT_T *p_event_data);
+static app_state handleSignalLsConnParamUpdateInd(LM_EVENT_T *p_event_data);
+static app_state handleSignalGattAccessInd(LM_EVENT_T *p_event_data);
+static app_state handleSignalLmDisconnectComplete(LM_EVENT_T *p_event_data);
+static app_state handleSignalGattCharValNotCfm(LM_EVENT_T *p_event_data);
 static void handleBondingChanceTimerExpiry(timer_id tid);
-static void handleSignalLmDisconnectComplete(HCI_EV_DATA_DISCONNECT_COMPLETE_T 
-                                                                *p_event_data);
-static void handleSignalLmConnectionUpdate(
-                                       LM_EV_CONNECTION_UPDATE_T* p_event_data);
 static void handleGapCppTimerExpiry(timer_id tid);
+static app_event appEventFromLmEvent(lm_event_code event_code);
+
+/*============================================================================*
+ *  Application State Tables
+ *============================================================================*/
+
+/* Entry and exit hooks of every application state, indexed by app_state */
+static const APP_STATE_HOOKS_T app_state_hooks[app_state_max] =
+{
+    /*  entry                       exit                                    */
+    {   NULL,                       appInitExit             }, /* init      */
+    {   appFastAdvertisingEntry,    appAdvertisingExit      }, /* fast adv  */
+    {   appSlowAdvertisingEntry,    appAdvertisingExit      }, /* slow adv  */
+    {   appConnectedEntry,          appConnectedExit        }, /* connected */
+    {   appDisconnectingEntry,      appDisconnectingExit    }, /* disconn.. */
+    {   appIdleEntry,               NULL                    }  /* idle      */
+};
+
+/* Short names used only to keep the event table below readable */
+#define EV_INVALID                  handleInvalidEvent
+#define EV_IGNORE                   handleIgnoredEvent
+
+/* Action taken for every (application state, application event) pair. The
+ * action returns the state the application moves to once it has completed.
+ * Events not expected in a state lead to app_panic_invalid_state.
+ */
+static const APP_EVENT_ACTION_T
+                            app_event_table[app_state_max][app_event_max] =
+{
+    /* app_state_init */
+    {
+        handleSignalGattAddDbCfm,           /* GATT_ADD_DB_CFM               */
+        EV_INVALID,                         /* GATT_CANCEL_CONNECT_CFM       */
+        handleSignalLmEvConnectionComplete, /* LM_EV_CONNECTION_COMPLETE     */
+        EV_INVALID,                         /* GATT_CONNECT_CFM              */
+        EV_INVALID,                         /* SM_KEYS_IND                   */
+        EV_INVALID,                         /* SM_PAIRING_AUTH_IND           */
+        EV_IGNORE,                          /* SM_SIMPLE_PAIRING_COMPLETE_IND*/
+        EV_INVALID,                         /* LM_EV_ENCRYPTION_CHANGE       */
+        EV_INVALID,                         /* SM_DIV_APPROVE_IND            */
+        EV_INVALID,                         /* LS_CONNECTION_PARAM_UPDATE_CFM*/
+        EV_INVALID,                         /* LM_EV_CONNECTION_UPDATE       */
+        EV_INVALID,                         /* LS_CONNECTION_PARAM_UPDATE_IND*/
+        EV_INVALID,                         /* GATT_ACCESS_IND               */
+        EV_INVALID,                         /* LM_EV_DISCONNECT_COMPLETE     */
+        EV_IGNORE                           /* GATT_CHAR_VAL_NOT_CFM         */
+    },
+
+    /* app_state_fast_advertising */
+    {
+        EV_INVALID,                         /* GATT_ADD_DB_CFM               */
+        handleSignalGattCancelConnectCfm,   /* GATT_CANCEL_CONNECT_CFM       */
+        handleSignalLmEvConnectionComplete, /* LM_EV_CONNECTION_COMPLETE     */
+        handleSignalGattConnectCfm,         /* GATT_CONNECT_CFM              */
+        EV_INVALID,                         /* SM_KEYS_IND                   */
+        EV_INVALID,                         /* SM_PAIRING_AUTH_IND           */
+        EV_IGNORE,                          /* SM_SIMPLE_PAIRING_COMPLETE_IND*/
+        EV_INVALID,                         /* LM_EV_ENCRYPTION_CHANGE       */
+        EV_INVALID,                         /* SM_DIV_APPROVE_IND            */
+        EV_INVALID,                         /* LS_CONNECTION_PARAM_UPDATE_CFM*/
+        EV_INVALID,                         /* LM_EV_CONNECTION_UPDATE       */
+        EV_INVALID,                         /* LS_CONNECTION_PARAM_UPDATE_IND*/
+        EV_INVALID,                         /* GATT_ACCESS_IND               */
+        EV_INVALID,                         /* LM_EV_DISCONNECT_COMPLETE     */
+        EV_IGNORE                           /* GATT_CHAR_VAL_NOT_CFM         */
+    },
+
+    /* app_state_slow_advertising */
+    {
+        EV_INVALID,                         /* GATT_ADD_DB_CFM               */
+        handleSignalGattCancelConnectCfm,   /* GATT_CANCEL_CONNECT_CFM       */
+        handleSignalLmEvConnectionComplete, /* LM_EV_CONNECTION_COMPLETE     */
+        handleSignalGattConnectCfm,         /* GATT_CONNECT_CFM              */
+        EV_INVALID,                         /* SM_KEYS_IND                   */
+        EV_INVALID,                         /* SM_PAIRING_AUTH_IND           */
+        EV_IGNORE,                          /* SM_SIMPLE_PAIRING_COMPLETE_IND*/
+        EV_INVALID,                         /* LM_EV_ENCRYPTION_CHANGE       */
+        EV_INVALID,                         /* SM_DIV_APPROVE_IND            */
+        EV_INVALID,                         /* LS_CONNECTION_PARAM_UPDATE_CFM*/
+        EV_INVALID,                         /* LM_EV_CONNECTION_UPDATE       */
+        EV_INVALID,                         /* LS_CONNECTION_PARAM_UPDATE_IND*/
+        EV_INVALID,                         /* GATT_ACCESS_IND               */
+        EV_INVALID,                         /* LM_EV_DISCONNECT_COMPLETE     */
+        EV_IGNORE                           /* GATT_CHAR_VAL_NOT_CFM         */
+    },
+
+    /* app_state_connected */
+    {
+        EV_INVALID,                         /* GATT_ADD_DB_CFM               */
+        EV_INVALID,                         /* GATT_CANCEL_CONNECT_CFM       */
+        handleSignalLmEvConnectionComplete, /* LM_EV_CONNECTION_COMPLETE     */
+        EV_INVALID,                         /* GATT_CONNECT_CFM              */
+        handleSignalSmKeysInd,              /* SM_KEYS_IND                   */
+        handleSignalSmPairingAuthInd,       /* SM_PAIRING_AUTH_IND           */
+        handleSignalSmSimplePairingCompleteInd,
+                                            /* SM_SIMPLE_PAIRING_COMPLETE_IND*/
+        handleSignalLMEncryptionChange,     /* LM_EV_ENCRYPTION_CHANGE       */
+        handleSignalSmDivApproveInd,        /* SM_DIV_APPROVE_IND            */
+        handleSignalLsConnParamUpdateCfm,   /* LS_CONNECTION_PARAM_UPDATE_CFM*/
+        handleSignalLmConnectionUpdate,     /* LM_EV_CONNECTION_UPDATE       */
+        handleSignalLsConnParamUpdateInd,   /* LS_CONNECTION_PARAM_UPDATE_IND*/
+        handleSignalGattAccessInd,          /* GATT_ACCESS_IND               */
+        handleSignalLmDisconnectComplete,   /* LM_EV_DISCONNECT_COMPLETE     */
+        handleSignalGattCharValNotCfm       /* GATT_CHAR_VAL_NOT_CFM         */
+    },
+
+    /* app_state_disconnecting */
+    {
+        EV_INVALID,                         /* GATT_ADD_DB_CFM               */
+        EV_INVALID,                         /* GATT_CANCEL_CONNECT_CFM       */
+        handleSignalLmEvConnectionComplete, /* LM_EV_CONNECTION_COMPLETE     */
+        EV_INVALID,                         /* GATT_CONNECT_CFM              */
+        EV_INVALID,                         /* SM_KEYS_IND                   */
+        EV_INVALID,                         /* SM_PAIRING_AUTH_IND           */
+        EV_IGNORE,                          /* SM_SIMPLE_PAIRING_COMPLETE_IND*/
+        EV_INVALID,                         /* LM_EV_ENCRYPTION_CHANGE       */
+        EV_INVALID,                         /* SM_DIV_APPROVE_IND            */
+        EV_INVALID,                         /* LS_CONNECTION_PARAM_UPDATE_CFM*/
+        handleSignalLmConnectionUpdate,     /* LM_EV_CONNECTION_UPDATE       */
+        EV_INVALID,                         /* LS_CONNECTION_PARAM_UPDATE_IND*/
+        EV_INVALID,                         /* GATT_ACCESS_IND               */
+        handleSignalLmDisconnectComplete,   /* LM_EV_DISCONNECT_COMPLETE     */
+        EV_IGNORE                           /* GATT_CHAR_VAL_NOT_CFM         */
+    },
+
+    /* app_state_idle */
+    {
+        EV_INVALID,                         /* GATT_ADD_DB_CFM               */
+        EV_INVALID,                         /* GATT_CANCEL_CONNECT_CFM       */
+        handleSignalLmEvConnectionComplete, /* LM_EV_CONNECTION_COMPLETE     */
+        EV_INVALID,                         /* GATT_CONNECT_CFM              */
+        EV_INVALID,                         /* SM_KEYS_IND                   */
+        EV_INVALID,                         /* SM_PAIRING_AUTH_IND           */
+        EV_IGNORE,                          /* SM_SIMPLE_PAIRING_COMPLETE_IND*/
+        EV_INVALID,                         /* LM_EV_ENCRYPTION_CHANGE       */
+        EV_INVALID,                         /* SM_DIV_APPROVE_IND            */
+        EV_INVALID,                         /* LS_CONNECTION_PARAM_UPDATE_CFM*/
+        EV_INVALID,                         /* LM_EV_CONNECTION_UPDATE       */
+        EV_INVALID,                         /* LS_CONNECTION_PARAM_UPDATE_IND*/
+        EV_INVALID,                         /* GATT_ACCESS_IND               */
+        EV_INVALID,                         /* LM_EV_DISCONNECT_COMPLETE     */
+        EV_IGNORE                           /* GATT_CHAR_VAL_NOT_CFM         */
+    }
+};
+
+#undef EV_INVALID
+#undef EV_IGNORE
 
 /*============================================================================*
  *  Private Function Implementations
@@ -185,6 +483,16 @@ static void htDataInit(void)
     g_ht_data.conn_latency = 0;
     g_ht_data.conn_timeout = 0;
 
+    AppSchedStop(app_sched_job_low_latency);
+    g_ht_data.low_latency = FALSE;
+
+#ifdef ENABLE_POWER_LADDER
+    AppSchedStop(app_sched_job_ladder);
+    g_ht_data.relaxed = FALSE;
+    g_ht_data.ladder_disconnect = FALSE;
+    g_ht_data.key_wake = FALSE;
+#endif /* ENABLE_POWER_LADDER */
+
     /* Health thermometer hardware data initialisation */
     HtHwDataInit();
 
@@ -197,6 +505,260 @@ static void htDataInit(void)
     /* Health Thermometer Service data initialisation */
     HealthThermoDataInit();
 
+    /* Diagnostics Service data initialisation */
+    DiagDataInit();
+
+#ifdef ENABLE_HID_MODE
+    /* HID Service data initialisation */
+    HidDataInit();
+#endif /* ENABLE_HID_MODE */
+
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readAppGroup
+ *
+ *  DESCRIPTION
+ *      This function reads the application record group from NVM into the 
+ *      application data instance if the group is valid.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if the group was valid and has been read.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool readAppGroup(void)
+{
+    return Nvm_ReadGroup(&g_ht_data.diversifier, NVM_APP_GROUP_WORDS, 
+                         NVM_OFFSET_APP_GROUP, NVM_LAYOUT_VERSION);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      writeAppGroup
+ *
+ *  DESCRIPTION
+ *      This function writes the last diversifier issued to NVM as the 
+ *      application record group.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void writeAppGroup(void)
+{
+    Nvm_WriteGroup(&g_ht_data.diversifier, NVM_APP_GROUP_WORDS, 
+                   NVM_OFFSET_APP_GROUP, NVM_LAYOUT_VERSION);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      migrateNvmLayoutV0
+ *
+ *  DESCRIPTION
+ *      This function converts the original NVM layout (version 0). The 
+ *      application and services data are moved up to make room for the 
+ *      application group header. They are first copied into a record group 
+ *      at NVM_V0_COPY_OFFSET, unless 'copied' says a migration cut short 
+ *      has done so already, then written back from the copy to where they 
+ *      move, and the header is written.
+ *
+ *      Until the copy is committed the original words are untouched, and 
+ *      from then on the migration is finished from the copy at the next 
+ *      start-up, so a reset at any point keeps the bond. The result is a 
+ *      layout version 1 group, which migrateNvmLayoutV1() converts further.
+ *      The copy lies where the current layout keeps the services data which 
+ *      is read next, so it is erased last.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void migrateNvmLayoutV0(bool copied)
+{
+    uint16 words[NVM_MIGRATE_CHUNK_WORDS];
+    uint16 group[NVM_V1_APP_GROUP_WORDS];
+    uint16 index;
+    uint16 length;
+
+    if(!copied)
+    {
+        Nvm_CopyToGroup(NVM_V0_COPY_WORDS, NVM_OFFSET_APP_GROUP, 
+                        NVM_V0_COPY_OFFSET, NVM_V0_COPY_VERSION);
+    }
+
+    for(index = 0; index < NVM_V0_COPY_WORDS; index += length)
+    {
+        length = NVM_V0_COPY_WORDS - index;
+
+        if(length > NVM_MIGRATE_CHUNK_WORDS)
+        {
+            length = NVM_MIGRATE_CHUNK_WORDS;
+        }
+
+        Nvm_Read(words, length, 
+                 NVM_V0_COPY_OFFSET + NVM_GROUP_HEADER_WORDS + index);
+        Nvm_Write(words, length, NVM_V1_OFFSET_BONDED_FLAG + index);
+    }
+
+    /* The application data is now where the group expects it, write the 
+     * header in front of it
+     */
+    Nvm_Read(group, NVM_V1_APP_GROUP_WORDS, NVM_V1_OFFSET_BONDED_FLAG);
+    Nvm_WriteGroup(group, NVM_V1_APP_GROUP_WORDS, NVM_OFFSET_APP_GROUP,
+                   NVM_LAYOUT_VERSION_V1);
+
+    /* Erase the copy, its header first. The words past the version 0 
+     * layout read as erased again, as they did before the migration.
+     */
+    MemSet(words, 0xffff, NVM_MIGRATE_CHUNK_WORDS);
+
+    for(index = 0; index < NVM_GROUP_HEADER_WORDS + NVM_V0_COPY_WORDS; 
+        index += length)
+    {
+        length = NVM_GROUP_HEADER_WORDS + NVM_V0_COPY_WORDS - index;
+
+        if(length > NVM_MIGRATE_CHUNK_WORDS)
+        {
+            length = NVM_MIGRATE_CHUNK_WORDS;
+        }
+
+        Nvm_Write(words, length, NVM_V0_COPY_OFFSET + index);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      migrateNvmLayoutV1
+ *
+ *  DESCRIPTION
+ *      This function converts the layout version 1 application group, which 
+ *      held a single bond, once the bond table has been read. The bond is 
+ *      added to the bond table and the group is rewritten with the 
+ *      diversifier only. The client configurations of the bond are not 
+ *      carried over, the central device writes them again when it 
+ *      reconnects.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void migrateNvmLayoutV1(void)
+{
+    uint16 group[NVM_V1_APP_GROUP_WORDS];
+    TYPED_BD_ADDR_T bd_addr;
+    uint16 *p_irk = NULL;
+
+    g_ht_data.diversifier = 0;
+
+    if(Nvm_ReadGroup(group, NVM_V1_APP_GROUP_WORDS, NVM_OFFSET_APP_GROUP,
+                     NVM_LAYOUT_VERSION_V1))
+    {
+        g_ht_data.diversifier = 
+                    group[NVM_V1_APP_GROUP_INDEX(NVM_V1_OFFSET_SM_DIV)];
+
+        if(group[NVM_V1_APP_GROUP_INDEX(NVM_V1_OFFSET_BONDED_FLAG)])
+        {
+            MemCopy(&bd_addr,
+                    &group[NVM_V1_APP_GROUP_INDEX(NVM_V1_OFFSET_BONDED_ADDR)],
+                    sizeof(TYPED_BD_ADDR_T));
+
+            if(GattIsAddressResolvableRandom(&bd_addr))
+            {
+                p_irk = &group[NVM_V1_APP_GROUP_INDEX(NVM_V1_OFFSET_SM_IRK)];
+            }
+
+            /* A migration cut short may have added the bond already, 
+             * replace it rather than adding it twice
+             */
+            BondTableSetActive(BondTableFind(&bd_addr));
+            BondTableAdd(&bd_addr, g_ht_data.diversifier, p_irk);
+
+            /* Nothing is connected yet */
+            BondTableSetActive(BOND_TABLE_INVALID);
+        }
+    }
+
+    writeAppGroup();
+    eraseNvmLayoutV1();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      eraseNvmLayoutV1
+ *
+ *  DESCRIPTION
+ *      This function erases the words of the layout version 1 group past 
+ *      the current application group, once the conversion has been 
+ *      committed. Until then resumeNvmLayoutV1() finishes the conversion 
+ *      from them.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void eraseNvmLayoutV1(void)
+{
+    uint16 words[NVM_MAX_APP_MEMORY_WORDS - NVM_V1_OFFSET_BONDED_ADDR];
+
+    MemSet(words, 0xffff, NVM_MAX_APP_MEMORY_WORDS - 
+                          NVM_V1_OFFSET_BONDED_ADDR);
+    Nvm_Write(words, NVM_MAX_APP_MEMORY_WORDS - NVM_V1_OFFSET_BONDED_ADDR, 
+              NVM_V1_OFFSET_BONDED_ADDR);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      resumeNvmLayoutV1
+ *
+ *  DESCRIPTION
+ *      This function is called when the application group is not valid, 
+ *      once the bond table has been read. A conversion of the layout 
+ *      version 1 group cut short while the new group was written leaves 
+ *      the bonded address and diversifier of the old group in place, and 
+ *      the bond in the bond table. If they match, the diversifier is taken 
+ *      from the old group and the conversion is finished.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if the conversion was finished.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool resumeNvmLayoutV1(void)
+{
+    TYPED_BD_ADDR_T bd_addr;
+    uint16 diversifier;
+    uint16 index;
+
+    Nvm_Read((uint16*)&bd_addr, sizeof(TYPED_BD_ADDR_T), 
+             NVM_V1_OFFSET_BONDED_ADDR);
+    Nvm_Read(&diversifier, sizeof(diversifier), NVM_V1_OFFSET_SM_DIV);
+
+    index = BondTableFind(&bd_addr);
+
+    if(index == BOND_TABLE_INVALID ||
+       BondTableFindDiversifier(diversifier) != index)
+    {
+        return FALSE;
+    }
+
+    g_ht_data.diversifier = diversifier;
+
+    writeAppGroup();
+    eraseNvmLayoutV1();
+
+    return TRUE;
 }
 
 
@@ -217,6 +779,15 @@ static void readPersistentStore(void)
     /* NVM offset for supported services */
     uint16 nvm_offset = NVM_MAX_APP_MEMORY_WORDS;
     uint16 nvm_sanity = 0xffff;
+    uint16 nvm_header;
+    uint16 nvm_version = NVM_LAYOUT_VERSION;
+    bool nvm_copied;
+    bool nvm_fresh = FALSE;
+    bool app_group_valid = TRUE;
+
+    /* The Nvm_Read() calls below, including the ones made by the services, 
+     * are served from the RAM shadow of the NVM loaded at start-up.
+     */
 
     /* Read persistent storage to know if the device was last bonded 
      * to another device 
@@ -233,45 +804,42 @@ static void readPersistentStore(void)
 
     if(nvm_sanity == NVM_SANITY_MAGIC)
     {
+        /* Find out which layout the NVM was written with */
+        Nvm_Read(&nvm_header, 
+                 sizeof(nvm_header), 
+                 NVM_OFFSET_APP_GROUP);
 
-        /* Read Bonded Flag from NVM */
-        Nvm_Read((uint16*)&g_ht_data.bonded,
-                  sizeof(g_ht_data.bonded),
-                  NVM_OFFSET_BONDED_FLAG);
+        nvm_version = NVM_GROUP_HEADER_VERSION(nvm_header);
 
-        if(g_ht_data.bonded)
-        {
-            /* Bonded Host Typed BD Address will only be stored if bonded flag
-             * is set to TRUE. Read last bonded device address.
-             */
-            Nvm_Read((uint16*)&g_ht_data.bonded_bd_addr, 
-                       sizeof(TYPED_BD_ADDR_T),
-                       NVM_OFFSET_BONDED_ADDR);
-
-            /* If device is bonded and bonded address is resolvable then read 
-             * the bonded device's IRK
-             */
-            if(GattIsAddressResolvableRandom(&g_ht_data.bonded_bd_addr))
-            {
-                Nvm_Read(g_ht_data.central_device_irk.irk, 
-                         MAX_WORDS_IRK,
-                         NVM_OFFSET_SM_IRK);
-            }
+        /* A valid copy of the layout version 0 words means their migration 
+         * was cut short, whatever the header reads
+         */
+        nvm_copied = Nvm_CheckGroup(NVM_V0_COPY_WORDS, NVM_V0_COPY_OFFSET, 
+                                    NVM_V0_COPY_VERSION);
 
-        }
-        else /* Case when we have only written NVM_SANITY_MAGIC to NVM but 
-              * didn't get bonded to any host in the last powered session
-              */
+        if(nvm_version == 0 || nvm_copied)
         {
-            g_ht_data.bonded = FALSE;
+            /* Written by an older version of the application, convert it
+             * keeping the bond
+             */
+            migrateNvmLayoutV0(nvm_copied);
+            nvm_version = NVM_LAYOUT_VERSION_V1;
         }
 
-        /* Read the diversifier associated with the presently bonded/last 
-         * bonded device.
+        /* A layout version 1 group is converted once the bond table has 
+         * been read
          */
-        Nvm_Read(&g_ht_data.diversifier, 
-                 sizeof(g_ht_data.diversifier),
-                 NVM_OFFSET_SM_DIV);
+        if((nvm_version != NVM_LAYOUT_VERSION_V1) && !readAppGroup())
+        {
+            /* The group is corrupt or was written by a newer layout. 
+             * Unless it is a conversion of the layout version 1 group cut 
+             * short, the diversifier is reset, so the bonds are discarded 
+             * as well once the bond table has been read. The services data 
+             * is kept.
+             */
+            app_group_valid = FALSE;
+            g_ht_data.diversifier = 0;
+        }
 
         /* If NVM in use, read device name and length from NVM */
         GapReadDataFromNVM(&nvm_offset);
@@ -283,6 +851,11 @@ static void readPersistentStore(void)
           */
     {
 
+        nvm_fresh = TRUE;
+
+        /* Commit the fresh NVM contents in a single batch */
+        Nvm_BeginBatch();
+
         nvm_sanity = NVM_SANITY_MAGIC;
 
         /* Write NVM Sanity word to the NVM */
@@ -290,46 +863,79 @@ static void readPersistentStore(void)
                   sizeof(nvm_sanity), 
                   NVM_OFFSET_SANITY_WORD);
 
-        /* The device will not be bonded as it is coming up for the first 
-         * time 
-         */
-        g_ht_data.bonded = FALSE;
-
-        /* Write bonded status to NVM */
-        Nvm_Write((uint16*)&g_ht_data.bonded, 
-                  sizeof(g_ht_data.bonded), 
-                  NVM_OFFSET_BONDED_FLAG);
-
         /* When the application is coming up for the first time after flashing 
          * the image to it, it will not have bonded to any device. So, no LTK 
          * will be associated with it. Hence, set the diversifier to 0.
          */
         g_ht_data.diversifier = 0;
 
-        /* Write the same to NVM. */
-        Nvm_Write(&g_ht_data.diversifier, 
-                  sizeof(g_ht_data.diversifier),
-                  NVM_OFFSET_SM_DIV);
+        /* Write the application group to NVM */
+        writeAppGroup();
 
         /* If fresh NVM, write device name and length to NVM for the 
          * first time.
          */
         GapInitWriteDataToNVM(&nvm_offset);
+
+        Nvm_EndBatch();
     
     }
 
-    /* Read Health Thermometer service data from NVM if the devices are bonded 
-     * and update the offset with the number of word of NVM required by 
-     * this service
+    /* Update the offset with the number of word of NVM reserved for 
+     * Health Thermometer service
      */
     HealthThermoReadDataFromNVM(&nvm_offset);
 
-    /* Read Battery service data from NVM if the devices are bonded and  
-     * update the offset with the number of word of NVM required by 
-     * this service
+    /* Update the offset with the number of word of NVM reserved for 
+     * Battery service
      */
     BatteryReadDataFromNVM(&nvm_offset);
 
+    /* Read the panic record left by the previous power cycle, if any, and 
+     * update the offset with the number of word of NVM required by 
+     * Diagnostics service
+     */
+    DiagReadDataFromNVM(&nvm_offset);
+
+    /* Restore the counters from their last checkpoint and update the 
+     * offset with the number of words of NVM used by the checkpoints
+     */
+    CounterStoreReadDataFromNVM(&nvm_offset);
+
+    if(nvm_fresh)
+    {
+        /* The device will not be bonded as it is coming up for the first 
+         * time
+         */
+        BondTableInitWriteDataToNVM(&nvm_offset);
+    }
+    else
+    {
+        /* Read the bonds and update the offset with the number of words of 
+         * NVM used by the bond table
+         */
+        BondTableReadDataFromNVM(&nvm_offset);
+
+        if(nvm_version == NVM_LAYOUT_VERSION_V1)
+        {
+            /* Move the bond of the older layout into the bond table */
+            migrateNvmLayoutV1();
+        }
+        else if(!app_group_valid && !resumeNvmLayoutV1())
+        {
+            /* The diversifiers of the bonds may be issued again */
+            BondTableRemoveAll();
+            writeAppGroup();
+        }
+    }
+
+#ifdef NVM_TYPE_FLASH
+    /* Nothing time critical is going on yet, compact the record log now if 
+     * it is filling up
+     */
+    Nvm_CompactLog();
+#endif /* NVM_TYPE_FLASH */
+
 }
 
 
@@ -368,6 +974,9 @@ static void requestConnParamUpdate(timer_id tid)
                  */
                 ++ g_ht_data.num_conn_update_req;
 
+                APP_TRACE(app_trace_conn_param_req,
+                          g_ht_data.num_conn_update_req);
+
                 /* Decide which parameter values are to be requested.
                  */
                 if(g_ht_data.num_conn_update_req <= 
@@ -404,6 +1013,8 @@ static void requestConnParamUpdate(timer_id tid)
                     ReportPanic(app_panic_con_param_update);
                 }
 
+                APP_PERF_INC(app_perf_conn_param_reqs);
+
 
             }
             break;
@@ -420,54 +1031,322 @@ static void requestConnParamUpdate(timer_id tid)
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      htTempMeasTimerHandler
+ *      releaseLowLatency
  *
  *  DESCRIPTION
- *      This function is called repeatedly via a timer to transmit 
- *      temperature measurements
+ *      This function is run by the low priority scheduler LOW_LATENCY_HOLD_TIME
+ *      after the last high priority key event. It requests the preferred 
+ *      connection parameters again if the low latency ones were granted.
  *
  *  RETURNS
  *      Nothing.
  *
  *---------------------------------------------------------------------------*/
 
-static void htTempMeasTimerHandler(timer_id tid)
+static void releaseLowLatency(void)
 {
-    /*
-    (modification)
-     int16 new_temp_r;
-     */
-    if(tid == g_ht_data.app_tid)
-    {
-        g_ht_data.app_tid = TIMER_INVALID;
-
-        /*Handling signal as per current state */
-        switch(g_ht_data.state)
-        {
-            case app_state_connected:
-            {
-
-                /* Send thermometer measurement only if encryption is enabled */
-                if(g_ht_data.encrypt_enabled)
-                {
-                    /* Read the temperature value 
-                    (modification)
-                    new_temp_r = ThermometerReadTemperature();
-                    */
+    g_ht_data.low_latency = FALSE;
 
-                    /* Send the updated value to the connected client */
-                    
-                    
-                }
+    APP_TRACE(app_trace_low_latency, 0);
 
-                /* Restart thermometer measurement timer */
-                g_ht_data.app_tid = TimerCreate(HT_TEMP_MEAS_TIME,
-                                                TRUE, htTempMeasTimerHandler);
+    requestPreferredParams();
+}
 
-            }
-            break;
 
-            default:
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      requestPreferredParams
+ *
+ *  DESCRIPTION
+ *      This function requests the preferred connection parameters, once the
+ *      low latency or relaxed ones are no longer wanted, unless the
+ *      connection already uses them.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void requestPreferredParams(void)
+{
+    /* Application specific preferred paramters */
+    ble_con_params app_pref_conn_param;
+
+    if(g_ht_data.state != app_state_connected ||
+       (g_ht_data.conn_interval >= PREFERRED_MIN_CON_INTERVAL &&
+        g_ht_data.conn_interval <= PREFERRED_MAX_CON_INTERVAL
+#if PREFERRED_SLAVE_LATENCY
+        && g_ht_data.conn_latency >= PREFERRED_SLAVE_LATENCY
+#endif
+       ))
+    {
+        return;
+    }
+
+    /* Any retry pending is superseded by this request. Should it fail, the
+     * usual attempts follow from LS_CONNECTION_PARAM_UPDATE_CFM.
+     */
+    TimerDelete(g_ht_data.con_param_update_tid);
+    g_ht_data.con_param_update_tid = TIMER_INVALID;
+    g_ht_data.cpu_timer_value = 0;
+
+    g_ht_data.num_conn_update_req = 1;
+
+    APP_TRACE(app_trace_conn_param_req, g_ht_data.num_conn_update_req);
+
+    app_pref_conn_param.con_max_interval = PREFERRED_MAX_CON_INTERVAL;
+    app_pref_conn_param.con_min_interval = PREFERRED_MIN_CON_INTERVAL;
+    app_pref_conn_param.con_slave_latency = PREFERRED_SLAVE_LATENCY;
+    app_pref_conn_param.con_super_timeout = PREFERRED_SUPERVISION_TIMEOUT;
+
+    if(LsConnectionParamUpdateReq(&g_ht_data.con_bd_addr, 
+                                  &app_pref_conn_param) != ls_err_none)
+    {
+        ReportPanic(app_panic_con_param_update);
+    }
+
+    APP_PERF_INC(app_perf_conn_param_reqs);
+}
+
+
+#ifdef ENABLE_POWER_LADDER
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ladderStep
+ *
+ *  DESCRIPTION
+ *      This function is run by the low priority scheduler while connected
+ *      without key events. LADDER_RELAX_TIME after the last key event it
+ *      requests the relaxed connection parameters, and LADDER_DISCONNECT_TIME
+ *      after it the link is closed.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void ladderStep(void)
+{
+    ble_con_params relaxed_conn_param;
+
+    if(g_ht_data.state != app_state_connected)
+    {
+        return;
+    }
+
+    if(g_ht_data.relaxed)
+    {
+        APP_PERF_INC(app_perf_ladder_disconnects);
+        APP_TRACE(app_trace_ladder, 2);
+
+        /* Advertise slowly rather than go idle once disconnected */
+        g_ht_data.ladder_disconnect = TRUE;
+        AppSetState(app_state_disconnecting);
+        return;
+    }
+
+    if(g_ht_data.low_latency)
+    {
+        /* The hold is still running, try again later */
+        AppSchedStart(app_sched_job_ladder, LADDER_RELAX_TIME, ladderStep);
+        return;
+    }
+
+    g_ht_data.relaxed = TRUE;
+
+    AppSchedStart(app_sched_job_ladder,
+                  LADDER_DISCONNECT_TIME - LADDER_RELAX_TIME, ladderStep);
+
+    APP_TRACE(app_trace_ladder, 1);
+
+    /* A pending request for the preferred parameters would undo this one */
+    TimerDelete(g_ht_data.con_param_update_tid);
+    g_ht_data.con_param_update_tid = TIMER_INVALID;
+    g_ht_data.cpu_timer_value = 0;
+
+    relaxed_conn_param.con_max_interval = RELAXED_MAX_CON_INTERVAL;
+    relaxed_conn_param.con_min_interval = RELAXED_MIN_CON_INTERVAL;
+    relaxed_conn_param.con_slave_latency = RELAXED_SLAVE_LATENCY;
+    relaxed_conn_param.con_super_timeout = RELAXED_SUPERVISION_TIMEOUT;
+
+    /* Should the request be refused, the connection simply stays as it is
+     * until the link is closed
+     */
+    if(LsConnectionParamUpdateReq(&g_ht_data.con_bd_addr,
+                                  &relaxed_conn_param) == ls_err_none)
+    {
+        APP_PERF_INC(app_perf_ladder_relaxes);
+    }
+}
+
+
+#ifdef LADDER_DORMANT
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ladderDormant
+ *
+ *  DESCRIPTION
+ *      This function is run by the low priority scheduler
+ *      LADDER_DORMANT_DELAY after going idle. The counters are saved and the
+ *      chip goes dormant, to be woken by a key on the WAKE pin. AppInit() is
+ *      called again on waking.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void ladderDormant(void)
+{
+    if(g_ht_data.state != app_state_idle)
+    {
+        return;
+    }
+
+    APP_TRACE(app_trace_ladder, 3);
+
+    /* The counts in RAM are lost while dormant */
+    CounterStoreCheckpoint();
+
+    SleepRequest(sleep_state_dormant, FALSE, NULL);
+}
+#endif /* LADDER_DORMANT */
+#endif /* ENABLE_POWER_LADDER */
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      openPairingWindow
+ *
+ *  DESCRIPTION
+ *      This function lets a further central bond for PAIRING_WINDOW_TIME.
+ *      Advertisements going on are restarted without the white list, an
+ *      idle device starts advertising. A connected device advertises
+ *      without the white list once the link has gone.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void openPairingWindow(void)
+{
+    g_ht_data.pairing_window = TRUE;
+    AppSchedStart(app_sched_job_pairing_window, PAIRING_WINDOW_TIME,
+                  closePairingWindow);
+    APP_PERF_INC(app_perf_pairing_windows);
+
+    switch(g_ht_data.state)
+    {
+        case app_state_fast_advertising:
+        case app_state_slow_advertising:
+        {
+            if(!g_ht_data.pairing_button_pressed)
+            {
+                /* Fast advertisements without the white list are started
+                 * once these have stopped
+                 */
+                g_ht_data.pairing_button_pressed = TRUE;
+                GattStopAdverts();
+            }
+        }
+        break;
+
+        case app_state_idle:
+        {
+            AppSetState(app_state_fast_advertising);
+        }
+        break;
+
+        default:
+            /* Nothing to do */
+        break;
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      closePairingWindow
+ *
+ *  DESCRIPTION
+ *      This function is called when the pairing window times out. The
+ *      advertisements going on are restarted with the white list if it can
+ *      be used.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void closePairingWindow(void)
+{
+    g_ht_data.pairing_window = FALSE;
+
+    if((g_ht_data.state == app_state_fast_advertising ||
+        g_ht_data.state == app_state_slow_advertising) &&
+       BondTableWhiteListUsable() && !g_ht_data.pairing_button_pressed)
+    {
+        g_ht_data.pairing_button_pressed = TRUE;
+        GattStopAdverts();
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      htTempMeasTimerHandler
+ *
+ *  DESCRIPTION
+ *      This function is called repeatedly via a timer to transmit 
+ *      temperature measurements
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void htTempMeasTimerHandler(timer_id tid)
+{
+    /*
+    (modification)
+     int16 new_temp_r;
+     */
+    if(tid == g_ht_data.app_tid)
+    {
+        g_ht_data.app_tid = TIMER_INVALID;
+
+        /*Handling signal as per current state */
+        switch(g_ht_data.state)
+        {
+            case app_state_connected:
+            {
+
+                /* Send thermometer measurement only if encryption is enabled */
+                if(g_ht_data.encrypt_enabled)
+                {
+                    /* Read the temperature value 
+                    (modification)
+                    new_temp_r = ThermometerReadTemperature();
+                    */
+
+                    /* Send the updated value to the connected client */
+                    
+                    
+                    /* Sample the battery level sent with the key reports 
+                     * again, notifying a change to the host
+                     */
+                    BatteryUpdateLevel(g_ht_data.st_ucid);
+                }
+
+                /* Restart thermometer measurement timer */
+                g_ht_data.app_tid = TimerCreate(HT_TEMP_MEAS_TIME,
+                                                TRUE, htTempMeasTimerHandler);
+
+            }
+            break;
+
+            default:
                 /* Ignore the timer */
             break;
         }
@@ -491,19 +1370,10 @@ static void htTempMeasTimerHandler(timer_id tid)
 
 static void appInitExit(void)
 {
-        if(g_ht_data.bonded && 
-            (!GattIsAddressResolvableRandom(&g_ht_data.bonded_bd_addr)))
-        {
-            /* If the device is bonded and bonded device address is not
-             * resolvable random, configure White list with the Bonded 
-             * host address 
-             */
-            if(LsAddWhiteListDevice(&g_ht_data.bonded_bd_addr) !=
-                ls_err_none)
-            {
-                ReportPanic(app_panic_add_whitelist);
-            }
-        }
+    /* Configure White list with the addresses of the bonded hosts which 
+     * are not resolvable random
+     */
+    BondTablePopulateWhiteList();
 }
 
 
@@ -530,104 +1400,284 @@ static void appAdvertisingExit(void)
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      handleSignalGattAddDBCfm
+ *      appDisconnectingExit
  *
  *  DESCRIPTION
- *      This function handles the signal GATT_ADD_DB_CFM
+ *      This function is called while exiting app_state_disconnecting state.
  *
  *  RETURNS
  *      Nothing.
  *
  *---------------------------------------------------------------------------*/
 
-static void handleSignalGattAddDbCfm(GATT_ADD_DB_CFM_T *p_event_data)
+static void appDisconnectingExit(void)
 {
-    /*Handling signal as per current state */
-    switch(g_ht_data.state)
-    {
-        case app_state_init:
-        {
-            if(p_event_data->result == sys_status_success)
-            {
-                AppSetState(app_state_fast_advertising);
-            }
-            else
-            {
-                /* Don't expect this to happen */
-                ReportPanic(app_panic_db_registration);
-            }
-        }
-        break;
+    /* Initialise application and used services data structure while
+     * exiting Disconnecting state
+     */
+    htDataInit();
+}
 
-        default:
-            /*Control should never come here */
-            ReportPanic(app_panic_invalid_state);
-        break;
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appFastAdvertisingEntry
+ *
+ *  DESCRIPTION
+ *      This function is called upon entering app_state_fast_advertising state.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void appFastAdvertisingEntry(void)
+{
+    GattStartAdverts(TRUE);
+
+    /* Indicate advertising mode by sounding two short beeps */
+    SoundBuzzer(buzzer_beep_twice);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appSlowAdvertisingEntry
+ *
+ *  DESCRIPTION
+ *      This function is called upon entering app_state_slow_advertising state.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void appSlowAdvertisingEntry(void)
+{
+    GattStartAdverts(FALSE);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appConnectedEntry
+ *
+ *  DESCRIPTION
+ *      This function is called upon entering app_state_connected state.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void appConnectedEntry(void)
+{
+    /* Trigger SM Slave Security request only if the remote host is not
+     * using resolvable random address
+     */
+    if(!GattIsAddressResolvableRandom(&g_ht_data.con_bd_addr))
+    {
+        SMRequestSecurityLevel(&g_ht_data.con_bd_addr);
     }
 
+#ifdef ENABLE_TX_POWER_CONTROL
+    /* Lower the transmit power as far as the link allows */
+    TxPowerStart(&g_ht_data.con_bd_addr);
+#endif /* ENABLE_TX_POWER_CONTROL */
+
+#ifdef ENABLE_POWER_LADDER
+    AppSchedStart(app_sched_job_ladder, LADDER_RELAX_TIME, ladderStep);
+#endif /* ENABLE_POWER_LADDER */
 }
 
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      handleSignalGattCancelConnectCfm
+ *      appConnectedExit
  *
  *  DESCRIPTION
- *      This function handles the signal GATT_CANCEL_CONNECT_CFM
+ *      This function is called while exiting app_state_connected state.
  *
  *  RETURNS
  *      Nothing.
  *
  *---------------------------------------------------------------------------*/
 
-static void handleSignalGattCancelConnectCfm(void)
+static void appConnectedExit(void)
 {
+#ifdef ENABLE_TX_POWER_CONTROL
+    /* Advertise at full power */
+    TxPowerStop();
+#endif /* ENABLE_TX_POWER_CONTROL */
+
+#ifdef ENABLE_POWER_LADDER
+    AppSchedStop(app_sched_job_ladder);
+#endif /* ENABLE_POWER_LADDER */
+}
 
-    /*Handling signal as per current state */
-    switch(g_ht_data.state)
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appDisconnectingEntry
+ *
+ *  DESCRIPTION
+ *      This function is called upon entering app_state_disconnecting state.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void appDisconnectingEntry(void)
+{
+    GattDisconnectReq(g_ht_data.st_ucid);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appIdleEntry
+ *
+ *  DESCRIPTION
+ *      This function is called upon entering app_state_idle state.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void appIdleEntry(void)
+{
+    /* Sound long beep to indicate non connectable mode*/
+    SoundBuzzer(buzzer_beep_long);
+
+#ifdef LADDER_DORMANT
+    /* Go dormant once the beep has been sounded */
+    AppSchedStart(app_sched_job_ladder, LADDER_DORMANT_DELAY, ladderDormant);
+#endif /* LADDER_DORMANT */
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleInvalidEvent
+ *
+ *  DESCRIPTION
+ *      This function is the state table action for events which are not
+ *      expected in the current application state.
+ *
+ *  RETURNS
+ *      The application state (never returns in practice).
+ *
+ *---------------------------------------------------------------------------*/
+
+static app_state handleInvalidEvent(LM_EVENT_T *p_event_data)
+{
+    /* Control should never come here */
+    ReportPanic(app_panic_invalid_state);
+
+    return g_ht_data.state;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleIgnoredEvent
+ *
+ *  DESCRIPTION
+ *      This function is the state table action for events which are silently
+ *      ignored in the current application state.
+ *
+ *  RETURNS
+ *      The current application state.
+ *
+ *---------------------------------------------------------------------------*/
+
+static app_state handleIgnoredEvent(LM_EVENT_T *p_event_data)
+{
+    return g_ht_data.state;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleSignalGattAddDBCfm
+ *
+ *  DESCRIPTION
+ *      This function handles the signal GATT_ADD_DB_CFM in app_state_init
+ *      state.
+ *
+ *  RETURNS
+ *      The next application state.
+ *
+ *---------------------------------------------------------------------------*/
+
+static app_state handleSignalGattAddDbCfm(LM_EVENT_T *p_event_data)
+{
+    if(((GATT_ADD_DB_CFM_T *)p_event_data)->result != sys_status_success)
     {
-        case app_state_fast_advertising:
-        case app_state_slow_advertising:
-        {
-            if(g_ht_data.pairing_button_pressed)
-            {
-                g_ht_data.pairing_button_pressed = FALSE;
+        /* Don't expect this to happen */
+        ReportPanic(app_panic_db_registration);
+    }
 
-                /* Reset and clear the whitelist */
-                LsResetWhiteList();
+    return app_state_fast_advertising;
+}
 
-                /* Trigger fast advertisements */
-                if(g_ht_data.state == app_state_fast_advertising)
-                {
-                    GattStartAdverts(TRUE);
-                }
-                else
-                {
-                    AppSetState(app_state_fast_advertising);
-                }
-            }
-            else
-            {
-                if(g_ht_data.state == app_state_fast_advertising)
-                {
-                    /* Trigger slow advertisements */
-                    AppSetState(app_state_slow_advertising);
-                }
-                else
-                {
-                    /* Move to app_state_idle state */
-                    AppSetState(app_state_idle);
-                }
-            }
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleSignalGattCancelConnectCfm
+ *
+ *  DESCRIPTION
+ *      This function handles the signal GATT_CANCEL_CONNECT_CFM in
+ *      app_state_fast_advertising and app_state_slow_advertising states.
+ *
+ *  RETURNS
+ *      The next application state.
+ *
+ *---------------------------------------------------------------------------*/
+
+static app_state handleSignalGattCancelConnectCfm(LM_EVENT_T *p_event_data)
+{
+    if(g_ht_data.pairing_button_pressed)
+    {
+        g_ht_data.pairing_button_pressed = FALSE;
+
+        /* Reset and clear the whitelist once the bonds have been removed.
+         * A pairing window keeps the bonds, and their white list.
+         */
+        if(BondTableCount() == 0)
+        {
+            LsResetWhiteList();
         }
-        break;
-        
-        default:
-            /*Control should never come here */
-            ReportPanic(app_panic_invalid_state);
-        break;
+
+        /* Trigger fast advertisements */
+        if(g_ht_data.state == app_state_fast_advertising)
+        {
+            GattStartAdverts(TRUE);
+        }
+
+        return app_state_fast_advertising;
+    }
+
+#ifdef ENABLE_POWER_LADDER
+    if(g_ht_data.key_wake)
+    {
+        /* A key was used while advertising slowly */
+        g_ht_data.key_wake = FALSE;
+
+        return app_state_fast_advertising;
+    }
+#endif /* ENABLE_POWER_LADDER */
+
+    if(g_ht_data.state == app_state_fast_advertising)
+    {
+        /* Trigger slow advertisements */
+        return app_state_slow_advertising;
     }
 
+    /* Move to app_state_idle state */
+    return app_state_idle;
 }
 
 /*---------------------------------------------------------------------------
@@ -639,17 +1689,23 @@ static void handleSignalGattCancelConnectCfm(void)
  *      This function handles the signal LM_EV_CONNECTION_COMPLETE.
  *
  *  RETURNS
- *      Nothing.
+ *      The current application state.
  *
- 
+
 *----------------------------------------------------------------------------*/
-static void handleSignalLmEvConnectionComplete(
-                                     LM_EV_CONNECTION_COMPLETE_T *p_event_data)
+static app_state handleSignalLmEvConnectionComplete(LM_EVENT_T *p_event_data)
 {
+    LM_EV_CONNECTION_COMPLETE_T *p_conn =
+                                    (LM_EV_CONNECTION_COMPLETE_T *)p_event_data;
+
     /* Store the connection parameters. */
-    g_ht_data.conn_interval = p_event_data->data.conn_interval;
-    g_ht_data.conn_latency = p_event_data->data.conn_latency;
-    g_ht_data.conn_timeout = p_event_data->data.supervision_timeout;
+    g_ht_data.conn_interval = p_conn->data.conn_interval;
+    g_ht_data.conn_latency = p_conn->data.conn_latency;
+    g_ht_data.conn_timeout = p_conn->data.supervision_timeout;
+
+    APP_TRACE(app_trace_conn_params, g_ht_data.conn_interval);
+
+    return g_ht_data.state;
 }
 
 /*-----------------------------------------------------------------------------*
@@ -683,127 +1739,102 @@ static void handleGapCppTimerExpiry(timer_id tid)
  *      handleSignalGattConnectCfm
  *
  *  DESCRIPTION
- *      This function handles the signal GATT_CONNECT_CFM
+ *      This function handles the signal GATT_CONNECT_CFM in
+ *      app_state_fast_advertising and app_state_slow_advertising states.
  *
  *  RETURNS
- *      Nothing.
+ *      The next application state.
  *
  *---------------------------------------------------------------------------*/
 
-static void handleSignalGattConnectCfm(GATT_CONNECT_CFM_T* p_event_data)
+static app_state handleSignalGattConnectCfm(LM_EVENT_T *p_event_data)
 {
-    /*Handling signal as per current state */
-    switch(g_ht_data.state)
+    GATT_CONNECT_CFM_T *p_cfm = (GATT_CONNECT_CFM_T *)p_event_data;
+
+    if(p_cfm->result != sys_status_success)
     {
-        case app_state_fast_advertising:
-        case app_state_slow_advertising:
+        /* Connection failure - Trigger fast advertisements */
+        if(g_ht_data.state == app_state_fast_advertising)
         {
-            if(p_event_data->result == sys_status_success)
-            {
-                /* Store received UCID */
-                g_ht_data.st_ucid = p_event_data->cid;
-
-                /* Store connected BD Address */
-                g_ht_data.con_bd_addr = p_event_data->bd_addr;
-
-                if(g_ht_data.bonded && 
-                    GattIsAddressResolvableRandom(&g_ht_data.bonded_bd_addr) &&
-                    (SMPrivacyMatchAddress(&p_event_data->bd_addr,
-                                            g_ht_data.central_device_irk.irk,
-                                            MAX_NUMBER_IRK_STORED, 
-                                            MAX_WORDS_IRK) < 0))
-                {
-                    /* Application was bonded to a remote device using 
-                     * resolvable random address and application has failed 
-                     * to resolve the remote device address to which we just 
-                     * connected, so disconnect and start advertising again
-                     */
+            /* Already in app_state_fast_advertising state, so just
+             * trigger fast advertisements
+             */
+            GattStartAdverts(TRUE);
+        }
 
-                    /* Disconnect if we are connected */
-                    AppSetState(app_state_disconnecting);
-                }
-                else
-                {
-                    /* Enter connected state 
-                     * - If the device is not bonded OR
-                     * - If the device is bonded and the connected host doesn't 
-                     *   support Resolvable Random address OR
-                     * - If the device is bonded and connected host supports 
-                     *   Resolvable Random address and the address gets resolved
-                     *   using the store IRK key
-                     */
-                    AppSetState(app_state_connected);
+        return app_state_fast_advertising;
+    }
 
-                    /* If the current connection parameters being used don't 
-                     * comply with the application's preferred connection 
-                     * parameters and the timer is not running and , start timer
-                     * to trigger Connection Parameter Update procedure
-                     */
-                    if((g_ht_data.con_param_update_tid == TIMER_INVALID) &&
-                       (g_ht_data.conn_interval < PREFERRED_MIN_CON_INTERVAL ||
-                        g_ht_data.conn_interval > PREFERRED_MAX_CON_INTERVAL
+    /* Store received UCID */
+    g_ht_data.st_ucid = p_cfm->cid;
+
+    /* Store connected BD Address */
+    g_ht_data.con_bd_addr = p_cfm->bd_addr;
+
+    /* Identify the connected host among the bonded hosts. A host using a 
+     * resolvable random address is resolved against the IRKs of all the 
+     * bonds at once.
+     */
+    BondTableSetActive(BondTableFind(&p_cfm->bd_addr));
+
+    if(AppIsDeviceBonded())
+    {
+        /* Connection accepted from a bonded host */
+        APP_PERF_INC(app_perf_reconnects);
+
+        /* Restore the client configurations the host wrote while bonded */
+        HealthThermoDataInit();
+        BatteryDataInit();
+#ifdef ENABLE_HID_MODE
+        HidDataInit();
+#endif /* ENABLE_HID_MODE */
+    }
+
+    /* Enter connected state. A host which is not bonded is accepted as well,
+     * so that it can pair.
+     *
+     * If the current connection parameters being used don't comply with the
+     * application's preferred connection parameters and the timer is not
+     * running and , start timer to trigger Connection Parameter Update
+     * procedure
+     */
+    if((g_ht_data.con_param_update_tid == TIMER_INVALID) &&
+       (g_ht_data.conn_interval < PREFERRED_MIN_CON_INTERVAL ||
+        g_ht_data.conn_interval > PREFERRED_MAX_CON_INTERVAL
 #if PREFERRED_SLAVE_LATENCY
-                        || g_ht_data.conn_latency < PREFERRED_SLAVE_LATENCY
+        || g_ht_data.conn_latency < PREFERRED_SLAVE_LATENCY
 #endif
-                       )
-                      )
-                    {
-                        /* Set the num of conn update attempts to zero */
-                        g_ht_data.num_conn_update_req = 0;
-
-                        /* The application first starts a timer of 
-                         * TGAP_CPP_PERIOD. During this time, the application 
-                         * waits for the peer device to do the database 
-                         * discovery procedure. After expiry of this timer, the 
-                         * application starts one more timer of period 
-                         * TGAP_CPC_PERIOD. If the application receives any 
-                         * GATT_ACCESS_IND during this time, it assumes that 
-                         * the peer device is still doing device database 
-                         * discovery procedure or some other configuration and 
-                         * it should not update the parameters, so it restarts 
-                         * the TGAP_CPC_PERIOD timer. If this timer expires, the
-                         * application assumes that database discovery procedure
-                         * is complete and it initiates the connection parameter
-                         * update procedure.
-                         * Please note that this procedure requires all the 
-                         * characteristic read/writes to be made IRQ. If 
-                         * application wants firmware to reply for any of the 
-                         * request, it shall reply with 
-                         * "gatt_status_irq_proceed".
-                         */
-                        g_ht_data.con_param_update_tid = TimerCreate(
-                                                TGAP_CPP_PERIOD,
+       )
+      )
+    {
+        /* Set the num of conn update attempts to zero */
+        g_ht_data.num_conn_update_req = 0;
+
+        /* The application first starts a timer of TGAP_CPP_PERIOD. During
+         * this time, the application waits for the peer device to do the
+         * database discovery procedure. After expiry of this timer, the
+         * application starts one more timer of period TGAP_CPC_PERIOD. If the
+         * application receives any GATT_ACCESS_IND during this time, it
+         * assumes that the peer device is still doing device database
+         * discovery procedure or some other configuration and it should not
+         * update the parameters, so it restarts the TGAP_CPC_PERIOD timer. If
+         * this timer expires, the application assumes that database discovery
+         * procedure is complete and it initiates the connection parameter
+         * update procedure.
+         * Please note that this procedure requires all the characteristic
+         * read/writes to be made IRQ. If application wants firmware to reply
+         * for any of the request, it shall reply with
+         * "gatt_status_irq_proceed".
+         */
+        g_ht_data.con_param_update_tid = TimerCreate(TGAP_CPP_PERIOD,
                                                 TRUE, handleGapCppTimerExpiry);
-                        g_ht_data.cpu_timer_value = TGAP_CPP_PERIOD;
+        g_ht_data.cpu_timer_value = TGAP_CPP_PERIOD;
 
-                    } /* Else at the expiry of timer Connection parameter 
-                       * update procedure will get triggered
-                       */
-                }
-            }
-            else
-            {
-                /* Connection failure - Trigger fast advertisements */
-                if(g_ht_data.state == app_state_slow_advertising)
-                {
-                    AppSetState(app_state_fast_advertising);
-                }
-                else
-                {
-                    /* Already in app_state_fast_advertising state, so just 
-                     * trigger fast advertisements
-                     */
-                    GattStartAdverts(TRUE);
-                }
-            }
-        }
-        break;
+    } /* Else at the expiry of timer Connection parameter update procedure
+       * will get triggered
+       */
 
-        default:
-            /* Control should never come here */
-            ReportPanic(app_panic_invalid_state);
-        break;
-    }
+    return app_state_connected;
 }
 
 
@@ -815,58 +1846,40 @@ static void handleSignalGattConnectCfm(GATT_CONNECT_CFM_T* p_event_data)
  *      This function handles the signal SM_KEYS_IND and copies IRK from it
  *
  *  RETURNS
- *      Nothing.
+ *      The current application state.
  *
  *---------------------------------------------------------------------------*/
 
-static void handleSignalSmKeysInd(SM_KEYS_IND_T *p_event_data)
+static app_state handleSignalSmKeysInd(LM_EVENT_T *p_event_data)
 {
-    /*Handling signal as per current state */
-    switch(g_ht_data.state)
-    {
-        case app_state_connected:
-        {
-            /* If keys are present, save them */
-            if((p_event_data->keys)->keys_present & (1 << SM_KEY_TYPE_DIV))
-            {
-                /* Store the diversifier which will be used for accepting/
-                 * rejecting the encryption requests.
-                 */
-                g_ht_data.diversifier = (p_event_data->keys)->div;
-
-                /* Write the new diversifier to NVM */
-                Nvm_Write(&g_ht_data.diversifier,
-                          sizeof(g_ht_data.diversifier), 
-                          NVM_OFFSET_SM_DIV);
-            }
+    SM_KEYS_IND_T *p_ind = (SM_KEYS_IND_T *)p_event_data;
 
-            /* Store IRK if the connected host is using random resolvable 
-             * address. IRK is used afterwards to validate the identity of 
-             * connected host 
-             */
-            if(GattIsAddressResolvableRandom(&g_ht_data.con_bd_addr) &&
-               ((p_event_data->keys)->keys_present & (1 << SM_KEY_TYPE_ID)))
-            {
-                MemCopy(g_ht_data.central_device_irk.irk, 
-                        (p_event_data->keys)->irk,
-                        MAX_WORDS_IRK);
+    /* If keys are present, save them */
+    if((p_ind->keys)->keys_present & (1 << SM_KEY_TYPE_DIV))
+    {
+        /* Store the diversifier which will be used for accepting/rejecting
+         * the encryption requests.
+         */
+        g_ht_data.diversifier = (p_ind->keys)->div;
+    }
 
-                /* If bonded device address is resolvable random
-                 * then store IRK to NVM 
-                 */
-                Nvm_Write(g_ht_data.central_device_irk.irk, 
-                          MAX_WORDS_IRK, 
-                          NVM_OFFSET_SM_IRK);
-            }
+    /* Store IRK if the connected host is using random resolvable address.
+     * IRK is used afterwards to validate the identity of connected host
+     */
+    if(GattIsAddressResolvableRandom(&g_ht_data.con_bd_addr) &&
+       ((p_ind->keys)->keys_present & (1 << SM_KEY_TYPE_ID)))
+    {
+        MemCopy(g_ht_data.central_device_irk.irk,
+                (p_ind->keys)->irk,
+                MAX_WORDS_IRK);
+    }
 
-        }
-        break;
+    /* Write the new diversifier to NVM, so that it is not issued again. 
+     * The IRK is stored with the bond once pairing completes.
+     */
+    writeAppGroup();
 
-        default:
-            /* Control should never come here */
-            ReportPanic(app_panic_invalid_state);
-        break;
-    }
+    return g_ht_data.state;
 }
 
 /*---------------------------------------------------------------------------
@@ -876,37 +1889,44 @@ static void handleSignalSmKeysInd(SM_KEYS_IND_T *p_event_data)
  *
  *  DESCRIPTION
  *      This function handles the signal SM_PAIRING_AUTH_IND. This message will
- *      only be received when the peer device is initiating 'Just Works' 
+ *      only be received when the peer device is initiating 'Just Works'
  *      pairing.
  *
  *  RETURNS/MODIFIES
- *      Nothing.
+ *      The current application state, or app_state_disconnecting if a host
+ *      which is not bonded may not bond.
  *
  *
  *----------------------------------------------------------------------------*/
-static void handleSignalSmPairingAuthInd(SM_PAIRING_AUTH_IND_T *p_event_data)
+static app_state handleSignalSmPairingAuthInd(LM_EVENT_T *p_event_data)
 {
-    /* Handling signal as per current state */
-    switch(g_ht_data.state)
+    /* Authorise the pairing request if the connected host is NOT bonded and
+     * no host is bonded yet or the pairing window is open, otherwise reject
+     * the pairing request
+     */
+    if(AppIsDeviceBonded())
     {
-        case app_state_connected:
-        {
-            /* Authorise the pairing request if the application is NOT bonded */
-            if(!g_ht_data.bonded)
-            {
-                SMPairingAuthRsp(p_event_data->data, TRUE);
-            }
-            else /* Otherwise Reject the pairing request */
-            {
-                SMPairingAuthRsp(p_event_data->data, FALSE);
-            }
-        }
-        break;
+        SMPairingAuthRsp(((SM_PAIRING_AUTH_IND_T *)p_event_data)->data,
+                         FALSE);
+    }
+    else if(BondTableCount() == 0 || g_ht_data.pairing_window)
+    {
+        SMPairingAuthRsp(((SM_PAIRING_AUTH_IND_T *)p_event_data)->data,
+                         TRUE);
+    }
+    else
+    {
+        /* A host which is not bonded could evict a bond. Make room for the
+         * bonded hosts.
+         */
+        APP_PERF_INC(app_perf_pairings_rejected);
+        SMPairingAuthRsp(((SM_PAIRING_AUTH_IND_T *)p_event_data)->data,
+                         FALSE);
 
-        default:
-            ReportPanic(app_panic_invalid_state);
-        break;
+        return app_state_disconnecting;
     }
+
+    return g_ht_data.state;
 }
 
 
@@ -916,110 +1936,97 @@ static void handleSignalSmPairingAuthInd(SM_PAIRING_AUTH_IND_T *p_event_data)
  *      handleSignalSmSimplePairingCompleteInd
  *
  *  DESCRIPTION
- *      This function handles the signal SM_SIMPLE_PAIRING_COMPLETE_IND
+ *      This function handles the signal SM_SIMPLE_PAIRING_COMPLETE_IND in
+ *      app_state_connected state. Firmware may send this signal after
+ *      disconnection, so it is ignored in the other states.
  *
  *  RETURNS
- *      Nothing.
+ *      The next application state.
  *
  *---------------------------------------------------------------------------*/
 
-static void handleSignalSmSimplePairingCompleteInd(
-                                 SM_SIMPLE_PAIRING_COMPLETE_IND_T *p_event_data)
+static app_state handleSignalSmSimplePairingCompleteInd(
+                                                 LM_EVENT_T *p_event_data)
 {
+    SM_SIMPLE_PAIRING_COMPLETE_IND_T *p_ind =
+                               (SM_SIMPLE_PAIRING_COMPLETE_IND_T *)p_event_data;
 
-    /*Handling signal as per current state */
-    switch(g_ht_data.state)
+    if(p_ind->status == sys_status_success)
     {
-        case app_state_connected:
-        {
-            if(p_event_data->status == sys_status_success)
-            {
-                /* Store bonded host information to NVM. This includes
-                 * application and services specific information
-                 */
-                g_ht_data.bonded = TRUE;
-                g_ht_data.bonded_bd_addr = p_event_data->bd_addr;
-
-                /* Store bonded host typed bd address to NVM */
-
-                /* Write one word bonded flag */
-                Nvm_Write((uint16*)&g_ht_data.bonded, 
-                          sizeof(g_ht_data.bonded), 
-                          NVM_OFFSET_BONDED_FLAG);
+        /* Store bonded host information to NVM. This includes
+         * application and services specific information
+         */
 
-                /* Write typed bd address of bonded host */
-                Nvm_Write((uint16*)&g_ht_data.bonded_bd_addr, 
-                          sizeof(TYPED_BD_ADDR_T), 
-                          NVM_OFFSET_BONDED_ADDR);
+        /* Application and services data are committed to NVM in a single
+         * batch once all of them have been collected
+         */
+        Nvm_BeginBatch();
 
-                /* Configure white list with the Bonded host address only 
-                 * if the connected host doesn't support random resolvable
-                 * address
-                 */
-                if(!GattIsAddressResolvableRandom(&g_ht_data.bonded_bd_addr))
-                {
-                    /* It is important to note that this application 
-                     * doesn't support reconnection address. In future, if 
-                     * the application is enhanced to support Reconnection 
-                     * Address, make sure that we don't add reconnection 
-                     * address to white list
-                     */
-                    if(LsAddWhiteListDevice(&g_ht_data.bonded_bd_addr) !=
-                        ls_err_none)
-                    {
-                        ReportPanic(app_panic_add_whitelist);
-                    }
+        /* A central has bonded, the pairing window is closed */
+        AppSchedStop(app_sched_job_pairing_window);
+        g_ht_data.pairing_window = FALSE;
 
-                }
+        /* Add the host to the bond table, evicting the least recently used
+         * bond if the table is full. The IRK is only kept if the host uses
+         * a resolvable random address.
+         */
+        BondTableAdd(&p_ind->bd_addr, g_ht_data.diversifier,
+                     GattIsAddressResolvableRandom(&p_ind->bd_addr) ?
+                     g_ht_data.central_device_irk.irk : NULL);
 
-                /* If the devices are bonded then send notification to all 
-                 * registered services for the same so that they can store
-                 * required data to NVM.
-                 */
+        /* Configure white list with the addresses of the bonded hosts which
+         * don't support random resolvable address. A bond may have been 
+         * evicted, so the white list is built again.
+         */
+        BondTablePopulateWhiteList();
 
-                HealthThermoBondingNotify();
+        /* If the devices are bonded then send notification to all
+         * registered services for the same so that they can store
+         * required data to NVM.
+         */
 
-                BatteryBondingNotify();
-            }
-            else
-            {
-                /* Pairing has failed.
-                 * 1. If pairing has failed due to repeated attempts, the 
-                 *    application should immediately disconnect the link.
-                 * 2. The application was bonded and pairing has failed.
-                 *    Since the application was using whitelist, so the remote 
-                 *    device has same address as our bonded device address.
-                 *    The remote connected device may be a genuine one but 
-                 *    instead of using old keys, wanted to use new keys. We 
-                 *    don't allow bonding again if we are already bonded but we
-                 *    will give some time to the connected device to encrypt the
-                 *    link using the old keys. if the remote device encrypts the
-                 *    link in that time, it's good. Otherwise we will disconnect
-                 *    the link.
-                 */
-                 if(p_event_data->status == sm_status_repeated_attempts)
-                 {
-                    AppSetState(app_state_disconnecting);
-                 }
-                 else if(g_ht_data.bonded)
-                 {
-                    g_ht_data.encrypt_enabled = FALSE;
-                    g_ht_data.bonding_reattempt_tid = 
-                                         TimerCreate(
-                                               BONDING_CHANCE_TIMER,
-                                               TRUE, 
-                                               handleBondingChanceTimerExpiry);
-                 }
-            }
-        }
-        break;
+        HealthThermoBondingNotify();
 
-        default:
-            /* Firmware may send this signal after disconnection. So don't 
-             * panic but ignore this signal.
-             */
-        break;
+        BatteryBondingNotify();
+
+#ifdef ENABLE_HID_MODE
+        HidBondingNotify();
+#endif /* ENABLE_HID_MODE */
+
+        Nvm_EndBatch();
+    }
+    else
+    {
+        /* Pairing has failed.
+         * 1. If pairing has failed due to repeated attempts, the
+         *    application should immediately disconnect the link.
+         * 2. The application was bonded and pairing has failed.
+         *    Since the application was using whitelist, so the remote
+         *    device has same address as our bonded device address.
+         *    The remote connected device may be a genuine one but
+         *    instead of using old keys, wanted to use new keys. We
+         *    don't allow bonding again if we are already bonded but we
+         *    will give some time to the connected device to encrypt the
+         *    link using the old keys. if the remote device encrypts the
+         *    link in that time, it's good. Otherwise we will disconnect
+         *    the link.
+         */
+         if(p_ind->status == sm_status_repeated_attempts)
+         {
+            return app_state_disconnecting;
+         }
+         else if(AppIsDeviceBonded())
+         {
+            g_ht_data.encrypt_enabled = FALSE;
+            g_ht_data.bonding_reattempt_tid =
+                                 TimerCreate(
+                                       BONDING_CHANCE_TIMER,
+                                       TRUE,
+                                       handleBondingChanceTimerExpiry);
+         }
     }
+
+    return g_ht_data.state;
 }
 
 
@@ -1031,52 +2038,51 @@ static void handleSignalSmSimplePairingCompleteInd(
  *      This function handles the signal LM_EV_ENCRYPTION_CHANGE
  *
  *  RETURNS
- *      Nothing.
+ *      The current application state.
  *
  *---------------------------------------------------------------------------*/
 
-static void handleSignalLMEncryptionChange(
-                    HCI_EV_DATA_ENCRYPTION_CHANGE_T *p_event_data)
+static app_state handleSignalLMEncryptionChange(LM_EVENT_T *p_event_data)
 {
-    /*Handling signal as per current state */
-    switch(g_ht_data.state)
+    HCI_EV_DATA_ENCRYPTION_CHANGE_T *p_enc = &p_event_data->enc_change.data;
+
+    if(p_enc->status == sys_status_success)
     {
-        case app_state_connected:
+        g_ht_data.encrypt_enabled = p_enc->enc_enable;
+
+        if(g_ht_data.encrypt_enabled)
         {
 
-            if(p_event_data->status == sys_status_success)
-            {
-                g_ht_data.encrypt_enabled = p_event_data->enc_enable;
+            /* Delete the bonding chance timer */
+            TimerDelete(g_ht_data.bonding_reattempt_tid);
+            g_ht_data.bonding_reattempt_tid = TIMER_INVALID;
 
-                if(g_ht_data.encrypt_enabled)
-                {
-                    
-                    /* Delete the bonding chance timer */
-                    TimerDelete(g_ht_data.bonding_reattempt_tid);
-                    g_ht_data.bonding_reattempt_tid = TIMER_INVALID;
-                
-                    /* Update battery status at every connection instance. It 
-                     * may not be worth updating timer more often, but again 
-                     * it will primarily depend upon application requirements 
-                     */
-                    BatteryUpdateLevel(g_ht_data.st_ucid);
+            /* The bonded host is back, it is the last to be evicted */
+            BondTableTouch();
 
-                    /* Start Temperature measurement timer to periodically
-                     * send measured readings to the connected host 
-                     */
-                    htTempMeasTimerHandler(TIMER_INVALID);
+            /* Update battery status at every connection instance. It
+             * may not be worth updating timer more often, but again
+             * it will primarily depend upon application requirements
+             */
+            BatteryUpdateLevel(g_ht_data.st_ucid);
 
-                }
+            /* Start Temperature measurement timer to periodically
+             * send measured readings to the connected host
+             */
+            htTempMeasTimerHandler(TIMER_INVALID);
+
+#ifdef ENABLE_POWER_LADDER
+            /* Send the report held since the key event which woke the
+             * device
+             */
+            HtHwSendHeldReport();
+#endif /* ENABLE_POWER_LADDER */
 
-            }
         }
-        break;
 
-        default:
-            /* Control should never come here */
-            ReportPanic(app_panic_invalid_state);
-        break;
     }
+
+    return g_ht_data.state;
 }
 
 
@@ -1085,49 +2091,36 @@ static void handleSignalLMEncryptionChange(
  *      handleSignalSmDivApproveInd
  *
  *  DESCRIPTION
- *      This function handles the signal SM_DIV_APPROVE_IND.
+ *      This function handles the signal SM_DIV_APPROVE_IND. Request for
+ *      approval from application comes only when pairing is not in progress.
  *
  *  RETURNS
- *      Nothing.
+ *      The current application state.
  *
  *----------------------------------------------------------------------------*/
 
-static void handleSignalSmDivApproveInd(SM_DIV_APPROVE_IND_T *p_event_data)
+static app_state handleSignalSmDivApproveInd(LM_EVENT_T *p_event_data)
 {
-    /* Handling signal as per current state */
-    switch(g_ht_data.state)
-    {
-        
-        /* Request for approval from application comes only when pairing is not
-         * in progress
-         */
-        case app_state_connected:
-        {
-            sm_div_verdict approve_div = SM_DIV_REVOKED;
-            
-            /* Check whether the application is still bonded (bonded flag gets
-             * reset upon 'connect' button press by the user). Then check 
-             * whether the diversifier is the same as the one stored by the 
-             * application
-             */
-            if(g_ht_data.bonded)
-            {
-                if(g_ht_data.diversifier == p_event_data->div)
-                {
-                    approve_div = SM_DIV_APPROVED;
-                }
-            }
+    SM_DIV_APPROVE_IND_T *p_ind = (SM_DIV_APPROVE_IND_T *)p_event_data;
+    sm_div_verdict approve_div = SM_DIV_REVOKED;
+    uint16 index;
+
+    /* Check whether the diversifier was issued to one of the bonded hosts 
+     * (the bonds get removed upon 'connect' button press by the user). The
+     * host encrypting with it is the bonded one, which also identifies a 
+     * host whose address could not be resolved.
+     */
+    index = BondTableFindDiversifier(p_ind->div);
 
-            SMDivApproval(p_event_data->cid, approve_div);
-        }
-        break;
+    if(index != BOND_TABLE_INVALID)
+    {
+        approve_div = SM_DIV_APPROVED;
+        BondTableSetActive(index);
+    }
 
-        default:
-            /* Control should never come here */
-            ReportPanic(app_panic_invalid_state);
-        break;
+    SMDivApproval(p_ind->cid, approve_div);
 
-    }
+    return g_ht_data.state;
 }
 
 
@@ -1139,44 +2132,45 @@ static void handleSignalSmDivApproveInd(SM_DIV_APPROVE_IND_T *p_event_data)
  *      This function handles the signal LS_CONNECTION_PARAM_UPDATE_CFM.
  *
  *  RETURNS
- *      Nothing.
+ *      The current application state.
  *
  *---------------------------------------------------------------------------*/
 
-static void handleSignalLsConnParamUpdateCfm(
-                            LS_CONNECTION_PARAM_UPDATE_CFM_T *p_event_data)
+static app_state handleSignalLsConnParamUpdateCfm(LM_EVENT_T *p_event_data)
 {
-    /*Handling signal as per current state */
-    switch(g_ht_data.state)
+    if(((LS_CONNECTION_PARAM_UPDATE_CFM_T *)p_event_data)->status ==
+                                                                ls_err_none)
     {
-        case app_state_connected:
-        {
-            /* Received in response to the L2CAP_CONNECTION_PARAMETER_UPDATE 
-             * request sent from the slave after encryption is enabled. If 
-             * the request has failed, the device should again send the same 
-             * request only after Tgap(conn_param_timeout). Refer 
-             * Bluetooth 4.0 spec Vol 3 Part C, Section 9.3.9 and profile spec.
-             */
-            if ((p_event_data->status != ls_err_none) &&
-                    (g_ht_data.num_conn_update_req < 
-                    MAX_NUM_CONN_PARAM_UPDATE_REQS))
-            {
-                /* Delete timer if running */
-                TimerDelete(g_ht_data.con_param_update_tid);
+        APP_PERF_INC(app_perf_conn_param_accepts);
+    }
 
-                g_ht_data.con_param_update_tid = TimerCreate(
-                                             GAP_CONN_PARAM_TIMEOUT,
-                                             TRUE, requestConnParamUpdate);
-                g_ht_data.cpu_timer_value = GAP_CONN_PARAM_TIMEOUT;
-            }
-        }
-        break;
+    /* Received in response to the L2CAP_CONNECTION_PARAMETER_UPDATE
+     * request sent from the slave after encryption is enabled. If
+     * the request has failed, the device should again send the same
+     * request only after Tgap(conn_param_timeout). Refer
+     * Bluetooth 4.0 spec Vol 3 Part C, Section 9.3.9 and profile spec.
+     * The preferred parameters are not asked for while the low latency or
+     * relaxed ones are wanted, they are asked for again once these end.
+     */
+    if ((((LS_CONNECTION_PARAM_UPDATE_CFM_T *)p_event_data)->status !=
+                                                                ls_err_none) &&
+            !g_ht_data.low_latency &&
+#ifdef ENABLE_POWER_LADDER
+            !g_ht_data.relaxed &&
+#endif /* ENABLE_POWER_LADDER */
+            (g_ht_data.num_conn_update_req <
+            MAX_NUM_CONN_PARAM_UPDATE_REQS))
+    {
+        /* Delete timer if running */
+        TimerDelete(g_ht_data.con_param_update_tid);
 
-        default:
-        /* Control should never come here */
-            ReportPanic(app_panic_invalid_state);
-        break;
+        g_ht_data.con_param_update_tid = TimerCreate(
+                                     GAP_CONN_PARAM_TIMEOUT,
+                                     TRUE, requestConnParamUpdate);
+        g_ht_data.cpu_timer_value = GAP_CONN_PARAM_TIMEOUT;
     }
+
+    return g_ht_data.state;
 }
 
 /*----------------------------------------------------------------------------*
@@ -1187,31 +2181,22 @@ static void handleSignalLsConnParamUpdateCfm(
  *      This function handles the signal LM_EV_CONNECTION_UPDATE.
  *
  *  RETURNS
- *      Nothing.
+ *      The current application state.
  *
  *---------------------------------------------------------------------------*/
-static void handleSignalLmConnectionUpdate(
-                                       LM_EV_CONNECTION_UPDATE_T* p_event_data)
+static app_state handleSignalLmConnectionUpdate(LM_EVENT_T *p_event_data)
 {
-    switch(g_ht_data.state)
-    {
-        case app_state_connected:
-        case app_state_disconnecting:
-        {
-            /* Store the new connection parameters. */
-            g_ht_data.conn_interval = p_event_data->data.conn_interval;
-            g_ht_data.conn_latency = p_event_data->data.conn_latency;
-            g_ht_data.conn_timeout = p_event_data->data.supervision_timeout;
-        }
-        break;
+    LM_EV_CONNECTION_UPDATE_T *p_update =
+                                      (LM_EV_CONNECTION_UPDATE_T *)p_event_data;
 
-        default:
-            /* Connection parameter update indication received in unexpected
-             * application state.
-             */
-            ReportPanic(app_panic_invalid_state);
-        break;
-    }
+    /* Store the new connection parameters. */
+    g_ht_data.conn_interval = p_update->data.conn_interval;
+    g_ht_data.conn_latency = p_update->data.conn_latency;
+    g_ht_data.conn_timeout = p_update->data.supervision_timeout;
+
+    APP_TRACE(app_trace_conn_params, g_ht_data.conn_interval);
+
+    return g_ht_data.state;
 }
 
 
@@ -1223,59 +2208,46 @@ static void handleSignalLmConnectionUpdate(
  *      This function handles the signal LS_CONNECTION_PARAM_UPDATE_IND
  *
  *  RETURNS
- *      Nothing.
+ *      The current application state.
  *
  *---------------------------------------------------------------------------*/
 
-static void handleSignalLsConnParamUpdateInd(
-                                 LS_CONNECTION_PARAM_UPDATE_IND_T *p_event_data)
+static app_state handleSignalLsConnParamUpdateInd(LM_EVENT_T *p_event_data)
 {
+    /* Delete timer if running */
+    TimerDelete(g_ht_data.con_param_update_tid);
+    g_ht_data.con_param_update_tid = TIMER_INVALID;
+    g_ht_data.cpu_timer_value = 0;
 
-    /*Handling signal as per current state */
-    switch(g_ht_data.state)
-    {
-
-        case app_state_connected:
-        {
-            /* Delete timer if running */
-            TimerDelete(g_ht_data.con_param_update_tid);
-            g_ht_data.con_param_update_tid = TIMER_INVALID;
-            g_ht_data.cpu_timer_value = 0;
-            
-            /* The application had already received the new connection 
-             * parameters while handling event LM_EV_CONNECTION_UPDATE.Check if
-             * new parameters comply with application preferred parameters. 
-             * If not, application shall trigger Connection parameter update 
-             * procedure.
-             */
-            if(g_ht_data.conn_interval < PREFERRED_MIN_CON_INTERVAL ||
-               g_ht_data.conn_interval > PREFERRED_MAX_CON_INTERVAL
+    /* The application had already received the new connection parameters
+     * while handling event LM_EV_CONNECTION_UPDATE.Check if new parameters
+     * comply with application preferred parameters. If not, application
+     * shall trigger Connection parameter update procedure, unless the low
+     * latency or relaxed parameters are wanted for now.
+     */
+    if(!g_ht_data.low_latency &&
+#ifdef ENABLE_POWER_LADDER
+       !g_ht_data.relaxed &&
+#endif /* ENABLE_POWER_LADDER */
+       (g_ht_data.conn_interval < PREFERRED_MIN_CON_INTERVAL ||
+        g_ht_data.conn_interval > PREFERRED_MAX_CON_INTERVAL
 #if PREFERRED_SLAVE_LATENCY
-               || g_ht_data.conn_latency < PREFERRED_SLAVE_LATENCY
+        || g_ht_data.conn_latency < PREFERRED_SLAVE_LATENCY
 #endif
-              )
-            {
-                /* Set the num of conn update attempts to zero */
-                g_ht_data.num_conn_update_req = 0;
-
-                /* Start timer to trigger Connection Parameter Update 
-                 * procedure 
-                 */
-                g_ht_data.con_param_update_tid = TimerCreate(
-                                         GAP_CONN_PARAM_TIMEOUT,
-                                         TRUE, requestConnParamUpdate);
-                g_ht_data.cpu_timer_value = GAP_CONN_PARAM_TIMEOUT;
+       ))
+    {
+        /* Set the num of conn update attempts to zero */
+        g_ht_data.num_conn_update_req = 0;
 
-            }
-        }
-        break;
+        /* Start timer to trigger Connection Parameter Update procedure */
+        g_ht_data.con_param_update_tid = TimerCreate(
+                                 GAP_CONN_PARAM_TIMEOUT,
+                                 TRUE, requestConnParamUpdate);
+        g_ht_data.cpu_timer_value = GAP_CONN_PARAM_TIMEOUT;
 
-        default:
-            /* Control should never come here */
-            ReportPanic(app_panic_invalid_state);
-        break;
     }
 
+    return g_ht_data.state;
 }
 
 
@@ -1284,84 +2256,69 @@ static void handleSignalLsConnParamUpdateInd(
  *      handleSignalGattAccessInd
  *
  *  DESCRIPTION
- *      This function handles GATT_ACCESS_IND message for attributes 
+ *      This function handles GATT_ACCESS_IND message for attributes
  *      maintained by the application.
  *
  *  RETURNS
- *      Nothing.
+ *      The current application state.
  *
  *---------------------------------------------------------------------------*/
 
-static void handleSignalGattAccessInd(GATT_ACCESS_IND_T *p_event_data)
+static app_state handleSignalGattAccessInd(LM_EVENT_T *p_event_data)
 {
+    GATT_ACCESS_IND_T *p_ind = (GATT_ACCESS_IND_T *)p_event_data;
 
-   
-    /*Handling signal as per current state */
-    switch(g_ht_data.state)
+    /* GATT_ACCESS_IND indicates that the central device is still disco-
+     * -vering services. So, restart the connection parameter update
+     * timer
+     */
+     if(g_ht_data.cpu_timer_value == TGAP_CPC_PERIOD &&
+        g_ht_data.con_param_update_tid != TIMER_INVALID)
+     {
+        TimerDelete(g_ht_data.con_param_update_tid);
+        g_ht_data.con_param_update_tid = TimerCreate(TGAP_CPC_PERIOD,
+                                         TRUE, requestConnParamUpdate);
+     }
+
+    /* Received GATT ACCESS IND with write access */
+    if(p_ind->flags ==
+        (ATT_ACCESS_WRITE |
+         ATT_ACCESS_PERMISSION |
+         ATT_ACCESS_WRITE_COMPLETE))
     {
-        case app_state_connected:
+        HandleAccessWrite(p_ind);
+
+        /* Check if indications are configured on Temperature
+         * Measurement characteristic of Health Thermometer service
+         */
+        if(g_ht_data.encrypt_enabled)
         {
+            /* Delete thermometer measurement timer */
+            TimerDelete(g_ht_data.app_tid);
+            g_ht_data.app_tid = TIMER_INVALID;
 
-            /* GATT_ACCESS_IND indicates that the central device is still disco-
-             * -vering services. So, restart the connection parameter update 
-             * timer
+            /* Send the temperature reading and start temperature
+             * measurement timer to periodically send measured readings
+             * to the connected host
              */
-             if(g_ht_data.cpu_timer_value == TGAP_CPC_PERIOD && 
-                g_ht_data.con_param_update_tid != TIMER_INVALID)
-             {
-                TimerDelete(g_ht_data.con_param_update_tid);
-                g_ht_data.con_param_update_tid = TimerCreate(TGAP_CPC_PERIOD,
-                                                 TRUE, requestConnParamUpdate);
-             }
-             
-            /* Received GATT ACCESS IND with write access */
-            if(p_event_data->flags == 
-                (ATT_ACCESS_WRITE | 
-                 ATT_ACCESS_PERMISSION | 
-                 ATT_ACCESS_WRITE_COMPLETE))
-            {
-               
-                HandleAccessWrite(p_event_data);
-
-               
-
-                /* Check if indications are configured on Temperature 
-                 * Measurement characteristic of Health Thermometer service
-                 */
-                if(g_ht_data.encrypt_enabled)
-                {
-                    /* Delete thermometer measurement timer */
-                    TimerDelete(g_ht_data.app_tid);
-                    g_ht_data.app_tid = TIMER_INVALID;
-
-                    /* Send the temperature reading and start temperature 
-                     * measurement timer to periodically send measured readings 
-                     * to the connected host 
-                     */
-                    htTempMeasTimerHandler(TIMER_INVALID);
-                }
-            }
-            /* Received GATT ACCESS IND with read access */
-            else if(p_event_data->flags == 
-                (ATT_ACCESS_READ | 
-                ATT_ACCESS_PERMISSION))
-            {
-                HandleAccessRead(p_event_data);
-            }
-            else
-            {
-                GattAccessRsp(p_event_data->cid, p_event_data->handle, 
-                              gatt_status_request_not_supported,
-                              0, NULL);
-            }
+            htTempMeasTimerHandler(TIMER_INVALID);
         }
-        break;
-
-        default:
-            /* Control should never come here */
-            ReportPanic(app_panic_invalid_state);
-        break;
     }
+    /* Received GATT ACCESS IND with read access */
+    else if(p_ind->flags ==
+        (ATT_ACCESS_READ |
+        ATT_ACCESS_PERMISSION))
+    {
+        HandleAccessRead(p_ind);
+    }
+    else
+    {
+        GattAccessRsp(p_ind->cid, p_ind->handle,
+                      gatt_status_request_not_supported,
+                      0, NULL);
+    }
+
+    return g_ht_data.state;
 }
 
 /*----------------------------------------------------------------------------*
@@ -1396,17 +2353,35 @@ static void handleBondingChanceTimerExpiry(timer_id tid)
  *
  *  DESCRIPTION
  *      This function handles LM Disconnect Complete event which is received
- *      at the completion of disconnect procedure triggered either by the 
- *      device or remote host or because of link loss 
+ *      at the completion of disconnect procedure triggered either by the
+ *      device or remote host or because of link loss. It is only dispatched
+ *      in app_state_connected and app_state_disconnecting states.
  *
  *  RETURNS
- *      Nothing.
+ *      The next application state.
  *
  *---------------------------------------------------------------------------*/
 
-static void handleSignalLmDisconnectComplete(
-                HCI_EV_DATA_DISCONNECT_COMPLETE_T *p_event_data)
+static app_state handleSignalLmDisconnectComplete(LM_EVENT_T *p_event_data)
 {
+    HCI_EV_DATA_DISCONNECT_COMPLETE_T *p_disc =
+                        &((LM_EV_DISCONNECT_COMPLETE_T *)p_event_data)->data;
+
+    /* Whether the host which disconnected was bonded */
+    bool bonded_host = AppIsDeviceBonded();
+
+#ifdef ENABLE_POWER_LADDER
+    /* Whether the link was closed for want of key events. The flag only
+     * applies to this disconnection, whatever its reason.
+     */
+    bool ladder_disconnect = g_ht_data.ladder_disconnect;
+
+    g_ht_data.ladder_disconnect = FALSE;
+#endif /* ENABLE_POWER_LADDER */
+
+#ifdef ENABLE_PERF_COUNTERS
+    AppPerfCountDisconnect(p_disc->reason);
+#endif /* ENABLE_PERF_COUNTERS */
 
     /* Delete the bonding chance timer */
     TimerDelete(g_ht_data.bonding_reattempt_tid);
@@ -1416,8 +2391,27 @@ static void handleSignalLmDisconnectComplete(
     g_ht_data.conn_interval = 0;
     g_ht_data.conn_latency = 0;
     g_ht_data.conn_timeout = 0;
-    
-    /* LM_EV_DISCONNECT_COMPLETE event can have following disconnect 
+
+    /* No host is connected any more */
+    BondTableSetActive(BOND_TABLE_INVALID);
+
+    if(g_ht_data.state == app_state_connected)
+    {
+        /* Initialise health thermometer data instance */
+        htDataInit();
+    }
+
+    /* Counting is expected to pause until the next connection */
+    CounterStoreCheckpoint();
+
+#ifdef NVM_TYPE_FLASH
+    /* The link is down, so the time taken to compact the record log does not
+     * disturb any connection event
+     */
+    Nvm_CompactLog();
+#endif /* NVM_TYPE_FLASH */
+
+    /* LM_EV_DISCONNECT_COMPLETE event can have following disconnect
      * reasons:
      *
      * HCI_ERROR_CONN_TIMEOUT - Link Loss case
@@ -1425,168 +2419,227 @@ static void handleSignalLmDisconnectComplete(
      * HCI_ERROR_OETC_* - Other end (i.e., remote host) terminated connection
      */
 
-    /*Handling signal as per current state */
-    switch(g_ht_data.state)
+    /* Link Loss Case */
+    if(p_disc->reason == HCI_ERROR_CONN_TIMEOUT)
     {
-        case app_state_connected:
-            /* Initialise health thermometer data instance */
-            htDataInit();
+        /* Start undirected advertisements by moving to
+         * app_state_fast_advertising state
+         */
+        return app_state_fast_advertising;
+    }
+    else if(p_disc->reason == HCI_ERROR_CONN_TERM_LOCAL_HOST)
+    {
+        if(g_ht_data.state == app_state_connected)
+        {
+            /* It is possible to receive LM_EV_DISCONNECT_COMPLETE event in
+             * app_state_connected state at the expiry of lower layers
+             * ATT/SMP timer leading to disconnect
+             */
+            return app_state_fast_advertising;
+        }
 
-            /* FALLTHROUGH */
+#ifdef ENABLE_POWER_LADDER
+        if(ladder_disconnect)
+        {
+            /* Closed for want of key events, stay reachable for a while */
+            return app_state_slow_advertising;
+        }
+#endif /* ENABLE_POWER_LADDER */
 
-        case app_state_disconnecting:
+        /* Case when application has triggered disconnect */
+        if(bonded_host)
         {
+            /* Move to app_state_idle state because of user action */
+            return app_state_idle;
+        }
 
-            /* Link Loss Case */
-            if(p_event_data->reason == HCI_ERROR_CONN_TIMEOUT)
-            {
-                /* Start undirected advertisements by moving to 
-                 * app_state_fast_advertising state
-                 */
-                AppSetState(app_state_fast_advertising);
-            }
-            else if(p_event_data->reason == HCI_ERROR_CONN_TERM_LOCAL_HOST)
-            {
+        /* Case of Bonding/Pairing removal */
+        return app_state_fast_advertising;
+    }
 
-                if(g_ht_data.state == app_state_connected)
-                {
-                    /* It is possible to receive LM_EV_DISCONNECT_COMPLETE 
-                     * event in app_state_connected state at the expiry of 
-                     * lower layers ATT/SMP timer leading to disconnect
-                     */
+    /* Remote user terminated connection case.
+     *
+     * If the device has not bonded but disconnected, it may just have
+     * discovered the services supported by the application or read some
+     * un-protected characteristic value like device name and disconnected.
+     * The application should be connectable because the same remote device
+     * may want to reconnect and bond. If not the application should be
+     * discoverable by other devices.
+     */
+    if(!bonded_host)
+    {
+        return app_state_fast_advertising;
+    }
 
-                    /* Start undirected advertisements by moving to 
-                     * app_state_fast_advertising state
-                     */
-                    AppSetState(app_state_fast_advertising);
-                }
-                else
-                {
-                    /* Case when application has triggered disconnect */
-
-                    if(g_ht_data.bonded)
-                    {
-                        /* If the device is bonded and host uses resolvable 
-                         * random address, the device initiates disconnect 
-                         * procedure if it gets reconnected to a different host,
-                         * in which case device should trigger fast 
-                         * advertisements after disconnecting from the last 
-                         * connected host.
-                         */
-                        if(GattIsAddressResolvableRandom(
-                                        &g_ht_data.bonded_bd_addr) &&
-                           (SMPrivacyMatchAddress(&g_ht_data.con_bd_addr,
-                                        g_ht_data.central_device_irk.irk,
-                                        MAX_NUMBER_IRK_STORED, 
-                                        MAX_WORDS_IRK) < 0))
-                        {
-                            AppSetState(app_state_fast_advertising);
-                        }
-                        else
-                        {
-                            /* Else move to app_state_idle state because of 
-                             * user action
-                             */
-                            AppSetState(app_state_idle);
-                        }
-                    }
-                    else /* Case of Bonding/Pairing removal */
-                    {
-                        /* Start undirected advertisements by moving to 
-                         * app_state_fast_advertising state
-                         */
-                        AppSetState(app_state_fast_advertising);
-                    }
-                }
+    /* Case when disconnect is triggered by a bonded Host */
+    return app_state_idle;
+}
 
-            }
-            else /* Remote user terminated connection case */
-            {
-                /* If the device has not bonded but disconnected, it may just 
-                 * have discovered the services supported by the application or 
-                 * read some un-protected characteristic value like device name 
-                 * and disconnected. The application should be connectable 
-                 * because the same remote device may want to reconnect and 
-                 * bond. If not the application should be discoverable by other 
-                 * devices.
-                 */
-                if(!g_ht_data.bonded)
-                {
-                    AppSetState(app_state_fast_advertising);
-                }
-                else /* Case when disconnect is triggered by a bonded Host */
-                {
-                    AppSetState(app_state_idle);
-                }
-            }
 
-        }
-        break;
-        
-        default:
-            /* Control should never come here */
-            ReportPanic(app_panic_invalid_state);
-        break;
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleSignalGattCharValNotCfm
+ *
+ *  DESCRIPTION
+ *      This function handles the signal GATT_CHAR_VAL_NOT_CFM which is received
+ *      once the firmware has processed a notification sent by the application.
+ *
+ *  RETURNS
+ *      The current application state.
+ *
+ *---------------------------------------------------------------------------*/
+
+static app_state handleSignalGattCharValNotCfm(LM_EVENT_T *p_event_data)
+{
+    GATT_CHAR_VAL_IND_CFM_T *p_cfm = (GATT_CHAR_VAL_IND_CFM_T *)p_event_data;
+
+    if(p_cfm->result != sys_status_success)
+    {
+        APP_TRACE(app_trace_notify_failed, p_cfm->handle);
+        APP_PERF_INC(app_perf_notify_failed);
+
+#ifdef ENABLE_TX_POWER_CONTROL
+        /* The link may be too weak for the transmit power in use */
+        TxPowerLinkDegraded();
+#endif /* ENABLE_TX_POWER_CONTROL */
+    }
+
+    if(p_cfm->handle == HANDLE_HT_TEMP_MEASUREMENT)
+    {
+        /* Key report confirmed, which ends its latency measurement */
+        APP_PERF_REPORT_CFM(p_cfm->result == sys_status_success);
+    }
+
+    if(DiagCheckHandleRange(p_cfm->handle))
+    {
+        /* Notification belongs to Diagnostics service */
+        DiagHandleNotificationCfm(p_cfm->handle);
     }
+
+    return g_ht_data.state;
 }
 
-/*============================================================================*
- *  Public Function Implementations
- *============================================================================*/
 
-#ifdef NVM_TYPE_FLASH
 /*----------------------------------------------------------------------------*
  *  NAME
- *      WriteApplicationAndServiceDataToNVM
+ *      appEventFromLmEvent
  *
  *  DESCRIPTION
- *      This function writes the application data to NVM. This function should 
- *      be called on getting nvm_status_needs_erase
+ *      This function maps an LM event code onto the column of the application
+ *      event table which handles it.
  *
  *  RETURNS
- *      Nothing.
+ *      The application event, or app_event_max if the LM event is not
+ *      handled by the application.
  *
  *---------------------------------------------------------------------------*/
-extern void WriteApplicationAndServiceDataToNVM(void)
+
+static app_event appEventFromLmEvent(lm_event_code event_code)
 {
-    uint16 nvm_sanity = 0xffff;
-    nvm_sanity = NVM_SANITY_MAGIC;
+    switch(event_code)
+    {
+        case GATT_ADD_DB_CFM:
+            /* Attribute database registration confirmation */
+            return app_event_gatt_add_db_cfm;
+
+        case GATT_CANCEL_CONNECT_CFM:
+            /* Confirmation for the completion of GattCancelConnectReq()
+             * procedure
+             */
+            return app_event_gatt_cancel_connect_cfm;
 
-    /* Write NVM sanity word to the NVM */
-    Nvm_Write(&nvm_sanity, sizeof(nvm_sanity), NVM_OFFSET_SANITY_WORD);
+        case LM_EV_CONNECTION_COMPLETE:
+            /* Handle the LM connection complete event. */
+            return app_event_lm_connection_complete;
+
+        case GATT_CONNECT_CFM:
+            /* Confirmation for the completion of GattConnectReq()
+             * procedure
+             */
+            return app_event_gatt_connect_cfm;
+
+        case SM_KEYS_IND:
+            /* Indication for the keys and associated security information
+             * on a connection that has completed Short Term Key Generation
+             * or Transport Specific Key Distribution
+             */
+            return app_event_sm_keys_ind;
+
+        case SM_PAIRING_AUTH_IND:
+            /* Authorize or Reject the pairing request */
+            return app_event_sm_pairing_auth_ind;
+
+        case SM_SIMPLE_PAIRING_COMPLETE_IND:
+            /* Indication for completion of Pairing procedure */
+            return app_event_sm_simple_pairing_complete_ind;
+
+        case LM_EV_ENCRYPTION_CHANGE:
+            /* Indication for encryption change event */
+            return app_event_lm_encryption_change;
 
-    /* Write Bonded flag to NVM. */
-    Nvm_Write((uint16*)&g_ht_data.bonded, 
-               sizeof(g_ht_data.bonded),
-               NVM_OFFSET_BONDED_FLAG);
+        case SM_DIV_APPROVE_IND:
+            /* Indication for SM Diversifier approval requested by F/W when
+             * the last bonded host exchange keys. Application may or may not
+             * approve the diversifier depending upon whether the application
+             * is still bonded to the same host
+             */
+            return app_event_sm_div_approve_ind;
 
+        /* Received in response to the LsConnectionParamUpdateReq()
+         * request sent from the slave after encryption is enabled. If
+         * the request has failed, the device should again send the same
+         * request only after Tgap(conn_param_timeout). Refer Bluetooth 4.0
+         * spec Vol 3 Part C, Section 9.3.9 and HID over GATT profile spec
+         * section 5.1.2.
+         */
+        case LS_CONNECTION_PARAM_UPDATE_CFM:
+            return app_event_ls_conn_param_update_cfm;
 
-    /* Write Bonded address to NVM. */
-    Nvm_Write((uint16*)&g_ht_data.bonded_bd_addr,
-              sizeof(TYPED_BD_ADDR_T),
-              NVM_OFFSET_BONDED_ADDR);
+        case LM_EV_CONNECTION_UPDATE:
+            /* This event is sent by the controller on connection parameter
+             * update.
+             */
+            return app_event_lm_connection_update;
 
-    /* Write the diversifier to NVM */
-    Nvm_Write(&g_ht_data.diversifier,
-                sizeof(g_ht_data.diversifier),
-                NVM_OFFSET_SM_DIV);
+        case LS_CONNECTION_PARAM_UPDATE_IND:
+            /* Indicates completion of remotely triggered Connection
+             * parameter update procedure
+             */
+            return app_event_ls_conn_param_update_ind;
 
-    /* Store the IRK to NVM */
-    Nvm_Write(g_ht_data.central_device_irk.irk,
-                MAX_WORDS_IRK,
-                NVM_OFFSET_SM_IRK);
+        case GATT_ACCESS_IND:
+            /* Indicates that an attribute controlled directly by the
+             * application (ATT_ATTR_IRQ attribute flag is set) is being
+             * read from or written to.
+             */
+            return app_event_gatt_access_ind;
 
-    /* Write GAP service data into NVM */
-    WriteGapServiceDataInNVM();
+        case LM_EV_DISCONNECT_COMPLETE:
+            /* Disconnect procedures either triggered by application or remote
+             * host or link loss case are considered completed on reception
+             * of LM_EV_DISCONNECT_COMPLETE event
+             */
+            return app_event_lm_disconnect_complete;
 
-    /* Write Health Thermometer service data into NVM */
-    WriteHealthThermometerServiceDataInNvm();
+        case GATT_CHAR_VAL_NOT_CFM:
+            /* Confirmation for the completion of GattCharValueNotification()
+             * procedure
+             */
+            return app_event_gatt_char_val_not_cfm;
 
-    /* Write Battery service data into NVM */
-    WriteBatteryServiceDataInNvm();
+        /* GATT_DISCONNECT_IND and GATT_DISCONNECT_CFM are ignored as the
+         * disconnect procedure is considered complete on reception of
+         * LM_EV_DISCONNECT_COMPLETE event.
+         */
+        default:
+            /* Ignore any other event */
+            return app_event_max;
+    }
 }
-#endif /* NVM_TYPE_FLASH */
 
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
 
 /*----------------------------------------------------------------------------*
  *  NAME
@@ -1594,7 +2647,9 @@ extern void WriteApplicationAndServiceDataToNVM(void)
  *
  *  DESCRIPTION
  *      This function calls firmware panic routine and gives a single point 
- *      of debugging any application level panics
+ *      of debugging any application level panics. A post-mortem record is 
+ *      written to NVM first so the cause of the reset can be read over the 
+ *      Diagnostics service afterwards.
  *
  *  RETURNS
  *      Nothing.
@@ -1603,6 +2658,9 @@ extern void WriteApplicationAndServiceDataToNVM(void)
 
 extern void ReportPanic(app_panic_code panic_code)
 {
+    /* Leave a post-mortem record to be read after the reset */
+    DiagWritePanicRecord(panic_code, g_ht_data.state, g_ht_data.last_lm_event);
+
     /* Raise panic */
     Panic(panic_code);
 }
@@ -1634,6 +2692,41 @@ extern void HandleShortButtonPress(uint8 *val)
 }
 
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HandlePairingButtonPress
+ *
+ *  DESCRIPTION
+ *      This function contains handling of long button press, which opens
+ *      the pairing window, and goes on timing the press for the extra long
+ *      button press.
+ *
+ *  RETURNS/MODIFIES
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void HandlePairingButtonPress(timer_id tid)
+{
+    if(tid == g_app_hw_data.button_press_tid)
+    {
+        /* The release is no longer a short press */
+        g_app_hw_data.pairing_hold = TRUE;
+
+        g_app_hw_data.button_press_tid = TimerCreate(
+                    EXTRA_LONG_BUTTON_PRESS_TIMER - PAIRING_BUTTON_PRESS_TIME,
+                    TRUE,
+                    HandleExtraLongButtonPress);
+
+        /* Sound two beeps to indicate the pairing window to user */
+        SoundBuzzer(buzzer_beep_twice);
+
+        openPairingWindow();
+
+    } /* Else ignore timer */
+}
+
+
 /*----------------------------------------------------------------------------*
  *  NAME
  *      HandleExtraLongButtonPress
@@ -1657,16 +2750,14 @@ extern void HandleExtraLongButtonPress(timer_id tid)
         /* Sound three beeps to indicate pairing removal to user */
         SoundBuzzer(buzzer_beep_thrice);
 
-        /* Remove bonding information*/
-
-        /* The device will no more be bonded */
-        g_ht_data.bonded = FALSE;
-
-        /* Write bonded status to NVM */
-        Nvm_Write((uint16*)&g_ht_data.bonded, 
-                  sizeof(g_ht_data.bonded), 
-                  NVM_OFFSET_BONDED_FLAG);
+        /* Remove bonding information of all the bonded hosts. The device 
+         * will no more be bonded, and any host can bond without the pairing
+         * window.
+         */
+        BondTableRemoveAll();
 
+        AppSchedStop(app_sched_job_pairing_window);
+        g_ht_data.pairing_window = FALSE;
 
         switch(g_ht_data.state)
         {
@@ -1744,110 +2835,185 @@ extern void HandleExtraLongButtonPress(timer_id tid)
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      AppSetState
+ *      AppRequestLowLatency
  *
  *  DESCRIPTION
- *      This function is used to set the state of the application.
+ *      This function is called on a high priority key event, such as the 
+ *      brake. It requests the low latency connection parameters, unless
+ *      already wanted, and holds them until LOW_LATENCY_HOLD_TIME after the
+ *      last such event.
  *
  *  RETURNS
  *      Nothing.
  *
  *---------------------------------------------------------------------------*/
 
-extern void AppSetState(app_state new_state)
+extern void AppRequestLowLatency(void)
 {
-    /* Check if the new state to be set is not the same as the present state
-     * of the application. */
-    app_state old_state = g_ht_data.state;
-    
-    if (old_state != new_state)
+    ble_con_params low_latency_conn_param;
+
+    if(g_ht_data.state != app_state_connected)
     {
-        /* Handle exiting old state */
-        switch (old_state)
-        {
-            case app_state_init:
-                appInitExit();
-            break;
+        return;
+    }
 
-            case app_state_disconnecting:
-                /* Common things to do whenever application exits
-                 * app_state_disconnecting state.
-                 */
+    /* Every high priority key event extends the hold */
+    AppSchedStart(app_sched_job_low_latency, LOW_LATENCY_HOLD_TIME,
+                  releaseLowLatency);
 
-                /* Initialise application and used services data structure 
-                 * while exiting Disconnecting state
-                 */
-                htDataInit();
-            break;
+    if(g_ht_data.low_latency)
+    {
+        return;
+    }
 
-            case app_state_fast_advertising:
-            case app_state_slow_advertising:
-                /* Common things to do whenever application exits
-                 * APP_*_ADVERTISING state.
-                 */
-                appAdvertisingExit();
-            break;
+    g_ht_data.low_latency = TRUE;
 
-            case app_state_connected:
-                /* Nothing to do */
-            break;
+    APP_TRACE(app_trace_low_latency, 1);
 
-            case app_state_idle:
-                /* Nothing to do */
-            break;
+    if(g_ht_data.conn_interval <= LOW_LATENCY_MAX_CON_INTERVAL &&
+       g_ht_data.conn_latency <= LOW_LATENCY_SLAVE_LATENCY)
+    {
+        /* The connection is already fast enough */
+        return;
+    }
 
-            default:
-                /* Nothing to do */
-            break;
-        }
+    /* A pending request for the preferred parameters would undo this one.
+     * releaseLowLatency() makes it once the hold ends.
+     */
+    TimerDelete(g_ht_data.con_param_update_tid);
+    g_ht_data.con_param_update_tid = TIMER_INVALID;
+    g_ht_data.cpu_timer_value = 0;
 
-        /* Set new state */
-        g_ht_data.state = new_state;
+    low_latency_conn_param.con_max_interval = LOW_LATENCY_MAX_CON_INTERVAL;
+    low_latency_conn_param.con_min_interval = LOW_LATENCY_MIN_CON_INTERVAL;
+    low_latency_conn_param.con_slave_latency = LOW_LATENCY_SLAVE_LATENCY;
+    low_latency_conn_param.con_super_timeout = 
+                                            LOW_LATENCY_SUPERVISION_TIMEOUT;
 
-        /* Handle entering new state */
-        switch (new_state)
-        {
-            case app_state_fast_advertising:
-            {
-                GattStartAdverts(TRUE);
+    /* The key report has already been sent, so a request refused by the
+     * firmware only leaves the parameters as they are
+     */
+    if(LsConnectionParamUpdateReq(&g_ht_data.con_bd_addr, 
+                                  &low_latency_conn_param) == ls_err_none)
+    {
+        APP_PERF_INC(app_perf_low_latency_reqs);
+    }
+}
 
-                /* Indicate advertising mode by sounding two short beeps */
-                SoundBuzzer(buzzer_beep_twice);
-            }
-            break;
 
-            case app_state_slow_advertising:
-                GattStartAdverts(FALSE);
-            break;
+#ifdef ENABLE_POWER_LADDER
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppKeyActivity
+ *
+ *  DESCRIPTION
+ *      This function is called on every key event. While connected it
+ *      restarts the inactivity power ladder, asking for the preferred
+ *      connection parameters again if the relaxed ones were requested. While
+ *      idle or advertising slowly it starts fast advertising, so the host
+ *      can reconnect quickly.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
 
-            case app_state_idle:
-                /* Sound long beep to indicate non connectable mode*/
-                SoundBuzzer(buzzer_beep_long);
-            break;
+extern void AppKeyActivity(void)
+{
+    switch(g_ht_data.state)
+    {
+        case app_state_connected:
+        {
+            AppSchedStart(app_sched_job_ladder, LADDER_RELAX_TIME,
+                          ladderStep);
 
-            case app_state_connected:
+            if(g_ht_data.relaxed)
             {
-                /* Common things to do whenever application enters
-                 * app_state_connected state.
-                 */
+                g_ht_data.relaxed = FALSE;
+
+                APP_TRACE(app_trace_ladder, 0);
 
-                /* Trigger SM Slave Security request only if the remote 
-                 * host is not using resolvable random address
+                /* The low latency parameters, if wanted, have been asked
+                 * for already
                  */
-                if(!GattIsAddressResolvableRandom(&g_ht_data.con_bd_addr))
+                if(!g_ht_data.low_latency)
                 {
-                    SMRequestSecurityLevel(&g_ht_data.con_bd_addr);
+                    requestPreferredParams();
                 }
+            }
+        }
+        break;
+
+        case app_state_slow_advertising:
+        {
+            if(!g_ht_data.key_wake)
+            {
+                APP_PERF_INC(app_perf_key_wakes);
+                APP_TRACE(app_trace_ladder, 4);
 
+                /* GATT_CANCEL_CONNECT_CFM moves to fast advertising */
+                g_ht_data.key_wake = TRUE;
+                GattStopAdverts();
             }
-            break;
+        }
+        break;
 
-            case app_state_disconnecting:
-                GattDisconnectReq(g_ht_data.st_ucid);
-            break;
+        case app_state_idle:
+        {
+            APP_PERF_INC(app_perf_key_wakes);
+            APP_TRACE(app_trace_ladder, 4);
 
-            default:
-            break;
+#ifdef LADDER_DORMANT
+            AppSchedStop(app_sched_job_ladder);
+#endif /* LADDER_DORMANT */
+
+            AppSetState(app_state_fast_advertising);
+        }
+        break;
+
+        default:
+            /* Fast advertising already, or busy */
+        break;
+    }
+}
+#endif /* ENABLE_POWER_LADDER */
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppSetState
+ *
+ *  DESCRIPTION
+ *      This function is used to set the state of the application.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void AppSetState(app_state new_state)
+{
+    /* Check if the new state to be set is not the same as the present state
+     * of the application. */
+    app_state old_state = g_ht_data.state;
+
+    if (old_state != new_state)
+    {
+        APP_TRACE(app_trace_state, (old_state << 8) | new_state);
+
+        /* Handle exiting old state */
+        if(app_state_hooks[old_state].exit != NULL)
+        {
+            app_state_hooks[old_state].exit();
+        }
+
+        /* Set new state */
+        g_ht_data.state = new_state;
+
+        /* Handle entering new state */
+        if(app_state_hooks[new_state].entry != NULL)
+        {
+            app_state_hooks[new_state].entry();
         }
     }
 }
@@ -1868,7 +3034,7 @@ extern void AppSetState(app_state new_state)
 
 extern bool AppIsDeviceBonded(void)
 {
-    return g_ht_data.bonded;
+    return (BondTableGetActive() != BOND_TABLE_INVALID);
 }
 
 
@@ -1919,12 +3085,17 @@ extern void AppInit(sleep_state last_sleep_state)
 
     /* Initialise the application timers */
     TimerInit(MAX_APP_TIMERS, (void*)app_timers);
+
+    /* Initialise the scheduler sharing one timer between low priority jobs */
+    AppSchedInit();
  
     /* Initialise GATT entity */
     GattInit();
 
     /* Install GATT Server support for the optional Write procedure
      * This is mandatory only if control point characteristic is supported. 
+     * The write commands of the Diagnostics Command characteristic are 
+     * received through it as well.
      */
     GattInstallServerWrite();
 
@@ -1934,9 +3105,17 @@ extern void AppInit(sleep_state last_sleep_state)
 #ifdef NVM_TYPE_EEPROM
     /* Configure the NVM manager to use I2C EEPROM for NVM store */
     NvmConfigureI2cEeprom();
+
+    /* Read the application and services data into RAM with a single NVM 
+     * transfer
+     */
+    Nvm_LoadShadow();
 #elif NVM_TYPE_FLASH
     /* Configure the NVM Manager to use SPI flash for NVM store. */
     NvmConfigureSpiFlash();
+
+    /* Rebuild the NVM contents from the record log held in the SPI flash */
+    Nvm_LoadLog();
 #endif /* NVM_TYPE_EEPROM */
 
     Nvm_Disable();
@@ -1961,6 +3140,14 @@ extern void AppInit(sleep_state last_sleep_state)
     /* Initialise Health Thermometer H/W */
     HtInitHardware();
 
+#ifdef LADDER_DORMANT
+    if(last_sleep_state == sleep_state_dormant)
+    {
+        /* Report the key which woke the device once the host is back */
+        HtHwReplayWakeKeys();
+    }
+#endif /* LADDER_DORMANT */
+
     /* Tell GATT about our database. We will get a GATT_ADD_DB_CFM event when
      * this has completed.
      */
@@ -2031,141 +3218,20 @@ extern void AppProcessSystemEvent(sys_event_id id, void *data)
 extern bool AppProcessLmEvent(lm_event_code event_code, 
                               LM_EVENT_T *p_event_data)
 {
+    app_event event = appEventFromLmEvent(event_code);
 
-    switch (event_code)
-    {
-
-        /* Handle events received from Firmware */
-
-        case GATT_ADD_DB_CFM:
-            /* Attribute database registration confirmation */
-            handleSignalGattAddDbCfm((GATT_ADD_DB_CFM_T*)p_event_data);
-        break;
-
-        case GATT_CANCEL_CONNECT_CFM:
-            /* Confirmation for the completion of GattCancelConnectReq()
-             * procedure 
-             */
-            handleSignalGattCancelConnectCfm();
-        break;
-
-        case LM_EV_CONNECTION_COMPLETE:
-            /* Handle the LM connection complete event. */
-            handleSignalLmEvConnectionComplete((LM_EV_CONNECTION_COMPLETE_T*)
-                                                                p_event_data);
-        break;
-
-        case GATT_CONNECT_CFM:
-            /* Confirmation for the completion of GattConnectReq() 
-             * procedure
-             */
-            handleSignalGattConnectCfm((GATT_CONNECT_CFM_T*)p_event_data);
-        break;
-
-        case SM_KEYS_IND:
-            /* Indication for the keys and associated security information
-             * on a connection that has completed Short Term Key Generation 
-             * or Transport Specific Key Distribution
-             */
-            handleSignalSmKeysInd((SM_KEYS_IND_T *)p_event_data);
-        break;
-
-        case SM_PAIRING_AUTH_IND:
-            /* Authorize or Reject the pairing request */
-            handleSignalSmPairingAuthInd((SM_PAIRING_AUTH_IND_T*)p_event_data);
-        break;
-
-        case SM_SIMPLE_PAIRING_COMPLETE_IND:
-            /* Indication for completion of Pairing procedure */
-            handleSignalSmSimplePairingCompleteInd(
-                (SM_SIMPLE_PAIRING_COMPLETE_IND_T *)p_event_data);
-        break;
-
-        case LM_EV_ENCRYPTION_CHANGE:
-            /* Indication for encryption change event */
-            handleSignalLMEncryptionChange(
-            (HCI_EV_DATA_ENCRYPTION_CHANGE_T *)&p_event_data->enc_change.data);
-        break;
+    g_ht_data.last_lm_event = event_code;
 
-        case SM_DIV_APPROVE_IND:
-            /* Indication for SM Diversifier approval requested by F/W when 
-             * the last bonded host exchange keys. Application may or may not
-             * approve the diversifier depending upon whether the application 
-             * is still bonded to the same host
-             */
-            handleSignalSmDivApproveInd((SM_DIV_APPROVE_IND_T *)p_event_data);
-        break;
+    APP_TRACE(app_trace_lm_event, event_code);
 
-        /* Received in response to the LsConnectionParamUpdateReq() 
-         * request sent from the slave after encryption is enabled. If 
-         * the request has failed, the device should again send the same 
-         * request only after Tgap(conn_param_timeout). Refer Bluetooth 4.0 
-         * spec Vol 3 Part C, Section 9.3.9 and HID over GATT profile spec 
-         * section 5.1.2.
+    if(event != app_event_max)
+    {
+        /* Run the action for the event in the current state and move to the
+         * state it returns
          */
-        case LS_CONNECTION_PARAM_UPDATE_CFM:
-            handleSignalLsConnParamUpdateCfm((LS_CONNECTION_PARAM_UPDATE_CFM_T*)
-                p_event_data);
-        break;
-
-
-        case LM_EV_CONNECTION_UPDATE:
-            /* This event is sent by the controller on connection parameter 
-             * update. 
-             */
-            handleSignalLmConnectionUpdate(
-                            (LM_EV_CONNECTION_UPDATE_T*)p_event_data);
-        break;
-
-
-        case LS_CONNECTION_PARAM_UPDATE_IND:
-            /* Indicates completion of remotely triggered Connection 
-             * parameter update procedure
-             */
-            handleSignalLsConnParamUpdateInd(
-                            (LS_CONNECTION_PARAM_UPDATE_IND_T *)p_event_data);
-        break;
-
-        case GATT_ACCESS_IND:
-            /* Indicates that an attribute controlled directly by the
-             * application (ATT_ATTR_IRQ attribute flag is set) is being 
-             * read from or written to.
-             */
-            handleSignalGattAccessInd((GATT_ACCESS_IND_T *)p_event_data);
-        break;
-
-        case GATT_DISCONNECT_IND:
-            /* Disconnect procedure triggered by remote host or due to 
-             * link loss is considered complete on reception of 
-             * LM_EV_DISCONNECT_COMPLETE event. So, it gets handled on 
-             * reception of LM_EV_DISCONNECT_COMPLETE event.
-             */
-        break;
-
-        case GATT_DISCONNECT_CFM:
-            /* Confirmation for the completion of GattDisconnectReq()
-             * procedure is ignored as the procedure is considered complete 
-             * on reception of LM_EV_DISCONNECT_COMPLETE event. So, it gets 
-             * handled on reception of LM_EV_DISCONNECT_COMPLETE event.
-             */
-        break;
-
-        case LM_EV_DISCONNECT_COMPLETE:
-        {
-            /* Disconnect procedures either triggered by application or remote
-             * host or link loss case are considered completed on reception 
-             * of LM_EV_DISCONNECT_COMPLETE event
-             */
-             handleSignalLmDisconnectComplete(
-                    &((LM_EV_DISCONNECT_COMPLETE_T *)p_event_data)->data);
-        }
-        break;
-
-        default:
-            /* Ignore any other event */ 
-        break;
-
+        AppSetState(app_event_table[g_ht_data.state][event](p_event_data));
     }
 
     return TRUE;
 }
+
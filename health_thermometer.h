@@ -21,6 +21,13 @@
 #include <types.h>
 #include <bluetooth.h>
 #include <timer.h>
+#include <bt_event_types.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
 
 /*============================================================================*
  *  Public Definitions
@@ -52,7 +59,12 @@ typedef enum
     app_state_disconnecting,
 
     /* Enters when the application is not connected to remote host */
-    app_state_idle
+    app_state_idle,
+
+    /* Number of application states. This must always be the last entry as
+     * it is used to size the application state tables.
+     */
+    app_state_max
 
 } app_state;
 
@@ -81,13 +93,9 @@ typedef struct
     /* Track the UCID as Clients connect and disconnect */
     uint16                         st_ucid;
 
-    /* Boolean flag to indicated whether the device is bonded */
-    bool                           bonded;
-
-    /* TYPED_BD_ADDR_T of the host to which device is bonded.*/
-    TYPED_BD_ADDR_T                bonded_bd_addr;
-
-    /* Diversifier associated with the LTK of the bonded device */
+    /* Diversifier associated with the LTK of the last device to bond. The 
+     * diversifiers of all the bonded devices are kept by the bond table.
+     */
     uint16                         diversifier;
 
     /* Store timer id for Connection Parameter Update timer in Connected 
@@ -105,8 +113,8 @@ typedef struct
      */
     uint32                         cpu_timer_value;
 
-    /* Central Private Address Resolution IRK  Will only be used when
-     * central device used resolvable random address. 
+    /* Central Private Address Resolution IRK received while pairing. Will 
+     * only be used when central device used resolvable random address. 
      */
     CENTRAL_DEVICE_IRK_T           central_device_irk;
 
@@ -123,6 +131,11 @@ typedef struct
     /* Boolean flag set to indicate pairing button press */
     bool                           pairing_button_pressed;
 
+    /* Boolean flag set while a further central may bond, see
+     * PAIRING_WINDOW_TIME
+     */
+    bool                           pairing_window;
+
     /* This timer will be used if the application is already bonded to the 
      * remote host address but the remote device wanted to rebond which we had 
      * declined. In this scenario, we give ample time to the remote device to 
@@ -140,6 +153,29 @@ typedef struct
     /*Variable to store the current connection timeout value. */
     uint16                         conn_timeout;
 
+    /* Boolean flag set while the low latency connection parameters are
+     * wanted, after a high priority key event
+     */
+    bool                           low_latency;
+
+#ifdef ENABLE_POWER_LADDER
+    /* Boolean flag set once the relaxed connection parameters have been
+     * requested, after LADDER_RELAX_TIME without key events
+     */
+    bool                           relaxed;
+
+    /* Boolean flag set when the link was closed for want of key events */
+    bool                           ladder_disconnect;
+
+    /* Boolean flag set when a key event stops slow advertising, to advertise
+     * fast instead
+     */
+    bool                           key_wake;
+#endif /* ENABLE_POWER_LADDER */
+
+    /* Last LM event received, recorded in the panic post-mortem record */
+    lm_event_code                  last_lm_event;
+
 
 } HT_DATA_T;
 
@@ -158,11 +194,26 @@ extern HT_DATA_T g_ht_data;
 /* This function contains handling of short button press */
 extern void HandleShortButtonPress(uint8 *val);
 
+/* This function opens the pairing window on a long button press */
+extern void HandlePairingButtonPress(timer_id tid);
+
 /* This function contains handling of extra long button press */
 extern void HandleExtraLongButtonPress(timer_id tid);
 
 /* This function is used to set the state of the application */
 extern void AppSetState(app_state new_state);
 
+/* This function requests the low latency connection parameters for a while,
+ * on a high priority key event
+ */
+extern void AppRequestLowLatency(void);
+
+#ifdef ENABLE_POWER_LADDER
+/* This function restarts the inactivity power ladder on a key event, and
+ * starts fast advertising if the device is idle or advertising slowly
+ */
+extern void AppKeyActivity(void);
+#endif /* ENABLE_POWER_LADDER */
+
 
 #endif /* __HEALTH_THERMOMETER_H__ */
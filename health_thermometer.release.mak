@@ -34,7 +34,9 @@ DBS=\
       dev_info_service_db.db\
       gap_service_db.db\
       gatt_service_db.db\
-      health_thermo_service_db.db
+      health_thermo_service_db.db\
+      diag_service_db.db\
+      hid_service_db.db
 
 INPUTS=\
       battery_service.c\
@@ -45,6 +47,19 @@ INPUTS=\
       ht_hw.c\
       nvm_access.c\
       dev_info_service.c\
+      app_trace.c\
+      app_perf.c\
+      diag_service.c\
+      counter_store.c\
+      bond_table.c\
+      app_sched.c\
+      signal_seq.c\
+      pulse_ctrlr.c\
+      packed_buf.c\
+      hid_service.c\
+      tx_power.c\
+      throttle.c\
+      pio_ctrlr_code.asm\
       $(DBS)
 
 KEYR=\
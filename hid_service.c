@@ -0,0 +1,571 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ * FILE
+ *     hid_service.c
+ *
+ * DESCRIPTION
+ *     This file defines routines for using HID service.
+ *
+ *     The keys are reported as a keyboard, in the boot protocol or in the
+ *     report protocol as selected by the host, so that the host operating
+ *     system decodes them in its HID driver. In the report protocol, the
+ *     GHG and BP counts are also reported as vendor usages. A report is only
+ *     notified when its content changes.
+ *
+ ****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *===========================================================================*/
+
+#include <gatt.h>
+#include <gatt_prim.h>
+#include <buf_utils.h>
+#include <mem.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *===========================================================================*/
+
+#include "app_gatt.h"
+#include "hid_service.h"
+#include "bond_table.h"
+#include "app_gatt_db.h"
+#include "app_perf.h"
+
+#ifdef ENABLE_HID_MODE
+
+/*============================================================================*
+ *  Private Definitions
+ *===========================================================================*/
+
+/* Values of the Protocol Mode characteristic */
+#define HID_PROTOCOL_MODE_BOOT                        (0x00)
+#define HID_PROTOCOL_MODE_REPORT                      (0x01)
+
+/* Values written to the HID Control Point characteristic */
+#define HID_CONTROL_POINT_SUSPEND                     (0x00)
+#define HID_CONTROL_POINT_EXIT_SUSPEND                (0x01)
+
+/* Size of the keyboard input report, the same in both protocols: the
+ * modifiers, a reserved octet and the key codes
+ */
+#define HID_KEYS_REPORT_SIZE                          (8)
+
+/* Offset of the first key code in the keyboard input report */
+#define HID_KEYS_REPORT_CODES                         (2)
+
+/* Size of the counters input report: the GHG and BP counts */
+#define HID_COUNTERS_REPORT_SIZE                      (2)
+
+/*============================================================================*
+ *  Private Data Types
+ *===========================================================================*/
+
+/* HID service data type */
+typedef struct
+{
+    /* Protocol selected by the host */
+    uint8   protocol_mode;
+
+    /* Boolean flag set while the host has suspended the reports */
+    bool    suspended;
+
+    /* Client configurations of the input reports */
+    gatt_client_config keys_client_config;
+    gatt_client_config counters_client_config;
+    gatt_client_config boot_keys_client_config;
+
+    /* Last keyboard input report, returned to reads in both protocols */
+    uint8   keys_report[HID_KEYS_REPORT_SIZE];
+
+    /* Last counters input report */
+    uint8   counters_report[HID_COUNTERS_REPORT_SIZE];
+
+    /* Last boot keyboard output report written by the host */
+    uint8   boot_output;
+
+} HID_DATA_T;
+
+/* Key code reported for a key */
+typedef struct
+{
+    /* HID_KEY_ bit of the key */
+    uint16  key;
+
+    /* Usage of the key on the key codes page */
+    uint8   code;
+
+} HID_KEY_CODE_T;
+
+/*============================================================================*
+ *  Private Data
+ *===========================================================================*/
+
+/* HID service data instance */
+static HID_DATA_T g_hid_data;
+
+/* Key codes of the keys, in report order. There are no more keys than key
+ * codes in a report, so a key is never left out.
+ */
+static const HID_KEY_CODE_T hid_key_codes[] =
+{
+    {HID_KEY_LEFT,      0x50},      /* Left Arrow */
+    {HID_KEY_RIGHT,     0x4f},      /* Right Arrow */
+    {HID_KEY_FASTER,    0x52},      /* Up Arrow */
+    {HID_KEY_BRAKE,     0x51},      /* Down Arrow */
+    {HID_KEY_GHG,       0x0a},      /* 'g' */
+    {HID_KEY_BP,        0x05}       /* 'b' */
+};
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *===========================================================================*/
+
+static bool hidBuildKeysReport(uint16 keys);
+static bool hidBuildCountersReport(uint8 ghg_count, uint8 bp_count);
+static sys_status hidWriteClientConfig(GATT_ACCESS_IND_T *p_ind,
+                                       gatt_client_config *p_client_config,
+                                       bond_cccd cccd);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *===========================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      hidBuildKeysReport
+ *
+ *  DESCRIPTION
+ *      This function builds the keyboard input report for the keys held
+ *      down.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if the report has changed.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool hidBuildKeysReport(uint16 keys)
+{
+    uint8 report[HID_KEYS_REPORT_SIZE];
+    uint16 index;
+    uint16 code = HID_KEYS_REPORT_CODES;
+
+    MemSet(report, 0, HID_KEYS_REPORT_SIZE);
+
+    for(index = 0;
+        index < sizeof(hid_key_codes) / sizeof(hid_key_codes[0]);
+        index ++)
+    {
+        if(keys & hid_key_codes[index].key)
+        {
+            report[code ++] = hid_key_codes[index].code;
+        }
+    }
+
+    if(MemCmp(report, g_hid_data.keys_report, HID_KEYS_REPORT_SIZE) == 0)
+    {
+        return FALSE;
+    }
+
+    MemCopy(g_hid_data.keys_report, report, HID_KEYS_REPORT_SIZE);
+
+    return TRUE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      hidBuildCountersReport
+ *
+ *  DESCRIPTION
+ *      This function builds the counters input report.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if the report has changed.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool hidBuildCountersReport(uint8 ghg_count, uint8 bp_count)
+{
+    if((g_hid_data.counters_report[0] == ghg_count) &&
+       (g_hid_data.counters_report[1] == bp_count))
+    {
+        return FALSE;
+    }
+
+    g_hid_data.counters_report[0] = ghg_count;
+    g_hid_data.counters_report[1] = bp_count;
+
+    return TRUE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      hidWriteClientConfig
+ *
+ *  DESCRIPTION
+ *      This function handles a write to the client configuration of an
+ *      input report, and stores it with the bond if the device is bonded.
+ *      The value must be 2 octets long.
+ *
+ *  RETURNS
+ *      Status of the write.
+ *
+ *---------------------------------------------------------------------------*/
+
+static sys_status hidWriteClientConfig(GATT_ACCESS_IND_T *p_ind,
+                                       gatt_client_config *p_client_config,
+                                       bond_cccd cccd)
+{
+    uint8 *p_value = p_ind->value;
+    uint16 client_config;
+
+    if(p_ind->size_value != 2)
+    {
+        return gatt_status_invalid_length;
+    }
+
+    client_config = BufReadUint16(&p_value);
+
+    /* Only notifications are supported */
+    if((client_config != gatt_client_config_notification) &&
+       (client_config != gatt_client_config_none))
+    {
+        return gatt_status_desc_improper_config;
+    }
+
+    *p_client_config = (gatt_client_config)client_config;
+
+    BondTableSetClientConfig(cccd, *p_client_config);
+
+    return sys_status_success;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *===========================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HidDataInit
+ *
+ *  DESCRIPTION
+ *      This function is used to initialise HID service data structure. The
+ *      host goes back to the report protocol on every connection.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void HidDataInit(void)
+{
+    g_hid_data.protocol_mode = HID_PROTOCOL_MODE_REPORT;
+    g_hid_data.suspended = FALSE;
+    g_hid_data.boot_output = 0;
+
+    MemSet(g_hid_data.keys_report, 0, HID_KEYS_REPORT_SIZE);
+    MemSet(g_hid_data.counters_report, 0, HID_COUNTERS_REPORT_SIZE);
+
+    /* Initialise the input report client configurations with the ones
+     * stored for the connected device if it is bonded
+     */
+    g_hid_data.keys_client_config =
+                            BondTableGetClientConfig(bond_cccd_hid_keys);
+    g_hid_data.counters_client_config =
+                            BondTableGetClientConfig(bond_cccd_hid_counters);
+    g_hid_data.boot_keys_client_config =
+                            BondTableGetClientConfig(bond_cccd_hid_boot_keys);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HidHandleAccessRead
+ *
+ *  DESCRIPTION
+ *      This function handles read operation on HID service attributes
+ *      maintained by the application and responds with the GATT_ACCESS_RSP
+ *      message.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void HidHandleAccessRead(GATT_ACCESS_IND_T *p_ind)
+{
+    uint16 length = 0;
+    uint8 value[2];
+    uint8 *p_val = value;
+    uint8 *p_value = value;
+    sys_status rc = sys_status_success;
+
+    switch(p_ind->handle)
+    {
+        case HANDLE_HID_PROTOCOL_MODE:
+        {
+            length = 1; /* One Octet */
+            value[0] = g_hid_data.protocol_mode;
+        }
+        break;
+
+        case HANDLE_HID_KEYS_REPORT:
+        case HANDLE_HID_BOOT_KEYS_REPORT:
+        {
+            length = HID_KEYS_REPORT_SIZE;
+            p_value = g_hid_data.keys_report;
+        }
+        break;
+
+        case HANDLE_HID_COUNTERS_REPORT:
+        {
+            length = HID_COUNTERS_REPORT_SIZE;
+            p_value = g_hid_data.counters_report;
+        }
+        break;
+
+        case HANDLE_HID_BOOT_OUTPUT_REPORT:
+        {
+            length = 1; /* One Octet */
+            value[0] = g_hid_data.boot_output;
+        }
+        break;
+
+        case HANDLE_HID_KEYS_REPORT_C_CFG:
+        {
+            length = 2; /* Two Octets */
+            BufWriteUint16(&p_val, g_hid_data.keys_client_config);
+        }
+        break;
+
+        case HANDLE_HID_COUNTERS_REPORT_C_CFG:
+        {
+            length = 2; /* Two Octets */
+            BufWriteUint16(&p_val, g_hid_data.counters_client_config);
+        }
+        break;
+
+        case HANDLE_HID_BOOT_KEYS_REPORT_C_CFG:
+        {
+            length = 2; /* Two Octets */
+            BufWriteUint16(&p_val, g_hid_data.boot_keys_client_config);
+        }
+        break;
+
+        default:
+            /* No more IRQ characteristics */
+            rc = gatt_status_read_not_permitted;
+        break;
+    }
+
+    /* Send Access response */
+    GattAccessRsp(p_ind->cid, p_ind->handle, rc, length, p_value);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HidHandleAccessWrite
+ *
+ *  DESCRIPTION
+ *      This function handles write operation on HID service attributes
+ *      maintained by the application and responds with the GATT_ACCESS_RSP
+ *      message. Values which are not defined are ignored, as the HID
+ *      service requires.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void HidHandleAccessWrite(GATT_ACCESS_IND_T *p_ind)
+{
+    uint8 *p_value = p_ind->value;
+    sys_status rc = sys_status_success;
+
+    switch(p_ind->handle)
+    {
+        case HANDLE_HID_PROTOCOL_MODE:
+        {
+            if((p_ind->size_value == 1) &&
+               ((p_value[0] == HID_PROTOCOL_MODE_BOOT) ||
+                (p_value[0] == HID_PROTOCOL_MODE_REPORT)))
+            {
+                g_hid_data.protocol_mode = p_value[0];
+            }
+        }
+        break;
+
+        case HANDLE_HID_CONTROL_POINT:
+        {
+            if(p_ind->size_value == 1)
+            {
+                if(p_value[0] == HID_CONTROL_POINT_SUSPEND)
+                {
+                    g_hid_data.suspended = TRUE;
+                }
+                else if(p_value[0] == HID_CONTROL_POINT_EXIT_SUSPEND)
+                {
+                    g_hid_data.suspended = FALSE;
+                }
+            }
+        }
+        break;
+
+        case HANDLE_HID_BOOT_OUTPUT_REPORT:
+        {
+            /* There are no LEDs to drive, the value is only kept */
+            if(p_ind->size_value >= 1)
+            {
+                g_hid_data.boot_output = p_value[0];
+            }
+        }
+        break;
+
+        case HANDLE_HID_KEYS_REPORT_C_CFG:
+            rc = hidWriteClientConfig(p_ind, &g_hid_data.keys_client_config,
+                                      bond_cccd_hid_keys);
+        break;
+
+        case HANDLE_HID_COUNTERS_REPORT_C_CFG:
+            rc = hidWriteClientConfig(p_ind,
+                                      &g_hid_data.counters_client_config,
+                                      bond_cccd_hid_counters);
+        break;
+
+        case HANDLE_HID_BOOT_KEYS_REPORT_C_CFG:
+            rc = hidWriteClientConfig(p_ind,
+                                      &g_hid_data.boot_keys_client_config,
+                                      bond_cccd_hid_boot_keys);
+        break;
+
+        default:
+            rc = gatt_status_write_not_permitted;
+        break;
+    }
+
+    /* Send ACCESS RESPONSE */
+    GattAccessRsp(p_ind->cid, p_ind->handle, rc, 0, NULL);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HidSendInputReport
+ *
+ *  DESCRIPTION
+ *      This function sends the keys held down, a set of HID_KEY_ bits, and
+ *      the GHG and BP counts to the connected host. Only the reports which
+ *      have changed are notified, on the input reports of the protocol
+ *      selected by the host. Nothing is sent while the host has suspended
+ *      the reports, but the values read are kept up to date.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void HidSendInputReport(uint16 ucid, uint16 keys, uint8 ghg_count,
+                               uint8 bp_count)
+{
+    bool keys_changed = hidBuildKeysReport(keys);
+    bool counters_changed = hidBuildCountersReport(ghg_count, bp_count);
+
+    if((ucid == GATT_INVALID_UCID) || g_hid_data.suspended)
+    {
+        return;
+    }
+
+    if(g_hid_data.protocol_mode == HID_PROTOCOL_MODE_BOOT)
+    {
+        /* The counters have no boot report */
+        if(keys_changed &&
+           (g_hid_data.boot_keys_client_config &
+                                            gatt_client_config_notification))
+        {
+            GattCharValueNotification(ucid, HANDLE_HID_BOOT_KEYS_REPORT,
+                                      HID_KEYS_REPORT_SIZE,
+                                      g_hid_data.keys_report);
+
+            APP_PERF_INC(app_perf_notify_sent);
+        }
+
+        return;
+    }
+
+    if(keys_changed &&
+       (g_hid_data.keys_client_config & gatt_client_config_notification))
+    {
+        GattCharValueNotification(ucid, HANDLE_HID_KEYS_REPORT,
+                                  HID_KEYS_REPORT_SIZE,
+                                  g_hid_data.keys_report);
+
+        APP_PERF_INC(app_perf_notify_sent);
+    }
+
+    if(counters_changed &&
+       (g_hid_data.counters_client_config & gatt_client_config_notification))
+    {
+        GattCharValueNotification(ucid, HANDLE_HID_COUNTERS_REPORT,
+                                  HID_COUNTERS_REPORT_SIZE,
+                                  g_hid_data.counters_report);
+
+        APP_PERF_INC(app_perf_notify_sent);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HidCheckHandleRange
+ *
+ *  DESCRIPTION
+ *      This function is used to check if the handle belongs to the HID
+ *      service
+ *
+ *  RETURNS
+ *      Boolean - Indicating whether handle falls in range or not.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool HidCheckHandleRange(uint16 handle)
+{
+    return ((handle >= HANDLE_HID_SERVICE) &&
+            (handle <= HANDLE_HID_SERVICE_END))
+            ? TRUE : FALSE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HidBondingNotify
+ *
+ *  DESCRIPTION
+ *      This function is used by application to notify bonding status to
+ *      HID service
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void HidBondingNotify(void)
+{
+    /* Store with the new bond the client configurations of the input
+     * reports that were configured prior to bonding
+     */
+    BondTableSetClientConfig(bond_cccd_hid_keys,
+                             g_hid_data.keys_client_config);
+    BondTableSetClientConfig(bond_cccd_hid_counters,
+                             g_hid_data.counters_client_config);
+    BondTableSetClientConfig(bond_cccd_hid_boot_keys,
+                             g_hid_data.boot_keys_client_config);
+}
+
+#endif /* ENABLE_HID_MODE */
@@ -0,0 +1,79 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      hid_service.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for HID service
+ *
+ *****************************************************************************/
+
+#ifndef __HID_SERVICE_H__
+#define __HID_SERVICE_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <bt_event_types.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+
+#ifdef ENABLE_HID_MODE
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Keys which can be held down, as passed to HidSendInputReport() */
+#define HID_KEY_LEFT            (0x0001)
+#define HID_KEY_RIGHT           (0x0002)
+#define HID_KEY_FASTER          (0x0004)
+#define HID_KEY_BRAKE           (0x0008)
+#define HID_KEY_GHG             (0x0010)
+#define HID_KEY_BP              (0x0020)
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* This function is used to initialise HID service data structure */
+extern void HidDataInit(void);
+
+/* This function handles read operation on HID service attributes
+ * maintained by the application
+ */
+extern void HidHandleAccessRead(GATT_ACCESS_IND_T *p_ind);
+
+/* This function handles write operation on HID service attributes
+ * maintained by the application
+ */
+extern void HidHandleAccessWrite(GATT_ACCESS_IND_T *p_ind);
+
+/* This function sends the keys held down and the counts to the connected
+ * host, in the protocol selected by the host
+ */
+extern void HidSendInputReport(uint16 ucid, uint16 keys, uint8 ghg_count,
+                               uint8 bp_count);
+
+/* This function is used to check if the handle belongs to the HID
+ * service
+ */
+extern bool HidCheckHandleRange(uint16 handle);
+
+/* This function is used by application to notify bonding status to
+ * HID service
+ */
+extern void HidBondingNotify(void);
+
+#endif /* ENABLE_HID_MODE */
+
+#endif /* __HID_SERVICE_H__ */
@@ -0,0 +1,48 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      hid_uuids.h
+ *
+ * DESCRIPTION
+ *      UUID MACROs for HID service
+ *
+ *****************************************************************************/
+
+#ifndef __HID_UUIDS_H__
+#define __HID_UUIDS_H__
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Brackets should not be used around the value of a macro. The parser which 
+ * creates .c and .h files from .db file doesn't understand brackets and will
+ * raise syntax errors. 
+ */
+
+/* For UUID values, refer http://developer.bluetooth.org/gatt/services/
+ * Pages/ServiceViewer.aspx?u=org.bluetooth.service.human_interface_device.xml
+ */
+
+#define UUID_HID_SERVICE                               0x1812
+
+#define UUID_HID_INFORMATION                           0x2a4a
+
+#define UUID_HID_REPORT_MAP                            0x2a4b
+
+#define UUID_HID_CONTROL_POINT                         0x2a4c
+
+#define UUID_HID_REPORT                                0x2a4d
+
+#define UUID_HID_PROTOCOL_MODE                         0x2a4e
+
+#define UUID_HID_BOOT_KEYBOARD_INPUT                   0x2a22
+
+#define UUID_HID_BOOT_KEYBOARD_OUTPUT                  0x2a32
+
+#define UUID_HID_REPORT_REFERENCE                      0x2908
+
+#endif /* __HID_UUIDS_H__ */
@@ -0,0 +1,275 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      bond_bench.c
+ *
+ *  DESCRIPTION
+ *      Measures the time BondTableFind() takes to identify a central using a
+ *      resolvable random address as the bond table fills up with 1 to
+ *      MAX_BONDED_DEVICES bonds holding IRKs, for each bonded central and
+ *      for a central which is not bonded. The number of AES blocks a lookup
+ *      encrypts is the cost on the chip, the host time only ranks the
+ *      table sizes. See host/README.txt.
+ *
+ *      Usage: bond_bench [-lookups <n>] [-aes-us <us>]
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  System Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "emu.h"
+#include "health_thermometer.h"
+#include "bond_table.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Lookups timed for each address by default */
+#define BB_LOOKUPS                          (20000)
+
+/* Diversifier of the first bond, the others count up from it */
+#define BB_DIV                              (0x2000)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Cost of looking up one address */
+typedef struct
+{
+    /* AES blocks encrypted by one lookup */
+    uint32                          aes_blocks;
+
+    /* Host time of one lookup in ns */
+    double                          host_ns;
+
+} BB_COST_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* IRKs and addresses of the bonds and of the central which is not bonded,
+ * the last entry
+ */
+static uint16 g_bb_irks[MAX_BONDED_DEVICES + 1][MAX_WORDS_IRK];
+static TYPED_BD_ADDR_T g_bb_addrs[MAX_BONDED_DEVICES + 1];
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static double bbNow(void);
+static void bbMakeCentral(uint16 central);
+static bool bbLookup(uint16 central, uint16 expected, uint32 lookups,
+                     BB_COST_T *p_cost);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      bbNow
+ *
+ *  DESCRIPTION
+ *      This function reads the monotonic clock of the host.
+ *
+ *  RETURNS
+ *      The time in ns.
+ *
+ *---------------------------------------------------------------------------*/
+
+static double bbNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      bbMakeCentral
+ *
+ *  DESCRIPTION
+ *      This function makes up the IRK of a central and the resolvable random
+ *      address it connects from.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void bbMakeCentral(uint16 central)
+{
+    uint16 index;
+
+    for(index = 0; index < MAX_WORDS_IRK; index++)
+    {
+        g_bb_irks[central][index] = (uint16)(0x3c5a * (central + 1) +
+                                             0x0707 * index);
+    }
+
+    EmuResolvableAddress(g_bb_irks[central], 0x2468ac + central,
+                         &g_bb_addrs[central]);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      bbLookup
+ *
+ *  DESCRIPTION
+ *      This function looks up the address of a central 'lookups' times.
+ *
+ *  RETURNS
+ *      FALSE if BondTableFind() didn't return the bond expected.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool bbLookup(uint16 central, uint16 expected, uint32 lookups,
+                     BB_COST_T *p_cost)
+{
+    uint32 aes = EmuAesCount();
+    uint16 found = BondTableFind(&g_bb_addrs[central]);
+    volatile uint16 sink;
+    double start;
+    uint32 run;
+
+    p_cost->aes_blocks = EmuAesCount() - aes;
+
+    start = bbNow();
+    for(run = 0; run < lookups; run++)
+    {
+        sink = BondTableFind(&g_bb_addrs[central]);
+    }
+    p_cost->host_ns = (bbNow() - start) / lookups;
+    (void)sink;
+
+    return found == expected;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    EMU_CONFIG_T config;
+    uint32 lookups = BB_LOOKUPS;
+    double aes_us = 0;
+    BB_COST_T cost;
+    BB_COST_T worst_bonded;
+    BB_COST_T stranger;
+    bool ok = TRUE;
+    uint16 bonds;
+    uint16 central;
+    int arg;
+
+    for(arg = 1; arg < argc; arg++)
+    {
+        if(strcmp(argv[arg], "-lookups") == 0 && arg + 1 < argc)
+        {
+            lookups = (uint32)atoi(argv[++arg]);
+        }
+        else if(strcmp(argv[arg], "-aes-us") == 0 && arg + 1 < argc)
+        {
+            aes_us = atof(argv[++arg]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: bond_bench [-lookups <n>] "
+                            "[-aes-us <us>]\n");
+            return 1;
+        }
+    }
+
+    if(lookups == 0)
+    {
+        lookups = 1;
+    }
+
+    /* Boot with nobody in range, so that the bond table is only filled by
+     * the bench
+     */
+    EmuDefaultConfig(&config);
+    config.peer.present = FALSE;
+    EmuBoot(&config);
+
+    for(central = 0; central <= MAX_BONDED_DEVICES; central++)
+    {
+        bbMakeCentral(central);
+    }
+
+    printf("bonds  aes/lookup (bonded max, stranger)  host ns/lookup "
+           "(bonded max, stranger)%s\n",
+           aes_us > 0 ? "  chip us (bonded max, stranger)" : "");
+
+    BondTableRemoveAll();
+
+    for(bonds = 1; bonds <= MAX_BONDED_DEVICES; bonds++)
+    {
+        /* Bond one more central, as the pairing does */
+        BondTableSetActive(BOND_TABLE_INVALID);
+        BondTableAdd(&g_bb_addrs[bonds - 1], BB_DIV + bonds,
+                     g_bb_irks[bonds - 1]);
+        BondTableSetActive(BOND_TABLE_INVALID);
+
+        memset(&worst_bonded, 0, sizeof(worst_bonded));
+        for(central = 0; central < bonds; central++)
+        {
+            if(!bbLookup(central, central, lookups, &cost))
+            {
+                fprintf(stderr, "bond_bench: bonded central %u not found "
+                                "among %u bonds\n", central, bonds);
+                ok = FALSE;
+            }
+
+            if(cost.aes_blocks > worst_bonded.aes_blocks)
+            {
+                worst_bonded.aes_blocks = cost.aes_blocks;
+            }
+            if(cost.host_ns > worst_bonded.host_ns)
+            {
+                worst_bonded.host_ns = cost.host_ns;
+            }
+        }
+
+        if(!bbLookup(MAX_BONDED_DEVICES, BOND_TABLE_INVALID, lookups,
+                     &stranger))
+        {
+            fprintf(stderr, "bond_bench: a central which is not bonded was "
+                            "found among %u bonds\n", bonds);
+            ok = FALSE;
+        }
+
+        printf("%5u  %10u %9u %25.0f %9.0f", bonds, worst_bonded.aes_blocks,
+               stranger.aes_blocks, worst_bonded.host_ns, stranger.host_ns);
+        if(aes_us > 0)
+        {
+            printf("  %17.0f %9.0f", worst_bonded.aes_blocks * aes_us,
+                   stranger.aes_blocks * aes_us);
+        }
+        printf("\n");
+    }
+
+    return ok ? 0 : 1;
+}
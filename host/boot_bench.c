@@ -0,0 +1,224 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      boot_bench.c
+ *
+ *  DESCRIPTION
+ *      Works out the time the I2C EEPROM keeps the boot busy from power-on
+ *      to GattAddDatabaseReq(), on a blank store and on the store left by a
+ *      boot which bonded with the peer, and checks that the second boot
+ *      reads the store with a single transfer. The time is that of the
+ *      EEPROM timing model of host/emu/emu_nvm.c, the CPU time is not
+ *      counted. See host/README.txt.
+ *
+ *      Usage: boot_bench
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  System Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "emu.h"
+#include "health_thermometer.h"
+#include "bond_table.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* The peer has paired by then */
+#define BB_BONDED_TIME                      (1500 * MILLISECOND)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Cost of a boot, left by its process for the parent */
+typedef struct
+{
+    /* The boot completed */
+    bool                            done;
+
+    /* Transfers with the EEPROM up to GattAddDatabaseReq() and the time
+     * they took in us
+     */
+    uint32                          transfers;
+    double                          busy_us;
+
+} BB_BOOT_T;
+
+/* Results shared with the boots */
+typedef struct
+{
+    /* Blank store, then the store holding a bond */
+    BB_BOOT_T                       boots[2];
+
+    /* The store left by the first boot once bonded */
+    uint16                          store[EMU_NVM_WORDS];
+
+} BB_SHARED_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static BB_SHARED_T *g_bb_shared;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void bbBoot(uint16 run);
+static bool bbFork(uint16 run);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      bbBoot
+ *
+ *  DESCRIPTION
+ *      This function boots the application, on a blank store for run 0 and
+ *      on the store it then left for run 1. GattAddDatabaseReq() is the last
+ *      call of AppInit(), so the cost of the boot up to it is known once
+ *      EmuBoot() returns. Run 0 then bonds with the peer and keeps the store.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void bbBoot(uint16 run)
+{
+    EMU_CONFIG_T config;
+    BB_BOOT_T *p_boot = &g_bb_shared->boots[run];
+
+    EmuDefaultConfig(&config);
+    if(run != 0)
+    {
+        config.peer.present = FALSE;
+        config.nvm_image = g_bb_shared->store;
+        config.nvm_image_words = EMU_NVM_WORDS;
+    }
+
+    EmuBoot(&config);
+    p_boot->transfers = EmuNvmTransfers();
+    p_boot->busy_us = EmuNvmBusyTime();
+
+    if(run == 0)
+    {
+        EmuRunUntil(BB_BONDED_TIME);
+        if(BondTableCount() != 1)
+        {
+            fprintf(stderr, "boot_bench: the peer did not bond\n");
+            return;
+        }
+        EmuNvmSave(g_bb_shared->store, EMU_NVM_WORDS);
+    }
+
+    p_boot->done = TRUE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      bbFork
+ *
+ *  DESCRIPTION
+ *      This function runs a boot in a process of its own, as the application
+ *      statics can't be reset.
+ *
+ *  RETURNS
+ *      TRUE if the boot completed.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool bbFork(uint16 run)
+{
+    pid_t pid;
+    int status;
+
+    fflush(NULL);
+    pid = fork();
+
+    if(pid == 0)
+    {
+        bbBoot(run);
+        fflush(NULL);
+        _exit(0);
+    }
+
+    return (pid > 0 && waitpid(pid, &status, 0) == pid &&
+            WIFEXITED(status) && g_bb_shared->boots[run].done);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    static const char *const names[2] = { "blank store", "bonded store" };
+    uint16 run;
+
+    if(argc > 1)
+    {
+        fprintf(stderr, "usage: boot_bench\n");
+        return 1;
+    }
+
+#ifdef NVM_TYPE_FLASH
+    printf("boot_bench: skipped, the timing model is that of the I2C "
+           "EEPROM\n");
+    return 0;
+#endif /* NVM_TYPE_FLASH */
+
+    g_bb_shared = mmap(NULL, sizeof(BB_SHARED_T), PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(g_bb_shared == MAP_FAILED)
+    {
+        perror("boot_bench: mmap");
+        return 1;
+    }
+
+    printf("store         transfers  EEPROM ms to GattAddDatabaseReq\n");
+
+    for(run = 0; run < 2; run++)
+    {
+        if(!bbFork(run))
+        {
+            fprintf(stderr, "boot_bench: the boot on the %s failed\n",
+                    names[run]);
+            return 1;
+        }
+
+        printf("%-12s  %9u  %31.2f\n", names[run],
+               g_bb_shared->boots[run].transfers,
+               g_bb_shared->boots[run].busy_us / 1000.0);
+    }
+
+    if(g_bb_shared->boots[1].transfers != 1)
+    {
+        fprintf(stderr, "boot_bench: the boot on the bonded store took %u "
+                        "transfers, expected 1\n",
+                g_bb_shared->boots[1].transfers);
+        return 1;
+    }
+
+    return 0;
+}
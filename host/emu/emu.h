@@ -0,0 +1,289 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      emu.h
+ *
+ *  DESCRIPTION
+ *      Interface of the host emulation of the uEnergy firmware: a virtual
+ *      microsecond clock, the event queue which delivers timers, system
+ *      events and LM events to the application one at a time, and the
+ *      injectors the harnesses use to drive the PIOs and the peer device.
+ *
+ *****************************************************************************/
+
+#ifndef __EMU_H__
+#define __EMU_H__
+
+/*============================================================================*
+ *  System Header Files
+ *============================================================================*/
+
+#include <stdint.h>
+#include <setjmp.h>
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <main.h>
+#include <timer.h>
+#include <bluetooth.h>
+#include <bt_event_types.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* The emulator and the harnesses see the libc <time.h>, so they take the
+ * SDK time units from here
+ */
+#ifndef MILLISECOND
+#define MILLISECOND                         (1000UL)
+#define SECOND                              (1000UL * MILLISECOND)
+#define MINUTE                              (60UL * SECOND)
+extern uint32 TimeGet32(void);
+#endif /* MILLISECOND */
+
+/* Connection identifier of the emulated link */
+#define EMU_CID                             (0x0040)
+
+/* Octets of a notification kept in its record */
+#define EMU_NOTIFICATION_MAX                (20)
+
+/* Words in the NVM store */
+#define EMU_NVM_WORDS                       (0x1000)
+
+/* Catch a Panic() of the application. Evaluates to TRUE when the code after
+ * it is re-entered through the panic, with the code in g_emu_panic_code.
+ */
+#define EMU_CATCH_PANIC() \
+    (g_emu_panic_armed = TRUE, setjmp(g_emu_panic_jmp) != 0)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Virtual time in microseconds since the emulated power-on */
+typedef uint64_t emu_time;
+
+/* Action run from the event queue at its due time */
+typedef void (*emu_action)(uint32 arg);
+
+/* How the central answers a connection parameter update request */
+typedef enum
+{
+    emu_policy_accept,                  /* Use the longest interval asked */
+    emu_policy_reject                   /* Refuse every request */
+
+} emu_param_policy;
+
+/* The peer device: a central which connects whenever it can */
+typedef struct
+{
+    /* Connects when the device advertises */
+    bool                            present;
+
+    /* Delay from the start of advertising to the connection */
+    emu_time                        connect_delay;
+
+    /* Connection parameters the central starts the link with, in units of
+     * 1.25 ms, connection events and 10 ms
+     */
+    uint16                          conn_interval;
+    uint16                          conn_latency;
+    uint16                          supervision_timeout;
+
+    /* Answer to the parameter update requests */
+    emu_param_policy                policy;
+
+    /* Notifications the link carries in one connection event */
+    uint16                          notifications_per_event;
+
+    /* Write the Temperature Measurement CCCD once the link is encrypted */
+    bool                            subscribe;
+
+    /* RSSI the link reports */
+    int8                            rssi;
+
+    /* The peer holds a bond with the device */
+    bool                            bonded;
+
+    /* Connects from a resolvable random address, new at each connection,
+     * and hands its IRK out when pairing. Otherwise its address is public.
+     */
+    bool                            resolvable;
+
+} EMU_PEER_T;
+
+/* Emulator configuration */
+typedef struct
+{
+    /* SPI flash semantics for the NVM store, I2C EEPROM otherwise */
+    bool                            nvm_flash;
+
+    /* Words the NVM store holds at power-on, from offset 0, the rest being
+     * erased. NULL for a blank store.
+     */
+    const uint16                   *nvm_image;
+    uint16                          nvm_image_words;
+
+    /* Print every event delivered to the application */
+    bool                            verbose;
+
+    /* Battery voltage in mV */
+    uint16                          battery_mv;
+
+    EMU_PEER_T                      peer;
+
+} EMU_CONFIG_T;
+
+/* A notification sent by the application */
+typedef struct
+{
+    uint16                          handle;
+    uint16                          size;
+    uint8                           value[EMU_NOTIFICATION_MAX];
+
+    /* GattCharValueNotification() call and over the air times */
+    emu_time                        call_time;
+    emu_time                        air_time;
+
+    /* Dropped with the link before it went over the air */
+    bool                            dropped;
+
+} EMU_NOTIFICATION_T;
+
+/* Called for every notification once it is sent or dropped */
+typedef void (*emu_notification_hook)(const EMU_NOTIFICATION_T *p_not);
+
+/*============================================================================*
+ *  Public Data
+ *============================================================================*/
+
+extern jmp_buf g_emu_panic_jmp;
+extern bool g_emu_panic_armed;
+extern uint16 g_emu_panic_code;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Fill in the default configuration */
+extern void EmuDefaultConfig(EMU_CONFIG_T *p_config);
+
+/* Set up the emulator and call AppPowerOnReset() and AppInit() */
+extern void EmuBoot(const EMU_CONFIG_T *p_config);
+
+/* Current virtual time */
+extern emu_time EmuNow(void);
+
+/* Deliver everything due up to 'time' and move the clock there */
+extern void EmuRunUntil(emu_time time);
+
+/* Deliver everything due within 'duration' from now */
+extern void EmuRunFor(emu_time duration);
+
+/* Run 'action' at 'time' from the event queue */
+extern void EmuAt(emu_time time, emu_action action, uint32 arg);
+
+/* Queue an LM event for the application 'delay' from now. A write access
+ * carries its value in 'value', a key indication its keys in 'p_keys'.
+ */
+extern void EmuPostLmEvent(emu_time delay, lm_event_code code,
+                           const LM_EVENT_T *p_event, const uint8 *value,
+                           const SM_KEYSET_T *p_keys);
+
+/* Queue a system event for the application now */
+extern void EmuPostSysEvent(sys_event_id id, const void *data,
+                            uint16 data_size);
+
+/* The application asked for the dormant state, nothing runs any more */
+extern bool EmuIsDormant(void);
+
+/* Times the application has been woken so far */
+extern uint32 EmuWakeCount(void);
+
+/* Print a line prefixed with the virtual time when verbose */
+extern void EmuLog(const char *format, ...)
+    __attribute__((format(printf, 1, 2)));
+
+/* Drive a PIO input, delivering sys_event_pio_changed if its edge is
+ * enabled
+ */
+extern void EmuPioSet(uint16 pio, bool level);
+
+/* Current level of the PIOs */
+extern uint32 EmuPioGet(void);
+
+/* The application takes PIO changed events from a PIO */
+extern bool EmuPioEventsEnabled(uint16 pio);
+
+/* Buzzer PWM is enabled */
+extern bool EmuPwmEnabled(void);
+
+/* Peer device state and injectors */
+extern EMU_PEER_T *EmuPeer(void);
+extern bool EmuIsConnected(void);
+extern bool EmuIsAdvertising(void);
+extern void EmuPeerSetPresent(bool present);
+extern void EmuPeerDisconnect(uint16 reason);
+extern void EmuLinkLoss(void);
+extern void EmuPeerUpdateParams(uint16 interval, uint16 latency,
+                                uint16 timeout);
+extern void EmuSetNotificationHook(emu_notification_hook hook);
+
+/* A different central, which is not bonded, takes the place of the peer */
+extern void EmuPeerReplace(bool resolvable);
+
+/* Make the resolvable random address of an IRK (8 words, least significant
+ * octet first) and a 22 bit random part
+ */
+extern void EmuResolvableAddress(const uint16 *irk, uint32 prand,
+                                 TYPED_BD_ADDR_T *p_addr);
+
+/* Random address hash function ah() of an IRK, and the number of AES blocks
+ * encrypted so far, by ah() or SMPrivacyMatchAddress()
+ */
+extern uint32 EmuAesHash(const uint16 *irk, uint32 prand);
+extern uint32 EmuAesCount(void);
+
+/* Cut the power to the NVM store once 'words' more words have been written,
+ * an erase counting as one: from then on writes and erases succeed without
+ * changing anything, as if the chip had been reset at that point. With
+ * 'torn', the word being written when the power goes is left corrupt: random
+ * on EEPROM, on flash the value written with random bits still erased. Power
+ * comes back with EmuNvmPowerOn().
+ */
+extern void EmuNvmPowerCut(uint32 words, bool torn);
+extern bool EmuNvmPowerIsCut(void);
+extern void EmuNvmPowerOn(void);
+
+/* Number of NvmErase() and NvmEraseBlock() calls since EmuNvmInit() */
+extern uint32 EmuNvmEraseCount(void);
+
+/* Transfers with the I2C EEPROM since EmuNvmInit() and the time in us they
+ * kept the bus busy, 0 on SPI flash
+ */
+extern uint32 EmuNvmTransfers(void);
+extern double EmuNvmBusyTime(void);
+
+/* Copy words into or out of the NVM store, from offset 0 */
+extern void EmuNvmLoad(const uint16 *words, uint16 length);
+extern void EmuNvmSave(uint16 *words, uint16 length);
+
+/* Current connection interval in microseconds and slave latency */
+extern uint32 EmuConnIntervalUs(void);
+extern uint16 EmuConnLatency(void);
+
+/* Internal to the emulator */
+extern void EmuLinkInit(const EMU_PEER_T *p_peer);
+extern void EmuNvmInit(bool flash);
+extern void EmuPioInit(void);
+extern void EmuMiscInit(uint16 battery_mv);
+extern void EmuSetDormant(void);
+
+#endif /* __EMU_H__ */
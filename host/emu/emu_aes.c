@@ -0,0 +1,250 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      emu_aes.c
+ *
+ *  DESCRIPTION
+ *      AES-128 encryption and the random address hash function ah() of the
+ *      Bluetooth Core Specification (Vol 3, Part H, 2.2.2), which the link
+ *      emulation uses to make and resolve resolvable random addresses.
+ *
+ *      An IRK is held in 8 words, least significant octet first as the SDK
+ *      hands them out, the low octet of each word first.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  System Header Files
+ *============================================================================*/
+
+#include <string.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "emu.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Octets of an AES-128 block and key, and its number of rounds */
+#define EMU_AES_BLOCK                       (16)
+#define EMU_AES_ROUNDS                      (10)
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static const uint8_t g_emu_aes_sbox[256] =
+{
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
+    0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+    0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
+    0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
+    0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+    0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
+    0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
+    0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+    0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
+    0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
+    0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+    0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
+    0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
+    0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+    0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
+    0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
+    0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+/* Number of AES blocks encrypted so far */
+static uint32 g_emu_aes_count;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static uint8_t emuAesXtime(uint8_t x);
+static void emuAesEncrypt(const uint8_t key[EMU_AES_BLOCK],
+                          const uint8_t in[EMU_AES_BLOCK],
+                          uint8_t out[EMU_AES_BLOCK]);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuAesXtime
+ *
+ *  DESCRIPTION
+ *      This function multiplies by x in GF(2^8).
+ *
+ *  RETURNS
+ *      The product.
+ *
+ *---------------------------------------------------------------------------*/
+
+static uint8_t emuAesXtime(uint8_t x)
+{
+    return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1b : 0x00));
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuAesEncrypt
+ *
+ *  DESCRIPTION
+ *      This function encrypts one block with AES-128 (FIPS-197), the round
+ *      keys being expanded as it goes. Blocks and keys are most significant
+ *      octet first.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void emuAesEncrypt(const uint8_t key[EMU_AES_BLOCK],
+                          const uint8_t in[EMU_AES_BLOCK],
+                          uint8_t out[EMU_AES_BLOCK])
+{
+    uint8_t state[EMU_AES_BLOCK];
+    uint8_t round_key[EMU_AES_BLOCK];
+    uint8_t temp[EMU_AES_BLOCK];
+    uint8_t rcon = 0x01;
+    uint16 round;
+    uint16 index;
+
+    memcpy(round_key, key, EMU_AES_BLOCK);
+    for(index = 0; index < EMU_AES_BLOCK; index++)
+    {
+        state[index] = in[index] ^ round_key[index];
+    }
+
+    for(round = 1; round <= EMU_AES_ROUNDS; round++)
+    {
+        /* SubBytes and ShiftRows, the state being held column by column */
+        for(index = 0; index < EMU_AES_BLOCK; index++)
+        {
+            temp[index] = g_emu_aes_sbox[state[(index + 4 * (index % 4)) %
+                                               EMU_AES_BLOCK]];
+        }
+
+        /* MixColumns, except in the last round */
+        for(index = 0; index < EMU_AES_BLOCK; index += 4)
+        {
+            uint8_t a0 = temp[index], a1 = temp[index + 1];
+            uint8_t a2 = temp[index + 2], a3 = temp[index + 3];
+            uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+
+            if(round == EMU_AES_ROUNDS)
+            {
+                memcpy(&state[index], &temp[index], 4);
+                continue;
+            }
+
+            state[index]     = a0 ^ all ^ emuAesXtime(a0 ^ a1);
+            state[index + 1] = a1 ^ all ^ emuAesXtime(a1 ^ a2);
+            state[index + 2] = a2 ^ all ^ emuAesXtime(a2 ^ a3);
+            state[index + 3] = a3 ^ all ^ emuAesXtime(a3 ^ a0);
+        }
+
+        /* Next round key */
+        round_key[0] ^= g_emu_aes_sbox[round_key[13]] ^ rcon;
+        round_key[1] ^= g_emu_aes_sbox[round_key[14]];
+        round_key[2] ^= g_emu_aes_sbox[round_key[15]];
+        round_key[3] ^= g_emu_aes_sbox[round_key[12]];
+        for(index = 4; index < EMU_AES_BLOCK; index++)
+        {
+            round_key[index] ^= round_key[index - 4];
+        }
+        rcon = emuAesXtime(rcon);
+
+        /* AddRoundKey */
+        for(index = 0; index < EMU_AES_BLOCK; index++)
+        {
+            state[index] ^= round_key[index];
+        }
+    }
+
+    memcpy(out, state, EMU_AES_BLOCK);
+    g_emu_aes_count++;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuAesHash
+ *
+ *  DESCRIPTION
+ *      This function works out the random address hash function
+ *      ah(irk, prand) = e(irk, padding || prand) mod 2^24.
+ *
+ *  RETURNS
+ *      The 24 bit hash.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint32 EmuAesHash(const uint16 *irk, uint32 prand)
+{
+    uint8_t key[EMU_AES_BLOCK];
+    uint8_t block[EMU_AES_BLOCK];
+    uint16 index;
+
+    /* The key is most significant octet first */
+    for(index = 0; index < EMU_AES_BLOCK; index++)
+    {
+        key[EMU_AES_BLOCK - 1 - index] =
+                        (uint8_t)(irk[index / 2] >> (8 * (index % 2)));
+    }
+
+    memset(block, 0, sizeof(block));
+    block[13] = (uint8_t)(prand >> 16);
+    block[14] = (uint8_t)(prand >> 8);
+    block[15] = (uint8_t)prand;
+
+    emuAesEncrypt(key, block, block);
+
+    return ((uint32)block[13] << 16) | ((uint32)block[14] << 8) | block[15];
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuAesCount
+ *
+ *  DESCRIPTION
+ *      This function returns the number of blocks encrypted so far.
+ *
+ *  RETURNS
+ *      See above.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint32 EmuAesCount(void)
+{
+    return g_emu_aes_count;
+}
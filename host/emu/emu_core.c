@@ -0,0 +1,726 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      emu_core.c
+ *
+ *  DESCRIPTION
+ *      The virtual clock, the event queue and the timers of the host
+ *      emulation. Everything the firmware would hand to the application -
+ *      timer expiries, system events, LM events - goes through one queue
+ *      ordered by due time and then by posting order, and is delivered from
+ *      EmuRunUntil() only, never from within an SDK call, as on the chip.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  System Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <setjmp.h>
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <timer.h>
+#include <panic.h>
+#include <main.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "emu.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Entries the event queue holds */
+#define EMU_QUEUE_SIZE                      (256)
+
+/* Octets of a write access value kept in the queue */
+#define EMU_VALUE_MAX                       (32)
+
+/* Octets of system event data kept in the queue */
+#define EMU_SYS_DATA_MAX                    (16)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef enum
+{
+    emu_entry_timer,
+    emu_entry_lm_event,
+    emu_entry_sys_event,
+    emu_entry_action
+
+} emu_entry_kind;
+
+typedef struct
+{
+    emu_time                        time;
+    uint64_t                        seq;
+    emu_entry_kind                  kind;
+
+    /* emu_entry_timer */
+    timer_id                        tid;
+    timer_callback_arg              handler;
+
+    /* emu_entry_lm_event */
+    lm_event_code                   code;
+    LM_EVENT_T                      event;
+    uint8                           value[EMU_VALUE_MAX];
+    SM_KEYSET_T                     keys;
+
+    /* emu_entry_sys_event */
+    sys_event_id                    sys_id;
+    uint16                          sys_data[EMU_SYS_DATA_MAX / 2];
+
+    /* emu_entry_action */
+    emu_action                      action;
+    uint32                          arg;
+
+} EMU_ENTRY_T;
+
+typedef struct
+{
+    emu_time                        now;
+    uint64_t                        seq;
+
+    EMU_ENTRY_T                     queue[EMU_QUEUE_SIZE];
+    uint16                          queued;
+
+    /* Timers given to TimerInit() and running */
+    uint16                          max_timers;
+    uint16                          running_timers;
+    timer_id                        next_tid;
+
+    bool                            dormant;
+    bool                            verbose;
+
+    /* Times the application was woken, and the time of the last wake-up */
+    uint32                          wakes;
+    emu_time                        last_wake;
+
+} EMU_CORE_T;
+
+/*============================================================================*
+ *  Public Data
+ *============================================================================*/
+
+jmp_buf g_emu_panic_jmp;
+bool g_emu_panic_armed;
+uint16 g_emu_panic_code;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static EMU_CORE_T g_emu;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static EMU_ENTRY_T *emuQueueAdd(emu_time time, emu_entry_kind kind);
+static int emuQueueEarliest(void);
+static void emuDeliver(EMU_ENTRY_T *p_entry);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuQueueAdd
+ *
+ *  DESCRIPTION
+ *      This function adds an entry due at 'time' to the event queue. A full
+ *      queue means the emulated system is flooded, which the firmware would
+ *      not survive either, so it stops the run.
+ *
+ *  RETURNS
+ *      The new entry.
+ *
+ *---------------------------------------------------------------------------*/
+
+static EMU_ENTRY_T *emuQueueAdd(emu_time time, emu_entry_kind kind)
+{
+    EMU_ENTRY_T *p_entry;
+
+    if(g_emu.queued == EMU_QUEUE_SIZE)
+    {
+        fprintf(stderr, "emu: event queue overflow at %llu us\n",
+                (unsigned long long)g_emu.now);
+        exit(3);
+    }
+
+    p_entry = &g_emu.queue[g_emu.queued++];
+    memset(p_entry, 0, sizeof(*p_entry));
+    p_entry->time = time;
+    p_entry->seq = g_emu.seq++;
+    p_entry->kind = kind;
+
+    return p_entry;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuQueueEarliest
+ *
+ *  DESCRIPTION
+ *      This function finds the entry which is due first, the earliest posted
+ *      of those due at the same time.
+ *
+ *  RETURNS
+ *      Its index, or -1 if the queue is empty.
+ *
+ *---------------------------------------------------------------------------*/
+
+static int emuQueueEarliest(void)
+{
+    int best = -1;
+    uint16 index;
+
+    for(index = 0; index < g_emu.queued; index++)
+    {
+        const EMU_ENTRY_T *p_entry = &g_emu.queue[index];
+
+        if(best < 0 ||
+           p_entry->time < g_emu.queue[best].time ||
+           (p_entry->time == g_emu.queue[best].time &&
+            p_entry->seq < g_emu.queue[best].seq))
+        {
+            best = index;
+        }
+    }
+
+    return best;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuDeliver
+ *
+ *  DESCRIPTION
+ *      This function hands one queue entry to the application.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void emuDeliver(EMU_ENTRY_T *p_entry)
+{
+    /* Everything the application is given at once runs in one wake-up */
+    if(p_entry->kind != emu_entry_action &&
+       (g_emu.wakes == 0 || p_entry->time > g_emu.last_wake))
+    {
+        g_emu.wakes++;
+        g_emu.last_wake = p_entry->time;
+    }
+
+    switch(p_entry->kind)
+    {
+        case emu_entry_timer:
+            /* The timer is free again before its handler runs */
+            g_emu.running_timers--;
+            p_entry->handler(p_entry->tid);
+        break;
+
+        case emu_entry_lm_event:
+            if(p_entry->code == GATT_ACCESS_IND)
+            {
+                p_entry->event.access_ind.value = p_entry->value;
+            }
+            else if(p_entry->code == SM_KEYS_IND)
+            {
+                p_entry->event.keys_ind.keys = &p_entry->keys;
+            }
+            EmuLog("lm event 0x%04x", p_entry->code);
+            AppProcessLmEvent(p_entry->code, &p_entry->event);
+        break;
+
+        case emu_entry_sys_event:
+            EmuLog("sys event %d", p_entry->sys_id);
+            AppProcessSystemEvent(p_entry->sys_id, p_entry->sys_data);
+        break;
+
+        case emu_entry_action:
+            p_entry->action(p_entry->arg);
+        break;
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuDefaultConfig
+ *
+ *  DESCRIPTION
+ *      This function fills in the default configuration: the NVM type the
+ *      application is built for, a 3 V battery and a present, unbonded peer
+ *      which connects 50 ms into advertising at a 30 ms interval without
+ *      slave latency.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuDefaultConfig(EMU_CONFIG_T *p_config)
+{
+    memset(p_config, 0, sizeof(*p_config));
+
+#ifdef NVM_TYPE_FLASH
+    p_config->nvm_flash = TRUE;
+#endif /* NVM_TYPE_FLASH */
+    p_config->battery_mv = 3000;
+
+    p_config->peer.present = TRUE;
+    p_config->peer.connect_delay = 50 * MILLISECOND;
+    p_config->peer.conn_interval = 24;
+    p_config->peer.conn_latency = 0;
+    p_config->peer.supervision_timeout = 200;
+    p_config->peer.policy = emu_policy_accept;
+    p_config->peer.notifications_per_event = 4;
+    p_config->peer.subscribe = TRUE;
+    p_config->peer.rssi = -60;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuBoot
+ *
+ *  DESCRIPTION
+ *      This function sets up the emulated chip and runs the power-on entry
+ *      points of the application. The application statics can't be reset,
+ *      so each harness run boots once, in a process of its own.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuBoot(const EMU_CONFIG_T *p_config)
+{
+    memset(&g_emu, 0, sizeof(g_emu));
+    g_emu.verbose = p_config->verbose;
+
+    EmuNvmInit(p_config->nvm_flash);
+    if(p_config->nvm_image != NULL)
+    {
+        EmuNvmLoad(p_config->nvm_image, p_config->nvm_image_words);
+    }
+    EmuPioInit();
+    EmuMiscInit(p_config->battery_mv);
+    EmuLinkInit(&p_config->peer);
+
+    AppPowerOnReset();
+    AppInit(sleep_state_cold_powerup);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuNow
+ *
+ *  DESCRIPTION
+ *      This function returns the virtual time.
+ *
+ *  RETURNS
+ *      Microseconds since power-on.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern emu_time EmuNow(void)
+{
+    return g_emu.now;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuRunUntil
+ *
+ *  DESCRIPTION
+ *      This function delivers every queue entry due up to 'time', moving the
+ *      clock to each entry's due time, and leaves the clock at 'time'.
+ *      Nothing is delivered once the application has gone dormant.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuRunUntil(emu_time time)
+{
+    while(!g_emu.dormant)
+    {
+        EMU_ENTRY_T entry;
+        int index = emuQueueEarliest();
+
+        if(index < 0 || g_emu.queue[index].time > time)
+        {
+            break;
+        }
+
+        /* Take the entry off the queue before delivering it, the delivery
+         * may add entries
+         */
+        entry = g_emu.queue[index];
+        g_emu.queue[index] = g_emu.queue[--g_emu.queued];
+
+        if(entry.time > g_emu.now)
+        {
+            g_emu.now = entry.time;
+        }
+
+        emuDeliver(&entry);
+    }
+
+    if(time > g_emu.now)
+    {
+        g_emu.now = time;
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuRunFor
+ *
+ *  DESCRIPTION
+ *      This function runs the emulation for 'duration'.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuRunFor(emu_time duration)
+{
+    EmuRunUntil(g_emu.now + duration);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuAt
+ *
+ *  DESCRIPTION
+ *      This function queues 'action' to run at 'time', or straight away if
+ *      'time' has passed.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuAt(emu_time time, emu_action action, uint32 arg)
+{
+    EMU_ENTRY_T *p_entry = emuQueueAdd(time > g_emu.now ? time : g_emu.now,
+                                       emu_entry_action);
+
+    p_entry->action = action;
+    p_entry->arg = arg;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuPostLmEvent
+ *
+ *  DESCRIPTION
+ *      This function queues an LM event for the application.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuPostLmEvent(emu_time delay, lm_event_code code,
+                           const LM_EVENT_T *p_event, const uint8 *value,
+                           const SM_KEYSET_T *p_keys)
+{
+    EMU_ENTRY_T *p_entry = emuQueueAdd(g_emu.now + delay, emu_entry_lm_event);
+
+    p_entry->code = code;
+    if(p_event != NULL)
+    {
+        p_entry->event = *p_event;
+    }
+
+    if(value != NULL && code == GATT_ACCESS_IND)
+    {
+        if(p_entry->event.access_ind.size_value > EMU_VALUE_MAX)
+        {
+            p_entry->event.access_ind.size_value = EMU_VALUE_MAX;
+        }
+        memcpy(p_entry->value, value,
+               p_entry->event.access_ind.size_value * sizeof(uint8));
+    }
+
+    if(p_keys != NULL)
+    {
+        p_entry->keys = *p_keys;
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuPostSysEvent
+ *
+ *  DESCRIPTION
+ *      This function queues a system event for the application.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuPostSysEvent(sys_event_id id, const void *data,
+                            uint16 data_size)
+{
+    EMU_ENTRY_T *p_entry = emuQueueAdd(g_emu.now, emu_entry_sys_event);
+
+    p_entry->sys_id = id;
+    if(data != NULL)
+    {
+        memcpy(p_entry->sys_data, data,
+               data_size < EMU_SYS_DATA_MAX ? data_size : EMU_SYS_DATA_MAX);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuIsDormant, EmuSetDormant
+ *
+ *  DESCRIPTION
+ *      These functions read and set the dormant state. The emulation does not
+ *      model waking up, which is a cold boot of the chip.
+ *
+ *  RETURNS
+ *      EmuIsDormant: TRUE once the application went dormant.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool EmuIsDormant(void)
+{
+    return g_emu.dormant;
+}
+
+extern void EmuSetDormant(void)
+{
+    EmuLog("dormant");
+    g_emu.dormant = TRUE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuWakeCount
+ *
+ *  DESCRIPTION
+ *      This function returns the number of times the application has been 
+ *      woken: timers, LM events and system events delivered at a later time 
+ *      than the ones before. The emulator's own actions don't count.
+ *
+ *  RETURNS
+ *      See above.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint32 EmuWakeCount(void)
+{
+    return g_emu.wakes;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuLog
+ *
+ *  DESCRIPTION
+ *      This function prints a line prefixed with the virtual time when the
+ *      emulator is verbose.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuLog(const char *format, ...)
+{
+    va_list args;
+
+    if(!g_emu.verbose)
+    {
+        return;
+    }
+
+    printf("%10llu.%03llu ms  ",
+           (unsigned long long)(g_emu.now / 1000),
+           (unsigned long long)(g_emu.now % 1000));
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+}
+
+/*============================================================================*
+ *  SDK Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TimeGet32
+ *
+ *  DESCRIPTION
+ *      This function returns the low 32 bits of the virtual clock, which
+ *      wrap every 71 minutes as the chip's clock does.
+ *
+ *  RETURNS
+ *      Microseconds.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint32 TimeGet32(void)
+{
+    return (uint32)g_emu.now;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TimerInit
+ *
+ *  DESCRIPTION
+ *      This function sets the number of timers the application may run at
+ *      once. The memory is the application's and is not used.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void TimerInit(uint16 num_timers, void *memory)
+{
+    g_emu.max_timers = num_timers;
+    g_emu.running_timers = 0;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TimerCreate
+ *
+ *  DESCRIPTION
+ *      This function starts a one-shot timer. Like the firmware it fails when
+ *      all the timers given to TimerInit() are running.
+ *
+ *  RETURNS
+ *      The timer identifier, or TIMER_INVALID.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern timer_id TimerCreate(uint32 time, bool wake, timer_callback_arg handler)
+{
+    EMU_ENTRY_T *p_entry;
+
+    if(g_emu.running_timers >= g_emu.max_timers)
+    {
+        EmuLog("timer pool exhausted");
+        return TIMER_INVALID;
+    }
+
+    p_entry = emuQueueAdd(g_emu.now + time, emu_entry_timer);
+    p_entry->handler = handler;
+    p_entry->tid = g_emu.next_tid++;
+    if(g_emu.next_tid == TIMER_INVALID)
+    {
+        g_emu.next_tid = 0;
+    }
+    g_emu.running_timers++;
+
+    return p_entry->tid;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TimerDelete
+ *
+ *  DESCRIPTION
+ *      This function stops a running timer.
+ *
+ *  RETURNS
+ *      TRUE if the timer was running.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool TimerDelete(timer_id id)
+{
+    uint16 index;
+
+    for(index = 0; index < g_emu.queued; index++)
+    {
+        if(g_emu.queue[index].kind == emu_entry_timer &&
+           g_emu.queue[index].tid == id)
+        {
+            g_emu.queue[index] = g_emu.queue[--g_emu.queued];
+            g_emu.running_timers--;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Panic
+ *
+ *  DESCRIPTION
+ *      This function returns to the harness which armed EMU_CATCH_PANIC(),
+ *      or ends the process with the panic code.
+ *
+ *  RETURNS
+ *      Does not return.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void Panic(uint16 panic_code)
+{
+    g_emu_panic_code = panic_code;
+    EmuLog("panic %u", panic_code);
+
+    if(g_emu_panic_armed)
+    {
+        g_emu_panic_armed = FALSE;
+        longjmp(g_emu_panic_jmp, 1);
+    }
+
+    fprintf(stderr, "emu: panic %u at %llu us\n", panic_code,
+            (unsigned long long)g_emu.now);
+    exit(2);
+}
@@ -0,0 +1,1088 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      emu_link.c
+ *
+ *  DESCRIPTION
+ *      Link emulation of the host build: the Gatt*, Ls*, Gap* and SM* calls
+ *      of the application and the peer device at the other end of the link.
+ *
+ *      The peer is a central which connects while the device advertises,
+ *      only from the white list if the device advertises to it, pairs or
+ *      re-encrypts when asked for security (on its own when it uses a
+ *      resolvable random address, as the device doesn't ask then), writes
+ *      the Temperature Measurement CCCD and answers parameter update
+ *      requests. Everything it sends, and every notification the device
+ *      sends, goes at a connection event anchor. The device skips up to 'slave latency' events when it
+ *      has nothing to send, so the peer's packets wait for the next event it
+ *      listens at, while its own notifications go at the next anchor.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  System Header Files
+ *============================================================================*/
+
+#include <string.h>
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <status.h>
+#include <gatt.h>
+#include <gatt_prim.h>
+#include <ls_app_if.h>
+#include <gap_app_if.h>
+#include <security.h>
+#include <bt_event_types.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "emu.h"
+#include "app_gatt_db.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Notifications waiting for a connection event */
+#define EMU_TX_QUEUE_SIZE                   (16)
+
+/* Connection events between a parameter update and its instant */
+#define EMU_UPDATE_INSTANT_EVENTS           (6)
+
+/* Diversifier the device hands out when pairing */
+#define EMU_PEER_DIV                        (0x1234)
+
+/* Entries of the white list of the controller */
+#define EMU_WHITE_LIST_SIZE                 (8)
+
+/* Words of an IRK */
+#define EMU_IRK_WORDS                       (8)
+
+/* Connection parameter units in microseconds */
+#define EMU_INTERVAL_UNIT                   (1250)
+#define EMU_TIMEOUT_UNIT                    (10 * MILLISECOND)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Steps of the peer run at connection events */
+typedef enum
+{
+    emu_step_security,
+    emu_step_pairing_keys,
+    emu_step_pairing_encrypt,
+    emu_step_pairing_complete,
+    emu_step_encrypt,
+    emu_step_subscribe,
+    emu_step_update_cfm,
+    emu_step_update_instant,
+    emu_step_disconnect_local,
+    emu_step_disconnect_remote,
+    emu_step_link_timeout,
+    emu_step_tx
+
+} emu_step;
+
+typedef struct
+{
+    EMU_PEER_T                      peer;
+
+    /* Advertising, and the generation which invalidates pending connects */
+    bool                            advertising;
+    bool                            whitelist;
+    uint16                          adv_generation;
+
+    /* White list of the controller */
+    TYPED_BD_ADDR_T                 white_list[EMU_WHITE_LIST_SIZE];
+    uint16                          white_list_count;
+
+    /* Identity of the peer, counting the centrals which replaced it, with
+     * its IRK and the address it uses now
+     */
+    uint16                          identity;
+    uint16                          irk[EMU_IRK_WORDS];
+    TYPED_BD_ADDR_T                 addr;
+
+    /* Link state. Steps posted for an older link generation are dropped. */
+    bool                            connected;
+    bool                            lost;
+    uint16                          link_generation;
+    emu_time                        anchor;
+    uint32                          interval_us;
+    uint16                          latency;
+    uint16                          timeout;
+
+    /* Pending parameter update */
+    uint16                          new_interval;
+    uint16                          new_latency;
+    uint16                          new_timeout;
+
+    /* Disconnection reason of emu_step_disconnect_remote */
+    uint16                          remote_reason;
+
+    /* Notifications waiting for a connection event */
+    EMU_NOTIFICATION_T              tx[EMU_TX_QUEUE_SIZE];
+    uint16                          tx_count;
+    bool                            tx_scheduled;
+
+    emu_notification_hook           hook;
+
+    int8                            tx_power;
+
+} EMU_LINK_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static EMU_LINK_T g_emu_link;
+
+/* Public address of the first peer, the centrals replacing it count up the
+ * LAP
+ */
+static const TYPED_BD_ADDR_T g_emu_peer_addr =
+{
+    L2CA_PUBLIC_ADDR_TYPE, { 0x00a1b2, 0xc3, 0x00d4 }
+};
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void emuSetIdentity(void);
+static void emuSetAddress(void);
+static bool emuOnWhiteList(const TYPED_BD_ADDR_T *p_addr);
+static emu_time emuNextAnchor(bool device_has_data);
+static void emuPostStep(emu_step step, bool device_has_data);
+static void emuRunStep(uint32 arg);
+static void emuConnect(uint32 generation);
+static void emuLinkDown(uint16 reason);
+static void emuSendTx(void);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuSetIdentity
+ *
+ *  DESCRIPTION
+ *      This function makes up the IRK and the address of the peer from its
+ *      identity.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void emuSetIdentity(void)
+{
+    uint16 index;
+
+    for(index = 0; index < EMU_IRK_WORDS; index++)
+    {
+        g_emu_link.irk[index] = (uint16)((g_emu_link.identity + 1) * 0x1f3d +
+                                         index * 0x0101);
+    }
+
+    emuSetAddress();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuSetAddress
+ *
+ *  DESCRIPTION
+ *      This function sets the address the peer connects from: its public
+ *      address, or a new resolvable random address of its IRK.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void emuSetAddress(void)
+{
+    g_emu_link.addr = g_emu_peer_addr;
+    g_emu_link.addr.addr.lap += g_emu_link.identity;
+
+    if(g_emu_link.peer.resolvable)
+    {
+        EmuResolvableAddress(g_emu_link.irk,
+                             0x123456 ^ ((uint32)g_emu_link.identity << 8) ^
+                             g_emu_link.link_generation,
+                             &g_emu_link.addr);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuOnWhiteList
+ *
+ *  DESCRIPTION
+ *      This function looks up an address in the white list.
+ *
+ *  RETURNS
+ *      TRUE if the address is on the white list.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool emuOnWhiteList(const TYPED_BD_ADDR_T *p_addr)
+{
+    uint16 index;
+
+    for(index = 0; index < g_emu_link.white_list_count; index++)
+    {
+        if(g_emu_link.white_list[index].type == p_addr->type &&
+           g_emu_link.white_list[index].addr.lap == p_addr->addr.lap &&
+           g_emu_link.white_list[index].addr.uap == p_addr->addr.uap &&
+           g_emu_link.white_list[index].addr.nap == p_addr->addr.nap)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuNextAnchor
+ *
+ *  DESCRIPTION
+ *      This function finds the next connection event after now. Without data
+ *      to send the device only listens at every (latency + 1)th event.
+ *
+ *  RETURNS
+ *      The time of the event.
+ *
+ *---------------------------------------------------------------------------*/
+
+static emu_time emuNextAnchor(bool device_has_data)
+{
+    emu_time now = EmuNow();
+    uint64_t event = (now - g_emu_link.anchor) / g_emu_link.interval_us + 1;
+    uint64_t every = device_has_data ? 1 : (uint64_t)g_emu_link.latency + 1;
+
+    event = ((event + every - 1) / every) * every;
+
+    return g_emu_link.anchor + event * g_emu_link.interval_us;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuPostStep
+ *
+ *  DESCRIPTION
+ *      This function runs a step of the peer at the next connection event of
+ *      the current link.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void emuPostStep(emu_step step, bool device_has_data)
+{
+    EmuAt(emuNextAnchor(device_has_data), emuRunStep,
+          ((uint32)g_emu_link.link_generation << 16) | step);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuRunStep
+ *
+ *  DESCRIPTION
+ *      This function runs a step of the peer, unless the link it belongs to
+ *      has gone or is lost.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void emuRunStep(uint32 arg)
+{
+    emu_step step = (emu_step)(arg & 0xffff);
+    LM_EVENT_T event;
+    uint8 value[2];
+
+    if((arg >> 16) != g_emu_link.link_generation || !g_emu_link.connected ||
+       (g_emu_link.lost && step != emu_step_link_timeout))
+    {
+        return;
+    }
+
+    memset(&event, 0, sizeof(event));
+
+    switch(step)
+    {
+        case emu_step_security:
+            if(g_emu_link.peer.bonded)
+            {
+                /* Re-encrypt with the keys of the bond */
+                event.div_approve_ind.cid = EMU_CID;
+                event.div_approve_ind.div = EMU_PEER_DIV;
+                EmuPostLmEvent(0, SM_DIV_APPROVE_IND, &event, NULL, NULL);
+            }
+            else
+            {
+                EmuPostLmEvent(0, SM_PAIRING_AUTH_IND, &event, NULL, NULL);
+            }
+        break;
+
+        case emu_step_pairing_keys:
+        {
+            SM_KEYSET_T keys;
+
+            memset(&keys, 0, sizeof(keys));
+            keys.keys_present = (1 << SM_KEY_TYPE_DIV);
+            keys.div = EMU_PEER_DIV;
+            if(g_emu_link.peer.resolvable)
+            {
+                keys.keys_present |= (1 << SM_KEY_TYPE_ID);
+                memcpy(keys.irk, g_emu_link.irk, sizeof(keys.irk));
+            }
+            event.keys_ind.remote_addr = g_emu_link.addr;
+            EmuPostLmEvent(0, SM_KEYS_IND, &event, NULL, &keys);
+            emuPostStep(emu_step_pairing_encrypt, FALSE);
+        }
+        break;
+
+        case emu_step_pairing_encrypt:
+            event.enc_change.data.status = sys_status_success;
+            event.enc_change.data.handle = EMU_CID;
+            event.enc_change.data.enc_enable = TRUE;
+            EmuPostLmEvent(0, LM_EV_ENCRYPTION_CHANGE, &event, NULL, NULL);
+            emuPostStep(emu_step_pairing_complete, FALSE);
+        break;
+
+        case emu_step_pairing_complete:
+            g_emu_link.peer.bonded = TRUE;
+            event.pairing_complete_ind.bd_addr = g_emu_link.addr;
+            event.pairing_complete_ind.status = sys_status_success;
+            EmuPostLmEvent(0, SM_SIMPLE_PAIRING_COMPLETE_IND, &event, NULL,
+                           NULL);
+            if(g_emu_link.peer.subscribe)
+            {
+                emuPostStep(emu_step_subscribe, FALSE);
+            }
+        break;
+
+        case emu_step_encrypt:
+            event.enc_change.data.status = sys_status_success;
+            event.enc_change.data.handle = EMU_CID;
+            event.enc_change.data.enc_enable = TRUE;
+            EmuPostLmEvent(0, LM_EV_ENCRYPTION_CHANGE, &event, NULL, NULL);
+            if(g_emu_link.peer.subscribe)
+            {
+                emuPostStep(emu_step_subscribe, FALSE);
+            }
+        break;
+
+        case emu_step_subscribe:
+            /* Enable notifications of the Temperature Measurement */
+            value[0] = 0x01;
+            value[1] = 0x00;
+            event.access_ind.cid = EMU_CID;
+            event.access_ind.handle = HANDLE_HT_TEMP_MEAS_C_CFG;
+            event.access_ind.flags = ATT_ACCESS_WRITE |
+                                     ATT_ACCESS_PERMISSION |
+                                     ATT_ACCESS_WRITE_COMPLETE;
+            event.access_ind.size_value = 2;
+            EmuPostLmEvent(0, GATT_ACCESS_IND, &event, value, NULL);
+        break;
+
+        case emu_step_update_cfm:
+            event.param_update_cfm.address = g_emu_link.addr;
+            if(g_emu_link.peer.policy == emu_policy_reject)
+            {
+                event.param_update_cfm.status = ls_err_arg;
+                EmuPostLmEvent(0, LS_CONNECTION_PARAM_UPDATE_CFM, &event,
+                               NULL, NULL);
+                break;
+            }
+            event.param_update_cfm.status = ls_err_none;
+            EmuPostLmEvent(0, LS_CONNECTION_PARAM_UPDATE_CFM, &event, NULL,
+                           NULL);
+            /* Fall through to schedule the instant */
+
+        case emu_step_update_instant:
+            if(step == emu_step_update_instant)
+            {
+                g_emu_link.anchor = EmuNow();
+                g_emu_link.interval_us = g_emu_link.new_interval *
+                                         EMU_INTERVAL_UNIT;
+                g_emu_link.latency = g_emu_link.new_latency;
+                g_emu_link.timeout = g_emu_link.new_timeout;
+
+                event.connection_update.data.status = sys_status_success;
+                event.connection_update.data.connection_handle = EMU_CID;
+                event.connection_update.data.conn_interval =
+                                                    g_emu_link.new_interval;
+                event.connection_update.data.conn_latency =
+                                                    g_emu_link.new_latency;
+                event.connection_update.data.supervision_timeout =
+                                                    g_emu_link.new_timeout;
+                EmuPostLmEvent(0, LM_EV_CONNECTION_UPDATE, &event, NULL,
+                               NULL);
+                EmuLog("link interval %u us latency %u timeout %u ms",
+                       g_emu_link.interval_us, g_emu_link.latency,
+                       g_emu_link.timeout * 10);
+            }
+            else
+            {
+                EmuAt(EmuNow() + EMU_UPDATE_INSTANT_EVENTS *
+                                 (emu_time)g_emu_link.interval_us,
+                      emuRunStep, ((uint32)g_emu_link.link_generation << 16) |
+                                  emu_step_update_instant);
+            }
+        break;
+
+        case emu_step_disconnect_local:
+            emuLinkDown(HCI_ERROR_CONN_TERM_LOCAL_HOST);
+        break;
+
+        case emu_step_disconnect_remote:
+            emuLinkDown(g_emu_link.remote_reason);
+        break;
+
+        case emu_step_link_timeout:
+            emuLinkDown(HCI_ERROR_CONN_TIMEOUT);
+        break;
+
+        case emu_step_tx:
+            emuSendTx();
+        break;
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuConnect
+ *
+ *  DESCRIPTION
+ *      This function connects the peer if the device is still advertising
+ *      the way it was when the connection was scheduled.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void emuConnect(uint32 generation)
+{
+    LM_EVENT_T event;
+
+    if(generation != g_emu_link.adv_generation || !g_emu_link.advertising ||
+       !g_emu_link.peer.present)
+    {
+        return;
+    }
+
+    emuSetAddress();
+    if(g_emu_link.whitelist && !emuOnWhiteList(&g_emu_link.addr))
+    {
+        return;
+    }
+
+    g_emu_link.advertising = FALSE;
+    g_emu_link.connected = TRUE;
+    g_emu_link.lost = FALSE;
+    g_emu_link.link_generation++;
+    g_emu_link.anchor = EmuNow();
+    g_emu_link.interval_us = g_emu_link.peer.conn_interval *
+                             EMU_INTERVAL_UNIT;
+    g_emu_link.latency = g_emu_link.peer.conn_latency;
+    g_emu_link.timeout = g_emu_link.peer.supervision_timeout;
+    EmuLog("connected, interval %u us latency %u", g_emu_link.interval_us,
+           g_emu_link.latency);
+
+    memset(&event, 0, sizeof(event));
+    event.connection_complete.data.status = sys_status_success;
+    event.connection_complete.data.connection_handle = EMU_CID;
+    event.connection_complete.data.peer_address = g_emu_link.addr;
+    event.connection_complete.data.conn_interval = g_emu_link.peer.conn_interval;
+    event.connection_complete.data.conn_latency = g_emu_link.peer.conn_latency;
+    event.connection_complete.data.supervision_timeout =
+                                        g_emu_link.peer.supervision_timeout;
+    EmuPostLmEvent(0, LM_EV_CONNECTION_COMPLETE, &event, NULL, NULL);
+
+    memset(&event, 0, sizeof(event));
+    event.connect_cfm.bd_addr = g_emu_link.addr;
+    event.connect_cfm.cid = EMU_CID;
+    event.connect_cfm.result = sys_status_success;
+    EmuPostLmEvent(0, GATT_CONNECT_CFM, &event, NULL, NULL);
+
+    if(g_emu_link.peer.resolvable)
+    {
+        emuPostStep(emu_step_security, FALSE);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuLinkDown
+ *
+ *  DESCRIPTION
+ *      This function ends the link, dropping the notifications it had not
+ *      sent, and tells the application.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void emuLinkDown(uint16 reason)
+{
+    LM_EVENT_T event;
+    uint16 index;
+
+    g_emu_link.connected = FALSE;
+    g_emu_link.lost = FALSE;
+    g_emu_link.link_generation++;
+    EmuLog("disconnected, reason 0x%02x", reason);
+
+    for(index = 0; index < g_emu_link.tx_count; index++)
+    {
+        g_emu_link.tx[index].dropped = TRUE;
+        if(g_emu_link.hook != NULL)
+        {
+            g_emu_link.hook(&g_emu_link.tx[index]);
+        }
+    }
+    g_emu_link.tx_count = 0;
+    g_emu_link.tx_scheduled = FALSE;
+
+    memset(&event, 0, sizeof(event));
+    event.disconnect_complete.data.status = sys_status_success;
+    event.disconnect_complete.data.handle = EMU_CID;
+    event.disconnect_complete.data.reason = reason;
+    EmuPostLmEvent(0, LM_EV_DISCONNECT_COMPLETE, &event, NULL, NULL);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuSendTx
+ *
+ *  DESCRIPTION
+ *      This function sends the notifications one connection event carries
+ *      and confirms each to the application.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void emuSendTx(void)
+{
+    uint16 sent = 0;
+    LM_EVENT_T event;
+
+    g_emu_link.tx_scheduled = FALSE;
+
+    while(g_emu_link.tx_count > 0 &&
+          sent < g_emu_link.peer.notifications_per_event)
+    {
+        EMU_NOTIFICATION_T *p_not = &g_emu_link.tx[0];
+
+        p_not->air_time = EmuNow();
+        if(g_emu_link.hook != NULL)
+        {
+            g_emu_link.hook(p_not);
+        }
+
+        memset(&event, 0, sizeof(event));
+        event.char_val_cfm.result = sys_status_success;
+        event.char_val_cfm.cid = EMU_CID;
+        event.char_val_cfm.handle = p_not->handle;
+        EmuPostLmEvent(0, GATT_CHAR_VAL_NOT_CFM, &event, NULL, NULL);
+
+        memmove(&g_emu_link.tx[0], &g_emu_link.tx[1],
+                --g_emu_link.tx_count * sizeof(EMU_NOTIFICATION_T));
+        sent++;
+    }
+
+    if(g_emu_link.tx_count > 0)
+    {
+        g_emu_link.tx_scheduled = TRUE;
+        emuPostStep(emu_step_tx, TRUE);
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuLinkInit
+ *
+ *  DESCRIPTION
+ *      This function sets up the peer with no link. The notification hook
+ *      stays, the harness may set it before booting.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuLinkInit(const EMU_PEER_T *p_peer)
+{
+    emu_notification_hook hook = g_emu_link.hook;
+
+    memset(&g_emu_link, 0, sizeof(g_emu_link));
+    g_emu_link.hook = hook;
+    g_emu_link.peer = *p_peer;
+    if(g_emu_link.peer.notifications_per_event == 0)
+    {
+        g_emu_link.peer.notifications_per_event = 1;
+    }
+
+    emuSetIdentity();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuPeer, EmuIsConnected, EmuIsAdvertising, EmuConnIntervalUs,
+ *      EmuConnLatency, EmuSetNotificationHook
+ *
+ *  DESCRIPTION
+ *      Accessors of the peer and the link.
+ *
+ *  RETURNS
+ *      See above.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern EMU_PEER_T *EmuPeer(void)
+{
+    return &g_emu_link.peer;
+}
+
+extern bool EmuIsConnected(void)
+{
+    return g_emu_link.connected;
+}
+
+extern bool EmuIsAdvertising(void)
+{
+    return g_emu_link.advertising;
+}
+
+extern uint32 EmuConnIntervalUs(void)
+{
+    return g_emu_link.interval_us;
+}
+
+extern uint16 EmuConnLatency(void)
+{
+    return g_emu_link.latency;
+}
+
+extern void EmuSetNotificationHook(emu_notification_hook hook)
+{
+    g_emu_link.hook = hook;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuPeerSetPresent
+ *
+ *  DESCRIPTION
+ *      This function brings the peer in or out of range. A peer coming into
+ *      range connects to an advertising device after its connect delay.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuPeerSetPresent(bool present)
+{
+    g_emu_link.peer.present = present;
+
+    if(present && g_emu_link.advertising)
+    {
+        EmuAt(EmuNow() + g_emu_link.peer.connect_delay, emuConnect,
+              g_emu_link.adv_generation);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuPeerReplace
+ *
+ *  DESCRIPTION
+ *      This function has a different central, which is not bonded, take the
+ *      place of the peer from its next connection, with its own public
+ *      address and IRK. It keeps the other settings of the peer.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuPeerReplace(bool resolvable)
+{
+    g_emu_link.identity++;
+    g_emu_link.peer.bonded = FALSE;
+    g_emu_link.peer.resolvable = resolvable;
+    emuSetIdentity();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuResolvableAddress
+ *
+ *  DESCRIPTION
+ *      This function makes a resolvable random address: the random part
+ *      with its top two bits 01 in the NAP and UAP, and the hash of the IRK
+ *      and the random part in the LAP.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuResolvableAddress(const uint16 *irk, uint32 prand,
+                                 TYPED_BD_ADDR_T *p_addr)
+{
+    prand = (prand & 0x3fffff) | 0x400000;
+
+    p_addr->type = L2CA_RANDOM_ADDR_TYPE;
+    p_addr->addr.nap = (uint16)(prand >> 8);
+    p_addr->addr.uap = (uint8)(prand & 0xff);
+    p_addr->addr.lap = EmuAesHash(irk, prand);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuPeerDisconnect
+ *
+ *  DESCRIPTION
+ *      This function has the peer end the link with 'reason'.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuPeerDisconnect(uint16 reason)
+{
+    if(g_emu_link.connected)
+    {
+        g_emu_link.remote_reason = reason;
+        emuPostStep(emu_step_disconnect_remote, FALSE);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuLinkLoss
+ *
+ *  DESCRIPTION
+ *      This function stops all traffic on the link, which times out after
+ *      the supervision timeout.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuLinkLoss(void)
+{
+    if(g_emu_link.connected && !g_emu_link.lost)
+    {
+        g_emu_link.lost = TRUE;
+        EmuAt(EmuNow() + g_emu_link.timeout * (emu_time)EMU_TIMEOUT_UNIT,
+              emuRunStep, ((uint32)g_emu_link.link_generation << 16) |
+                          emu_step_link_timeout);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuPeerUpdateParams
+ *
+ *  DESCRIPTION
+ *      This function has the central change the connection parameters on
+ *      its own.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuPeerUpdateParams(uint16 interval, uint16 latency,
+                                uint16 timeout)
+{
+    if(g_emu_link.connected)
+    {
+        g_emu_link.new_interval = interval;
+        g_emu_link.new_latency = latency;
+        g_emu_link.new_timeout = timeout;
+        EmuAt(emuNextAnchor(FALSE) + EMU_UPDATE_INSTANT_EVENTS *
+                                     (emu_time)g_emu_link.interval_us,
+              emuRunStep, ((uint32)g_emu_link.link_generation << 16) |
+                          emu_step_update_instant);
+    }
+}
+
+/*============================================================================*
+ *  SDK Function Implementations
+ *============================================================================*/
+
+extern void GattInit(void)
+{
+}
+
+extern void GattInstallServerWrite(void)
+{
+}
+
+extern void GattAddDatabaseReq(uint16 size, uint16 *p_db)
+{
+    LM_EVENT_T event;
+
+    memset(&event, 0, sizeof(event));
+    event.add_db_cfm.result = sys_status_success;
+    EmuPostLmEvent(0, GATT_ADD_DB_CFM, &event, NULL, NULL);
+}
+
+extern void GattConnectReq(TYPED_BD_ADDR_T *p_addr, uint16 flags)
+{
+    g_emu_link.advertising = TRUE;
+    g_emu_link.whitelist = (flags & L2CAP_CONNECTION_SLAVE_WHITELIST) != 0;
+    g_emu_link.adv_generation++;
+    EmuLog("advertising%s", g_emu_link.whitelist ? " to the white list" : "");
+
+    if(g_emu_link.peer.present)
+    {
+        EmuAt(EmuNow() + g_emu_link.peer.connect_delay, emuConnect,
+              g_emu_link.adv_generation);
+    }
+}
+
+extern void GattCancelConnectReq(void)
+{
+    LM_EVENT_T event;
+
+    g_emu_link.advertising = FALSE;
+    g_emu_link.adv_generation++;
+
+    memset(&event, 0, sizeof(event));
+    event.cancel_connect_cfm.result = sys_status_success;
+    EmuPostLmEvent(0, GATT_CANCEL_CONNECT_CFM, &event, NULL, NULL);
+}
+
+extern void GattDisconnectReq(uint16 cid)
+{
+    if(g_emu_link.connected)
+    {
+        emuPostStep(emu_step_disconnect_local, TRUE);
+    }
+}
+
+extern void GattAccessRsp(uint16 cid, uint16 handle, sys_status result,
+                          uint16 size_value, uint8 *value)
+{
+}
+
+extern sys_status GattCharValueNotification(uint16 cid, uint16 handle,
+                                            uint16 size, uint8 *value)
+{
+    EMU_NOTIFICATION_T *p_not;
+
+    if(!g_emu_link.connected || cid != EMU_CID)
+    {
+        return sys_status_failed;
+    }
+
+    if(g_emu_link.tx_count == EMU_TX_QUEUE_SIZE)
+    {
+        return gatt_status_insufficient_resources;
+    }
+
+    p_not = &g_emu_link.tx[g_emu_link.tx_count++];
+    memset(p_not, 0, sizeof(*p_not));
+    p_not->handle = handle;
+    p_not->size = size < EMU_NOTIFICATION_MAX ? size : EMU_NOTIFICATION_MAX;
+    memcpy(p_not->value, value, p_not->size * sizeof(uint8));
+    p_not->call_time = EmuNow();
+
+    if(!g_emu_link.tx_scheduled && !g_emu_link.lost)
+    {
+        g_emu_link.tx_scheduled = TRUE;
+        emuPostStep(emu_step_tx, TRUE);
+    }
+
+    return sys_status_success;
+}
+
+extern ls_err GapSetMode(gap_role role, gap_mode_discover discover,
+                         gap_mode_connect connect, gap_mode_bond bond,
+                         gap_mode_security security)
+{
+    return ls_err_none;
+}
+
+extern ls_err GapSetAdvInterval(uint32 adv_interval_min,
+                                uint32 adv_interval_max)
+{
+    return ls_err_none;
+}
+
+extern ls_err LsStoreAdvScanData(uint16 len, uint8 *data, ad_src src)
+{
+    return ls_err_none;
+}
+
+extern ls_err LsConnectionParamUpdateReq(TYPED_BD_ADDR_T *p_addr,
+                                         ble_con_params *p_params)
+{
+    if(!g_emu_link.connected)
+    {
+        return ls_err_state;
+    }
+
+    /* The central takes the longest interval the device asks for */
+    g_emu_link.new_interval = p_params->con_max_interval;
+    g_emu_link.new_latency = p_params->con_slave_latency;
+    g_emu_link.new_timeout = p_params->con_super_timeout;
+    emuPostStep(emu_step_update_cfm, TRUE);
+
+    return ls_err_none;
+}
+
+extern ls_err LsAddWhiteListDevice(TYPED_BD_ADDR_T *p_addr)
+{
+    if(g_emu_link.white_list_count == EMU_WHITE_LIST_SIZE)
+    {
+        return ls_err_arg;
+    }
+
+    if(!emuOnWhiteList(p_addr))
+    {
+        g_emu_link.white_list[g_emu_link.white_list_count++] = *p_addr;
+    }
+
+    return ls_err_none;
+}
+
+extern ls_err LsResetWhiteList(void)
+{
+    g_emu_link.white_list_count = 0;
+
+    return ls_err_none;
+}
+
+extern ls_err LsReadTransmitPowerLevel(int8 *p_level)
+{
+    *p_level = g_emu_link.tx_power;
+    return ls_err_none;
+}
+
+extern ls_err LsSetTransmitPowerLevel(int8 level)
+{
+    g_emu_link.tx_power = level;
+    return ls_err_none;
+}
+
+extern ls_err LsReadRssi(TYPED_BD_ADDR_T *p_addr, int8 *p_rssi)
+{
+    if(!g_emu_link.connected)
+    {
+        return ls_err_state;
+    }
+
+    *p_rssi = g_emu_link.peer.rssi;
+    return ls_err_none;
+}
+
+extern void SMInit(uint16 diversifier)
+{
+}
+
+extern void SMRequestSecurityLevel(TYPED_BD_ADDR_T *p_addr)
+{
+    if(g_emu_link.connected)
+    {
+        emuPostStep(emu_step_security, TRUE);
+    }
+}
+
+extern void SMPairingAuthRsp(void *data, bool pairing_ok)
+{
+    LM_EVENT_T event;
+
+    if(pairing_ok)
+    {
+        emuPostStep(emu_step_pairing_keys, FALSE);
+        return;
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.pairing_complete_ind.bd_addr = g_emu_link.addr;
+    event.pairing_complete_ind.status = sys_status_failed;
+    EmuPostLmEvent(0, SM_SIMPLE_PAIRING_COMPLETE_IND, &event, NULL, NULL);
+}
+
+extern void SMDivApproval(uint16 cid, sm_div_verdict approve_div)
+{
+    if(approve_div == SM_DIV_APPROVED)
+    {
+        emuPostStep(emu_step_encrypt, TRUE);
+    }
+    else
+    {
+        /* The device no longer knows the keys, the encryption fails */
+        g_emu_link.peer.bonded = FALSE;
+        g_emu_link.remote_reason = HCI_ERROR_AUTH_FAIL;
+        emuPostStep(emu_step_disconnect_remote, TRUE);
+    }
+}
+
+extern int16 SMPrivacyMatchAddress(TYPED_BD_ADDR_T *p_addr, uint16 *irks,
+                                   uint16 num_irks, uint16 irk_size)
+{
+    uint32 prand = ((uint32)p_addr->addr.nap << 8) | p_addr->addr.uap;
+    uint16 index;
+
+    /* Hash the random part with each IRK in turn, as the firmware does */
+    for(index = 0; index < num_irks; index++)
+    {
+        if(EmuAesHash(&irks[index * irk_size], prand) == p_addr->addr.lap)
+        {
+            return (int16)index;
+        }
+    }
+
+    return -1;
+}
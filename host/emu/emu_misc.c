@@ -0,0 +1,167 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      emu_misc.c
+ *
+ *  DESCRIPTION
+ *      The rest of the SDK for the host build: battery and AIO readings,
+ *      the word-based memory and octet buffer helpers, sleep and the CS
+ *      keys.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  System Header Files
+ *============================================================================*/
+
+#include <string.h>
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <mem.h>
+#include <buf_utils.h>
+#include <battery.h>
+#include <thermometer.h>
+#include <sleep.h>
+#include <config_store.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "emu.h"
+
+/* Quoted, as the libc <aio.h> comes first on the emulator's include path */
+#include "../include/aio.h"
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Battery voltage in mV */
+static uint16 g_emu_battery_mv;
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuMiscInit
+ *
+ *  DESCRIPTION
+ *      This function sets the battery voltage.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuMiscInit(uint16 battery_mv)
+{
+    g_emu_battery_mv = battery_mv;
+}
+
+/*============================================================================*
+ *  SDK Function Implementations
+ *============================================================================*/
+
+extern uint16 BatteryReadVoltage(void)
+{
+    return g_emu_battery_mv;
+}
+
+extern uint16 AioRead(aio_select aio)
+{
+    /* A throttle at rest */
+    return 0;
+}
+
+extern int16 ThermometerReadTemperature(void)
+{
+    return 25;
+}
+
+/* Lengths are in words, as sizeof() gives them on the XAP */
+extern void MemCopy(void *dest, const void *src, uint16 length)
+{
+    memmove(dest, src, length * sizeof(uint16));
+}
+
+extern void MemSet(void *dest, uint16 value, uint16 length)
+{
+    uint16 *p_word = dest;
+
+    while(length--)
+    {
+        *p_word++ = value;
+    }
+}
+
+extern int16 MemCmp(const void *a, const void *b, uint16 length)
+{
+    const uint16 *p_a = a;
+    const uint16 *p_b = b;
+
+    for(; length > 0; length--, p_a++, p_b++)
+    {
+        if(*p_a != *p_b)
+        {
+            return (*p_a < *p_b) ? -1 : 1;
+        }
+    }
+
+    return 0;
+}
+
+/* One octet per uint8 word, little-endian */
+extern uint8 BufReadUint8(uint8 **p_buf)
+{
+    return *(*p_buf)++ & 0xff;
+}
+
+extern uint16 BufReadUint16(uint8 **p_buf)
+{
+    uint16 value = BufReadUint8(p_buf);
+
+    return value | (BufReadUint8(p_buf) << 8);
+}
+
+extern void BufWriteUint8(uint8 **p_buf, uint8 value)
+{
+    *(*p_buf)++ = value & 0xff;
+}
+
+extern void BufWriteUint16(uint8 **p_buf, uint16 value)
+{
+    BufWriteUint8(p_buf, value & 0xff);
+    BufWriteUint8(p_buf, value >> 8);
+}
+
+extern void SleepRequest(sleep_state state, bool wake_time_valid,
+                         void *p_wake_time)
+{
+    if(state == sleep_state_dormant)
+    {
+        EmuSetDormant();
+    }
+}
+
+extern void SleepWakeOnUartRX(bool enable)
+{
+}
+
+extern bool CSReadBdaddr(BD_ADDR_T *p_addr)
+{
+    p_addr->lap = 0x01ff00;
+    p_addr->uap = 0x5b;
+    p_addr->nap = 0x0002;
+
+    return TRUE;
+}
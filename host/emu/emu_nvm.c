@@ -0,0 +1,505 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      emu_nvm.c
+ *
+ *  DESCRIPTION
+ *      NVM emulation of the host build. The store starts erased. With I2C
+ *      EEPROM semantics any word can be rewritten; with SPI flash semantics
+ *      a write to a word which is not erased fails with
+ *      nvm_status_needs_erase and only NvmErase() and NvmEraseBlock() erase,
+ *      the whole store or one SPI flash block.
+ *
+ *      The power to the store can be cut after a given number of words, to
+ *      leave it as a reset in the middle of a write or compaction would,
+ *      with the word being written then corrupted or not.
+ *
+ *      With I2C EEPROM semantics the time the transfers keep the bus busy is
+ *      added up, from the figures below: waking the EEPROM after
+ *      NvmDisable(), addressing it, clocking the words at 400 kHz and
+ *      waiting for the write cycle of each page written. The virtual clock
+ *      is not moved by it.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  System Header Files
+ *============================================================================*/
+
+#include <string.h>
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <status.h>
+#include <nvm.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "emu.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+#define EMU_NVM_ERASED                      (0xffff)
+
+/* Words in an SPI flash block, the unit NvmEraseBlock() erases */
+#define EMU_NVM_BLOCK_WORDS                 (0x800)
+
+/* I2C EEPROM timing in us. An octet takes 9 clocks at 400 kHz. A read sends
+ * the device address, the 2 octet word address and the device address
+ * again, a write the first three. A write cycle programs a page of
+ * EMU_NVM_PAGE_WORDS words. The wake-up time is an estimate, not a
+ * measurement on the board.
+ */
+#define EMU_NVM_OCTET_US                    (22.5)
+#define EMU_NVM_READ_ADDRESS_US             (4 * EMU_NVM_OCTET_US)
+#define EMU_NVM_WRITE_ADDRESS_US            (3 * EMU_NVM_OCTET_US)
+#define EMU_NVM_WORD_US                     (2 * EMU_NVM_OCTET_US)
+#define EMU_NVM_WRITE_CYCLE_US              (5000)
+#define EMU_NVM_PAGE_WORDS                  (32)
+#define EMU_NVM_WAKE_US                     (100)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    uint16                          words[EMU_NVM_WORDS];
+    bool                            flash;
+
+    /* Erases so far */
+    uint32                          erases;
+
+    /* The power is to be cut, after 'budget' more words, corrupting the
+     * word being written if 'torn'
+     */
+    bool                            cut_armed;
+    uint32                          budget;
+    bool                            torn;
+
+    /* A word has been torn already */
+    bool                            cut_done;
+
+    /* Random number generator of the corrupted words */
+    uint32                          random;
+
+    /* The EEPROM has been woken since the last NvmDisable() */
+    bool                            awake;
+
+    /* Transfers so far, and the time they kept the I2C bus busy in us */
+    uint32                          transfers;
+    double                          busy_us;
+
+} EMU_NVM_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static EMU_NVM_T g_emu_nvm;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static uint32 emuNvmPowered(uint32 words);
+static void emuNvmTear(uint16 offset, uint16 value);
+static void emuNvmTransfer(double us);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuNvmPowered
+ *
+ *  DESCRIPTION
+ *      This function takes words to be written from the budget left before
+ *      the power cut.
+ *
+ *  RETURNS
+ *      The number of the words which are still written.
+ *
+ *---------------------------------------------------------------------------*/
+
+static uint32 emuNvmPowered(uint32 words)
+{
+    if(!g_emu_nvm.cut_armed)
+    {
+        return words;
+    }
+
+    if(words > g_emu_nvm.budget)
+    {
+        words = g_emu_nvm.budget;
+    }
+    g_emu_nvm.budget -= words;
+
+    return words;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuNvmTear
+ *
+ *  DESCRIPTION
+ *      This function corrupts the word the power was cut in the middle of
+ *      writing, if the cut tears words.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void emuNvmTear(uint16 offset, uint16 value)
+{
+    uint16 noise;
+
+    if(!g_emu_nvm.torn)
+    {
+        return;
+    }
+
+    g_emu_nvm.random = g_emu_nvm.random * 1103515245 + 12345;
+    noise = (uint16)(g_emu_nvm.random >> 16);
+
+    /* Programming flash only clears bits, some have not been yet */
+    g_emu_nvm.words[offset] = g_emu_nvm.flash ? (value | noise) : noise;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuNvmTransfer
+ *
+ *  DESCRIPTION
+ *      This function adds up a transfer with the I2C EEPROM taking 'us', and
+ *      the wake-up of the EEPROM if it has been disabled.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void emuNvmTransfer(double us)
+{
+    if(g_emu_nvm.flash)
+    {
+        return;
+    }
+
+    if(!g_emu_nvm.awake)
+    {
+        g_emu_nvm.awake = TRUE;
+        us += EMU_NVM_WAKE_US;
+    }
+
+    g_emu_nvm.transfers++;
+    g_emu_nvm.busy_us += us;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuNvmInit
+ *
+ *  DESCRIPTION
+ *      This function erases the store and selects its semantics. A power
+ *      cut armed beforehand stays armed.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuNvmInit(bool flash)
+{
+    uint16 index;
+
+    g_emu_nvm.flash = flash;
+    g_emu_nvm.erases = 0;
+    g_emu_nvm.awake = FALSE;
+    g_emu_nvm.transfers = 0;
+    g_emu_nvm.busy_us = 0;
+
+    for(index = 0; index < EMU_NVM_WORDS; index++)
+    {
+        g_emu_nvm.words[index] = EMU_NVM_ERASED;
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuNvmPowerCut
+ *
+ *  DESCRIPTION
+ *      This function arms a power cut after 'words' more words.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuNvmPowerCut(uint32 words, bool torn)
+{
+    g_emu_nvm.cut_armed = TRUE;
+    g_emu_nvm.budget = words;
+    g_emu_nvm.torn = torn;
+    g_emu_nvm.cut_done = FALSE;
+    g_emu_nvm.random = words;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuNvmPowerIsCut
+ *
+ *  DESCRIPTION
+ *      This function tells whether the power cut has happened.
+ *
+ *  RETURNS
+ *      TRUE once the store ignores writes and erases.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool EmuNvmPowerIsCut(void)
+{
+    return g_emu_nvm.cut_armed && g_emu_nvm.budget == 0;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuNvmPowerOn
+ *
+ *  DESCRIPTION
+ *      This function powers the store again, as it was left.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuNvmPowerOn(void)
+{
+    g_emu_nvm.cut_armed = FALSE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuNvmEraseCount
+ *
+ *  DESCRIPTION
+ *      This function returns the number of erases so far.
+ *
+ *  RETURNS
+ *      See above.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint32 EmuNvmEraseCount(void)
+{
+    return g_emu_nvm.erases;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuNvmTransfers, EmuNvmBusyTime
+ *
+ *  DESCRIPTION
+ *      These functions return the number of transfers with the I2C EEPROM
+ *      so far and the time they kept the bus busy. Both stay 0 with SPI
+ *      flash semantics.
+ *
+ *  RETURNS
+ *      EmuNvmTransfers: see above.
+ *      EmuNvmBusyTime: the time in us.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint32 EmuNvmTransfers(void)
+{
+    return g_emu_nvm.transfers;
+}
+
+extern double EmuNvmBusyTime(void)
+{
+    return g_emu_nvm.busy_us;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuNvmLoad
+ *
+ *  DESCRIPTION
+ *      This function copies words into the store, from offset 0.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuNvmLoad(const uint16 *words, uint16 length)
+{
+    memcpy(g_emu_nvm.words, words, length * sizeof(uint16));
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuNvmSave
+ *
+ *  DESCRIPTION
+ *      This function copies words out of the store, from offset 0.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuNvmSave(uint16 *words, uint16 length)
+{
+    memcpy(words, g_emu_nvm.words, length * sizeof(uint16));
+}
+
+/*============================================================================*
+ *  SDK Function Implementations
+ *============================================================================*/
+
+extern void NvmConfigureI2cEeprom(void)
+{
+}
+
+extern void NvmConfigureSpiFlash(void)
+{
+}
+
+extern void NvmDisable(void)
+{
+    g_emu_nvm.awake = FALSE;
+}
+
+extern sys_status NvmRead(uint16 *buffer, uint16 length, uint16 offset)
+{
+    if((uint32)offset + length > EMU_NVM_WORDS)
+    {
+        return nvm_status_invalid_offset;
+    }
+
+    memcpy(buffer, &g_emu_nvm.words[offset], length * sizeof(uint16));
+    emuNvmTransfer(EMU_NVM_READ_ADDRESS_US + length * EMU_NVM_WORD_US);
+
+    return sys_status_success;
+}
+
+extern sys_status NvmWrite(uint16 *buffer, uint16 length, uint16 offset)
+{
+    uint32 written;
+    uint16 index;
+    uint16 words;
+
+    if((uint32)offset + length > EMU_NVM_WORDS)
+    {
+        return nvm_status_invalid_offset;
+    }
+
+    if(g_emu_nvm.flash)
+    {
+        for(index = 0; index < length; index++)
+        {
+            if(g_emu_nvm.words[offset + index] != EMU_NVM_ERASED)
+            {
+                EmuLog("nvm write at %u needs erase", offset + index);
+                return nvm_status_needs_erase;
+            }
+        }
+    }
+
+    /* Each page the words span is written by a transfer of its own */
+    for(index = 0; index < length; index += words)
+    {
+        words = EMU_NVM_PAGE_WORDS - (offset + index) % EMU_NVM_PAGE_WORDS;
+        if(words > length - index)
+        {
+            words = length - index;
+        }
+
+        emuNvmTransfer(EMU_NVM_WRITE_ADDRESS_US + words * EMU_NVM_WORD_US +
+                       EMU_NVM_WRITE_CYCLE_US);
+    }
+
+    written = emuNvmPowered(length);
+    memcpy(&g_emu_nvm.words[offset], buffer, written * sizeof(uint16));
+
+    if(written < length && !g_emu_nvm.cut_done)
+    {
+        /* The power went in the middle of this write */
+        g_emu_nvm.cut_done = TRUE;
+        emuNvmTear(offset + written, buffer[written]);
+    }
+
+    return sys_status_success;
+}
+
+extern sys_status NvmErase(bool erase_all)
+{
+    uint16 index;
+
+    g_emu_nvm.erases++;
+
+    if(emuNvmPowered(1) == 0)
+    {
+        return sys_status_success;
+    }
+
+    for(index = 0; index < EMU_NVM_WORDS; index++)
+    {
+        g_emu_nvm.words[index] = EMU_NVM_ERASED;
+    }
+
+    return sys_status_success;
+}
+
+extern sys_status NvmEraseBlock(uint16 offset)
+{
+    uint16 start = offset - offset % EMU_NVM_BLOCK_WORDS;
+    uint16 index;
+
+    if(offset >= EMU_NVM_WORDS)
+    {
+        return nvm_status_invalid_offset;
+    }
+
+    g_emu_nvm.erases++;
+
+    if(emuNvmPowered(1) == 0)
+    {
+        return sys_status_success;
+    }
+
+    for(index = start; index < start + EMU_NVM_BLOCK_WORDS; index++)
+    {
+        g_emu_nvm.words[index] = EMU_NVM_ERASED;
+    }
+
+    return sys_status_success;
+}
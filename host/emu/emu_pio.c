@@ -0,0 +1,358 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      emu_pio.c
+ *
+ *  DESCRIPTION
+ *      PIO emulation of the host build. The harness drives the input levels
+ *      with EmuPioSet(); an edge the application enabled with
+ *      PioSetEventMask() is delivered as sys_event_pio_changed. The PWM only
+ *      records what the application asked for.
+ *
+ *      The PIO controller runs a model of pio_ctrlr_code.asm rather than the
+ *      program image: while started, it samples the GHG and BP inputs every
+ *      EMU_PIO_CTRLR_SAMPLE from the event queue, without waking the
+ *      application, debounces them and counts their presses in the shared
+ *      memory, as the program does.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  System Header Files
+ *============================================================================*/
+
+#include <string.h>
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <pio.h>
+#include <pio_ctrlr.h>
+#include <main.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "emu.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+#define EMU_PIO_MAX                         (32)
+
+/* Time the sampling loop of pio_ctrlr_code.asm takes on the slow clock, the
+ * only one the application runs the controller from
+ */
+#define EMU_PIO_CTRLR_SAMPLE                (8 * MILLISECOND)
+
+/* Samples in a row an input must read its new level for, DEBOUNCE_SAMPLES of
+ * pio_ctrlr_code.asm
+ */
+#define EMU_PIO_CTRLR_DEBOUNCE              (2)
+
+/* Inputs counted by the program, GHG (PIO10) in the low octet of the shared
+ * word and BP (PIO11) in its high octet
+ */
+#define EMU_PIO_CTRLR_INPUTS                (2)
+#define EMU_PIO_CTRLR_FIRST_PIO             (10)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    /* Levels of the PIOs, inputs rest high as the buttons are pulled up */
+    uint32                          state;
+
+    /* Edges delivered for each PIO */
+    pio_event_mode                  event_mode[EMU_PIO_MAX];
+
+    /* Buzzer PWM running */
+    bool                            pwm_enabled;
+
+    /* PIO controller program running, and the number of times it has been
+     * started, which tells the samples queued by an earlier start
+     */
+    bool                            ctrlr_running;
+    uint32                          ctrlr_starts;
+
+    /* Debounced levels of the counted inputs, a bit set while released, and
+     * the samples in a row each has read a new level for (R2 to R4 of the
+     * program)
+     */
+    uint32                          ctrlr_state;
+    uint16                          ctrlr_samples[EMU_PIO_CTRLR_INPUTS];
+
+} EMU_PIO_T;
+
+/*============================================================================*
+ *  Public Data
+ *============================================================================*/
+
+/* Program image of the PIO controller, which the host does not run */
+uint16 pio_ctrlr_code;
+
+/* Memory the PIO controller shares with the application, see pio_ctrlr.h */
+uint16 g_emu_pio_ctrlr_ram[1];
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static EMU_PIO_T g_emu_pio;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void emuPioCtrlrSample(uint32 start);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      emuPioCtrlrSample
+ *
+ *  DESCRIPTION
+ *      This function runs one pass of the sampling loop of the PIO
+ *      controller program and queues the next one. An input changes state
+ *      once it has read its new level on EMU_PIO_CTRLR_DEBOUNCE samples in a
+ *      row, and each change to pressed increments its octet counter. The
+ *      samples of a program since stopped or restarted are dropped.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void emuPioCtrlrSample(uint32 start)
+{
+    uint16 input;
+    uint16 shift;
+    uint16 count;
+    uint32 mask;
+
+    if(!g_emu_pio.ctrlr_running || start != g_emu_pio.ctrlr_starts)
+    {
+        return;
+    }
+
+    for(input = 0; input < EMU_PIO_CTRLR_INPUTS; input++)
+    {
+        mask = 1UL << (EMU_PIO_CTRLR_FIRST_PIO + input);
+
+        if(((g_emu_pio.state ^ g_emu_pio.ctrlr_state) & mask) == 0)
+        {
+            g_emu_pio.ctrlr_samples[input] = 0;
+        }
+        else if(++ g_emu_pio.ctrlr_samples[input] == EMU_PIO_CTRLR_DEBOUNCE)
+        {
+            g_emu_pio.ctrlr_state ^= mask;
+            g_emu_pio.ctrlr_samples[input] = 0;
+
+            if((g_emu_pio.ctrlr_state & mask) == 0)
+            {
+                /* Pressed, the octet counter wraps on its own */
+                shift = 8 * input;
+                count = (uint16)(((g_emu_pio_ctrlr_ram[0] >> shift) + 1) &
+                                 0xff);
+                g_emu_pio_ctrlr_ram[0] = (uint16)
+                    ((g_emu_pio_ctrlr_ram[0] & ~(0xff << shift)) |
+                     (count << shift));
+            }
+        }
+    }
+
+    EmuAt(EmuNow() + EMU_PIO_CTRLR_SAMPLE, emuPioCtrlrSample, start);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuPioInit
+ *
+ *  DESCRIPTION
+ *      This function sets all the PIOs high with their events disabled.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuPioInit(void)
+{
+    memset(&g_emu_pio, 0, sizeof(g_emu_pio));
+    g_emu_pio.state = 0xffffffffUL;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuPioSet
+ *
+ *  DESCRIPTION
+ *      This function drives the level of a PIO. A change the application
+ *      listens to is queued as sys_event_pio_changed carrying the changed PIO
+ *      and the levels of all of them.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EmuPioSet(uint16 pio, bool level)
+{
+    uint32 mask = 1UL << pio;
+    pio_event_mode mode = g_emu_pio.event_mode[pio];
+    pio_changed_data change;
+
+    if(((g_emu_pio.state & mask) != 0) == (level != FALSE))
+    {
+        return;
+    }
+
+    g_emu_pio.state ^= mask;
+    EmuLog("pio %u %s", pio, level ? "high" : "low");
+
+    if(mode == pio_event_mode_both ||
+       (mode == pio_event_mode_rising && level) ||
+       (mode == pio_event_mode_falling && !level))
+    {
+        change.pio_cause = mask;
+        change.pio_state = g_emu_pio.state;
+        EmuPostSysEvent(sys_event_pio_changed, &change, sizeof(change));
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuPioGet, EmuPwmEnabled
+ *
+ *  DESCRIPTION
+ *      These functions return the PIO levels and whether the buzzer PWM is
+ *      running.
+ *
+ *  RETURNS
+ *      See above.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint32 EmuPioGet(void)
+{
+    return g_emu_pio.state;
+}
+
+extern bool EmuPwmEnabled(void)
+{
+    return g_emu_pio.pwm_enabled;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EmuPioEventsEnabled
+ *
+ *  DESCRIPTION
+ *      This function tells whether the application takes PIO changed events 
+ *      from a PIO, on either edge.
+ *
+ *  RETURNS
+ *      TRUE if it does.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool EmuPioEventsEnabled(uint16 pio)
+{
+    return g_emu_pio.event_mode[pio] != pio_event_mode_disable;
+}
+
+/*============================================================================*
+ *  SDK Function Implementations
+ *============================================================================*/
+
+extern void PioSetModes(uint32 pio_mask, pio_mode mode)
+{
+}
+
+extern void PioSetDir(uint16 pio, bool output)
+{
+}
+
+extern void PioSetPullModes(uint32 pio_mask, pio_pull_mode pull_mode)
+{
+}
+
+extern void PioSetI2CPullMode(pio_i2c_pull_mode mode)
+{
+}
+
+extern void PioSetEventMask(uint32 pio_mask, pio_event_mode mode)
+{
+    uint16 pio;
+
+    for(pio = 0; pio < EMU_PIO_MAX; pio++)
+    {
+        if(pio_mask & (1UL << pio))
+        {
+            g_emu_pio.event_mode[pio] = mode;
+        }
+    }
+}
+
+extern uint32 PioGets(void)
+{
+    return g_emu_pio.state;
+}
+
+extern bool PioConfigPWM(uint16 pwm_index, pio_pwm_mode mode,
+                         uint8 dull_off_time, uint8 dull_on_time,
+                         uint8 dull_hold_time, uint8 bright_off_time,
+                         uint8 bright_on_time, uint8 bright_hold_time,
+                         uint8 ramp_rate)
+{
+    return TRUE;
+}
+
+extern void PioEnablePWM(uint16 pwm_index, bool enable)
+{
+    g_emu_pio.pwm_enabled = enable;
+}
+
+extern void PioCtrlrInit(uint16 *image)
+{
+}
+
+extern void PioCtrlrStart(void)
+{
+    /* The program clears its counters and takes both inputs as released */
+    g_emu_pio_ctrlr_ram[0] = 0;
+    g_emu_pio.ctrlr_state = 0xffffffffUL;
+    memset(g_emu_pio.ctrlr_samples, 0, sizeof(g_emu_pio.ctrlr_samples));
+    g_emu_pio.ctrlr_running = TRUE;
+    g_emu_pio.ctrlr_starts++;
+
+    EmuAt(EmuNow(), emuPioCtrlrSample, g_emu_pio.ctrlr_starts);
+}
+
+extern void PioCtrlrStop(void)
+{
+    g_emu_pio.ctrlr_running = FALSE;
+}
+
+extern void PioCtrlrClock(bool fast_clock)
+{
+}
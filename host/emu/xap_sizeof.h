@@ -0,0 +1,24 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      xap_sizeof.h
+ *
+ *  DESCRIPTION
+ *      Forced into every application source of the host build. The XAP is
+ *      word addressed and the application passes sizeof() results to
+ *      MemCopy(), MemSet() and NvmRead()/NvmWrite() as word counts. Every
+ *      type the application uses is a whole number of 16-bit words on the
+ *      host too (see host/include/types.h), so halving sizeof() keeps those
+ *      calls right.
+ *
+ *****************************************************************************/
+
+#ifndef __XAP_SIZEOF_H__
+#define __XAP_SIZEOF_H__
+
+#define sizeof(x)                           (sizeof(x) / 2)
+
+#endif /* __XAP_SIZEOF_H__ */
@@ -0,0 +1,724 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      fsm_bench.c
+ *
+ *  DESCRIPTION
+ *      Drives every (application state, LM event) pair through
+ *      AppProcessLmEvent(), checks the state it ends in (or the panic it
+ *      raises) against the behaviour of the switch based dispatcher the state
+ *      table replaced, and reports the cost of each dispatch.
+ *
+ *      Each state is reached once in a process of its own, which then forks
+ *      one process per measured dispatch, so every dispatch starts from the
+ *      same application data. The cost is counted in time stamp counter
+ *      ticks (nanoseconds where there is no TSC); it compares handlers with
+ *      each other, it is not a count of XAP cycles.
+ *
+ *      Usage: fsm_bench [-q] [-runs <n>]
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  System Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <gatt_prim.h>
+#include <config_store.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "emu.h"
+#include "app_gatt.h"
+#include "app_gatt_db.h"
+#include "health_thermometer.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Dispatches measured for each pair unless -runs is given */
+#define FSM_DEFAULT_RUNS                    (31)
+#define FSM_MAX_RUNS                        (255)
+
+/* Outcomes besides an application state */
+#define FSM_PANIC                           (-1)
+#define FSM_SAME                            (-2)
+
+/* Give up reaching a state after this much virtual time */
+#define FSM_REACH_LIMIT                     (30 * MINUTE)
+#define FSM_REACH_STEP                      (100 * MILLISECOND)
+
+/* Shorthands for the expected outcome table */
+#define P                                   FSM_PANIC
+#define S                                   FSM_SAME
+#define FAST                                app_state_fast_advertising
+#define SLOW                                app_state_slow_advertising
+#define CONN                                app_state_connected
+#define IDLE                                app_state_idle
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Fills in the payload of an event */
+typedef void (*fsm_payload)(LM_EVENT_T *p_event);
+
+/* An LM event with a canonical payload and the outcome the switch based
+ * dispatcher had for it in each state: a panic, staying in the state (which
+ * may have run its handler) or the state moved to. The peer is bonded in the
+ * connected and disconnecting states.
+ */
+typedef struct
+{
+    const char                     *name;
+    lm_event_code                   code;
+    fsm_payload                     payload;
+    int                             expected[app_state_max];
+
+} FSM_CASE_T;
+
+/* What a measured dispatch reports to the process which reached the state */
+typedef struct
+{
+    int                             outcome;
+    uint16                          panic_code;
+    uint64_t                        cost;
+
+} FSM_RESULT_T;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void payloadAddDbCfm(LM_EVENT_T *p_event);
+static void payloadCancelConnectCfm(LM_EVENT_T *p_event);
+static void payloadConnectionComplete(LM_EVENT_T *p_event);
+static void payloadConnectCfm(LM_EVENT_T *p_event);
+static void payloadConnectCfmFailed(LM_EVENT_T *p_event);
+static void payloadKeysInd(LM_EVENT_T *p_event);
+static void payloadPairingAuthInd(LM_EVENT_T *p_event);
+static void payloadPairingCompleteInd(LM_EVENT_T *p_event);
+static void payloadEncryptionChange(LM_EVENT_T *p_event);
+static void payloadDivApproveInd(LM_EVENT_T *p_event);
+static void payloadParamUpdateCfm(LM_EVENT_T *p_event);
+static void payloadConnectionUpdate(LM_EVENT_T *p_event);
+static void payloadParamUpdateInd(LM_EVENT_T *p_event);
+static void payloadAccessInd(LM_EVENT_T *p_event);
+static void payloadLinkLoss(LM_EVENT_T *p_event);
+static void payloadLocalHost(LM_EVENT_T *p_event);
+static void payloadRemoteUser(LM_EVENT_T *p_event);
+static void payloadCharValNotCfm(LM_EVENT_T *p_event);
+static void payloadGattDisconnect(LM_EVENT_T *p_event);
+static uint64_t fsmCounter(void);
+static void fsmTouchData(void);
+static bool fsmReach(app_state state);
+static void fsmDispatch(const FSM_CASE_T *p_case, int fd);
+static bool fsmMeasure(app_state state, uint16 runs, int fd);
+static int fsmCompareCost(const void *a, const void *b);
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static const char *const g_fsm_state_names[app_state_max] =
+{
+    "init", "fast_advertising", "slow_advertising", "connected",
+    "disconnecting", "idle"
+};
+
+/* Octets of the access and the keys the payloads point at */
+static uint8 g_fsm_cccd_value[2] = {0x01, 0x00};
+static SM_KEYSET_T g_fsm_keys;
+
+/* Start of the dispatch being measured, kept across a panic's longjmp() */
+static volatile uint64_t g_fsm_start;
+
+/* init, fast_advertising, slow_advertising, connected, disconnecting, idle */
+static const FSM_CASE_T g_fsm_cases[] =
+{
+    {"GATT_ADD_DB_CFM", GATT_ADD_DB_CFM, payloadAddDbCfm,
+        {FAST, P,    P,    P,    P,    P}},
+    {"GATT_CANCEL_CONNECT_CFM", GATT_CANCEL_CONNECT_CFM,
+        payloadCancelConnectCfm,
+        {P,    SLOW, IDLE, P,    P,    P}},
+    {"LM_EV_CONNECTION_COMPLETE", LM_EV_CONNECTION_COMPLETE,
+        payloadConnectionComplete,
+        {S,    S,    S,    S,    S,    S}},
+    {"GATT_CONNECT_CFM", GATT_CONNECT_CFM, payloadConnectCfm,
+        {P,    CONN, CONN, P,    P,    P}},
+    {"GATT_CONNECT_CFM failed", GATT_CONNECT_CFM, payloadConnectCfmFailed,
+        {P,    S,    FAST, P,    P,    P}},
+    {"SM_KEYS_IND", SM_KEYS_IND, payloadKeysInd,
+        {P,    P,    P,    S,    P,    P}},
+    {"SM_PAIRING_AUTH_IND", SM_PAIRING_AUTH_IND, payloadPairingAuthInd,
+        {P,    P,    P,    S,    P,    P}},
+    {"SM_SIMPLE_PAIRING_COMPLETE_IND", SM_SIMPLE_PAIRING_COMPLETE_IND,
+        payloadPairingCompleteInd,
+        {S,    S,    S,    S,    S,    S}},
+    {"LM_EV_ENCRYPTION_CHANGE", LM_EV_ENCRYPTION_CHANGE,
+        payloadEncryptionChange,
+        {P,    P,    P,    S,    P,    P}},
+    {"SM_DIV_APPROVE_IND", SM_DIV_APPROVE_IND, payloadDivApproveInd,
+        {P,    P,    P,    S,    P,    P}},
+    {"LS_CONNECTION_PARAM_UPDATE_CFM", LS_CONNECTION_PARAM_UPDATE_CFM,
+        payloadParamUpdateCfm,
+        {P,    P,    P,    S,    P,    P}},
+    {"LM_EV_CONNECTION_UPDATE", LM_EV_CONNECTION_UPDATE,
+        payloadConnectionUpdate,
+        {P,    P,    P,    S,    S,    P}},
+    {"LS_CONNECTION_PARAM_UPDATE_IND", LS_CONNECTION_PARAM_UPDATE_IND,
+        payloadParamUpdateInd,
+        {P,    P,    P,    S,    P,    P}},
+    {"GATT_ACCESS_IND", GATT_ACCESS_IND, payloadAccessInd,
+        {P,    P,    P,    S,    P,    P}},
+    {"LM_EV_DISCONNECT_COMPLETE timeout", LM_EV_DISCONNECT_COMPLETE,
+        payloadLinkLoss,
+        {P,    P,    P,    FAST, FAST, P}},
+    {"LM_EV_DISCONNECT_COMPLETE local", LM_EV_DISCONNECT_COMPLETE,
+        payloadLocalHost,
+        {P,    P,    P,    FAST, IDLE, P}},
+    {"LM_EV_DISCONNECT_COMPLETE remote", LM_EV_DISCONNECT_COMPLETE,
+        payloadRemoteUser,
+        {P,    P,    P,    IDLE, IDLE, P}},
+    /* Ignored by the switch, now dispatched in app_state_connected */
+    {"GATT_CHAR_VAL_NOT_CFM", GATT_CHAR_VAL_NOT_CFM, payloadCharValNotCfm,
+        {S,    S,    S,    S,    S,    S}},
+    /* Not handled by the application */
+    {"GATT_DISCONNECT_IND", GATT_DISCONNECT_IND, payloadGattDisconnect,
+        {S,    S,    S,    S,    S,    S}},
+    {"GATT_DISCONNECT_CFM", GATT_DISCONNECT_CFM, payloadGattDisconnect,
+        {S,    S,    S,    S,    S,    S}},
+};
+
+#define FSM_CASES   (sizeof(g_fsm_cases) / sizeof(g_fsm_cases[0]))
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      payload*
+ *
+ *  DESCRIPTION
+ *      These functions fill in the payload of an event the way the peer
+ *      device of the emulation would send it. The event is zeroed first.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void payloadAddDbCfm(LM_EVENT_T *p_event)
+{
+    p_event->add_db_cfm.result = sys_status_success;
+}
+
+static void payloadCancelConnectCfm(LM_EVENT_T *p_event)
+{
+    p_event->cancel_connect_cfm.result = sys_status_success;
+}
+
+static void payloadConnectionComplete(LM_EVENT_T *p_event)
+{
+    p_event->connection_complete.data.conn_interval = 24;
+    p_event->connection_complete.data.supervision_timeout = 200;
+}
+
+static void payloadConnectCfm(LM_EVENT_T *p_event)
+{
+    p_event->connect_cfm.cid = EMU_CID;
+    p_event->connect_cfm.result = sys_status_success;
+    CSReadBdaddr(&p_event->connect_cfm.bd_addr.addr);
+}
+
+static void payloadConnectCfmFailed(LM_EVENT_T *p_event)
+{
+    p_event->connect_cfm.result = sys_status_failed;
+}
+
+static void payloadKeysInd(LM_EVENT_T *p_event)
+{
+    g_fsm_keys.keys_present = (1 << SM_KEY_TYPE_DIV);
+    g_fsm_keys.div = 0x1234;
+    p_event->keys_ind.keys = &g_fsm_keys;
+}
+
+static void payloadPairingAuthInd(LM_EVENT_T *p_event)
+{
+    p_event->pairing_auth_ind.bonding = TRUE;
+}
+
+static void payloadPairingCompleteInd(LM_EVENT_T *p_event)
+{
+    p_event->pairing_complete_ind.status = sys_status_success;
+}
+
+static void payloadEncryptionChange(LM_EVENT_T *p_event)
+{
+    p_event->enc_change.data.status = sys_status_success;
+    p_event->enc_change.data.enc_enable = TRUE;
+}
+
+static void payloadDivApproveInd(LM_EVENT_T *p_event)
+{
+    p_event->div_approve_ind.cid = EMU_CID;
+    p_event->div_approve_ind.div = 0x1234;
+}
+
+static void payloadParamUpdateCfm(LM_EVENT_T *p_event)
+{
+    p_event->param_update_cfm.status = ls_err_none;
+}
+
+static void payloadConnectionUpdate(LM_EVENT_T *p_event)
+{
+    p_event->connection_update.data.conn_interval = 72;
+    p_event->connection_update.data.conn_latency = 4;
+    p_event->connection_update.data.supervision_timeout = 600;
+}
+
+static void payloadParamUpdateInd(LM_EVENT_T *p_event)
+{
+    p_event->param_update_ind.conn_interval = 72;
+    p_event->param_update_ind.conn_latency = 4;
+    p_event->param_update_ind.supervision_timeout = 600;
+}
+
+static void payloadAccessInd(LM_EVENT_T *p_event)
+{
+    p_event->access_ind.cid = EMU_CID;
+    p_event->access_ind.handle = HANDLE_HT_TEMP_MEAS_C_CFG;
+    p_event->access_ind.flags = ATT_ACCESS_WRITE | ATT_ACCESS_PERMISSION |
+                                ATT_ACCESS_WRITE_COMPLETE;
+    p_event->access_ind.size_value = 2;
+    p_event->access_ind.value = g_fsm_cccd_value;
+}
+
+static void payloadLinkLoss(LM_EVENT_T *p_event)
+{
+    p_event->disconnect_complete.data.reason = HCI_ERROR_CONN_TIMEOUT;
+}
+
+static void payloadLocalHost(LM_EVENT_T *p_event)
+{
+    p_event->disconnect_complete.data.reason = HCI_ERROR_CONN_TERM_LOCAL_HOST;
+}
+
+static void payloadRemoteUser(LM_EVENT_T *p_event)
+{
+    p_event->disconnect_complete.data.reason = HCI_ERROR_OETC_USER;
+}
+
+static void payloadCharValNotCfm(LM_EVENT_T *p_event)
+{
+    p_event->char_val_cfm.result = sys_status_success;
+    p_event->char_val_cfm.cid = EMU_CID;
+    p_event->char_val_cfm.handle = HANDLE_HT_TEMP_MEASUREMENT;
+}
+
+static void payloadGattDisconnect(LM_EVENT_T *p_event)
+{
+    p_event->disconnect_ind.cid = EMU_CID;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      fsmCounter
+ *
+ *  DESCRIPTION
+ *      This function reads the counter the dispatch cost is measured with.
+ *
+ *  RETURNS
+ *      Time stamp counter ticks, or nanoseconds without a TSC.
+ *
+ *---------------------------------------------------------------------------*/
+
+static uint64_t fsmCounter(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      fsmTouchData
+ *
+ *  DESCRIPTION
+ *      This function writes every page of the data and bss of the process,
+ *      so that the copy on write faults after fork() are not counted in the
+ *      dispatch being measured.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void fsmTouchData(void)
+{
+    /* Bounds of the data and bss, from the GNU linker */
+    extern char __data_start[], end[];
+    volatile char *p_byte;
+    long page = sysconf(_SC_PAGESIZE);
+
+    for(p_byte = __data_start; p_byte < end; p_byte += page)
+    {
+        *p_byte = *p_byte;
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      fsmReach
+ *
+ *  DESCRIPTION
+ *      This function boots the application and drives it into 'state'. The
+ *      advertising states and idle are reached with the peer out of range,
+ *      the connected state once the peer has bonded and subscribed, and the
+ *      disconnecting state from there.
+ *
+ *  RETURNS
+ *      TRUE if the application is in 'state'.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool fsmReach(app_state state)
+{
+    EMU_CONFIG_T config;
+    app_state target = (state == app_state_disconnecting) ?
+                       app_state_connected : state;
+
+    EmuDefaultConfig(&config);
+    config.peer.present = (target == app_state_connected);
+    EmuBoot(&config);
+
+    /* GATT_ADD_DB_CFM is still queued */
+    if(state == app_state_init)
+    {
+        return (g_ht_data.state == app_state_init);
+    }
+
+    while(g_ht_data.state != target && EmuNow() < FSM_REACH_LIMIT)
+    {
+        EmuRunFor(FSM_REACH_STEP);
+    }
+
+    if(target == app_state_connected)
+    {
+        /* Let the peer pair and subscribe */
+        EmuRunFor(2 * SECOND);
+
+        if(!AppIsDeviceBonded())
+        {
+            return FALSE;
+        }
+    }
+
+    if(state == app_state_disconnecting && g_ht_data.state == target)
+    {
+        /* Its LM_EV_DISCONNECT_COMPLETE stays queued */
+        AppSetState(app_state_disconnecting);
+    }
+
+    return (g_ht_data.state == state);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      fsmDispatch
+ *
+ *  DESCRIPTION
+ *      This function delivers the event of 'p_case' to the application and
+ *      writes the outcome and the cost of the dispatch to 'fd'. It runs in
+ *      a process of its own and ends it.
+ *
+ *  RETURNS
+ *      Does not return.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void fsmDispatch(const FSM_CASE_T *p_case, int fd)
+{
+    FSM_RESULT_T result;
+    LM_EVENT_T event;
+    app_state before = g_ht_data.state;
+
+    memset(&result, 0, sizeof(result));
+    memset(&event, 0, sizeof(event));
+    p_case->payload(&event);
+
+    fsmTouchData();
+
+    if(EMU_CATCH_PANIC())
+    {
+        result.cost = fsmCounter() - g_fsm_start;
+        result.outcome = FSM_PANIC;
+        result.panic_code = g_emu_panic_code;
+    }
+    else
+    {
+        g_fsm_start = fsmCounter();
+        AppProcessLmEvent(p_case->code, &event);
+        result.cost = fsmCounter() - g_fsm_start;
+        g_emu_panic_armed = FALSE;
+
+        result.outcome = (g_ht_data.state == before) ?
+                         FSM_SAME : (int)g_ht_data.state;
+    }
+
+    if(write(fd, &result, sizeof(result)) != sizeof(result))
+    {
+        _exit(1);
+    }
+
+    _exit(0);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      fsmMeasure
+ *
+ *  DESCRIPTION
+ *      This function reaches 'state' and measures each event in it 'runs'
+ *      times, writing the results to 'fd' in order. It runs in a process of
+ *      its own.
+ *
+ *  RETURNS
+ *      FALSE if the state could not be reached or a dispatch failed.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool fsmMeasure(app_state state, uint16 runs, int fd)
+{
+    uint16 index;
+    uint16 run;
+    pid_t pid;
+    int status;
+
+    if(!fsmReach(state))
+    {
+        fprintf(stderr, "fsm_bench: can't reach %s\n",
+                g_fsm_state_names[state]);
+        return FALSE;
+    }
+
+    for(index = 0; index < FSM_CASES; index++)
+    {
+        for(run = 0; run < runs; run++)
+        {
+            fflush(NULL);
+            pid = fork();
+            if(pid == 0)
+            {
+                fsmDispatch(&g_fsm_cases[index], fd);
+            }
+
+            if(pid < 0 || waitpid(pid, &status, 0) != pid ||
+               !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            {
+                fprintf(stderr, "fsm_bench: %s in %s did not complete\n",
+                        g_fsm_cases[index].name, g_fsm_state_names[state]);
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      fsmCompareCost
+ *
+ *  DESCRIPTION
+ *      This function orders two dispatch costs for qsort().
+ *
+ *  RETURNS
+ *      Negative, zero or positive as 'a' is cheaper, as costly or dearer.
+ *
+ *---------------------------------------------------------------------------*/
+
+static int fsmCompareCost(const void *a, const void *b)
+{
+    uint64_t cost_a = *(const uint64_t *)a;
+    uint64_t cost_b = *(const uint64_t *)b;
+
+    return (cost_a > cost_b) - (cost_a < cost_b);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    uint64_t costs[FSM_MAX_RUNS];
+    FSM_RESULT_T result;
+    bool quiet = FALSE;
+    uint16 runs = FSM_DEFAULT_RUNS;
+    uint32 mismatches = 0;
+    uint32 pairs = 0;
+    char got[40], expected[40];
+    app_state state;
+    uint16 index;
+    uint16 run;
+    int fds[2];
+    int arg;
+    int outcome;
+    int status;
+    pid_t pid;
+
+    for(arg = 1; arg < argc; arg++)
+    {
+        if(strcmp(argv[arg], "-q") == 0)
+        {
+            quiet = TRUE;
+        }
+        else if(strcmp(argv[arg], "-runs") == 0 && arg + 1 < argc &&
+                atoi(argv[arg + 1]) > 0 && atoi(argv[arg + 1]) <= FSM_MAX_RUNS)
+        {
+            runs = (uint16)atoi(argv[++arg]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: fsm_bench [-q] [-runs <1..%u>]\n",
+                    FSM_MAX_RUNS);
+            return 1;
+        }
+    }
+
+    if(!quiet)
+    {
+        printf("%-17s %-34s %-17s %-17s %8s %8s\n", "state", "event",
+               "expected", "got", "min", "median");
+    }
+
+    for(state = app_state_init; state < app_state_max; state++)
+    {
+        if(pipe(fds) != 0)
+        {
+            perror("fsm_bench");
+            return 1;
+        }
+
+        fflush(NULL);
+        pid = fork();
+        if(pid == 0)
+        {
+            close(fds[0]);
+            _exit(fsmMeasure(state, runs, fds[1]) ? 0 : 1);
+        }
+        close(fds[1]);
+
+        for(index = 0; index < FSM_CASES; index++)
+        {
+            outcome = FSM_SAME;
+
+            for(run = 0; run < runs; run++)
+            {
+                if(read(fds[0], &result, sizeof(result)) != sizeof(result))
+                {
+                    close(fds[0]);
+                    waitpid(pid, &status, 0);
+                    return 1;
+                }
+
+                /* Every run starts from the same data, so they agree */
+                outcome = result.outcome;
+                costs[run] = result.cost;
+            }
+
+            qsort(costs, runs, sizeof(costs[0]), fsmCompareCost);
+
+            if(outcome == FSM_PANIC)
+            {
+                snprintf(got, sizeof(got), "panic %u", result.panic_code);
+            }
+            else
+            {
+                snprintf(got, sizeof(got), "%s", outcome == FSM_SAME ?
+                         "-" : g_fsm_state_names[outcome]);
+            }
+
+            outcome = g_fsm_cases[index].expected[state];
+            if(outcome == FSM_PANIC)
+            {
+                snprintf(expected, sizeof(expected), "panic %u",
+                         app_panic_invalid_state);
+            }
+            else
+            {
+                snprintf(expected, sizeof(expected), "%s",
+                         outcome == FSM_SAME ?
+                         "-" : g_fsm_state_names[outcome]);
+            }
+
+            pairs++;
+            if(strcmp(got, expected) != 0)
+            {
+                mismatches++;
+            }
+
+            if(!quiet || strcmp(got, expected) != 0)
+            {
+                printf("%-17s %-34s %-17s %-17s %8llu %8llu%s\n",
+                       g_fsm_state_names[state], g_fsm_cases[index].name,
+                       expected, got, (unsigned long long)costs[0],
+                       (unsigned long long)costs[runs / 2],
+                       strcmp(got, expected) != 0 ? "  MISMATCH" : "");
+            }
+        }
+
+        close(fds[0]);
+        if(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+           WEXITSTATUS(status) != 0)
+        {
+            return 1;
+        }
+    }
+
+    printf("%u pairs, %u differ from the switch dispatcher, costs in %s "
+           "over %u runs\n", pairs, mismatches,
+#if defined(__x86_64__) || defined(__i386__)
+           "TSC ticks",
+#else
+           "ns",
+#endif
+           runs);
+
+    return (mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+#
+#  Copyright Cambridge Silicon Radio Limited 2012-2014
+#  Part of CSR uEnergy SDK 2.3.0
+#  Application version 2.3.0.0
+#
+#  FILE
+#      gattdbgen.py
+#
+#  DESCRIPTION
+#      Host build stand-in for the SDK gattdbgen tool. It runs the C
+#      preprocessor over app_gatt_db.db and writes app_gatt_db.h with the
+#      HANDLE_ and ATTR_LEN_ macros, numbering the handles the way gattdbgen
+#      does, and app_gatt_db.c with a GattGetDatabase() returning an empty
+#      database (the host GATT emulation does not serve attributes itself).
+#
+#      Usage: gattdbgen.py <app_gatt_db.db> <output dir> [cpp flags...]
+#
+
+import os
+import re
+import subprocess
+import sys
+
+TOKEN = re.compile(r'\s*(?:("(?:[^"\\]|\\.)*")|([{}\[\]:,])|([^\s{}\[\]:,"]+))')
+
+
+def tokenise(text):
+    tokens = []
+    pos = 0
+    text = text.rstrip()
+    while pos < len(text):
+        match = TOKEN.match(text, pos)
+        if match is None:
+            raise SystemExit('gattdbgen: cannot parse near %r' % text[pos:pos + 40])
+        tokens.append(match.group(1) or match.group(2) or match.group(3))
+        pos = match.end()
+    return tokens
+
+
+def parse_body(tokens, pos, closing):
+    """Parse 'key : value' and 'keyword { ... }' entries up to 'closing'."""
+    entries = []
+    while pos < len(tokens) and tokens[pos] != closing:
+        if tokens[pos] == ',':
+            pos += 1
+            continue
+        key = tokens[pos]
+        pos += 1
+        if tokens[pos] == '{':
+            block, pos = parse_body(tokens, pos + 1, '}')
+            entries.append((key, block))
+            pos += 1
+        elif tokens[pos] == ':':
+            pos += 1
+            if tokens[pos] == '[':
+                values = []
+                pos += 1
+                while tokens[pos] != ']':
+                    if tokens[pos] != ',':
+                        values.append(tokens[pos])
+                    pos += 1
+                entries.append((key, values))
+            else:
+                entries.append((key, tokens[pos]))
+            pos += 1
+        else:
+            raise SystemExit('gattdbgen: unexpected %r after %r' % (tokens[pos], key))
+    return entries, pos
+
+
+def value_length(value):
+    """Length in octets of an attribute value, as gattdbgen counts it."""
+    if isinstance(value, list):
+        return sum(value_length(item) for item in value)
+    if value.startswith('"'):
+        return len(value) - 2
+    if value.lower().startswith('0x'):
+        return max(1, (len(value) - 2 + 1) // 2)
+    number = int(value, 0)
+    return 1 if number < 0x100 else 2
+
+
+def field(block, key, default=None):
+    for name, value in block:
+        if name == key:
+            return value
+    return default
+
+
+def generate(entries):
+    """Return (name, handle, length) for every named attribute, a None
+    handle or length leaving out that macro."""
+    attrs = []
+    handle = 0
+    services = [block for key, block in entries
+                if key in ('primary_service', 'secondary_service')]
+    for index, service in enumerate(services):
+        handle += 1
+        name = field(service, 'name').strip('"')
+        uuid = field(service, 'uuid')
+        attrs.append((name, handle, None))
+        service_entry = len(attrs)
+        for key, block in service:
+            if key == 'include':
+                handle += 1
+            if key != 'characteristic':
+                continue
+            handle += 2
+            size = field(block, 'size_value')
+            value = field(block, 'value', '0x00')
+            attrs.append((field(block, 'name').strip('"'), handle,
+                          int(size, 0) if size else value_length(value)))
+            for sub_key, sub_block in block:
+                if sub_key in ('client_config', 'server_config', 'descriptor'):
+                    handle += 1
+                    sub_name = field(sub_block, 'name')
+                    if sub_name:
+                        sub_value = field(sub_block, 'value')
+                        attrs.append((sub_name.strip('"'), handle,
+                                      value_length(sub_value) if sub_value
+                                      else 0))
+        end = handle if index < len(services) - 1 else 0xffff
+        attrs[service_entry:service_entry] = [
+            (name + '_END', end, None),
+            (name, None, 2 if len(uuid) <= 6 else 16)]
+    return attrs
+
+
+def main():
+    if len(sys.argv) < 3:
+        raise SystemExit('usage: gattdbgen.py <db> <output dir> [cpp flags...]')
+    db, out_dir, cpp_flags = sys.argv[1], sys.argv[2], sys.argv[3:]
+    text = subprocess.check_output(['gcc', '-E', '-P', '-x', 'c'] +
+                                   cpp_flags + [db], universal_newlines=True)
+    entries, _ = parse_body(tokenise(text), 0, None)
+    attrs = generate(entries)
+
+    lines = ['/*',
+             ' * THIS FILE IS AUTOGENERATED, DO NOT EDIT!',
+             ' *',
+             ' * generated by host/gattdbgen.py from %s' % os.path.basename(db),
+             ' */',
+             '#ifndef __APP_GATT_DB_H',
+             '#define __APP_GATT_DB_H',
+             '',
+             '#include <main.h>',
+             '']
+    for name, handle, length in attrs:
+        if handle is not None:
+            lines.append('#define %-31s (0x%04x)' % ('HANDLE_' + name,
+                                                    handle))
+        if length is not None:
+            lines.append('#define %-31s (%d)' % ('ATTR_LEN_' + name, length))
+    lines += ['',
+              'extern uint16 *GattGetDatabase(uint16 *len);',
+              '',
+              '#endif /* __APP_GATT_DB_H */',
+              '']
+    with open(os.path.join(out_dir, 'app_gatt_db.h'), 'w') as header:
+        header.write('\n'.join(lines))
+
+    with open(os.path.join(out_dir, 'app_gatt_db.c'), 'w') as source:
+        source.write('\n'.join([
+            '/* THIS FILE IS AUTOGENERATED, DO NOT EDIT! */',
+            '#include "app_gatt_db.h"',
+            '',
+            'static uint16 gattDatabase[1];',
+            '',
+            'extern uint16 *GattGetDatabase(uint16 *len)',
+            '{',
+            '    *len = 0;',
+            '    return gattDatabase;',
+            '}',
+            '']))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,25 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      aio.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __AIO_H__
+#define __AIO_H__
+
+#include <types.h>
+
+typedef enum { aio0, aio1, aio2 } aio_select;
+
+/* Voltage in mV */
+extern uint16 AioRead(aio_select aio);
+
+#endif /* __AIO_H__ */
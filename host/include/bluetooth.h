@@ -0,0 +1,52 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      bluetooth.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __BLUETOOTH_H__
+#define __BLUETOOTH_H__
+
+#include <types.h>
+
+/* The SDK structures are laid out with the word alignment of the XAP */
+#pragma pack(push, 2)
+
+/* Bluetooth device address */
+typedef struct
+{
+    uint32                          lap;
+    uint8                           uap;
+    uint16                          nap;
+
+} BD_ADDR_T;
+
+/* Bluetooth device address with its type */
+typedef struct
+{
+    uint16                          type;
+    BD_ADDR_T                       addr;
+
+} TYPED_BD_ADDR_T;
+
+#pragma pack(pop)
+
+/* Address types */
+#define L2CA_PUBLIC_ADDR_TYPE               (0x00)
+#define L2CA_RANDOM_ADDR_TYPE               (0x01)
+
+/* Sub-type of a random address, held in the top bits of the NAP */
+#define BD_ADDR_NAP_RANDOM_TYPE_MASK        (0xc000)
+#define BD_ADDR_NAP_RANDOM_TYPE_NONRESOLV   (0x0000)
+#define BD_ADDR_NAP_RANDOM_TYPE_RESOLVABLE  (0x4000)
+#define BD_ADDR_NAP_RANDOM_TYPE_STATIC      (0xc000)
+
+#endif /* __BLUETOOTH_H__ */
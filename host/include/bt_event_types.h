@@ -0,0 +1,270 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      bt_event_types.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __BT_EVENT_TYPES_H__
+#define __BT_EVENT_TYPES_H__
+
+#include <types.h>
+#include <status.h>
+#include <bluetooth.h>
+#include <ls_err.h>
+
+/* LM event codes delivered to AppProcessLmEvent() */
+typedef enum
+{
+    LM_EV_DISCONNECT_COMPLETE = 0x0100,
+    LM_EV_ENCRYPTION_CHANGE,
+    LM_EV_NUMBER_COMPLETED_PACKETS,
+    LM_EV_CONNECTION_COMPLETE,
+    LM_EV_CONNECTION_UPDATE,
+
+    GATT_ADD_DB_CFM = 0x0200,
+    GATT_CONNECT_CFM,
+    GATT_CANCEL_CONNECT_CFM,
+    GATT_DISCONNECT_IND,
+    GATT_DISCONNECT_CFM,
+    GATT_ACCESS_IND,
+    GATT_CHAR_VAL_NOT_CFM,
+    GATT_CHAR_VAL_IND_CFM,
+
+    SM_KEYS_IND = 0x0300,
+    SM_PAIRING_AUTH_IND,
+    SM_SIMPLE_PAIRING_COMPLETE_IND,
+    SM_DIV_APPROVE_IND,
+
+    LS_CONNECTION_PARAM_UPDATE_CFM = 0x0400,
+    LS_CONNECTION_PARAM_UPDATE_IND,
+    LS_RADIO_EVENT_IND
+
+} lm_event_code;
+
+/* HCI error codes, as disconnection reasons */
+#define HCI_ERROR_AUTH_FAIL                 (0x05)
+#define HCI_ERROR_CONN_TIMEOUT              (0x08)
+#define HCI_ERROR_OETC_USER                 (0x13)
+#define HCI_ERROR_OETC_LOW_RESOURCE         (0x14)
+#define HCI_ERROR_OETC_POWERING_OFF         (0x15)
+#define HCI_ERROR_CONN_TERM_LOCAL_HOST      (0x16)
+#define HCI_ERROR_UNSPECIFIED               (0x1f)
+#define HCI_ERROR_LMP_RESPONSE_TIMEOUT      (0x22)
+#define HCI_ERROR_INSTANT_PASSED            (0x28)
+#define HCI_ERROR_CONN_FAIL_TO_BE_ESTABLISHED (0x3e)
+
+/* Key types of SM_KEYSET_T.keys_present */
+#define SM_KEY_TYPE_NONE                    (0)
+#define SM_KEY_TYPE_ENC_CENTRAL             (1)
+#define SM_KEY_TYPE_DIV                     (2)
+#define SM_KEY_TYPE_SIGN                    (3)
+#define SM_KEY_TYPE_ID                      (4)
+
+/* The SDK structures are laid out with the word alignment of the XAP */
+#pragma pack(push, 2)
+
+/* Keys distributed during pairing */
+typedef struct
+{
+    uint16                          keys_present;
+    uint16                          encryption_key_size;
+    uint16                          div;
+    uint16                          irk[8];
+
+} SM_KEYSET_T;
+
+typedef struct
+{
+    sys_status                      status;
+    uint16                          handle;
+    uint16                          reason;
+
+} HCI_EV_DATA_DISCONNECT_COMPLETE_T;
+
+typedef struct
+{
+    sys_status                      status;
+    uint16                          handle;
+    bool                            enc_enable;
+
+} HCI_EV_DATA_ENCRYPTION_CHANGE_T;
+
+typedef struct
+{
+    sys_status                      status;
+    uint16                          connection_handle;
+    uint16                          role;
+    TYPED_BD_ADDR_T                 peer_address;
+    uint16                          conn_interval;
+    uint16                          conn_latency;
+    uint16                          supervision_timeout;
+    uint16                          clock_accuracy;
+
+} HCI_EV_DATA_ULP_CONNECTION_COMPLETE_T;
+
+typedef struct
+{
+    sys_status                      status;
+    uint16                          connection_handle;
+    uint16                          conn_interval;
+    uint16                          conn_latency;
+    uint16                          supervision_timeout;
+
+} HCI_EV_DATA_ULP_CONNECTION_UPDATE_COMPLETE_T;
+
+typedef struct
+{
+    HCI_EV_DATA_DISCONNECT_COMPLETE_T data;
+
+} LM_EV_DISCONNECT_COMPLETE_T;
+
+typedef struct
+{
+    HCI_EV_DATA_ENCRYPTION_CHANGE_T data;
+
+} LM_EV_ENCRYPTION_CHANGE_T;
+
+typedef struct
+{
+    HCI_EV_DATA_ULP_CONNECTION_COMPLETE_T data;
+
+} LM_EV_CONNECTION_COMPLETE_T;
+
+typedef struct
+{
+    HCI_EV_DATA_ULP_CONNECTION_UPDATE_COMPLETE_T data;
+
+} LM_EV_CONNECTION_UPDATE_T;
+
+typedef struct
+{
+    sys_status                      result;
+
+} GATT_ADD_DB_CFM_T;
+
+typedef struct
+{
+    TYPED_BD_ADDR_T                 bd_addr;
+    uint16                          cid;
+    sys_status                      result;
+
+} GATT_CONNECT_CFM_T;
+
+typedef struct
+{
+    sys_status                      result;
+
+} GATT_CANCEL_CONNECT_CFM_T;
+
+typedef struct
+{
+    uint16                          cid;
+    sys_status                      reason;
+
+} GATT_DISCONNECT_IND_T;
+
+typedef struct
+{
+    uint16                          cid;
+    sys_status                      result;
+
+} GATT_DISCONNECT_CFM_T;
+
+typedef struct
+{
+    uint16                          cid;
+    uint16                          handle;
+    uint16                          flags;
+    uint16                          offset;
+    uint16                          size_value;
+    uint8                           *value;
+
+} GATT_ACCESS_IND_T;
+
+typedef struct
+{
+    sys_status                      result;
+    uint16                          cid;
+    uint16                          handle;
+
+} GATT_CHAR_VAL_IND_CFM_T;
+
+typedef struct
+{
+    TYPED_BD_ADDR_T                 remote_addr;
+    SM_KEYSET_T                     *keys;
+
+} SM_KEYS_IND_T;
+
+typedef struct
+{
+    void                            *data;
+    uint16                          bonding;
+
+} SM_PAIRING_AUTH_IND_T;
+
+typedef struct
+{
+    TYPED_BD_ADDR_T                 bd_addr;
+    sys_status                      status;
+    uint16                          security_level;
+
+} SM_SIMPLE_PAIRING_COMPLETE_IND_T;
+
+typedef struct
+{
+    uint16                          cid;
+    uint16                          div;
+
+} SM_DIV_APPROVE_IND_T;
+
+typedef struct
+{
+    TYPED_BD_ADDR_T                 address;
+    ls_err                          status;
+
+} LS_CONNECTION_PARAM_UPDATE_CFM_T;
+
+typedef struct
+{
+    TYPED_BD_ADDR_T                 address;
+    uint16                          conn_interval;
+    uint16                          conn_latency;
+    uint16                          supervision_timeout;
+
+} LS_CONNECTION_PARAM_UPDATE_IND_T;
+
+/* Any LM event */
+typedef union
+{
+    LM_EV_DISCONNECT_COMPLETE_T         disconnect_complete;
+    LM_EV_ENCRYPTION_CHANGE_T           enc_change;
+    LM_EV_CONNECTION_COMPLETE_T         connection_complete;
+    LM_EV_CONNECTION_UPDATE_T           connection_update;
+    GATT_ADD_DB_CFM_T                   add_db_cfm;
+    GATT_CONNECT_CFM_T                  connect_cfm;
+    GATT_CANCEL_CONNECT_CFM_T           cancel_connect_cfm;
+    GATT_DISCONNECT_IND_T               disconnect_ind;
+    GATT_DISCONNECT_CFM_T               disconnect_cfm;
+    GATT_ACCESS_IND_T                   access_ind;
+    GATT_CHAR_VAL_IND_CFM_T             char_val_cfm;
+    SM_KEYS_IND_T                       keys_ind;
+    SM_PAIRING_AUTH_IND_T               pairing_auth_ind;
+    SM_SIMPLE_PAIRING_COMPLETE_IND_T    pairing_complete_ind;
+    SM_DIV_APPROVE_IND_T                div_approve_ind;
+    LS_CONNECTION_PARAM_UPDATE_CFM_T    param_update_cfm;
+    LS_CONNECTION_PARAM_UPDATE_IND_T    param_update_ind;
+
+} LM_EVENT_T;
+
+#pragma pack(pop)
+
+#endif /* __BT_EVENT_TYPES_H__ */
@@ -0,0 +1,26 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      buf_utils.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __BUF_UTILS_H__
+#define __BUF_UTILS_H__
+
+#include <types.h>
+
+/* Little-endian octet buffer access, one octet per uint8 word */
+extern uint8 BufReadUint8(uint8 **p_buf);
+extern uint16 BufReadUint16(uint8 **p_buf);
+extern void BufWriteUint8(uint8 **p_buf, uint8 value);
+extern void BufWriteUint16(uint8 **p_buf, uint16 value);
+
+#endif /* __BUF_UTILS_H__ */
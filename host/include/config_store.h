@@ -0,0 +1,24 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      config_store.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __CONFIG_STORE_H__
+#define __CONFIG_STORE_H__
+
+#include <types.h>
+#include <bluetooth.h>
+
+/* Read the Bluetooth address from the CS keys */
+extern bool CSReadBdaddr(BD_ADDR_T *p_addr);
+
+#endif /* __CONFIG_STORE_H__ */
@@ -0,0 +1,30 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      gap_app_if.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __GAP_APP_IF_H__
+#define __GAP_APP_IF_H__
+
+#include <types.h>
+#include <ls_err.h>
+#include <gap_types.h>
+
+extern ls_err GapSetMode(gap_role role, gap_mode_discover discover,
+                         gap_mode_connect connect, gap_mode_bond bond,
+                         gap_mode_security security);
+
+/* Advertising interval in microseconds */
+extern ls_err GapSetAdvInterval(uint32 adv_interval_min,
+                                uint32 adv_interval_max);
+
+#endif /* __GAP_APP_IF_H__ */
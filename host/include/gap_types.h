@@ -0,0 +1,52 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      gap_types.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __GAP_TYPES_H__
+#define __GAP_TYPES_H__
+
+#include <types.h>
+
+/* Advertising data types */
+#define AD_TYPE_SERVICE_UUID_16BIT_LIST     (0x03)
+#define AD_TYPE_LOCAL_NAME_SHORT            (0x08)
+#define AD_TYPE_LOCAL_NAME_COMPLETE         (0x09)
+#define AD_TYPE_TX_POWER                    (0x0a)
+#define AD_TYPE_APPEARANCE                  (0x19)
+
+typedef enum { gap_role_peripheral } gap_role;
+
+typedef enum
+{
+    gap_mode_discover_no,
+    gap_mode_discover_general
+
+} gap_mode_discover;
+
+typedef enum
+{
+    gap_mode_connect_no,
+    gap_mode_connect_undirected
+
+} gap_mode_connect;
+
+typedef enum { gap_mode_bond_no, gap_mode_bond_yes } gap_mode_bond;
+
+typedef enum
+{
+    gap_mode_security_none,
+    gap_mode_security_unauthenticate
+
+} gap_mode_security;
+
+#endif /* __GAP_TYPES_H__ */
@@ -0,0 +1,50 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      gatt.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __GATT_H__
+#define __GATT_H__
+
+#include <types.h>
+#include <status.h>
+#include <bluetooth.h>
+#include <gatt_prim.h>
+#include <gap_types.h>
+
+/* Initialise the GATT layer */
+extern void GattInit(void);
+
+/* Install the write support of the GATT server */
+extern void GattInstallServerWrite(void);
+
+/* Register the GATT database; GATT_ADD_DB_CFM follows */
+extern void GattAddDatabaseReq(uint16 size, uint16 *p_db);
+
+/* Start advertising for a connection; GATT_CONNECT_CFM follows */
+extern void GattConnectReq(TYPED_BD_ADDR_T *p_addr, uint16 flags);
+
+/* Stop advertising; GATT_CANCEL_CONNECT_CFM follows */
+extern void GattCancelConnectReq(void);
+
+/* Disconnect the link; LM_EV_DISCONNECT_COMPLETE follows */
+extern void GattDisconnectReq(uint16 cid);
+
+/* Answer a GATT_ACCESS_IND */
+extern void GattAccessRsp(uint16 cid, uint16 handle, sys_status result,
+                          uint16 size_value, uint8 *value);
+
+/* Send a notification; GATT_CHAR_VAL_NOT_CFM follows */
+extern sys_status GattCharValueNotification(uint16 cid, uint16 handle,
+                                            uint16 size, uint8 *value);
+
+#endif /* __GATT_H__ */
@@ -0,0 +1,34 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      gatt_prim.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __GATT_PRIM_H__
+#define __GATT_PRIM_H__
+
+#include <types.h>
+#include <status.h>
+
+/* Flags of GATT_ACCESS_IND_T */
+#define ATT_ACCESS_READ                     (0x0001)
+#define ATT_ACCESS_WRITE                    (0x0002)
+#define ATT_ACCESS_WRITE_CMD                (0x0800)
+#define ATT_ACCESS_WRITE_COMPLETE           (0x4000)
+#define ATT_ACCESS_PERMISSION               (0x8000)
+
+/* Attribute flag asking for GATT_ACCESS_IND on access */
+#define ATT_ATTR_IRQ                        (0x0008)
+
+/* Default ATT MTU */
+#define ATT_MTU                             (23)
+
+#endif /* __GATT_PRIM_H__ */
@@ -0,0 +1,59 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      ls_app_if.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __LS_APP_IF_H__
+#define __LS_APP_IF_H__
+
+#include <types.h>
+#include <bluetooth.h>
+#include <time.h>
+#include <ls_err.h>
+#include <gap_types.h>
+
+/* Flags of GattConnectReq() */
+#define L2CAP_CONNECTION_SLAVE_UNDIRECTED   (0x0001)
+#define L2CAP_CONNECTION_SLAVE_WHITELIST    (0x0002)
+#define L2CAP_OWN_ADDR_TYPE_PUBLIC          (0x0000)
+
+/* L2CAP signalling codes */
+#define L2CAP_CONNECTION_PARAMETER_UPDATE_REQUEST (0x12)
+
+/* Advertising data destination */
+typedef enum
+{
+    ad_src_advertise,
+    ad_src_scan_rsp
+
+} ad_src;
+
+/* Connection parameters asked for with LsConnectionParamUpdateReq() */
+typedef struct
+{
+    uint16                          con_max_interval;
+    uint16                          con_min_interval;
+    uint16                          con_slave_latency;
+    uint16                          con_super_timeout;
+
+} ble_con_params;
+
+extern ls_err LsStoreAdvScanData(uint16 len, uint8 *data, ad_src src);
+extern ls_err LsConnectionParamUpdateReq(TYPED_BD_ADDR_T *p_addr,
+                                         ble_con_params *p_params);
+extern ls_err LsAddWhiteListDevice(TYPED_BD_ADDR_T *p_addr);
+extern ls_err LsResetWhiteList(void);
+extern ls_err LsReadTransmitPowerLevel(int8 *p_level);
+extern ls_err LsSetTransmitPowerLevel(int8 level);
+extern ls_err LsReadRssi(TYPED_BD_ADDR_T *p_addr, int8 *p_rssi);
+
+#endif /* __LS_APP_IF_H__ */
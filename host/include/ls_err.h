@@ -0,0 +1,28 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      ls_err.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __LS_ERR_H__
+#define __LS_ERR_H__
+
+/* Link supervisor error codes */
+typedef enum
+{
+    ls_err_none = 0,
+    ls_err_arg,
+    ls_err_state,
+    ls_err_busy
+
+} ls_err;
+
+#endif /* __LS_ERR_H__ */
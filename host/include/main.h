@@ -0,0 +1,39 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      main.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __MAIN_H__
+#define __MAIN_H__
+
+#include <types.h>
+#include <sleep.h>
+#include <pio.h>
+#include <bt_event_types.h>
+
+/* System events delivered to AppProcessSystemEvent() */
+typedef enum
+{
+    sys_event_battery_low,
+    sys_event_pio_changed,
+    sys_event_pio_ctrlr
+
+} sys_event_id;
+
+/* Application entry points called by the firmware */
+extern void AppPowerOnReset(void);
+extern void AppInit(sleep_state last_sleep_state);
+extern void AppProcessSystemEvent(sys_event_id id, void *data);
+extern bool AppProcessLmEvent(lm_event_code event_code,
+                              LM_EVENT_T *p_event_data);
+
+#endif /* __MAIN_H__ */
@@ -0,0 +1,25 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      mem.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __MEM_H__
+#define __MEM_H__
+
+#include <types.h>
+
+/* Lengths are in words, as sizeof() on the XAP */
+extern void MemCopy(void *dest, const void *src, uint16 length);
+extern void MemSet(void *dest, uint16 value, uint16 length);
+extern int16 MemCmp(const void *a, const void *b, uint16 length);
+
+#endif /* __MEM_H__ */
@@ -0,0 +1,35 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      nvm.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __NVM_H__
+#define __NVM_H__
+
+#include <types.h>
+#include <status.h>
+
+extern void NvmConfigureI2cEeprom(void);
+extern void NvmConfigureSpiFlash(void);
+extern void NvmDisable(void);
+
+/* Offsets and lengths are in words */
+extern sys_status NvmRead(uint16 *buffer, uint16 length, uint16 offset);
+extern sys_status NvmWrite(uint16 *buffer, uint16 length, uint16 offset);
+
+/* Erase the whole NVM store */
+extern sys_status NvmErase(bool erase_all);
+
+/* Erase the SPI flash block holding the given word of the NVM store */
+extern sys_status NvmEraseBlock(uint16 offset);
+
+#endif /* __NVM_H__ */
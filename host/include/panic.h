@@ -0,0 +1,23 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      panic.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __PANIC_H__
+#define __PANIC_H__
+
+#include <types.h>
+
+/* Does not return */
+extern void Panic(uint16 panic_code);
+
+#endif /* __PANIC_H__ */
@@ -0,0 +1,66 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      pio.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __PIO_H__
+#define __PIO_H__
+
+#include <types.h>
+
+/* Data of sys_event_pio_changed */
+typedef struct
+{
+    uint32                          pio_cause;
+    uint32                          pio_state;
+
+} pio_changed_data;
+
+typedef enum { pio_mode_user, pio_mode_pwm0 } pio_mode;
+
+typedef enum
+{
+    pio_mode_no_pulls,
+    pio_mode_weak_pull_up,
+    pio_mode_strong_pull_up,
+    pio_mode_weak_pull_down,
+    pio_mode_strong_pull_down
+
+} pio_pull_mode;
+
+typedef enum
+{
+    pio_event_mode_disable,
+    pio_event_mode_rising,
+    pio_event_mode_falling,
+    pio_event_mode_both
+
+} pio_event_mode;
+
+typedef enum { pio_pwm_mode_push_pull } pio_pwm_mode;
+
+typedef enum { pio_i2c_pull_mode_strong_pull_down } pio_i2c_pull_mode;
+
+extern void PioSetModes(uint32 pio_mask, pio_mode mode);
+extern void PioSetDir(uint16 pio, bool output);
+extern void PioSetPullModes(uint32 pio_mask, pio_pull_mode pull_mode);
+extern void PioSetEventMask(uint32 pio_mask, pio_event_mode mode);
+extern void PioSetI2CPullMode(pio_i2c_pull_mode mode);
+extern uint32 PioGets(void);
+extern bool PioConfigPWM(uint16 pwm_index, pio_pwm_mode mode,
+                         uint8 dull_off_time, uint8 dull_on_time,
+                         uint8 dull_hold_time, uint8 bright_off_time,
+                         uint8 bright_on_time, uint8 bright_hold_time,
+                         uint8 ramp_rate);
+extern void PioEnablePWM(uint16 pwm_index, bool enable);
+
+#endif /* __PIO_H__ */
@@ -0,0 +1,35 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      pio_ctrlr.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __PIO_CTRLR_H__
+#define __PIO_CTRLR_H__
+
+#include <types.h>
+
+/* The application reads the memory it shares with the PIO controller at
+ * PIO_CTRLR_SHARED_RAM, which can't be mapped on the host. user_config.h is
+ * included ahead of every source, so the address is moved here to the memory
+ * of the emulated controller, see host/emu/emu_pio.c.
+ */
+extern uint16 g_emu_pio_ctrlr_ram[];
+
+#undef PIO_CTRLR_SHARED_RAM
+#define PIO_CTRLR_SHARED_RAM    (g_emu_pio_ctrlr_ram)
+
+extern void PioCtrlrInit(uint16 *image);
+extern void PioCtrlrStart(void);
+extern void PioCtrlrStop(void);
+extern void PioCtrlrClock(bool fast_clock);
+
+#endif /* __PIO_CTRLR_H__ */
@@ -0,0 +1,38 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      security.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __SECURITY_H__
+#define __SECURITY_H__
+
+#include <types.h>
+#include <bluetooth.h>
+
+/* Verdict of SMDivApproval() */
+typedef enum
+{
+    SM_DIV_REVOKED,
+    SM_DIV_APPROVED
+
+} sm_div_verdict;
+
+extern void SMInit(uint16 diversifier);
+extern void SMRequestSecurityLevel(TYPED_BD_ADDR_T *p_addr);
+extern void SMPairingAuthRsp(void *data, bool pairing_ok);
+extern void SMDivApproval(uint16 cid, sm_div_verdict approve_div);
+
+/* Index of the IRK which resolves 'p_addr', or a negative value */
+extern int16 SMPrivacyMatchAddress(TYPED_BD_ADDR_T *p_addr, uint16 *irks,
+                                   uint16 num_irks, uint16 irk_size);
+
+#endif /* __SECURITY_H__ */
@@ -0,0 +1,34 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      sleep.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __SLEEP_H__
+#define __SLEEP_H__
+
+#include <types.h>
+
+typedef enum
+{
+    sleep_state_cold_powerup,
+    sleep_state_warm_powerup,
+    sleep_state_deep,
+    sleep_state_hibernate,
+    sleep_state_dormant
+
+} sleep_state;
+
+extern void SleepRequest(sleep_state state, bool wake_time_valid,
+                         void *p_wake_time);
+extern void SleepWakeOnUartRX(bool enable);
+
+#endif /* __SLEEP_H__ */
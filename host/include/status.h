@@ -0,0 +1,50 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      status.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __STATUS_H__
+#define __STATUS_H__
+
+#include <types.h>
+
+/* Status returned by the firmware */
+typedef uint16                  sys_status;
+
+/* Status groups */
+#define STATUS_GROUP_SYS                    (0x0000)
+#define STATUS_GROUP_GATT                   (0x0100)
+#define STATUS_GROUP_NVM                    (0x0300)
+#define STATUS_GROUP_SM                     (0x0400)
+
+#define sys_status_success                  (STATUS_GROUP_SYS + 0x00)
+#define sys_status_failed                   (STATUS_GROUP_SYS + 0x01)
+
+/* GATT status codes, the ATT error code within STATUS_GROUP_GATT */
+#define gatt_status_read_not_permitted      (STATUS_GROUP_GATT + 0x02)
+#define gatt_status_write_not_permitted     (STATUS_GROUP_GATT + 0x03)
+#define gatt_status_request_not_supported   (STATUS_GROUP_GATT + 0x06)
+#define gatt_status_invalid_offset          (STATUS_GROUP_GATT + 0x07)
+#define gatt_status_invalid_length          (STATUS_GROUP_GATT + 0x0d)
+#define gatt_status_unlikely_error          (STATUS_GROUP_GATT + 0x0e)
+#define gatt_status_insufficient_resources  (STATUS_GROUP_GATT + 0x11)
+#define gatt_status_application_error       (STATUS_GROUP_GATT + 0x80)
+#define gatt_status_irq_proceed             (STATUS_GROUP_GATT + 0xff)
+
+/* NVM status codes */
+#define nvm_status_invalid_offset           (STATUS_GROUP_NVM + 0x01)
+#define nvm_status_needs_erase              (STATUS_GROUP_NVM + 0x05)
+
+/* Security Manager status codes */
+#define sm_status_repeated_attempts         (STATUS_GROUP_SM + 0x09)
+
+#endif /* __STATUS_H__ */
@@ -0,0 +1,28 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      time.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __TIME_H__
+#define __TIME_H__
+
+#include <types.h>
+
+/* Time units, in microseconds */
+#define MILLISECOND                         (1000UL)
+#define SECOND                              (1000UL * MILLISECOND)
+#define MINUTE                              (60UL * SECOND)
+
+/* Microseconds since reset, wrapping every 71 minutes */
+extern uint32 TimeGet32(void);
+
+#endif /* __TIME_H__ */
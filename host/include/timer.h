@@ -0,0 +1,41 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      timer.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#include <types.h>
+#include <time.h>
+
+typedef uint16                      timer_id;
+
+/* Timer expiry handler */
+typedef void (*timer_callback_arg)(timer_id const);
+
+/* Invalid timer identifier, returned when no timer is free */
+#define TIMER_INVALID                       ((timer_id)0xffff)
+
+/* Words taken by each timer in the memory given to TimerInit() */
+#define SIZEOF_APP_TIMER                    (4)
+
+/* Initialise 'num_timers' application timers held in 'memory' */
+extern void TimerInit(uint16 num_timers, void *memory);
+
+/* Start a one-shot timer of 'time' microseconds */
+extern timer_id TimerCreate(uint32 time, bool wake, timer_callback_arg handler);
+
+/* Stop a timer. Stopping TIMER_INVALID or an expired timer does nothing. */
+extern bool TimerDelete(timer_id id);
+
+#endif /* __TIMER_H__ */
@@ -0,0 +1,37 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      types.h
+ *
+ *  DESCRIPTION
+ *      Host build stand-in for the uEnergy SDK header of the same name. It
+ *      only declares what the application uses, see host/README.txt.
+ *
+ *****************************************************************************/
+
+#ifndef __TYPES_H__
+#define __TYPES_H__
+
+/* The XAP is word addressed, so uint8 and int8 take a whole 16-bit word as 
+ * they do on the target
+ */
+typedef unsigned short          uint8;
+typedef signed short            int8;
+typedef unsigned short          uint16;
+typedef signed short            int16;
+typedef unsigned int            uint32;
+typedef signed int              int32;
+
+typedef uint16                  bool;
+
+#define TRUE                    (1)
+#define FALSE                   (0)
+
+#ifndef NULL
+#define NULL                    ((void *)0)
+#endif /* NULL */
+
+#endif /* __TYPES_H__ */
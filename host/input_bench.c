@@ -0,0 +1,308 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      input_bench.c
+ *
+ *  DESCRIPTION
+ *      Works out how long the CPU is kept awake by a key changing at a range
+ *      of edge rates, with the key taking PIO changed events (interrupt
+ *      mode) and with it sampled by inputPoll() (polling mode), and checks
+ *      that the INPUT_STORM_EDGES threshold at which ht_hw.c moves a key to
+ *      polling is past the rate at which polling gets cheaper. The number of
+ *      wake-ups is the cost on the chip, the awake time only scales it by an
+ *      estimate of the time one takes. See host/README.txt.
+ *
+ *      Usage: input_bench [-wake-us <us>]
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  System Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "emu.h"
+#include "health_thermometer.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Key driven by the bench, see ht_hw.c. It pulls its PIO low when pressed. */
+#define IB_KEY                              (9)
+
+/* Time one wake-up keeps the CPU awake, in us. This is an estimate, not a
+ * measurement on the board.
+ */
+#define IB_WAKE_US                          (100)
+
+/* The peer has paired and subscribed by then */
+#define IB_CONNECTED_TIME                   (1500 * MILLISECOND)
+
+/* The key settles into its mode, then its wake-ups are counted */
+#define IB_SETTLE_TIME                      (1 * SECOND)
+#define IB_MEASURE_TIME                     (4 * SECOND)
+
+/* Edge rates of the key, in edges per second. The lowest and the highest
+ * rates give the cost of an edge in interrupt mode and of a poll in polling
+ * mode.
+ */
+static const uint16 g_ib_rates[] =
+{
+    0, 10, 20, 40, 60, 80, 100, 110, 120, 140, 160, 200, 300, 500, 1000
+};
+
+#define IB_RATES        (sizeof(g_ib_rates) / sizeof(g_ib_rates[0]))
+
+/* Edge rates at which ht_hw.c moves a key to polling and back */
+#define IB_STORM_RATE   ((double)INPUT_STORM_EDGES * SECOND / \
+                         INPUT_STORM_WINDOW)
+#define IB_QUIET_RATE   ((double)INPUT_QUIET_EDGES * SECOND / \
+                         INPUT_STORM_WINDOW)
+
+/* Polls per second in polling mode */
+#define IB_POLL_RATE    ((double)SECOND / INPUT_POLL_INTERVAL)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Result of a run, left by its process for the parent */
+typedef struct
+{
+    /* The run completed */
+    bool                            done;
+
+    /* Wake-ups counted over IB_MEASURE_TIME */
+    uint32                          wakes;
+
+    /* The key was being polled at the end of the run */
+    bool                            polled;
+
+} IB_RESULT_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Results of the runs, shared with their processes */
+static IB_RESULT_T *g_ib_results;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void ibRun(uint16 rate, IB_RESULT_T *p_result);
+static bool ibFork(uint16 index);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ibRun
+ *
+ *  DESCRIPTION
+ *      This function boots the application, connects the peer and toggles
+ *      the key at 'rate' edges per second, counting the wake-ups once the
+ *      key has settled into its mode.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void ibRun(uint16 rate, IB_RESULT_T *p_result)
+{
+    EMU_CONFIG_T config;
+    emu_time start = IB_CONNECTED_TIME;
+    emu_time measure = start + IB_SETTLE_TIME;
+    emu_time end = measure + IB_MEASURE_TIME;
+    emu_time time = start;
+    uint32 edge = 0;
+    uint32 wakes = 0;
+    bool counting = FALSE;
+
+    EmuDefaultConfig(&config);
+    EmuBoot(&config);
+    EmuRunUntil(start);
+
+    if(g_ht_data.state != app_state_connected)
+    {
+        fprintf(stderr, "input_bench: not connected\n");
+        return;
+    }
+
+    while(rate != 0 && time < end)
+    {
+        if(!counting && time >= measure)
+        {
+            EmuRunUntil(measure);
+            wakes = EmuWakeCount();
+            counting = TRUE;
+        }
+
+        /* Press on even edges, release on odd ones */
+        EmuRunUntil(time);
+        EmuPioSet(IB_KEY, edge & 1);
+
+        time = start + (emu_time)(++ edge) * SECOND / rate;
+    }
+
+    if(!counting)
+    {
+        EmuRunUntil(measure);
+        wakes = EmuWakeCount();
+    }
+
+    EmuRunUntil(end);
+
+    p_result->wakes = EmuWakeCount() - wakes;
+    p_result->polled = !EmuPioEventsEnabled(IB_KEY);
+    p_result->done = TRUE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ibFork
+ *
+ *  DESCRIPTION
+ *      This function runs the rate of the given index in a process of its
+ *      own, as the application statics can't be reset.
+ *
+ *  RETURNS
+ *      TRUE if the run completed.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool ibFork(uint16 index)
+{
+    pid_t pid;
+    int status;
+
+    fflush(NULL);
+    pid = fork();
+
+    if(pid == 0)
+    {
+        ibRun(g_ib_rates[index], &g_ib_results[index]);
+        fflush(NULL);
+        _exit(0);
+    }
+
+    return (pid > 0 && waitpid(pid, &status, 0) == pid &&
+            WIFEXITED(status) && g_ib_results[index].done);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    double wake_us = IB_WAKE_US;
+    double seconds = (double)IB_MEASURE_TIME / SECOND;
+    double base;
+    double per_edge;
+    double per_poll;
+    double crossover;
+    double wakes;
+    bool ok = TRUE;
+    uint16 index;
+    int arg;
+
+    for(arg = 1; arg < argc; arg++)
+    {
+        if(strcmp(argv[arg], "-wake-us") == 0 && arg + 1 < argc)
+        {
+            wake_us = atof(argv[++arg]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: input_bench [-wake-us <us>]\n");
+            return 1;
+        }
+    }
+
+    g_ib_results = mmap(NULL, sizeof(IB_RESULT_T) * IB_RATES,
+                        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                        -1, 0);
+    if(g_ib_results == MAP_FAILED)
+    {
+        perror("input_bench: mmap");
+        return 1;
+    }
+
+    for(index = 0; index < IB_RATES; index++)
+    {
+        if(!ibFork(index))
+        {
+            fprintf(stderr, "input_bench: the run at %u edges/s failed\n",
+                    g_ib_rates[index]);
+            return 1;
+        }
+    }
+
+    if(g_ib_results[1].polled || !g_ib_results[IB_RATES - 1].polled)
+    {
+        fprintf(stderr, "input_bench: the key was not taking events at %u "
+                        "edges/s and polled at %u edges/s\n",
+                g_ib_rates[1], g_ib_rates[IB_RATES - 1]);
+        return 1;
+    }
+
+    /* Wake-ups of the connection without the key, then those of an edge in
+     * interrupt mode and of a poll in polling mode
+     */
+    base = g_ib_results[0].wakes / seconds;
+    per_edge = (g_ib_results[1].wakes / seconds - base) / g_ib_rates[1];
+    per_poll = (g_ib_results[IB_RATES - 1].wakes / seconds - base) /
+                                                                IB_POLL_RATE;
+    crossover = per_poll * IB_POLL_RATE / per_edge;
+
+    printf("edges/s  mode     wakes/s  awake ms/s    interrupt wakes/s  "
+           "polling wakes/s\n");
+
+    for(index = 0; index < IB_RATES; index++)
+    {
+        wakes = g_ib_results[index].wakes / seconds;
+
+        printf("%7u  %-7s %8.1f %11.2f %20.1f %16.1f\n", g_ib_rates[index],
+               g_ib_results[index].polled ? "polling" : "events", wakes,
+               wakes * wake_us / 1000.0, base + per_edge * g_ib_rates[index],
+               base + per_poll * IB_POLL_RATE);
+    }
+
+    printf("input_bench: %.2f wake-ups per edge, %.2f per poll, polling is "
+           "cheaper from %.0f edges/s\n", per_edge, per_poll, crossover);
+    printf("input_bench: keys move to polling from %.0f edges/s and back "
+           "below %.0f edges/s\n", IB_STORM_RATE, IB_QUIET_RATE);
+
+    /* Polling must be cheaper by the time a key is moved to it, and events
+     * by the time it goes back
+     */
+    if(crossover > IB_STORM_RATE || crossover < IB_QUIET_RATE)
+    {
+        fprintf(stderr, "input_bench: INPUT_STORM_EDGES and "
+                        "INPUT_QUIET_EDGES should bracket %.0f edges/s\n",
+                crossover);
+        ok = FALSE;
+    }
+
+    return ok ? 0 : 1;
+}
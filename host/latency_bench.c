@@ -0,0 +1,909 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      latency_bench.c
+ *
+ *  DESCRIPTION
+ *      Replays key press scenarios on the host emulation and measures the
+ *      latency of each key event, from its PIO edge to the
+ *      GattCharValueNotification() call of the first key report showing it
+ *      and to that report going over the air. The results are printed as
+ *      JSON, so that connection parameter and coalescing changes can be
+ *      compared. See host/README.txt.
+ *
+ *      Usage: latency_bench [-v] [-interval <1.25 ms units>]
+ *                           [-latency <events>] [-reject] [<scenario>...]
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  System Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "emu.h"
+#include "app_gatt_db.h"
+#include "health_thermometer.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Key PIOs, see ht_hw.c. The keys pull their PIO low when pressed. */
+#define LB_LEFT                             (0)
+#define LB_RIGHT                            (3)
+#define LB_FASTER                           (4)
+#define LB_BRAKE                            (9)
+#define LB_GHG                              (10)
+#define LB_BP                               (11)
+
+/* Octets of a key report */
+#define LB_REPORT_BP                        (1)
+#define LB_REPORT_GHG                       (2)
+#define LB_REPORT_SWITCHS                   (3)
+
+/* Key events recorded in one scenario */
+#define LB_MAX_EDGES                        (1024)
+
+/* The peer has paired and subscribed by then */
+#define LB_CONNECTED_TIME                   (1500 * MILLISECOND)
+
+/* The scenarios start once the GHG and BP keys have been armed */
+#define LB_START_TIME                       (2500 * MILLISECOND)
+
+/* Time left after a scenario for its last reports to go */
+#define LB_DRAIN_TIME                       (2 * SECOND)
+
+/* A tap, and the skew between the keys of a chord */
+#define LB_TAP_HOLD                         (80 * MILLISECOND)
+#define LB_CHORD_HOLD                       (150 * MILLISECOND)
+#define LB_CHORD_SKEW                       (2 * MILLISECOND)
+
+/* Length of a GHG or BP pulse train, and the longest pulse */
+#define LB_TRAIN_TIME                       (10 * SECOND)
+#define LB_PULSE_MAX                        (20 * MILLISECOND)
+
+/* Time between the BRAKE taps made during the GHG and BP trains */
+#define LB_BRAKE_PERIOD                     (500 * MILLISECOND)
+
+/* No key is tapped during the scenario */
+#define LB_NO_KEY                           (0xff)
+
+/* Encoding of the argument of lbSetPio() */
+#define LB_PIO_ARG(pio, level)              ((uint32)(pio) | \
+                                             ((uint32)(level) << 8))
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* What a key event shows in the key reports */
+typedef enum
+{
+    lb_edge_switch,                     /* A cleared bit of the switch octet */
+    lb_edge_ghg,                        /* The GHG count reaching a value */
+    lb_edge_bp                          /* The BP count reaching a value */
+
+} lb_edge_kind;
+
+typedef enum
+{
+    lb_edge_pending,
+    lb_edge_reported,
+    lb_edge_lost
+
+} lb_edge_fate;
+
+/* A key event */
+typedef struct
+{
+    emu_time                        time;
+    lb_edge_kind                    kind;
+
+    /* Bit of the switch octet, or the count which shows the event */
+    uint16                          key;
+
+    lb_edge_fate                    fate;
+
+    /* From the edge to the notification call and to its air time */
+    emu_time                        to_call;
+    emu_time                        to_air;
+
+} LB_EDGE_T;
+
+struct LB_SCENARIO_T;
+
+/* Schedules the key events of a scenario from 'start', returning its end */
+typedef emu_time (*lb_schedule)(const struct LB_SCENARIO_T *p_scenario,
+                                emu_time start);
+
+typedef struct LB_SCENARIO_T
+{
+    const char                     *name;
+    lb_schedule                     schedule;
+
+    /* PIO and rate of a pulse train */
+    uint16                          pio;
+    uint16                          rate_hz;
+
+    /* PIO of a switch key tapped during the trains, whose events are also
+     * reported on their own, or LB_NO_KEY
+     */
+    uint16                          tapped_pio;
+
+} LB_SCENARIO_T;
+
+/* Results of a scenario */
+typedef struct
+{
+    LB_EDGE_T                       edges[LB_MAX_EDGES];
+    uint16                          num_edges;
+
+    /* GHG and BP falling edges counted so far */
+    uint16                          ghg_edges;
+    uint16                          bp_edges;
+
+    /* Key reports sent, and notifications dropped with the link */
+    uint32                          reports;
+    uint32                          dropped;
+
+    /* Press time of each key, for the LEFT short press */
+    emu_time                        pressed_at[32];
+
+} LB_RUN_T;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void lbRecord(lb_edge_kind kind, uint16 key);
+static void lbSetPio(uint32 arg);
+static void lbPress(emu_time time, uint16 pio, emu_time hold);
+static void lbResolve(lb_edge_kind kind, uint16 key,
+                      const EMU_NOTIFICATION_T *p_not);
+static void lbNotification(const EMU_NOTIFICATION_T *p_not);
+static emu_time lbTaps(const LB_SCENARIO_T *p_scenario, emu_time start);
+static emu_time lbChords(const LB_SCENARIO_T *p_scenario, emu_time start);
+static emu_time lbTrain(const LB_SCENARIO_T *p_scenario, emu_time start);
+static emu_time lbTrainsTapped(const LB_SCENARIO_T *p_scenario,
+                               emu_time start);
+static void lbPeerBack(uint32 arg);
+static emu_time lbReconnect(const LB_SCENARIO_T *p_scenario, emu_time start);
+static int lbCompareTime(const void *a, const void *b);
+static void lbPrintPercentiles(const char *name, emu_time *p_times,
+                               uint16 count);
+static bool lbIsTapped(const LB_SCENARIO_T *p_scenario,
+                       const LB_EDGE_T *p_edge);
+static bool lbRun(const LB_SCENARIO_T *p_scenario,
+                  const EMU_CONFIG_T *p_config);
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static const LB_SCENARIO_T g_lb_scenarios[] =
+{
+    {"tap",             lbTaps,         0,          0,      LB_NO_KEY},
+    {"chord",           lbChords,       0,          0,      LB_NO_KEY},
+    {"ghg_1hz",         lbTrain,        LB_GHG,     1,      LB_NO_KEY},
+    {"ghg_5hz",         lbTrain,        LB_GHG,     5,      LB_NO_KEY},
+    {"ghg_10hz",        lbTrain,        LB_GHG,     10,     LB_NO_KEY},
+    {"ghg_20hz",        lbTrain,        LB_GHG,     20,     LB_NO_KEY},
+    {"bp_1hz",          lbTrain,        LB_BP,      1,      LB_NO_KEY},
+    {"bp_5hz",          lbTrain,        LB_BP,      5,      LB_NO_KEY},
+    {"bp_10hz",         lbTrain,        LB_BP,      10,     LB_NO_KEY},
+    {"bp_20hz",         lbTrain,        LB_BP,      20,     LB_NO_KEY},
+    {"brake_ghg_bp_20hz",
+                        lbTrainsTapped, 0,          20,     LB_BRAKE},
+    {"reconnect",       lbReconnect,    0,          0,      LB_NO_KEY},
+};
+
+#define LB_SCENARIOS    (sizeof(g_lb_scenarios) / sizeof(g_lb_scenarios[0]))
+
+/* Bit of the switch octet cleared by a press and by a release of each switch
+ * key, see htProcessPioChange()
+ */
+static const struct
+{
+    uint16                          pio;
+    uint16                          press_bit;
+    uint16                          release_bit;
+
+} g_lb_switchs[] =
+{
+    {LB_LEFT,       6,  7},
+    {LB_RIGHT,      4,  5},
+    {LB_FASTER,     2,  3},
+    {LB_BRAKE,      0,  1},
+};
+
+#define LB_SWITCHS      (sizeof(g_lb_switchs) / sizeof(g_lb_switchs[0]))
+
+/* The scenario running in this process */
+static LB_RUN_T g_lb;
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      lbRecord
+ *
+ *  DESCRIPTION
+ *      This function records a key event at the current time.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void lbRecord(lb_edge_kind kind, uint16 key)
+{
+    LB_EDGE_T *p_edge;
+
+    if(g_lb.num_edges == LB_MAX_EDGES)
+    {
+        fprintf(stderr, "latency_bench: too many key events\n");
+        exit(1);
+    }
+
+    p_edge = &g_lb.edges[g_lb.num_edges++];
+    p_edge->time = EmuNow();
+    p_edge->kind = kind;
+    p_edge->key = key;
+    p_edge->fate = lb_edge_pending;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      lbSetPio
+ *
+ *  DESCRIPTION
+ *      This function drives a key PIO from the event queue, recording the key
+ *      event which the application reports for the edge, if any. The first
+ *      GHG or BP press after boot only arms the key, so the GHG and BP edges
+ *      are only recorded once the scenario has started.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void lbSetPio(uint32 arg)
+{
+    uint16 pio = arg & 0xff;
+    bool level = (arg >> 8) & 1;
+    uint16 index;
+
+    for(index = 0; index < LB_SWITCHS; index++)
+    {
+        if(g_lb_switchs[index].pio != pio)
+        {
+            continue;
+        }
+
+        if(!level)
+        {
+            g_lb.pressed_at[pio] = EmuNow();
+            lbRecord(lb_edge_switch, g_lb_switchs[index].press_bit);
+        }
+        else if(pio != LB_LEFT ||
+                EmuNow() - g_lb.pressed_at[pio] < 2 * SECOND)
+        {
+            /* A long LEFT press is not reported as a release */
+            lbRecord(lb_edge_switch, g_lb_switchs[index].release_bit);
+        }
+    }
+
+    if(!level && EmuNow() >= LB_START_TIME)
+    {
+        if(pio == LB_GHG)
+        {
+            lbRecord(lb_edge_ghg, ++g_lb.ghg_edges & 0xff);
+        }
+        else if(pio == LB_BP)
+        {
+            lbRecord(lb_edge_bp, ++g_lb.bp_edges & 0xff);
+        }
+    }
+
+    EmuPioSet(pio, level);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      lbPress
+ *
+ *  DESCRIPTION
+ *      This function runs the emulation up to 'time' and schedules a press of
+ *      a key then for 'hold', so the event queue only holds the next few
+ *      presses however long the scenario. The presses of a scenario are
+ *      made in time order.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void lbPress(emu_time time, uint16 pio, emu_time hold)
+{
+    EmuRunUntil(time);
+    EmuAt(time, lbSetPio, LB_PIO_ARG(pio, FALSE));
+    EmuAt(time + hold, lbSetPio, LB_PIO_ARG(pio, TRUE));
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      lbResolve
+ *
+ *  DESCRIPTION
+ *      This function marks the key events shown by a key report as reported.
+ *      A count shows every GHG or BP press up to it. A cleared switch bit
+ *      shows the latest press or release of that key before the report, and
+ *      earlier ones still pending never had a report of their own, so they
+ *      are lost.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void lbResolve(lb_edge_kind kind, uint16 key,
+                      const EMU_NOTIFICATION_T *p_not)
+{
+    LB_EDGE_T *p_edge;
+    bool shown = FALSE;
+    int index;
+
+    for(index = g_lb.num_edges - 1; index >= 0; index--)
+    {
+        p_edge = &g_lb.edges[index];
+
+        if(p_edge->kind != kind || p_edge->fate != lb_edge_pending ||
+           p_edge->time > p_not->call_time)
+        {
+            continue;
+        }
+
+        if(kind == lb_edge_switch)
+        {
+            if(p_edge->key != key)
+            {
+                continue;
+            }
+
+            p_edge->fate = shown ? lb_edge_lost : lb_edge_reported;
+            shown = TRUE;
+        }
+        else if(((key - p_edge->key) & 0xff) < 0x80)
+        {
+            /* The count has reached the one of the press */
+            p_edge->fate = lb_edge_reported;
+        }
+
+        if(p_edge->fate == lb_edge_reported)
+        {
+            p_edge->to_call = p_not->call_time - p_edge->time;
+            p_edge->to_air = p_not->air_time - p_edge->time;
+        }
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      lbNotification
+ *
+ *  DESCRIPTION
+ *      This function matches the key reports sent to the key events.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void lbNotification(const EMU_NOTIFICATION_T *p_not)
+{
+    uint16 bit;
+
+    if(p_not->dropped)
+    {
+        g_lb.dropped++;
+        return;
+    }
+
+    if(p_not->handle != HANDLE_HT_TEMP_MEASUREMENT ||
+       p_not->size <= LB_REPORT_SWITCHS)
+    {
+        return;
+    }
+
+    g_lb.reports++;
+
+    for(bit = 0; bit < 8; bit++)
+    {
+        if(!(p_not->value[LB_REPORT_SWITCHS] & (1 << bit)))
+        {
+            lbResolve(lb_edge_switch, bit, p_not);
+        }
+    }
+
+    lbResolve(lb_edge_ghg, p_not->value[LB_REPORT_GHG] & 0xff, p_not);
+    lbResolve(lb_edge_bp, p_not->value[LB_REPORT_BP] & 0xff, p_not);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      lbTaps
+ *
+ *  DESCRIPTION
+ *      This function schedules ten taps of each switch key in turn, one
+ *      every 250 ms.
+ *
+ *  RETURNS
+ *      The end of the scenario.
+ *
+ *---------------------------------------------------------------------------*/
+
+static emu_time lbTaps(const LB_SCENARIO_T *p_scenario, emu_time start)
+{
+    emu_time time = start;
+    uint16 tap;
+
+    for(tap = 0; tap < 10 * LB_SWITCHS; tap++, time += 250 * MILLISECOND)
+    {
+        lbPress(time, g_lb_switchs[tap % LB_SWITCHS].pio, LB_TAP_HOLD);
+    }
+
+    return time;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      lbChords
+ *
+ *  DESCRIPTION
+ *      This function schedules twenty chords of two switch keys, pressed and
+ *      released a few ms apart, one every 500 ms.
+ *
+ *  RETURNS
+ *      The end of the scenario.
+ *
+ *---------------------------------------------------------------------------*/
+
+static emu_time lbChords(const LB_SCENARIO_T *p_scenario, emu_time start)
+{
+    emu_time time = start;
+    uint16 chord;
+
+    for(chord = 0; chord < 20; chord++, time += 500 * MILLISECOND)
+    {
+        lbPress(time, g_lb_switchs[chord % LB_SWITCHS].pio, LB_CHORD_HOLD);
+        lbPress(time + LB_CHORD_SKEW,
+                g_lb_switchs[(chord + 1) % LB_SWITCHS].pio, LB_CHORD_HOLD);
+    }
+
+    return time;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      lbTrain
+ *
+ *  DESCRIPTION
+ *      This function schedules a train of pulses on the GHG or BP key at the
+ *      rate of the scenario.
+ *
+ *  RETURNS
+ *      The end of the scenario.
+ *
+ *---------------------------------------------------------------------------*/
+
+static emu_time lbTrain(const LB_SCENARIO_T *p_scenario, emu_time start)
+{
+    emu_time period = SECOND / p_scenario->rate_hz;
+    emu_time pulse = (period / 2 < LB_PULSE_MAX) ? period / 2 : LB_PULSE_MAX;
+    emu_time time;
+
+    for(time = start; time < start + LB_TRAIN_TIME; time += period)
+    {
+        lbPress(time, p_scenario->pio, pulse);
+    }
+
+    return time;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      lbTrainsTapped
+ *
+ *  DESCRIPTION
+ *      This function schedules trains of pulses on the GHG and BP keys at
+ *      the rate of the scenario, the BP pulses half a period after the GHG
+ *      ones, and a tap of the tapped key every LB_BRAKE_PERIOD, a quarter of
+ *      a period after a GHG pulse.
+ *
+ *  RETURNS
+ *      The end of the scenario.
+ *
+ *---------------------------------------------------------------------------*/
+
+static emu_time lbTrainsTapped(const LB_SCENARIO_T *p_scenario,
+                               emu_time start)
+{
+    emu_time period = SECOND / p_scenario->rate_hz;
+    emu_time pulse = (period / 2 < LB_PULSE_MAX) ? period / 2 : LB_PULSE_MAX;
+    emu_time tap = start;
+    emu_time time;
+
+    for(time = start; time < start + LB_TRAIN_TIME; time += period)
+    {
+        lbPress(time, LB_GHG, pulse);
+
+        if(time >= tap)
+        {
+            lbPress(time + period / 4, p_scenario->tapped_pio, LB_TAP_HOLD);
+            tap += LB_BRAKE_PERIOD;
+        }
+
+        lbPress(time + period / 2, LB_BP, pulse);
+    }
+
+    return time;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      lbPeerBack
+ *
+ *  DESCRIPTION
+ *      This function brings the peer back into range.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void lbPeerBack(uint32 arg)
+{
+    EmuPeerSetPresent(TRUE);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      lbReconnect
+ *
+ *  DESCRIPTION
+ *      This function takes the peer out of range for 4 s and taps LEFT and
+ *      pulses GHG twice a second from then until 1 s after it is back. The
+ *      device only notices the link loss at the supervision timeout.
+ *
+ *  RETURNS
+ *      The end of the scenario.
+ *
+ *---------------------------------------------------------------------------*/
+
+static emu_time lbReconnect(const LB_SCENARIO_T *p_scenario, emu_time start)
+{
+    emu_time time;
+
+    EmuRunUntil(start);
+    EmuPeerSetPresent(FALSE);
+    EmuLinkLoss();
+    EmuAt(start + 4 * SECOND, lbPeerBack, 0);
+
+    for(time = start + 100 * MILLISECOND;
+        time < start + 5 * SECOND;
+        time += 500 * MILLISECOND)
+    {
+        lbPress(time, LB_LEFT, LB_TAP_HOLD);
+        lbPress(time + 250 * MILLISECOND, LB_GHG, LB_PULSE_MAX);
+    }
+
+    return time;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      lbCompareTime
+ *
+ *  DESCRIPTION
+ *      This function orders two latencies for qsort().
+ *
+ *  RETURNS
+ *      Negative, zero or positive as 'a' is shorter, as long or longer.
+ *
+ *---------------------------------------------------------------------------*/
+
+static int lbCompareTime(const void *a, const void *b)
+{
+    emu_time time_a = *(const emu_time *)a;
+    emu_time time_b = *(const emu_time *)b;
+
+    return (time_a > time_b) - (time_a < time_b);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      lbPrintPercentiles
+ *
+ *  DESCRIPTION
+ *      This function prints the p50, p99 and maximum of 'count' latencies as
+ *      a JSON member, in ms. The percentiles are nearest rank.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void lbPrintPercentiles(const char *name, emu_time *p_times,
+                               uint16 count)
+{
+    if(count == 0)
+    {
+        printf("\"%s\": null", name);
+        return;
+    }
+
+    qsort(p_times, count, sizeof(p_times[0]), lbCompareTime);
+
+    printf("\"%s\": {\"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f}", name,
+           p_times[(count * 50 + 99) / 100 - 1] / 1000.0,
+           p_times[(count * 99 + 99) / 100 - 1] / 1000.0,
+           p_times[count - 1] / 1000.0);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      lbIsTapped
+ *
+ *  DESCRIPTION
+ *      This function tells whether a key event is a press or release of the
+ *      key tapped during the scenario.
+ *
+ *  RETURNS
+ *      TRUE if it is.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool lbIsTapped(const LB_SCENARIO_T *p_scenario,
+                       const LB_EDGE_T *p_edge)
+{
+    uint16 index;
+
+    if(p_edge->kind != lb_edge_switch)
+    {
+        return FALSE;
+    }
+
+    for(index = 0; index < LB_SWITCHS; index++)
+    {
+        if(g_lb_switchs[index].pio == p_scenario->tapped_pio)
+        {
+            return (p_edge->key == g_lb_switchs[index].press_bit ||
+                    p_edge->key == g_lb_switchs[index].release_bit);
+        }
+    }
+
+    return FALSE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      lbRun
+ *
+ *  DESCRIPTION
+ *      This function boots the application, connects the peer, arms the GHG
+ *      and BP keys, replays a scenario and prints its results as a JSON
+ *      object, or an object with an error. The events of a tapped key are
+ *      also summed up on their own. It runs in a process of its own.
+ *
+ *  RETURNS
+ *      FALSE if the peer did not connect.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool lbRun(const LB_SCENARIO_T *p_scenario,
+                  const EMU_CONFIG_T *p_config)
+{
+    static emu_time to_call[LB_MAX_EDGES], to_air[LB_MAX_EDGES];
+    static emu_time tapped_to_call[LB_MAX_EDGES], tapped_to_air[LB_MAX_EDGES];
+    uint16 reported = 0;
+    uint16 lost = 0;
+    uint16 tapped = 0;
+    uint16 tapped_reported = 0;
+    uint16 index;
+    emu_time end;
+
+    EmuSetNotificationHook(lbNotification);
+    EmuBoot(p_config);
+    EmuRunUntil(LB_CONNECTED_TIME);
+
+    if(g_ht_data.state != app_state_connected)
+    {
+        printf("    {\"name\": \"%s\", \"error\": \"not connected\"}",
+               p_scenario->name);
+        return FALSE;
+    }
+
+    /* The first press of GHG and BP after boot only arms them */
+    lbPress(LB_CONNECTED_TIME, LB_GHG, LB_PULSE_MAX);
+    lbPress(LB_CONNECTED_TIME + 100 * MILLISECOND, LB_BP, LB_PULSE_MAX);
+
+    end = p_scenario->schedule(p_scenario, LB_START_TIME);
+    EmuRunUntil(end + LB_DRAIN_TIME);
+
+    for(index = 0; index < g_lb.num_edges; index++)
+    {
+        if(lbIsTapped(p_scenario, &g_lb.edges[index]))
+        {
+            tapped++;
+
+            if(g_lb.edges[index].fate == lb_edge_reported)
+            {
+                tapped_to_call[tapped_reported] = g_lb.edges[index].to_call;
+                tapped_to_air[tapped_reported] = g_lb.edges[index].to_air;
+                tapped_reported++;
+            }
+        }
+
+        if(g_lb.edges[index].fate == lb_edge_reported)
+        {
+            to_call[reported] = g_lb.edges[index].to_call;
+            to_air[reported] = g_lb.edges[index].to_air;
+            reported++;
+        }
+        else
+        {
+            lost++;
+        }
+    }
+
+    printf("    {\"name\": \"%s\", \"events\": %u, \"reported\": %u, "
+           "\"lost\": %u, \"reports\": %u, \"dropped_notifications\": %u,\n"
+           "     ", p_scenario->name, g_lb.num_edges, reported, lost,
+           g_lb.reports, g_lb.dropped);
+    lbPrintPercentiles("edge_to_call_ms", to_call, reported);
+    printf(",\n     ");
+    lbPrintPercentiles("edge_to_air_ms", to_air, reported);
+
+    if(p_scenario->tapped_pio != LB_NO_KEY)
+    {
+        printf(",\n     \"tapped_events\": %u, \"tapped_reported\": %u, ",
+               tapped, tapped_reported);
+        lbPrintPercentiles("tapped_edge_to_call_ms", tapped_to_call,
+                           tapped_reported);
+        printf(",\n     ");
+        lbPrintPercentiles("tapped_edge_to_air_ms", tapped_to_air,
+                           tapped_reported);
+    }
+
+    printf("}");
+
+    return TRUE;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    EMU_CONFIG_T config;
+    bool selected[LB_SCENARIOS];
+    bool any_selected = FALSE;
+    bool first = TRUE;
+    bool ok = TRUE;
+    uint16 index;
+    int status;
+    int arg;
+    pid_t pid;
+
+    EmuDefaultConfig(&config);
+    memset(selected, 0, sizeof(selected));
+
+    for(arg = 1; arg < argc; arg++)
+    {
+        if(strcmp(argv[arg], "-v") == 0)
+        {
+            config.verbose = TRUE;
+        }
+        else if(strcmp(argv[arg], "-interval") == 0 && arg + 1 < argc)
+        {
+            config.peer.conn_interval = (uint16)atoi(argv[++arg]);
+        }
+        else if(strcmp(argv[arg], "-latency") == 0 && arg + 1 < argc)
+        {
+            config.peer.conn_latency = (uint16)atoi(argv[++arg]);
+        }
+        else if(strcmp(argv[arg], "-reject") == 0)
+        {
+            config.peer.policy = emu_policy_reject;
+        }
+        else
+        {
+            for(index = 0; index < LB_SCENARIOS; index++)
+            {
+                if(strcmp(argv[arg], g_lb_scenarios[index].name) == 0)
+                {
+                    selected[index] = TRUE;
+                    any_selected = TRUE;
+                    break;
+                }
+            }
+
+            if(index == LB_SCENARIOS)
+            {
+                fprintf(stderr, "usage: latency_bench [-v] [-interval <n>] "
+                                "[-latency <n>] [-reject] [<scenario>...]\n");
+                return 1;
+            }
+        }
+    }
+
+    printf("{\"nvm\": \"%s\", \"conn_interval\": %u, \"conn_latency\": %u, "
+           "\"param_updates\": \"%s\",\n \"scenarios\": [\n",
+           config.nvm_flash ? "flash" : "eeprom", config.peer.conn_interval,
+           config.peer.conn_latency,
+           config.peer.policy == emu_policy_reject ? "reject" : "accept");
+
+    for(index = 0; index < LB_SCENARIOS; index++)
+    {
+        if(any_selected && !selected[index])
+        {
+            continue;
+        }
+
+        if(!first)
+        {
+            printf(",\n");
+        }
+        first = FALSE;
+
+        fflush(NULL);
+        pid = fork();
+        if(pid == 0)
+        {
+            bool run_ok = lbRun(&g_lb_scenarios[index], &config);
+
+            fflush(NULL);
+            _exit(run_ok ? 0 : 1);
+        }
+
+        if(pid < 0 || waitpid(pid, &status, 0) != pid ||
+           !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            ok = FALSE;
+        }
+    }
+
+    printf("\n ]}\n");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,647 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      nvm_bench.c
+ *
+ *  DESCRIPTION
+ *      Checks that the NVM survives a power failure at any point, the word
+ *      being written then being corrupted:
+ *
+ *      - the migration of the original NVM layout (version 0) holding a
+ *        bond, on a boot of the application, which must keep the bond and
+ *        the services data;
+ *      - on SPI flash builds, the record log under a workload of Nvm_Write()
+ *        calls of random words with a quiet point (Nvm_CompactLog()) now and
+ *        then. The log replayed from what the store holds must give the
+ *        contents before or after the step the power was cut in, and must
+ *        still take writes and compact afterwards.
+ *
+ *      Each is run once for every word it writes, the power being cut after
+ *      that word. See host/README.txt.
+ *
+ *      Usage: nvm_bench [-steps <n>] [-stride <words>]
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  System Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "emu.h"
+#include "nvm_access.h"
+#include "health_thermometer.h"
+#include "bond_table.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Steps of the workload by default, enough for a few compactions */
+#define NB_STEPS                            (700)
+
+/* Every NB_QUIET_STEPS th step is a quiet point. The log fills up from the
+ * compaction threshold to full in fewer steps, so some compactions happen in
+ * Nvm_Write().
+ */
+#define NB_QUIET_STEPS                      (150)
+
+/* Longest Nvm_Write() of the workload, in words */
+#define NB_MAX_LENGTH                       (8)
+
+/* Steps run after the log has been replayed from a power cut */
+#define NB_RECOVERY_STEPS                   (400)
+
+/* Words of the original NVM layout (version 0), as health_thermometer.c
+ * migrates it: the sanity word, the bonded flag, the bonded device address,
+ * the diversifier and the IRK, then the services data up to the nvm_size of
+ * the time. The migration moves every word but the sanity word two words up,
+ * making room for a group header.
+ */
+#define NB_V0_OFFSET_BONDED_FLAG            (1)
+#define NB_V0_OFFSET_BONDED_ADDR            (2)
+#define NB_V0_OFFSET_SM_DIV                 (NB_V0_OFFSET_BONDED_ADDR + \
+                                             sizeof(TYPED_BD_ADDR_T) / 2)
+#define NB_V0_OFFSET_SM_IRK                 (NB_V0_OFFSET_SM_DIV + 1)
+#define NB_V0_OFFSET_SERVICES               (NB_V0_OFFSET_SM_IRK + \
+                                             MAX_WORDS_IRK)
+#define NB_V0_MEMORY_WORDS                  (0x40)
+#define NB_V0_SHIFT                         (NVM_GROUP_HEADER_WORDS)
+
+/* Diversifier of the bond of the version 0 layout */
+#define NB_V0_DIV                           (0x1d05)
+
+/* Results a boot leaves for the parent process */
+typedef struct
+{
+    /* Logical NVM contents after a boot on a blank store */
+    uint16                          fresh[NVM_SHADOW_WORDS];
+
+    /* The store as a boot cut short left it */
+    uint16                          store[EMU_NVM_WORDS];
+
+    /* The power was cut before the end of the boot */
+    bool                            cut;
+
+} NB_SHARED_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Shared with the boots, each run in a process of its own */
+static NB_SHARED_T *g_nb_shared;
+
+/* Bonded device address of the version 0 layout */
+static TYPED_BD_ADDR_T g_nb_v0_addr;
+
+#ifdef NVM_TYPE_FLASH
+/* Contents the NVM should hold, and those before the last step */
+static uint16 g_nb_model[NVM_SHADOW_WORDS];
+static uint16 g_nb_before[NVM_SHADOW_WORDS];
+
+/* Workload random number generator */
+static uint32 g_nb_random;
+
+/* Erases in Nvm_Write() */
+static uint32 g_nb_write_erases;
+#endif /* NVM_TYPE_FLASH */
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void nbBoot(const uint16 *p_image, uint16 words, bool cut,
+                   uint32 cut_words);
+static bool nbFork(void (*child)(uint32 arg), uint32 arg);
+static void nbFreshBoot(uint32 arg);
+static void nbMigrationBoot(uint32 cut_words);
+static void nbMigrationCheck(uint32 cut_words);
+static uint32 nbMigration(uint32 stride, uint32 *p_cuts);
+#ifdef NVM_TYPE_FLASH
+static uint16 nbRandom(uint16 range);
+static void nbStep(uint32 step);
+static bool nbRun(uint32 steps, bool cut, uint32 words);
+static bool nbReplayMatches(bool either);
+static uint32 nbLog(uint32 steps, uint32 stride, uint32 *p_cuts);
+#endif /* NVM_TYPE_FLASH */
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nbBoot
+ *
+ *  DESCRIPTION
+ *      This function boots the application, without a peer in range, on a
+ *      store holding the image given, the power being cut after 'cut_words'
+ *      words if 'cut' is TRUE.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void nbBoot(const uint16 *p_image, uint16 words, bool cut,
+                   uint32 cut_words)
+{
+    EMU_CONFIG_T config;
+
+    EmuDefaultConfig(&config);
+    config.peer.present = FALSE;
+    config.nvm_image = p_image;
+    config.nvm_image_words = words;
+
+    if(cut)
+    {
+        EmuNvmPowerCut(cut_words, TRUE);
+    }
+
+    EmuBoot(&config);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nbFork
+ *
+ *  DESCRIPTION
+ *      This function runs a boot in a process of its own, as the application
+ *      statics can't be reset.
+ *
+ *  RETURNS
+ *      TRUE if the process exited with status 0.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool nbFork(void (*child)(uint32 arg), uint32 arg)
+{
+    pid_t pid = fork();
+    int status;
+
+    if(pid == 0)
+    {
+        child(arg);
+        _exit(0);
+    }
+
+    return pid > 0 && waitpid(pid, &status, 0) == pid &&
+           WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nbFreshBoot
+ *
+ *  DESCRIPTION
+ *      This function boots on a blank store and keeps the NVM contents the
+ *      application writes, from which the version 0 layout is made up.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void nbFreshBoot(uint32 arg)
+{
+    nbBoot(NULL, 0, FALSE, 0);
+    Nvm_Read(g_nb_shared->fresh, NVM_SHADOW_WORDS, 0);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nbMigrationBoot
+ *
+ *  DESCRIPTION
+ *      This function boots on a store holding the version 0 layout, the
+ *      power being cut after 'cut_words' words, and keeps what the store
+ *      holds.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void nbMigrationBoot(uint32 cut_words)
+{
+    uint16 image[NB_V0_MEMORY_WORDS];
+    uint16 index;
+
+    /* The sanity word, the bond, and the services data as the application
+     * writes them, where they were before the group header was added
+     */
+    memset(image, 0, sizeof(image));
+    image[0] = g_nb_shared->fresh[0];
+    image[NB_V0_OFFSET_BONDED_FLAG] = TRUE;
+    memcpy(&image[NB_V0_OFFSET_BONDED_ADDR], &g_nb_v0_addr,
+           sizeof(g_nb_v0_addr));
+    image[NB_V0_OFFSET_SM_DIV] = NB_V0_DIV;
+    for(index = NB_V0_OFFSET_SERVICES; index < NB_V0_MEMORY_WORDS; index++)
+    {
+        image[index] = g_nb_shared->fresh[index + NB_V0_SHIFT];
+    }
+
+    nbBoot(image, NB_V0_MEMORY_WORDS, TRUE, cut_words);
+
+    g_nb_shared->cut = EmuNvmPowerIsCut();
+    EmuNvmSave(g_nb_shared->store, EMU_NVM_WORDS);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nbMigrationCheck
+ *
+ *  DESCRIPTION
+ *      This function boots on the store a migration cut short left and
+ *      checks that the bond and the services data were kept.
+ *
+ *  RETURNS
+ *      Exits with status 1 if they were not.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void nbMigrationCheck(uint32 cut_words)
+{
+    uint16 words[NVM_SHADOW_WORDS];
+    uint16 start = NB_V0_OFFSET_SERVICES + NB_V0_SHIFT;
+    uint16 end = NB_V0_MEMORY_WORDS + NB_V0_SHIFT;
+    bool ok = TRUE;
+
+    nbBoot(g_nb_shared->store, EMU_NVM_WORDS, FALSE, 0);
+
+    if(BondTableCount() != 1 ||
+       BondTableFind(&g_nb_v0_addr) == BOND_TABLE_INVALID ||
+       g_ht_data.diversifier != NB_V0_DIV)
+    {
+        fprintf(stderr, "nvm_bench: power cut after %u words of the "
+                        "migration: the bond was lost\n", cut_words);
+        ok = FALSE;
+    }
+
+    Nvm_Read(words, NVM_SHADOW_WORDS, 0);
+    if(memcmp(&words[start], &g_nb_shared->fresh[start],
+              (end - start) * sizeof(uint16)) != 0)
+    {
+        fprintf(stderr, "nvm_bench: power cut after %u words of the "
+                        "migration: the services data changed\n", cut_words);
+        ok = FALSE;
+    }
+
+    _exit(ok ? 0 : 1);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nbMigration
+ *
+ *  DESCRIPTION
+ *      This function cuts the power after every 'stride' words of the
+ *      migration of the version 0 layout, until a boot completes.
+ *
+ *  RETURNS
+ *      The number of failures.
+ *
+ *---------------------------------------------------------------------------*/
+
+static uint32 nbMigration(uint32 stride, uint32 *p_cuts)
+{
+    uint32 failures = 0;
+    uint32 words;
+
+    g_nb_v0_addr.type = L2CA_PUBLIC_ADDR_TYPE;
+    g_nb_v0_addr.addr.lap = 0x5b1d0e;
+    g_nb_v0_addr.addr.uap = 0x02;
+    g_nb_v0_addr.addr.nap = 0x0a12;
+
+    if(!nbFork(nbFreshBoot, 0))
+    {
+        fprintf(stderr, "nvm_bench: the boot on a blank store failed\n");
+        return 1;
+    }
+
+    for(words = 0; ; words += stride)
+    {
+        g_nb_shared->cut = FALSE;
+
+        if(!nbFork(nbMigrationBoot, words))
+        {
+            fprintf(stderr, "nvm_bench: power cut after %u words of the "
+                            "migration: the boot failed\n", words);
+            failures++;
+            continue;
+        }
+
+        if(!nbFork(nbMigrationCheck, words))
+        {
+            failures++;
+        }
+
+        if(!g_nb_shared->cut)
+        {
+            /* The migration completed, and has just been checked */
+            break;
+        }
+
+        (*p_cuts)++;
+    }
+
+    return failures;
+}
+
+
+#ifdef NVM_TYPE_FLASH
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nbRandom
+ *
+ *  DESCRIPTION
+ *      This function draws the next number of the workload.
+ *
+ *  RETURNS
+ *      A number from 0 to range - 1.
+ *
+ *---------------------------------------------------------------------------*/
+
+static uint16 nbRandom(uint16 range)
+{
+    g_nb_random = g_nb_random * 1103515245 + 12345;
+
+    return (uint16)((g_nb_random >> 16) % range);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nbStep
+ *
+ *  DESCRIPTION
+ *      This function runs one step of the workload: a quiet point, or a
+ *      write of 1 to NB_MAX_LENGTH random words at a random offset. The
+ *      model is updated with the contents the step leaves.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void nbStep(uint32 step)
+{
+    uint16 words[NB_MAX_LENGTH];
+    uint16 length;
+    uint16 offset;
+    uint16 index;
+    uint32 erases;
+
+    memcpy(g_nb_before, g_nb_model, sizeof(g_nb_model));
+
+    if(step % NB_QUIET_STEPS == NB_QUIET_STEPS - 1)
+    {
+        Nvm_CompactLog();
+        return;
+    }
+
+    length = 1 + nbRandom(NB_MAX_LENGTH);
+    offset = nbRandom(NVM_SHADOW_WORDS - length + 1);
+
+    for(index = 0; index < length; index++)
+    {
+        words[index] = nbRandom(0xffff);
+    }
+
+    erases = EmuNvmEraseCount();
+    Nvm_Write(words, length, offset);
+    g_nb_write_erases += EmuNvmEraseCount() - erases;
+
+    memcpy(&g_nb_model[offset], words, length * sizeof(uint16));
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nbRun
+ *
+ *  DESCRIPTION
+ *      This function runs the workload from a blank store, the power being
+ *      cut after 'words' words if 'cut' is TRUE. The run stops at the end of
+ *      the step the power was cut in.
+ *
+ *  RETURNS
+ *      TRUE if the power was cut.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool nbRun(uint32 steps, bool cut, uint32 words)
+{
+    uint32 step;
+
+    EmuNvmInit(TRUE);
+    if(cut)
+    {
+        EmuNvmPowerCut(words, TRUE);
+    }
+    else
+    {
+        EmuNvmPowerOn();
+    }
+
+    Nvm_LoadLog();
+
+    g_nb_random = 1;
+    g_nb_write_erases = 0;
+    memset(g_nb_model, 0xff, sizeof(g_nb_model));
+    memset(g_nb_before, 0xff, sizeof(g_nb_before));
+
+    for(step = 0; step < steps; step++)
+    {
+        nbStep(step);
+
+        if(EmuNvmPowerIsCut())
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nbReplayMatches
+ *
+ *  DESCRIPTION
+ *      This function replays the log as at start-up and compares the
+ *      contents it gives with the model, or with the contents before the last
+ *      step if 'either' is TRUE.
+ *
+ *  RETURNS
+ *      TRUE if they match.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool nbReplayMatches(bool either)
+{
+    uint16 words[NVM_SHADOW_WORDS];
+
+    EmuNvmPowerOn();
+    Nvm_LoadLog();
+    Nvm_Read(words, NVM_SHADOW_WORDS, 0);
+
+    return memcmp(words, g_nb_model, sizeof(words)) == 0 ||
+           (either && memcmp(words, g_nb_before, sizeof(words)) == 0);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nbLog
+ *
+ *  DESCRIPTION
+ *      This function runs the workload without a power cut, then with the
+ *      power cut after every 'stride' words until a run completes. It runs
+ *      on the NVM layer in this process, so it must come after the boots.
+ *
+ *  RETURNS
+ *      The number of failures.
+ *
+ *---------------------------------------------------------------------------*/
+
+static uint32 nbLog(uint32 steps, uint32 stride, uint32 *p_cuts)
+{
+    uint32 failures = 0;
+    uint32 erases;
+    uint32 words;
+    uint32 step;
+
+    nbRun(steps, FALSE, 0);
+    erases = EmuNvmEraseCount();
+    if(!nbReplayMatches(FALSE))
+    {
+        fprintf(stderr, "nvm_bench: the log does not replay the workload\n");
+        failures++;
+    }
+    if(g_nb_write_erases != 0)
+    {
+        fprintf(stderr, "nvm_bench: %u of the %u erases were in "
+                        "Nvm_Write()\n", g_nb_write_erases, erases);
+        failures++;
+    }
+
+    for(words = 0; nbRun(steps, TRUE, words); words += stride)
+    {
+        (*p_cuts)++;
+
+        if(!nbReplayMatches(TRUE))
+        {
+            fprintf(stderr, "nvm_bench: power cut after %u words of the "
+                            "workload: the replayed contents are neither "
+                            "those before nor after the step\n", words);
+            failures++;
+            continue;
+        }
+
+        /* The model holds whichever contents were replayed */
+        Nvm_Read(g_nb_model, NVM_SHADOW_WORDS, 0);
+
+        for(step = 0; step < NB_RECOVERY_STEPS; step++)
+        {
+            nbStep(step);
+        }
+
+        if(!nbReplayMatches(FALSE))
+        {
+            fprintf(stderr, "nvm_bench: power cut after %u words of the "
+                            "workload: the log lost writes made after the "
+                            "replay\n", words);
+            failures++;
+        }
+    }
+
+    printf("nvm_bench: log workload of %u steps, %u erases, none in "
+           "Nvm_Write()\n", steps, erases);
+
+    return failures;
+}
+#endif /* NVM_TYPE_FLASH */
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    uint32 steps = NB_STEPS;
+    uint32 stride = 1;
+    uint32 migration_cuts = 0;
+    uint32 log_cuts = 0;
+    uint32 failures;
+    int arg;
+
+    for(arg = 1; arg < argc; arg++)
+    {
+        if(strcmp(argv[arg], "-steps") == 0 && arg + 1 < argc)
+        {
+            steps = (uint32)atoi(argv[++arg]);
+        }
+        else if(strcmp(argv[arg], "-stride") == 0 && arg + 1 < argc)
+        {
+            stride = (uint32)atoi(argv[++arg]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: nvm_bench [-steps <n>] "
+                            "[-stride <words>]\n");
+            return 1;
+        }
+    }
+
+    if(stride == 0)
+    {
+        stride = 1;
+    }
+
+    g_nb_shared = mmap(NULL, sizeof(NB_SHARED_T), PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(g_nb_shared == MAP_FAILED)
+    {
+        perror("nvm_bench: mmap");
+        return 1;
+    }
+
+    /* The boots fork from this process, before the log workload runs in it */
+    failures = nbMigration(stride, &migration_cuts);
+    printf("nvm_bench: layout version 0 migration, %u power cuts\n",
+           migration_cuts);
+
+#ifdef NVM_TYPE_FLASH
+    failures += nbLog(steps, stride, &log_cuts);
+    printf("nvm_bench: log workload, %u power cuts\n", log_cuts);
+#else
+    /* There is no record log on I2C EEPROM */
+    (void)steps;
+    (void)log_cuts;
+#endif /* NVM_TYPE_FLASH */
+
+    printf("nvm_bench: %u failures\n", failures);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+#
+#  Copyright Cambridge Silicon Radio Limited 2012-2014
+#  Part of CSR uEnergy SDK 2.3.0
+#  Application version 2.3.0.0
+#
+#  FILE
+#      power_model.py
+#
+#  DESCRIPTION
+#      Works out the average current of each stage of the inactivity power
+#      ladder, as listed in user_config.h, from the connection and
+#      advertising parameters of gap_conn_params.h and the charge and sleep
+#      current figures below.
+#
+#      The charge and sleep current figures are estimates, not measurements
+#      on the board. Replace them once measured and update user_config.h
+#      with the output.
+#
+#      Usage: power_model.py [--check]
+#
+#      --check fails unless the list in user_config.h matches the model.
+#
+
+import os
+import re
+import sys
+
+# Charge taken by one connection event and by one advertising event on all
+# three channels, in uC, and the current in deep sleep and dormant, in uA
+CONNECTION_EVENT_UC = 15.0
+ADVERTISING_EVENT_UC = 25.0
+DEEP_SLEEP_UA = 5.0
+DORMANT_UA = 0.6
+
+APP_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+
+# Width of the stage column in user_config.h
+LABEL_WIDTH = 56
+
+
+def read_defines(path):
+    """Return the integer #defines of a header, times in ms."""
+    defines = {}
+    with open(path, encoding='latin-1') as header:
+        for line in header:
+            match = re.match(r'\s*#define\s+(\w+)\s+\(?\s*(0x[0-9a-fA-F]+|\d+)'
+                             r'(\s*\*\s*MILLISECOND)?', line)
+            if match:
+                defines[match.group(1)] = int(match.group(2), 0)
+    return defines
+
+
+def period_text(ms):
+    if ms >= 1000 and ms % 1000 == 0:
+        return '%gs' % (ms / 1000)
+    return '%gms' % ms
+
+
+def current_text(ua):
+    """Two significant figures, as the list gives them."""
+    return '~%guA' % float('%.2g' % ua)
+
+
+def connected_period(defines, prefix):
+    """Time between the connection events the device listens at, in ms."""
+    interval = defines[prefix + '_MAX_CON_INTERVAL'] * 1.25
+    return interval * (defines[prefix + '_SLAVE_LATENCY'] + 1)
+
+
+def stages():
+    defines = read_defines(os.path.join(APP_DIR, 'gap_conn_params.h'))
+
+    preferred = connected_period(defines, 'PREFERRED')
+    relaxed = connected_period(defines, 'RELAXED')
+    fast = defines['FC_ADVERTISING_INTERVAL_MAX']
+    slow = defines['RP_ADVERTISING_INTERVAL_MAX']
+
+    # Charge per event over the event period, plus deep sleep in between
+    return [
+        ('Connected, preferred parameters (%s per event)' %
+         period_text(preferred),
+         CONNECTION_EVENT_UC * 1000 / preferred + DEEP_SLEEP_UA),
+        ('Connected, relaxed parameters (%s per event)' %
+         period_text(relaxed),
+         CONNECTION_EVENT_UC * 1000 / relaxed + DEEP_SLEEP_UA),
+        ('Fast advertising (%s)' % period_text(fast),
+         ADVERTISING_EVENT_UC * 1000 / fast + DEEP_SLEEP_UA),
+        ('Slow advertising (%s)' % period_text(slow),
+         ADVERTISING_EVENT_UC * 1000 / slow + DEEP_SLEEP_UA),
+        ('Idle, deep sleep', DEEP_SLEEP_UA),
+        ('Dormant', DORMANT_UA),
+    ]
+
+
+def model_lines():
+    return [' *  %-*s%s' % (LABEL_WIDTH, label, current_text(ua))
+            for label, ua in stages()]
+
+
+def config_lines():
+    """The list of stages in the user_config.h comment."""
+    lines = []
+    with open(os.path.join(APP_DIR, 'user_config.h'),
+              encoding='latin-1') as header:
+        for line in header:
+            if re.match(r' \*  \S.*~[0-9.]+uA$', line.rstrip()):
+                lines.append(line.rstrip())
+    return lines
+
+
+def main():
+    lines = model_lines()
+
+    if sys.argv[1:] == ['--check']:
+        if config_lines() != lines:
+            sys.stderr.write('power_model: user_config.h does not match the '
+                             'model, it should list:\n%s\n' % '\n'.join(lines))
+            return 1
+        print('power_model: user_config.h matches the model')
+        return 0
+
+    if sys.argv[1:]:
+        raise SystemExit('usage: power_model.py [--check]')
+
+    print('\n'.join(lines))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,395 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      sim.c
+ *
+ *  DESCRIPTION
+ *      Runs the application on the host emulation from a script of timed
+ *      commands, printing the notifications it sends. See host/README.txt
+ *      for the script commands.
+ *
+ *      Usage: sim [-v] [-interval <1.25 ms units>] [-latency <events>]
+ *                 [-reject] <script>
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  System Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "emu.h"
+#include "app_gatt_db.h"
+#include "health_thermometer.h"
+#include "bond_table.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+#define SIM_LINE_MAX                        (256)
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static const char *const g_sim_state_names[app_state_max] =
+{
+    "init", "fast_advertising", "slow_advertising", "connected",
+    "disconnecting", "idle"
+};
+
+/* Compiler flags of user_config.h a script may require */
+static const char *const g_sim_features[] =
+{
+#ifdef ENABLE_POWER_LADDER
+    "ENABLE_POWER_LADDER",
+#endif /* ENABLE_POWER_LADDER */
+#ifdef ENABLE_TX_POWER_CONTROL
+    "ENABLE_TX_POWER_CONTROL",
+#endif /* ENABLE_TX_POWER_CONTROL */
+#ifdef ENABLE_PIO_CTRLR_COUNTING
+    "ENABLE_PIO_CTRLR_COUNTING",
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
+    NULL
+};
+
+/* Notifications sent so far */
+static uint32 g_sim_notifications;
+
+/* Switch octet and GHG and BP counts of the last key report */
+static uint8 g_sim_switchs = 0xff;
+static uint8 g_sim_ghg_count;
+static uint8 g_sim_bp_count;
+
+/* A feature the script requires is not built in */
+static bool g_sim_skipped;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void simNotification(const EMU_NOTIFICATION_T *p_not);
+static void simRelease(uint32 pio);
+static bool simCommand(const char *line, uint32 line_number);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      simNotification
+ *
+ *  DESCRIPTION
+ *      This function prints a notification once it is sent or dropped.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void simNotification(const EMU_NOTIFICATION_T *p_not)
+{
+    uint16 index;
+
+    if(p_not->dropped)
+    {
+        printf("%10.3f ms  dropped handle 0x%04x\n",
+               EmuNow() / 1000.0, p_not->handle);
+        return;
+    }
+
+    g_sim_notifications++;
+    if(p_not->handle == HANDLE_HT_TEMP_MEASUREMENT && p_not->size > 3)
+    {
+        g_sim_switchs = p_not->value[3];
+        g_sim_ghg_count = p_not->value[2];
+        g_sim_bp_count = p_not->value[1];
+    }
+    printf("%10.3f ms  notify  handle 0x%04x:", p_not->air_time / 1000.0,
+           p_not->handle);
+    for(index = 0; index < p_not->size; index++)
+    {
+        printf(" %02x", p_not->value[index]);
+    }
+    printf("  (%.3f ms after the call)\n",
+           (p_not->air_time - p_not->call_time) / 1000.0);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      simRelease
+ *
+ *  DESCRIPTION
+ *      This function releases a pressed button.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void simRelease(uint32 pio)
+{
+    EmuPioSet((uint16)pio, TRUE);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      simCommand
+ *
+ *  DESCRIPTION
+ *      This function runs the emulation up to the time of a script line and
+ *      carries out its command.
+ *
+ *  RETURNS
+ *      FALSE if the line is wrong or its expectation failed.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool simCommand(const char *line, uint32 line_number)
+{
+    double time_ms;
+    char command[32] = "";
+    char word[32] = "";
+    char name[32] = "";
+    unsigned a = 0, b = 0, c = 0;
+    int fields;
+
+    if(sscanf(line, " %lf %31s", &time_ms, command) != 2)
+    {
+        fprintf(stderr, "line %u: expected '<ms> <command>'\n", line_number);
+        return FALSE;
+    }
+
+    EmuRunUntil((emu_time)(time_ms * MILLISECOND));
+    line = strstr(line, command) + strlen(command);
+
+    if(strcmp(command, "pio") == 0 &&
+       sscanf(line, "%u %u", &a, &b) == 2)
+    {
+        EmuPioSet((uint16)a, (bool)b);
+    }
+    else if(strcmp(command, "press") == 0 &&
+            sscanf(line, "%u %u", &a, &b) == 2)
+    {
+        /* Press for 'b' ms */
+        EmuPioSet((uint16)a, FALSE);
+        EmuAt(EmuNow() + b * MILLISECOND, simRelease, a);
+    }
+    else if(strcmp(command, "burst") == 0 &&
+            sscanf(line, "%u %u", &a, &b) == 2)
+    {
+        /* 'b' edges before the application gets to run */
+        for(c = 0; c < b; c++)
+        {
+            EmuPioSet((uint16)a, (EmuPioGet() & (1UL << a)) == 0);
+        }
+    }
+    else if(strcmp(command, "disconnect") == 0)
+    {
+        fields = sscanf(line, "%x", &a);
+        EmuPeerDisconnect(fields == 1 ? a : HCI_ERROR_OETC_USER);
+    }
+    else if(strcmp(command, "linkloss") == 0)
+    {
+        EmuLinkLoss();
+    }
+    else if(strcmp(command, "peer") == 0 &&
+            sscanf(line, "%31s %31s", word, name) >= 1)
+    {
+        if(strcmp(word, "stranger") == 0)
+        {
+            /* A central which is not bonded comes into range instead */
+            EmuPeerReplace(strcmp(name, "resolvable") == 0);
+            EmuPeerSetPresent(TRUE);
+        }
+        else
+        {
+            EmuPeerSetPresent(strcmp(word, "present") == 0);
+        }
+    }
+    else if(strcmp(command, "update") == 0 &&
+            sscanf(line, "%u %u %u", &a, &b, &c) == 3)
+    {
+        EmuPeerUpdateParams((uint16)a, (uint16)b, (uint16)c);
+    }
+    else if(strcmp(command, "expect") == 0 &&
+            sscanf(line, "%31s %31s", word, name) >= 1)
+    {
+        if(strcmp(word, "notifications") == 0)
+        {
+            a = (unsigned)atoi(name);
+            if(g_sim_notifications < a)
+            {
+                fprintf(stderr, "line %u: %u notifications, expected %u\n",
+                        line_number, g_sim_notifications, a);
+                return FALSE;
+            }
+        }
+        else if(strcmp(word, "switchs") == 0)
+        {
+            a = (unsigned)strtoul(name, NULL, 16);
+            if(g_sim_switchs != a)
+            {
+                fprintf(stderr, "line %u: switchs %02x, expected %02x\n",
+                        line_number, g_sim_switchs, a);
+                return FALSE;
+            }
+        }
+        else if(strcmp(word, "counts") == 0 &&
+                sscanf(line, "%*s %u %u", &a, &b) == 2)
+        {
+            if(g_sim_ghg_count != a || g_sim_bp_count != b)
+            {
+                fprintf(stderr, "line %u: counts %u %u, expected %u %u\n",
+                        line_number, g_sim_ghg_count, g_sim_bp_count, a, b);
+                return FALSE;
+            }
+        }
+        else if(strcmp(word, "bonds") == 0)
+        {
+            a = (unsigned)atoi(name);
+            if(BondTableCount() != a)
+            {
+                fprintf(stderr, "line %u: %u bonds, expected %u\n",
+                        line_number, BondTableCount(), a);
+                return FALSE;
+            }
+        }
+        else if(strcmp(word, "dormant") == 0)
+        {
+            if(!EmuIsDormant())
+            {
+                fprintf(stderr, "line %u: not dormant\n", line_number);
+                return FALSE;
+            }
+        }
+        else if(strcmp(word, "state") != 0 ||
+                g_ht_data.state >= app_state_max ||
+                strcmp(name, g_sim_state_names[g_ht_data.state]) != 0)
+        {
+            fprintf(stderr, "line %u: state %s, expected %s %s\n",
+                    line_number, g_ht_data.state < app_state_max ?
+                    g_sim_state_names[g_ht_data.state] : "?", word, name);
+            return FALSE;
+        }
+    }
+    else if(strcmp(command, "requires") == 0 &&
+            sscanf(line, "%31s", word) == 1)
+    {
+        /* !<flag> requires the flag to be turned off */
+        b = (word[0] == '!');
+
+        for(a = 0; g_sim_features[a] != NULL &&
+                   strcmp(g_sim_features[a], word + b) != 0; a++)
+        {
+        }
+
+        g_sim_skipped = ((g_sim_features[a] == NULL) != b);
+        if(g_sim_skipped)
+        {
+            printf("skipped, built %s %s\n", b ? "with" : "without",
+                   word + b);
+        }
+    }
+    else if(strcmp(command, "end") != 0)
+    {
+        fprintf(stderr, "line %u: unknown command '%s'\n", line_number,
+                command);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    EMU_CONFIG_T config;
+    char line[SIM_LINE_MAX];
+    uint32 line_number = 0;
+    const char *script = NULL;
+    FILE *p_file;
+    int arg;
+
+    EmuDefaultConfig(&config);
+
+    for(arg = 1; arg < argc; arg++)
+    {
+        if(strcmp(argv[arg], "-v") == 0)
+        {
+            config.verbose = TRUE;
+        }
+        else if(strcmp(argv[arg], "-interval") == 0 && arg + 1 < argc)
+        {
+            config.peer.conn_interval = (uint16)atoi(argv[++arg]);
+        }
+        else if(strcmp(argv[arg], "-latency") == 0 && arg + 1 < argc)
+        {
+            config.peer.conn_latency = (uint16)atoi(argv[++arg]);
+        }
+        else if(strcmp(argv[arg], "-reject") == 0)
+        {
+            config.peer.policy = emu_policy_reject;
+        }
+        else
+        {
+            script = argv[arg];
+        }
+    }
+
+    if(script == NULL || (p_file = fopen(script, "r")) == NULL)
+    {
+        fprintf(stderr, "usage: sim [-v] [-interval <n>] [-latency <n>] "
+                        "[-reject] <script>\n");
+        return 1;
+    }
+
+    EmuSetNotificationHook(simNotification);
+    EmuBoot(&config);
+
+    while(fgets(line, sizeof(line), p_file) != NULL)
+    {
+        line_number++;
+        line[strcspn(line, "#\r\n")] = '\0';
+        if(strspn(line, " \t") == strlen(line))
+        {
+            continue;
+        }
+
+        if(!simCommand(line, line_number))
+        {
+            fclose(p_file);
+            return 1;
+        }
+
+        if(g_sim_skipped)
+        {
+            fclose(p_file);
+            return 0;
+        }
+    }
+    fclose(p_file);
+
+    printf("%10.3f ms  state %s, %u notifications%s\n", EmuNow() / 1000.0,
+           g_sim_state_names[g_ht_data.state], g_sim_notifications,
+           EmuIsDormant() ? ", dormant" : "");
+
+    return 0;
+}
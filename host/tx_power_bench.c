@@ -0,0 +1,368 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      tx_power_bench.c
+ *
+ *  DESCRIPTION
+ *      Replays RSSI traces on the link to the peer, the RSSI being changed
+ *      once a second, and checks that the transmit power control of
+ *      tx_power.c settles on the lowest level which keeps the host
+ *      TX_POWER_MARGIN dB above TX_POWER_TARGET_RSSI: stepping down within
+ *      TX_POWER_DOWN_SAMPLES samples a level, and stepping up by the next
+ *      sample when the link fades. See host/README.txt.
+ *
+ *      Usage: tx_power_bench
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  System Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "emu.h"
+#include "health_thermometer.h"
+#include "tx_power.h"
+
+#ifdef ENABLE_TX_POWER_CONTROL
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* The peer has connected and the control started by then */
+#define TB_CONNECTED_TIME                   (1500 * MILLISECOND)
+
+/* Samples the smoothed RSSI takes to follow a rise of the link to within a
+ * dB, on top of those the levels take to step down
+ */
+#define TB_SMOOTHING_SAMPLES                (12)
+
+/* Segments of a trace at most */
+#define TB_SEGMENTS_MAX                     (4)
+
+/* Transmit power of each level in dBm, as tx_power.c has them */
+static const int16 g_tb_level_dbm[] = { -18, -14, -10, -6, -2, 2, 6, 8 };
+
+#define TB_LEVELS       (sizeof(g_tb_level_dbm) / sizeof(g_tb_level_dbm[0]))
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Part of a trace, at one RSSI give or take a jitter */
+typedef struct
+{
+    /* Length in samples */
+    uint16                          samples;
+
+    /* RSSI and the most it strays either way, in dBm */
+    int16                           rssi;
+    int16                           jitter;
+
+} TB_SEGMENT_T;
+
+/* RSSI trace */
+typedef struct
+{
+    const char                     *name;
+    TB_SEGMENT_T                    segments[TB_SEGMENTS_MAX];
+
+} TB_TRACE_T;
+
+/* Result of a segment, left by the process of its trace for the parent */
+typedef struct
+{
+    /* Samples taken to settle within the levels allowed, or more than the
+     * segment if it never did
+     */
+    uint16                          settle;
+
+    /* The most samples settling may take */
+    uint16                          bound;
+
+    /* Levels allowed, and the level at the end of the segment */
+    uint16                          low;
+    uint16                          high;
+    uint16                          level;
+
+    /* Energy of a key report at the end of the segment, in nJ */
+    uint16                          energy;
+
+} TB_RESULT_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static const TB_TRACE_T g_tb_traces[] =
+{
+    /* Next to the host, down from full power to the lowest level */
+    {"near",    {{60, -50, 0}}},
+
+    /* Out of reach of the margin, full power all along */
+    {"far",     {{30, -95, 0}}},
+
+    /* A fade and back */
+    {"fade",    {{60, -50, 0}, {15, -75, 0}, {60, -50, 0}}},
+
+    /* A link which keeps moving by a few dB */
+    {"jitter",  {{60, -62, 4}}},
+
+    /* Walking away from the host and back */
+    {"walk",    {{40, -55, 0}, {40, -65, 0}, {40, -72, 0}, {60, -55, 0}}}
+};
+
+#define TB_TRACES       (sizeof(g_tb_traces) / sizeof(g_tb_traces[0]))
+
+/* Results of the traces, shared with their processes */
+static TB_RESULT_T (*g_tb_results)[TB_SEGMENTS_MAX];
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static uint16 tbLevelFor(int16 rssi);
+static void tbRun(const TB_TRACE_T *p_trace, TB_RESULT_T *p_results);
+static bool tbFork(uint16 index);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      tbLevelFor
+ *
+ *  DESCRIPTION
+ *      This function works out the lowest level at which the host sees
+ *      TX_POWER_TARGET_RSSI plus TX_POWER_MARGIN over a link of the RSSI
+ *      given, the path loss being the same both ways.
+ *
+ *  RETURNS
+ *      The level.
+ *
+ *---------------------------------------------------------------------------*/
+
+static uint16 tbLevelFor(int16 rssi)
+{
+    int16 needed = TX_POWER_TARGET_RSSI + TX_POWER_MARGIN +
+                   TX_POWER_HOST_TX_POWER - rssi;
+    uint16 level;
+
+    for(level = 0; level < TB_LEVELS - 1 && g_tb_level_dbm[level] < needed;
+        level++)
+    {
+    }
+
+    return level;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      tbRun
+ *
+ *  DESCRIPTION
+ *      This function boots the application, connects the peer and replays a
+ *      trace, recording for each segment the samples the level took to
+ *      settle within the levels the RSSI of the segment calls for.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void tbRun(const TB_TRACE_T *p_trace, TB_RESULT_T *p_results)
+{
+    EMU_CONFIG_T config;
+    emu_time time = TB_CONNECTED_TIME;
+    uint32 random = 1;
+    uint16 segment;
+    uint16 sample;
+    uint16 start;
+    uint16 level;
+    int16 jitter;
+
+    EmuDefaultConfig(&config);
+    config.peer.rssi = p_trace->segments[0].rssi;
+    EmuBoot(&config);
+    EmuRunUntil(time);
+
+    if(!EmuIsConnected())
+    {
+        fprintf(stderr, "tx_power_bench: not connected\n");
+        return;
+    }
+
+    for(segment = 0; segment < TB_SEGMENTS_MAX &&
+                     p_trace->segments[segment].samples != 0; segment++)
+    {
+        const TB_SEGMENT_T *p_segment = &p_trace->segments[segment];
+        TB_RESULT_T *p_result = &p_results[segment];
+
+        p_result->low = tbLevelFor(p_segment->rssi + p_segment->jitter);
+        p_result->high = tbLevelFor(p_segment->rssi - p_segment->jitter);
+        p_result->settle = 0;
+
+        /* Stepping down takes TX_POWER_DOWN_SAMPLES samples a level once the
+         * smoothed RSSI has caught up, stepping up the next sample
+         */
+        start = TxPowerGetLevel();
+        p_result->bound = 2;
+        if(start > p_result->high)
+        {
+            p_result->bound = (start - p_result->high) *
+                              TX_POWER_DOWN_SAMPLES + TB_SMOOTHING_SAMPLES;
+        }
+
+        for(sample = 0; sample < p_segment->samples; sample++)
+        {
+            jitter = 0;
+            if(p_segment->jitter != 0)
+            {
+                random = random * 1103515245 + 12345;
+                jitter = (int16)((random >> 16) %
+                                 (2 * p_segment->jitter + 1)) -
+                         p_segment->jitter;
+            }
+
+            EmuPeer()->rssi = (int8)(p_segment->rssi + jitter);
+            time += SECOND;
+            EmuRunUntil(time);
+
+            level = TxPowerGetLevel();
+            if(level < p_result->low || level > p_result->high)
+            {
+                /* Not settled yet, or not any more */
+                p_result->settle = sample + 1;
+            }
+        }
+
+        p_result->level = TxPowerGetLevel();
+        p_result->energy = TxPowerReportEnergy();
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      tbFork
+ *
+ *  DESCRIPTION
+ *      This function replays the trace of the given index in a process of
+ *      its own, as the application statics can't be reset.
+ *
+ *  RETURNS
+ *      TRUE if the process exited with status 0.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool tbFork(uint16 index)
+{
+    pid_t pid;
+    int status;
+
+    fflush(NULL);
+    pid = fork();
+
+    if(pid == 0)
+    {
+        tbRun(&g_tb_traces[index], g_tb_results[index]);
+        fflush(NULL);
+        _exit(0);
+    }
+
+    return (pid > 0 && waitpid(pid, &status, 0) == pid &&
+            WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+#endif /* ENABLE_TX_POWER_CONTROL */
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+#ifdef ENABLE_TX_POWER_CONTROL
+    const TB_SEGMENT_T *p_segment;
+    const TB_RESULT_T *p_result;
+    bool ok = TRUE;
+    uint16 index;
+    uint16 segment;
+#endif /* ENABLE_TX_POWER_CONTROL */
+
+    if(argc > 1)
+    {
+        fprintf(stderr, "usage: tx_power_bench\n");
+        return 1;
+    }
+
+#ifndef ENABLE_TX_POWER_CONTROL
+    printf("tx_power_bench: skipped, built without "
+           "ENABLE_TX_POWER_CONTROL\n");
+    return 0;
+#else
+    g_tb_results = mmap(NULL, sizeof(*g_tb_results) * TB_TRACES,
+                        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                        -1, 0);
+    if(g_tb_results == MAP_FAILED)
+    {
+        perror("tx_power_bench: mmap");
+        return 1;
+    }
+
+    printf("trace    samples  rssi dBm  levels  level  settled  bound  "
+           "nJ/report\n");
+
+    for(index = 0; index < TB_TRACES; index++)
+    {
+        if(!tbFork(index))
+        {
+            fprintf(stderr, "tx_power_bench: the %s trace failed\n",
+                    g_tb_traces[index].name);
+            return 1;
+        }
+
+        for(segment = 0; segment < TB_SEGMENTS_MAX; segment++)
+        {
+            p_segment = &g_tb_traces[index].segments[segment];
+            p_result = &g_tb_results[index][segment];
+
+            if(p_segment->samples == 0)
+            {
+                break;
+            }
+
+            printf("%-8s %7u  %4d +-%-2d  %3u-%-2u  %5u  %7u  %5u  %9u\n",
+                   segment == 0 ? g_tb_traces[index].name : "",
+                   p_segment->samples, p_segment->rssi, p_segment->jitter,
+                   p_result->low, p_result->high, p_result->level,
+                   p_result->settle, p_result->bound, p_result->energy);
+
+            if(p_result->settle > p_result->bound)
+            {
+                fprintf(stderr, "tx_power_bench: %s segment %u settled "
+                                "after %u samples, expected %u at most\n",
+                        g_tb_traces[index].name, segment, p_result->settle,
+                        p_result->bound);
+                ok = FALSE;
+            }
+        }
+    }
+
+    return ok ? 0 : 1;
+#endif /* ENABLE_TX_POWER_CONTROL */
+}
@@ -38,6 +38,10 @@
 #include "dev_info_service.h"
 #include "dev_info_uuids.h"
 #include "battery_uuids.h"
+#include "diag_service.h"
+#include "hid_service.h"
+#include "hid_uuids.h"
+#include "bond_table.h"
 
 /*============================================================================*
  *  Private Definitions
@@ -89,14 +93,14 @@ static void gattAdvertTimerHandler(timer_id tid);
 static void addDeviceNameToAdvData(uint16 adv_data_len, uint16 scan_data_len)
 {
 
-    uint8 *p_device_name = NULL;
+    uint8 device_name[DEVICE_NAME_MAX_LENGTH + 1];
     uint16 device_name_adtype_len;
 
     /* Read device name along with AD Type and its length */
-    p_device_name = GapGetNameAndLength(&device_name_adtype_len);
+    device_name_adtype_len = GapGetNameAdData(device_name);
 
     /* Add complete device name to Advertisement data */
-    p_device_name[0] = AD_TYPE_LOCAL_NAME_COMPLETE;
+    device_name[0] = AD_TYPE_LOCAL_NAME_COMPLETE;
 
     /* Increment device_name_length by one to account for length field
      * which will be added by the GAP layer. 
@@ -108,7 +112,7 @@ static void addDeviceNameToAdvData(uint16 adv_data_len, uint16 scan_data_len)
     if((device_name_adtype_len + 1) <= (MAX_ADV_DATA_LEN - adv_data_len))
     {
         /* Add Complete Device Name to Advertisement Data */
-        if (LsStoreAdvScanData(device_name_adtype_len , p_device_name, 
+        if (LsStoreAdvScanData(device_name_adtype_len , device_name, 
                       ad_src_advertise) != ls_err_none)
         {
             ReportPanic(app_panic_set_advert_data);
@@ -119,7 +123,7 @@ static void addDeviceNameToAdvData(uint16 adv_data_len, uint16 scan_data_len)
     else if((device_name_adtype_len + 1) <= (MAX_ADV_DATA_LEN - scan_data_len)) 
     {
         /* Add Complete Device Name to Scan Response Data */
-        if (LsStoreAdvScanData(device_name_adtype_len , p_device_name, 
+        if (LsStoreAdvScanData(device_name_adtype_len , device_name, 
                       ad_src_scan_rsp) != ls_err_none)
         {
             ReportPanic(app_panic_set_scan_rsp_data);
@@ -135,9 +139,9 @@ static void addDeviceNameToAdvData(uint16 adv_data_len, uint16 scan_data_len)
                                            */
     {
         /* Add shortened device name to Advertisement data */
-        p_device_name[0] = AD_TYPE_LOCAL_NAME_SHORT;
+        device_name[0] = AD_TYPE_LOCAL_NAME_SHORT;
 
-       if (LsStoreAdvScanData(SHORTENED_DEV_NAME_LEN , p_device_name, 
+       if (LsStoreAdvScanData(SHORTENED_DEV_NAME_LEN , device_name, 
                       ad_src_advertise) != ls_err_none)
         {
             ReportPanic(app_panic_set_advert_data);
@@ -147,10 +151,10 @@ static void addDeviceNameToAdvData(uint16 adv_data_len, uint16 scan_data_len)
     else /* Add device name to remaining Scan reponse data space */
     {
         /* Add as much as can be stored in Scan Response data */
-        p_device_name[0] = AD_TYPE_LOCAL_NAME_SHORT;
+        device_name[0] = AD_TYPE_LOCAL_NAME_SHORT;
 
        if (LsStoreAdvScanData(MAX_ADV_DATA_LEN - scan_data_len, 
-                                    p_device_name, 
+                                    device_name, 
                                     ad_src_scan_rsp) != ls_err_none)
         {
             ReportPanic(app_panic_set_scan_rsp_data);
@@ -189,8 +193,8 @@ static void gattSetAdvertParams(bool fast_connection)
 
     uint8 device_appearance[ATTR_LEN_DEVICE_APPEARANCE + 1] = {
                 AD_TYPE_APPEARANCE,
-                LE8_L(APPEARANCE_THERMOMETER_VALUE),
-                LE8_H(APPEARANCE_THERMOMETER_VALUE)
+                LE8_L(APP_APPEARANCE_VALUE),
+                LE8_H(APP_APPEARANCE_VALUE)
                 };
 
     /* A variable to keep track of the data added to AdvData. The limit is 
@@ -367,6 +371,18 @@ extern void HandleAccessRead(GATT_ACCESS_IND_T *p_ind)
         /* Attribute handle belongs to Device Information service */
         DeviceInfoHandleAccessRead(p_ind);
     }
+#ifdef ENABLE_HID_MODE
+    else if(HidCheckHandleRange(p_ind->handle))
+    {
+        /* Attribute handle belongs to HID service */
+        HidHandleAccessRead(p_ind);
+    }
+#endif /* ENABLE_HID_MODE */
+    else if(DiagCheckHandleRange(p_ind->handle))
+    {
+        /* Attribute handle belongs to Diagnostics service */
+        DiagHandleAccessRead(p_ind);
+    }
     else
     {
         /* Application doesn't support 'Read' operation on received 
@@ -416,6 +432,18 @@ extern void HandleAccessWrite(GATT_ACCESS_IND_T *p_ind)
         /* Attribute handle belongs to Battery service */
         BatteryHandleAccessWrite(p_ind);
     }
+#ifdef ENABLE_HID_MODE
+    else if(HidCheckHandleRange(p_ind->handle))
+    {
+        /* Attribute handle belongs to HID service */
+        HidHandleAccessWrite(p_ind);
+    }
+#endif /* ENABLE_HID_MODE */
+    else if(DiagCheckHandleRange(p_ind->handle))
+    {
+        /* Attribute handle belongs to Diagnostics service */
+        DiagHandleAccessWrite(p_ind);
+    }
     else
     {
         /* Application doesn't support 'Write' operation on received 
@@ -463,10 +491,10 @@ extern void GattStartAdverts(bool fast_connection)
 
     /* If white list is enabled, set the controller's advertising filter policy 
      * to "process scan and connection requests only from devices in the White 
-     * List"
+     * List". Advertisements are only left open to any host in the pairing
+     * window, so that a further host can bond while the table holds bonds.
      */
-    if(g_ht_data.bonded &&
-       (!GattIsAddressResolvableRandom(&(g_ht_data.bonded_bd_addr))))
+    if(BondTableWhiteListUsable() && !g_ht_data.pairing_window)
     {
         connect_flags = L2CAP_CONNECTION_SLAVE_WHITELIST |
                        L2CAP_OWN_ADDR_TYPE_PUBLIC;
@@ -536,6 +564,12 @@ extern uint16 GetSupported16BitUUIDServiceList(uint8 *p_service_uuid_ad)
     p_service_uuid_ad[i++] = LE8_L(UUID_HEALTH_THERMOMETER_SERVICE);
     p_service_uuid_ad[i++] = LE8_H(UUID_HEALTH_THERMOMETER_SERVICE);
 
+#ifdef ENABLE_HID_MODE
+    /* HID hosts only connect to devices advertising the HID service */
+    p_service_uuid_ad[i++] = LE8_L(UUID_HID_SERVICE);
+    p_service_uuid_ad[i++] = LE8_H(UUID_HID_SERVICE);
+#endif /* ENABLE_HID_MODE */
+
     return ((uint16)i);
 
 }
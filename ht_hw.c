@@ -18,6 +18,8 @@
 #include <pio.h>
 #include <pio_ctrlr.h>
 #include <timer.h>
+#include <time.h>
+#include <mem.h>
 #include "battery_service.h"
 /*============================================================================*
  *  Local Header Files
@@ -30,6 +32,14 @@
 #include "app_gatt_db.h"
 #include "app_gatt.h"
 #include "user_config.h"
+#include "app_trace.h"
+#include "app_perf.h"
+#include "counter_store.h"
+#include "signal_seq.h"
+#include "app_sched.h"
+#include "pulse_ctrlr.h"
+#include "hid_service.h"
+#include "throttle.h"
 
 
 /*============================================================================*
@@ -60,32 +70,45 @@
 #define BUTTON_GHG_MASK          (PIO_BIT_MASK(BUTTON_GHG))
 #define BUTTON_BP_MASK           (PIO_BIT_MASK(BUTTON_BP))
 
-/* PIO direction */
-#define PIO_DIRECTION_INPUT     (FALSE)
-#define PIO_DIRECTION_OUTPUT    (TRUE)
+/* Number of keys whose edge rate is tracked, see input_key_masks */
+#ifdef ENABLE_PIO_CTRLR_COUNTING
+#define INPUT_KEYS              (4)
+#else
+#define INPUT_KEYS              (6)
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
 
-/* Extra long button press timer */
-#define EXTRA_LONG_BUTTON_PRESS_TIMER \
-                                (4*SECOND)
+#ifdef LADDER_DORMANT
+/* Keys reported when held down on waking from dormant. The counter keys are
+ * left out, as a pulse would be counted twice.
+ */
+#define WAKE_KEYS_MASK          (BUTTON_LEFT_MASK | BUTTON_RIGHT_MASK | \
+                                 BUTTON_FASTER_MASK | BUTTON_BRAKE_MASK)
+#endif /* LADDER_DORMANT */
 
-#ifdef ENABLE_BUZZER
+/* Mask used to wrap the input event queue indices */
+#define INPUT_QUEUE_MASK        (INPUT_QUEUE_SIZE - 1)
 
-/* The index (0-3) of the PWM unit to be configured */
-#define BUZZER_PWM_INDEX_0      (0)
+#ifndef ENABLE_PIO_CTRLR_COUNTING
+/* Keys whose presses are counted */
+#define COUNTER_KEYS_MASK       (BUTTON_GHG_MASK | BUTTON_BP_MASK)
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
 
-/* PWM parameters for Buzzer */
+/* PIO direction */
+#define PIO_DIRECTION_INPUT     (FALSE)
+#define PIO_DIRECTION_OUTPUT    (TRUE)
 
-/* Dull on. off and hold times ,30usΪλ*/
-#define DULL_BUZZ_ON_TIME       (2)    /* 60us */
-#define DULL_BUZZ_OFF_TIME      (15)   /* 450us */
-#define DULL_BUZZ_HOLD_TIME     (0)
+#ifdef ENABLE_BUZZER
 
-/* Bright on, off and hold times */
-#define BRIGHT_BUZZ_ON_TIME     (2)    /* 60us */
-#define BRIGHT_BUZZ_OFF_TIME    (15)   /* 450us */
-#define BRIGHT_BUZZ_HOLD_TIME   (0)    /* 0us */
+/* Steps the beep patterns are made of */
+#define BEEP_SHORT_STEP         {SIGNAL_LEVEL_BEEP, \
+                                 SIGNAL_DURATION(SHORT_BEEP_TIMER_VALUE)}
+#define BEEP_LONG_STEP          {SIGNAL_LEVEL_BEEP, \
+                                 SIGNAL_DURATION(LONG_BEEP_TIMER_VALUE)}
+#define BEEP_GAP_STEP           {SIGNAL_LEVEL_OFF, \
+                                 SIGNAL_DURATION(BEEP_GAP_TIMER_VALUE)}
 
-#define BUZZ_RAMP_RATE          (0xFF)
+/* Entry of the beep pattern table */
+#define BEEP_PATTERN(steps)     {(steps), sizeof(steps) / sizeof((steps)[0])}
 
 #endif /* ENABLE_BUZZER */
                                         
@@ -96,354 +119,278 @@ typedef enum _button_state
     button_state_up,         /* Button was released */
     button_state_unknown     /* Button state is unknown */
 } BUTTON_STATE_T;     
-/*============================================================================*
- *  Public data
- *============================================================================*/
-
-/* Blood pressure application hardware data instance */
-APP_HW_DATA_T                   g_app_hw_data;
-
-static BUTTON_STATE_T ghg_state = button_state_unknown;
-static BUTTON_STATE_T bp_state = button_state_unknown;
 
-uint8 ghg_count=0;
-uint8 bp_count=0;
+/* Priority of a key in the input path */
+typedef enum
+{
+    /* Counter keys. Their changes may be held back for up to
+     * REPORT_COALESCE_DELAY and merged into one report.
+     */
+    input_prio_low,
 
+    /* Keys reported at once, along with any change held back */
+    input_prio_normal,
 
-/*============================================================================*
- *  Private Function Implementations
- *============================================================================*/
+    /* Keys reported at once which also ask for the low latency connection
+     * parameters
+     */
+    input_prio_high
 
-#ifdef ENABLE_BUZZER
+} input_prio;
 
-/*----------------------------------------------------------------------------*
- *  NAME
- *      appBuzzerTimerHandler
- *
- *  DESCRIPTION
- *      This function is used to stop the Buzzer at the expiry of 
- *      timer.
- *
- *  RETURNS/MODIFIES
- *      Nothing.
- *
- *---------------------------------------------------------------------------*/
-static void appBuzzerTimerHandler(timer_id tid)
+/* Priority of a key */
+typedef struct
 {
-    uint32 beep_timer = SHORT_BEEP_TIMER_VALUE;
-
-    g_app_hw_data.buzzer_tid = TIMER_INVALID;
-
-    switch(g_app_hw_data.beep_type)
-    {
-        case buzzer_beep_short: /* FALLTHROUGH */
-        case buzzer_beep_long:
-        {
-            g_app_hw_data.beep_type = buzzer_beep_off;
+    uint32                      mask;
+    input_prio                  prio;
 
-            /* Disable buzzer */
-            PioEnablePWM(BUZZER_PWM_INDEX_0, FALSE);
-        }
-        break;
-        case buzzer_beep_twice:
-        {
-            if(g_app_hw_data.beep_count == 0)
-            {
-                /* First beep sounded. Start the silent gap*/
-                g_app_hw_data.beep_count = 1;
+} INPUT_KEY_PRIO_T;
 
-                /* Disable buzzer */
-                PioEnablePWM(BUZZER_PWM_INDEX_0, FALSE);
+/* PIO changed event waiting to be decoded */
+typedef struct
+{
+    /* PIO cause and state of the event */
+    uint32                      cause;
+    uint32                      state;
 
-                /* Time gap between two beeps */
-                beep_timer = BEEP_GAP_TIMER_VALUE;
-            }
-            else if(g_app_hw_data.beep_count == 1)
-            {
-                g_app_hw_data.beep_count = 2;
+    /* Time the event was received */
+    uint32                      time;
 
-                /* Enable buzzer */
-                PioEnablePWM(BUZZER_PWM_INDEX_0, TRUE);
+} INPUT_EVENT_T;
 
-                /* Start another short beep */
-                beep_timer = SHORT_BEEP_TIMER_VALUE;
-            }
-            else
-            {
-                /* Two beeps have been sounded. Stop buzzer now*/
-                g_app_hw_data.beep_count = 0;
+#ifdef ENABLE_HID_MODE
+/* HID key reported for a key PIO */
+typedef struct
+{
+    uint32                      mask;
+    uint16                      key;
 
-                /* Disable buzzer */
-                PioEnablePWM(BUZZER_PWM_INDEX_0, FALSE);
+} INPUT_HID_KEY_T;
+#endif /* ENABLE_HID_MODE */
 
-                g_app_hw_data.beep_type = buzzer_beep_off;
-            }
-        }
-        break;
-        case buzzer_beep_thrice:
-        {
-            if(g_app_hw_data.beep_count == 0 ||
-               g_app_hw_data.beep_count == 2)
-            {
-                /* First beep sounded. Start the silent gap*/
-                ++ g_app_hw_data.beep_count;
+#ifdef ENABLE_BUZZER
+/* Signal pattern sounded for a beep type */
+typedef struct
+{
+    /* Steps of the pattern, held in ROM */
+    const SIGNAL_STEP_T         *p_steps;
 
-                /* Disable buzzer */
-                PioEnablePWM(BUZZER_PWM_INDEX_0, FALSE);
+    /* Number of steps, zero to silence the buzzer */
+    uint16                      num_steps;
 
-                /* Time gap between two beeps */
-                beep_timer = BEEP_GAP_TIMER_VALUE;
-            }
-            else if(g_app_hw_data.beep_count == 1 ||
-                    g_app_hw_data.beep_count == 3)
-            {
-                ++ g_app_hw_data.beep_count;
+} BEEP_PATTERN_T;
+#endif /* ENABLE_BUZZER */
 
-                /* Enable buzzer */
-                PioEnablePWM(BUZZER_PWM_INDEX_0, TRUE);
+/* Key input data type. Keys changing faster than INPUT_STORM_EDGES per
+ * INPUT_STORM_WINDOW cost a wake-up per edge, so they are sampled every
+ * INPUT_POLL_INTERVAL instead until they calm down.
+ */
+typedef struct
+{
+    /* Start of the current edge counting window */
+    uint32                      window_start;
 
-                beep_timer = SHORT_BEEP_TIMER_VALUE;
-            }
-            else
-            {
-                /* Two beeps have been sounded. Stop buzzer now*/
-                g_app_hw_data.beep_count = 0;
+    /* Edges of each key in the current window, indexed as input_key_masks */
+    uint16                      edges[INPUT_KEYS];
 
-                /* Disable buzzer */
-                PioEnablePWM(BUZZER_PWM_INDEX_0, FALSE);
+    /* Keys being polled instead of raising PIO changed events */
+    uint32                      poll_mask;
 
-                g_app_hw_data.beep_type = buzzer_beep_off;
-            }
-        }
-        break;
+    /* PIO state at the last poll */
+    uint32                      last_state;
 
-        default:
-        {
-            /* No such beep type */
-            ReportPanic(app_panic_unexpected_beep_type);
-            /* Though break statement will not be executed after panic but this
-             * has been kept to avoid any confusion for default case.
-             */
-        }
-        break;
-    }
+    /* Boolean flag set while a report of low priority changes is held
+     * back
+     */
+    bool                        report_pending;
 
-    if(g_app_hw_data.beep_type != buzzer_beep_off)
-    {
-        /* start the timer */
-        g_app_hw_data.buzzer_tid = TimerCreate(beep_timer, TRUE, 
-                                               appBuzzerTimerHandler);
-    }
-}
+    /* Report mode set by the host */
+    report_mode                 mode;
 
-#endif /* ENABLE_BUZZER*/
+    /* PIO changed events waiting to be decoded, oldest first from
+     * queue_head
+     */
+    INPUT_EVENT_T               queue[INPUT_QUEUE_SIZE];
+    uint16                      queue_head;
+    uint16                      queue_count;
+
+#ifndef ENABLE_PIO_CTRLR_COUNTING
+    /* Counter keys which changed an odd number of times in the newest event
+     * queued, events merged into it included, and the presses the merges
+     * have lost so far. Two changes of a key merged into one hide exactly
+     * one press, which is added back when the queue is decoded.
+     */
+    uint32                      merged_toggles;
+    uint16                      lost_ghg;
+    uint16                      lost_bp;
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
+
+#ifdef ENABLE_HID_MODE
+    /* Keys held down, as HID_KEY_ bits */
+    uint16                      keys_down;
+#endif /* ENABLE_HID_MODE */
+
+#ifdef ENABLE_POWER_LADDER
+    /* Boolean flag set while a report is held until the host reconnects,
+     * and the switch states of all the key events made since
+     */
+    bool                        report_held;
+    uint8                       held_switchs;
+#endif /* ENABLE_POWER_LADDER */
 
+} INPUT_DATA_T;
 
 /*============================================================================*
- *  Public Function Implementations
+ *  Public data
  *============================================================================*/
 
-/*----------------------------------------------------------------------------*
- *  NAME
- *      HtInitHardware
- *
- *  DESCRIPTION
- *      This function is called to initialise Health Thermometer hardware
- *
- *  RETURNS
- *      Nothing.
- *
- *---------------------------------------------------------------------------*/
-
-extern void HtInitHardware(void)
-{
-    /* Setup PIOs
-     * PIO3  - Buzzer
-     * PIO11 - Button
-     */
-    
-    PioSetModes(BUTTON_LEFT_MASK, pio_mode_user);
-    PioSetDir(BUTTON_LEFT, PIO_DIRECTION_INPUT);
-    PioSetPullModes(BUTTON_LEFT_MASK, pio_mode_strong_pull_up);
-    /* Setup button on PIO2 */
-    PioSetEventMask(BUTTON_LEFT_MASK, pio_event_mode_both);
-    
-    PioSetModes(BUTTON_RIGHT_MASK, pio_mode_user);
-    PioSetDir(BUTTON_RIGHT, PIO_DIRECTION_INPUT);
-    PioSetPullModes(BUTTON_RIGHT_MASK, pio_mode_strong_pull_up);
-    /* Setup button on PIO3 */
-    PioSetEventMask(BUTTON_RIGHT_MASK, pio_event_mode_both);
-  
-    PioSetModes(BUTTON_FASTER_MASK, pio_mode_user);
-    PioSetDir(BUTTON_FASTER, PIO_DIRECTION_INPUT);
-    PioSetPullModes(BUTTON_FASTER_MASK, pio_mode_strong_pull_up);
-    /* Setup button on PIO4 */
-    PioSetEventMask(BUTTON_FASTER_MASK, pio_event_mode_both);
-    
-    PioSetModes(BUTTON_BRAKE_MASK, pio_mode_user);
-    PioSetDir(BUTTON_BRAKE, PIO_DIRECTION_INPUT);
-    PioSetPullModes(BUTTON_BRAKE_MASK, pio_mode_strong_pull_up);
-    /* Setup button on PIO9 */
-    PioSetEventMask(BUTTON_BRAKE_MASK, pio_event_mode_both);    
-    
-    PioSetModes(BUTTON_GHG_MASK, pio_mode_user);
-    PioSetDir(BUTTON_GHG, PIO_DIRECTION_INPUT);
-    PioSetPullModes(BUTTON_GHG_MASK, pio_mode_strong_pull_up);
-    /* Setup button on PIO10 */
-    PioSetEventMask(BUTTON_GHG_MASK, pio_event_mode_both);    
-
-    PioSetModes(BUTTON_BP_MASK, pio_mode_user);
-    PioSetDir(BUTTON_BP, PIO_DIRECTION_INPUT);
-    PioSetPullModes(BUTTON_BP_MASK, pio_mode_strong_pull_up);
-    /* Setup button on PIO11 */
-    PioSetEventMask(BUTTON_BP_MASK, pio_event_mode_both);      
-#ifdef ENABLE_BUZZER
-    PioSetModes(BUZZER_PIO_MASK, pio_mode_pwm0);
-
-    /* Configure the buzzer on PIO3 */
-    PioConfigPWM(BUZZER_PWM_INDEX_0, pio_pwm_mode_push_pull, DULL_BUZZ_ON_TIME,
-                 DULL_BUZZ_OFF_TIME, DULL_BUZZ_HOLD_TIME, BRIGHT_BUZZ_ON_TIME,
-                 BRIGHT_BUZZ_OFF_TIME, BRIGHT_BUZZ_HOLD_TIME, BUZZ_RAMP_RATE);
-
-
-    PioEnablePWM(BUZZER_PWM_INDEX_0, FALSE);
-#endif /* ENABLE_BUZZER */
-
-    /* Save power by changing the I2C pull mode to pull down */
-    PioSetI2CPullMode(pio_i2c_pull_mode_strong_pull_down);
-
-}
+/* Blood pressure application hardware data instance */
+APP_HW_DATA_T                   g_app_hw_data;
 
+static BUTTON_STATE_T ghg_state = button_state_unknown;
+static BUTTON_STATE_T bp_state = button_state_unknown;
 
-/*----------------------------------------------------------------------------*
- *  NAME
- *      HtHwDataInit
- *
- *  DESCRIPTION
- *      This function initialises Health Thermometer hardware data structure
- *
- *  RETURNS
- *      Nothing.
- *
- *---------------------------------------------------------------------------*/
+/* Key input data instance */
+static INPUT_DATA_T g_input;
 
-extern void HtHwDataInit(void)
+/* Keys whose edge rate is tracked */
+static const uint32 input_key_masks[INPUT_KEYS] =
 {
-
-    /* Delete button press timer */
-    TimerDelete(g_app_hw_data.button_press_tid);
-    g_app_hw_data.button_press_tid = TIMER_INVALID;
-
-}
-
-
-/*----------------------------------------------------------------------------*
- *  NAME
- *      SoundBuzzer
- *
- *  DESCRIPTION
- *      This function is called to trigger beeps of different types 
- *      'buzzer_beep_type'.
- *
- *  RETURNS/MODIFIES
- *      Nothing.
- *
- *---------------------------------------------------------------------------*/
-
-extern void SoundBuzzer(buzzer_beep_type beep_type)
+    BUTTON_LEFT_MASK,
+    BUTTON_RIGHT_MASK,
+    BUTTON_FASTER_MASK,
+    BUTTON_BRAKE_MASK,
+#ifndef ENABLE_PIO_CTRLR_COUNTING
+    BUTTON_GHG_MASK,
+    BUTTON_BP_MASK
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
+};
+
+/* Priority of each key. Keys not listed are of low priority. */
+static const INPUT_KEY_PRIO_T input_key_prios[] =
 {
-#ifdef ENABLE_BUZZER
-    uint32 beep_timer = SHORT_BEEP_TIMER_VALUE;
-
-    PioEnablePWM(BUZZER_PWM_INDEX_0, FALSE);
-
-    TimerDelete(g_app_hw_data.buzzer_tid);
-    g_app_hw_data.buzzer_tid = TIMER_INVALID;
-
-    g_app_hw_data.beep_count = 0;
+    {BUTTON_LEFT_MASK,      input_prio_normal},
+    {BUTTON_RIGHT_MASK,     input_prio_normal},
+    {BUTTON_FASTER_MASK,    input_prio_normal},
+    {BUTTON_BRAKE_MASK,     input_prio_high},
+    {BUTTON_GHG_MASK,       input_prio_low},
+    {BUTTON_BP_MASK,        input_prio_low}
+};
+
+#ifdef ENABLE_HID_MODE
+/* HID key of each key PIO. The keys pull their PIO low when held down. */
+static const INPUT_HID_KEY_T input_hid_keys[] =
+{
+    {BUTTON_LEFT_MASK,      HID_KEY_LEFT},
+    {BUTTON_RIGHT_MASK,     HID_KEY_RIGHT},
+    {BUTTON_FASTER_MASK,    HID_KEY_FASTER},
+    {BUTTON_BRAKE_MASK,     HID_KEY_BRAKE},
+    {BUTTON_GHG_MASK,       HID_KEY_GHG},
+    {BUTTON_BP_MASK,        HID_KEY_BP}
+};
+#endif /* ENABLE_HID_MODE */
 
-    /* Store the beep type in some global variable. It will used on timer 
-     * expiry to check the type of beeps being sounded.
-     */
-    g_app_hw_data.beep_type = beep_type;
+uint8 ghg_count=0;
+uint8 bp_count=0;
 
-    switch(g_app_hw_data.beep_type)
-    {
-        case buzzer_beep_off:
-        {
-            /* Don't do anything */
-        }
-        break;
+#ifdef ENABLE_BUZZER
+/* Steps of the beep patterns */
+static const SIGNAL_STEP_T beep_short_steps[] =
+{
+    BEEP_SHORT_STEP
+};
 
-        case buzzer_beep_short: /* One short beep will be sounded */
-            /* FALLTHROUGH */
-        case buzzer_beep_twice: /* Two short beeps will be sounded */
-            /* FALLTHROUGH */
-        case buzzer_beep_thrice: /* Three short beeps will be sounded */
-        {
-            beep_timer = SHORT_BEEP_TIMER_VALUE;
-        }
-        break;
+static const SIGNAL_STEP_T beep_long_steps[] =
+{
+    BEEP_LONG_STEP
+};
 
-        case buzzer_beep_long:
-        {
-            /* One long beep will be sounded */
-            beep_timer = LONG_BEEP_TIMER_VALUE;
-        }
-        break;
+static const SIGNAL_STEP_T beep_twice_steps[] =
+{
+    BEEP_SHORT_STEP, BEEP_GAP_STEP, BEEP_SHORT_STEP
+};
 
-        default:
-        {
-            /* No such beep type defined */
-            ReportPanic(app_panic_unexpected_beep_type);
-            /* Though break statement will not be executed after panic but this
-             * has been kept to avoid any confusion for default case.
-             */
-        }
-        break;
-    }
+static const SIGNAL_STEP_T beep_thrice_steps[] =
+{
+    BEEP_SHORT_STEP, BEEP_GAP_STEP, BEEP_SHORT_STEP, BEEP_GAP_STEP,
+    BEEP_SHORT_STEP
+};
 
-    if(g_app_hw_data.beep_type != buzzer_beep_off)
-    {
-        /* Initialize beep count to zero */
-        g_app_hw_data.beep_count = 0;
+/* Beep patterns, indexed by buzzer_beep_type */
+static const BEEP_PATTERN_T beep_patterns[] =
+{
+    {NULL, 0},                          /* buzzer_beep_off */
+    BEEP_PATTERN(beep_short_steps),     /* buzzer_beep_short */
+    BEEP_PATTERN(beep_long_steps),      /* buzzer_beep_long */
+    BEEP_PATTERN(beep_twice_steps),     /* buzzer_beep_twice */
+    BEEP_PATTERN(beep_thrice_steps)     /* buzzer_beep_thrice */
+};
+#endif /* ENABLE_BUZZER */
 
-        /* Enable buzzerThe timeout period is measured in microseconds. time.h defines a number of constants
- for MILLISECOND, SECOND and MINUTE, e.g. allowing 10*SECOND to be used when starting a timer.
- Note that although the timeout value is a 32-bit number the maximum timeout period is actually (2^31)-1 microseconds 
-(not (2^32)-1 microseconds) to enable safe 'roll over' handling. (2^31)-1 microseconds corresponds to approximately
- 35 minutes 47 seconds. */
-        PioEnablePWM(BUZZER_PWM_INDEX_0, TRUE);
 
-        TimerDelete(g_app_hw_data.buzzer_tid);
-        g_app_hw_data.buzzer_tid = TimerCreate(beep_timer, TRUE, 
-                                               appBuzzerTimerHandler);
-    }
-#endif /* ENABLE_BUZZER */
-}
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
 
+static void htProcessPioChange(const pio_changed_data *pPioData,
+                               uint32 time);
+static input_prio inputPriority(uint32 cause);
+#ifdef ENABLE_HID_MODE
+static void inputTrackKeysDown(uint32 cause, uint32 state);
+#endif /* ENABLE_HID_MODE */
+static void htSendReport(uint8 switchs);
+#ifdef ENABLE_POWER_LADDER
+static uint8 htSwitchsDown(uint32 state);
+#endif /* ENABLE_POWER_LADDER */
+static void htQueueReport(uint8 switchs, input_prio prio);
+static void htFlushReport(void);
+static void inputStartPolling(uint32 mask, uint32 state);
+static void inputStopPolling(uint32 mask);
+static void inputCountEdges(uint32 cause, uint32 state);
+static void inputPoll(void);
+static void inputRunQueue(void);
+#ifndef ENABLE_PIO_CTRLR_COUNTING
+static void inputAddLostPresses(void);
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
+#ifdef ENABLE_PIO_CTRLR_COUNTING
+static void htPulsePoll(void);
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
+#ifdef ENABLE_THROTTLE
+static void htThrottlePoll(void);
+#endif /* ENABLE_THROTTLE */
 
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      HandlePIOChangedEvent
+ *      htProcessPioChange
  *
  *  DESCRIPTION
- *      This function handles PIO Changed event
+ *      This function decodes a change of the key inputs, whether signalled
+ *      by a PIO changed event or found by the input poll, and sends the
+ *      resulting report. 'time' is the time the change was seen.
  *
  *  RETURNS
  *      Nothing.
  *
  *---------------------------------------------------------------------------*/
 
-extern void HandlePIOChangedEvent(void *data)
+static void htProcessPioChange(const pio_changed_data *pPioData,
+                               uint32 time)
 {
-    const pio_changed_data *pPioData = (const pio_changed_data *)data;    
     bool valid_ghgStateChange = FALSE;
     bool valid_bpStateChange = FALSE;
-    uint8  val[5];
-    val[4]=readBatteryLevel();
+    APP_PERF_KEY_EVENT(time);
+#ifdef ENABLE_PIO_CTRLR_COUNTING
+    /* Report the pulses counted since the last report */
+    PulseCtrlrFetch();
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
     uint8 switchs=0xFF;
+#ifdef ENABLE_HID_MODE
+    inputTrackKeysDown(pPioData->pio_cause, pPioData->pio_state);
+#endif /* ENABLE_HID_MODE */
     
     if(pPioData->pio_cause & BUTTON_LEFT_MASK)
     {
@@ -452,17 +399,19 @@ extern void HandlePIOChangedEvent(void *data)
         {
             /* This event comes when a button is pressed */
 
-            /* Start a timer for LONG_BUTTON_PRESS_TIMER seconds. If timer expi-
-             * res before we receive a button release event then it was a long -
-             * press and if we receive a button release pio changed event, it -
-             * means it was a short press.
+            /* Start a timer for PAIRING_BUTTON_PRESS_TIME. If timer expires
+             * before we receive a button release event then it was a long -
+             * press, which opens the pairing window and goes on to the extra
+             * long press, and if we receive a button release pio changed -
+             * event, it means it was a short press.
              */
             TimerDelete(g_app_hw_data.button_press_tid);
+            g_app_hw_data.pairing_hold = FALSE;
 
             g_app_hw_data.button_press_tid = TimerCreate(
-                                           EXTRA_LONG_BUTTON_PRESS_TIMER,
+                                           PAIRING_BUTTON_PRESS_TIME,
                                            TRUE,
-                                           HandleExtraLongButtonPress);
+                                           HandlePairingButtonPress);
              switchs &= 0xBF;/*(1011 1111)*/
         }
         else
@@ -471,13 +420,16 @@ extern void HandlePIOChangedEvent(void *data)
             if(g_app_hw_data.button_press_tid != TIMER_INVALID)
             {
                 /* Timer was already running. This means it was a short button 
-                 * press.
+                 * press, unless it was held long enough to open the pairing
+                 * window.
                  */
                 TimerDelete(g_app_hw_data.button_press_tid);
                 g_app_hw_data.button_press_tid = TIMER_INVALID;
 
-              
-                switchs &= 0x7F;/*(0111 1111)*/
+                if(!g_app_hw_data.pairing_hold)
+                {
+                    switchs &= 0x7F;/*(0111 1111)*/
+                }
             }
         }
     }
@@ -543,6 +495,8 @@ extern void HandlePIOChangedEvent(void *data)
             {
                 ghg_count+=1;
             }
+
+            CounterStoreIncrement();
         }
     }         
     if(pPioData->pio_cause & BUTTON_BP_MASK)
@@ -570,15 +524,969 @@ extern void HandlePIOChangedEvent(void *data)
             {
                 bp_count+=1;
             }
+
+            CounterStoreIncrement();
         }
     }         
 
-    val[3]=switchs;
-    val[2]=ghg_count;
-    val[1]=bp_count;
-
-    HandleShortButtonPress(val);
+    htQueueReport(switchs, inputPriority(pPioData->pio_cause));
    
 }
 
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      inputPriority
+ *
+ *  DESCRIPTION
+ *      This function returns the highest priority of the keys in 'cause'.
+ *
+ *  RETURNS
+ *      Priority of the change.
+ *
+ *---------------------------------------------------------------------------*/
+
+static input_prio inputPriority(uint32 cause)
+{
+    input_prio prio = input_prio_low;
+    uint16 key;
+
+    for(key = 0;
+        key < sizeof(input_key_prios) / sizeof(input_key_prios[0]);
+        key ++)
+    {
+        if((cause & input_key_prios[key].mask) &&
+           (input_key_prios[key].prio > prio))
+        {
+            prio = input_key_prios[key].prio;
+        }
+    }
+
+    return prio;
+}
+
+
+#ifdef ENABLE_HID_MODE
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      inputTrackKeysDown
+ *
+ *  DESCRIPTION
+ *      This function updates the keys held down from the PIO state of the
+ *      keys in 'cause'.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void inputTrackKeysDown(uint32 cause, uint32 state)
+{
+    uint16 key;
+
+    for(key = 0;
+        key < sizeof(input_hid_keys) / sizeof(input_hid_keys[0]);
+        key ++)
+    {
+        if(!(cause & input_hid_keys[key].mask))
+        {
+            continue;
+        }
+
+        if(state & input_hid_keys[key].mask)
+        {
+            g_input.keys_down &= ~input_hid_keys[key].key;
+        }
+        else
+        {
+            g_input.keys_down |= input_hid_keys[key].key;
+        }
+    }
+}
+#endif /* ENABLE_HID_MODE */
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      htSendReport
+ *
+ *  DESCRIPTION
+ *      This function sends a key report with the given switch states and
+ *      the current counts. The counts of any report held back are carried
+ *      by this one, so it is no longer sent.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void htSendReport(uint8 switchs)
+{
+    uint8 val[MAX_TEMP_MEAS_SIZE];
+
+    if(g_input.report_pending)
+    {
+        AppSchedStop(app_sched_job_report_flush);
+        g_input.report_pending = FALSE;
+    }
+
+#ifdef ENABLE_POWER_LADDER
+    if(g_ht_data.state != app_state_connected)
+    {
+        /* Keep the key events until the host is back, the counts are read
+         * when the report is sent. Each event clears its own bit, so the
+         * press and the release of a key made meanwhile are both reported
+         * and the key is not left looking held down.
+         */
+        if(!g_input.report_held)
+        {
+            g_input.report_held = TRUE;
+            g_input.held_switchs = 0xFF;
+        }
+        g_input.held_switchs &= switchs;
+
+        return;
+    }
+#endif /* ENABLE_POWER_LADDER */
+
+#ifdef ENABLE_THROTTLE
+    val[5]=ThrottleGetPosition();
+#endif /* ENABLE_THROTTLE */
+    val[4]=BatteryGetLevel();
+    val[3]=switchs;
+    val[2]=ghg_count;
+    val[1]=bp_count;
+
+    HandleShortButtonPress(val);
+
+#ifdef ENABLE_HID_MODE
+    /* Report the keys to a HID host as well */
+    HidSendInputReport(g_ht_data.st_ucid, g_input.keys_down, ghg_count,
+                       bp_count);
+#endif /* ENABLE_HID_MODE */
+}
+
+
+#ifdef ENABLE_POWER_LADDER
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      htSwitchsDown
+ *
+ *  DESCRIPTION
+ *      This function works out the switch states of a report pressing the
+ *      switch keys held down in the given PIO state.
+ *
+ *  RETURNS
+ *      The switch states.
+ *
+ *---------------------------------------------------------------------------*/
+
+static uint8 htSwitchsDown(uint32 state)
+{
+    uint8 switchs = 0xFF;
+
+    if(!(state & BUTTON_LEFT_MASK))
+    {
+        switchs &= 0xBF;/*(1011 1111)*/
+    }
+    if(!(state & BUTTON_RIGHT_MASK))
+    {
+        switchs &= 0xEF;/*(1110 1111)*/
+    }
+    if(!(state & BUTTON_FASTER_MASK))
+    {
+        switchs &= 0xFB;/*(1111 1011)*/
+    }
+    if(!(state & BUTTON_BRAKE_MASK))
+    {
+        switchs &= 0xFE;/*(1111 1110)*/
+    }
+
+    return switchs;
+}
+#endif /* ENABLE_POWER_LADDER */
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      htQueueReport
+ *
+ *  DESCRIPTION
+ *      This function reports a key change according to its priority. Low
+ *      priority changes are held back for up to REPORT_COALESCE_DELAY, so a
+ *      burst of counter pulses costs one report. Other changes are sent at
+ *      once, ahead of and along with any change held back, and high
+ *      priority ones also ask for the low latency connection parameters.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void htQueueReport(uint8 switchs, input_prio prio)
+{
+    if(prio == input_prio_low && g_input.mode == report_mode_coalesced)
+    {
+        if(g_input.report_pending)
+        {
+            APP_PERF_INC(app_perf_reports_coalesced);
+        }
+        else
+        {
+            g_input.report_pending = TRUE;
+            AppSchedStart(app_sched_job_report_flush, REPORT_COALESCE_DELAY,
+                          htFlushReport);
+        }
+
+#ifdef ENABLE_POWER_LADDER
+        AppKeyActivity();
+#endif /* ENABLE_POWER_LADDER */
+
+        return;
+    }
+
+    if(g_input.report_pending)
+    {
+        APP_PERF_INC(app_perf_reports_coalesced);
+    }
+
+    if(prio == input_prio_high)
+    {
+        APP_PERF_KEY_HIGH();
+        APP_PERF_INC(app_perf_high_prio_reports);
+    }
+
+    htSendReport(switchs);
+
+    if(prio == input_prio_high)
+    {
+        /* Only once the report has been handed to the firmware */
+        AppRequestLowLatency();
+    }
+
+#ifdef ENABLE_POWER_LADDER
+    /* After the low latency request, which takes precedence over the
+     * preferred parameters asked for when leaving the relaxed ones
+     */
+    AppKeyActivity();
+#endif /* ENABLE_POWER_LADDER */
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      htFlushReport
+ *
+ *  DESCRIPTION
+ *      This function is run by the low priority scheduler
+ *      REPORT_COALESCE_DELAY after a low priority change was held back. It
+ *      sends the changes held back since.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void htFlushReport(void)
+{
+    /* The job is no longer pending */
+    g_input.report_pending = FALSE;
+
+    htSendReport(0xFF);     /* No switch change */
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      inputStartPolling
+ *
+ *  DESCRIPTION
+ *      This function stops the PIO changed events of the given keys and
+ *      samples them on every input poll instead. 'state' is the PIO state
+ *      the keys were last seen in, so a change made before the first poll
+ *      is still reported.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void inputStartPolling(uint32 mask, uint32 state)
+{
+    PioSetEventMask(mask, pio_event_mode_disable);
+
+    g_input.last_state = (g_input.last_state & ~mask) | (state & mask);
+
+    if(g_input.poll_mask == 0)
+    {
+        AppSchedStart(app_sched_job_input_poll, INPUT_POLL_INTERVAL,
+                      inputPoll);
+    }
+
+    g_input.poll_mask |= mask;
+
+    APP_TRACE(app_trace_input_mode, g_input.poll_mask & 0xffff);
+    APP_PERF_INC(app_perf_input_storms);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      inputStopPolling
+ *
+ *  DESCRIPTION
+ *      This function returns the given keys to PIO changed events. The keys
+ *      are sampled once more after their events have been enabled, so a
+ *      change made since the last poll is not lost.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void inputStopPolling(uint32 mask)
+{
+    pio_changed_data change;
+
+    g_input.poll_mask &= ~mask;
+
+    if(g_input.poll_mask == 0)
+    {
+        AppSchedStop(app_sched_job_input_poll);
+    }
+
+    PioSetEventMask(mask, pio_event_mode_both);
+
+    APP_TRACE(app_trace_input_mode, g_input.poll_mask & 0xffff);
+
+    change.pio_state = PioGets();
+    change.pio_cause = (change.pio_state ^ g_input.last_state) & mask;
+
+    if(change.pio_cause != 0)
+    {
+        htProcessPioChange(&change, TimeGet32());
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      inputCountEdges
+ *
+ *  DESCRIPTION
+ *      This function counts the edges of each key over windows of
+ *      INPUT_STORM_WINDOW. A key with INPUT_STORM_EDGES edges in a window is
+ *      moved to polling at once. A polled key with fewer than
+ *      INPUT_QUIET_EDGES edges in a window goes back to PIO changed events
+ *      at the end of the window.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void inputCountEdges(uint32 cause, uint32 state)
+{
+    uint32 now = TimeGet32();
+    uint32 quiet_mask = 0;
+    uint32 storm_mask = 0;
+    uint16 key;
+
+    if(now - g_input.window_start >= INPUT_STORM_WINDOW)
+    {
+        for(key = 0; key < INPUT_KEYS; key ++)
+        {
+            if((g_input.poll_mask & input_key_masks[key]) &&
+               (g_input.edges[key] < INPUT_QUIET_EDGES))
+            {
+                quiet_mask |= input_key_masks[key];
+            }
+
+            g_input.edges[key] = 0;
+        }
+
+        g_input.window_start = now;
+    }
+
+    for(key = 0; key < INPUT_KEYS; key ++)
+    {
+        if(cause & input_key_masks[key])
+        {
+            ++ g_input.edges[key];
+
+            if(!(g_input.poll_mask & input_key_masks[key]) &&
+               (g_input.edges[key] >= INPUT_STORM_EDGES))
+            {
+                storm_mask |= input_key_masks[key];
+            }
+        }
+    }
+
+    if(storm_mask != 0)
+    {
+        inputStartPolling(storm_mask, state);
+    }
+
+    if(quiet_mask != 0)
+    {
+        inputStopPolling(quiet_mask);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      inputPoll
+ *
+ *  DESCRIPTION
+ *      This function is run every INPUT_POLL_INTERVAL by the low priority
+ *      scheduler while keys are being polled. Changes of the polled keys
+ *      are handled as if they had raised a PIO changed event.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void inputPoll(void)
+{
+    pio_changed_data change;
+
+    APP_PERF_INC(app_perf_input_polls);
+
+    change.pio_state = PioGets();
+    change.pio_cause = (change.pio_state ^ g_input.last_state) &
+                                                        g_input.poll_mask;
+
+    g_input.last_state = change.pio_state;
+
+    /* Keep polling, unless all the keys go back to events below */
+    AppSchedStart(app_sched_job_input_poll, INPUT_POLL_INTERVAL, inputPoll);
+
+    inputCountEdges(change.pio_cause, change.pio_state);
+
+    if(change.pio_cause != 0)
+    {
+        htProcessPioChange(&change, TimeGet32());
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      inputRunQueue
+ *
+ *  DESCRIPTION
+ *      This function is run by the low priority scheduler once PIO changed
+ *      events have been queued. It decodes the queued events in the order
+ *      they were received and sends the resulting reports.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void inputRunQueue(void)
+{
+    pio_changed_data change;
+    const INPUT_EVENT_T *p_event;
+    uint32 polled;
+
+    /* No event can be queued while this runs, so the queue is left empty */
+    while(g_input.queue_count != 0)
+    {
+        p_event = &g_input.queue[g_input.queue_head];
+
+        change.pio_cause = p_event->cause;
+        change.pio_state = p_event->state;
+
+        /* Keys changing too often are moved to polling */
+        inputCountEdges(change.pio_cause, change.pio_state);
+
+        /* Keys polled since the event was queued carry on from its state */
+        polled = change.pio_cause & g_input.poll_mask;
+        g_input.last_state = (g_input.last_state & ~polled) |
+                             (change.pio_state & polled);
+
+#ifndef ENABLE_PIO_CTRLR_COUNTING
+        if(g_input.queue_count == 1)
+        {
+            /* The presses lost to a full queue go with the newest event */
+            inputAddLostPresses();
+        }
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
+
+        htProcessPioChange(&change, p_event->time);
+
+        g_input.queue_head = (g_input.queue_head + 1) & INPUT_QUEUE_MASK;
+        -- g_input.queue_count;
+    }
+}
+
+
+#ifndef ENABLE_PIO_CTRLR_COUNTING
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      inputAddLostPresses
+ *
+ *  DESCRIPTION
+ *      This function adds the GHG and BP presses lost by merging PIO changed
+ *      events into a full queue to the counts, which wrap at 0xFF.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void inputAddLostPresses(void)
+{
+    if((g_input.lost_ghg == 0) && (g_input.lost_bp == 0))
+    {
+        return;
+    }
+
+    ghg_count = (ghg_count + g_input.lost_ghg) & 0xff;
+    bp_count = (bp_count + g_input.lost_bp) & 0xff;
+    CounterStoreAdd(g_input.lost_ghg + g_input.lost_bp);
+
+    g_input.lost_ghg = 0;
+    g_input.lost_bp = 0;
+}
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
+
+
+#ifdef ENABLE_PIO_CTRLR_COUNTING
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      htPulsePoll
+ *
+ *  DESCRIPTION
+ *      This function is run every PULSE_POLL_INTERVAL by the low priority
+ *      scheduler. It fetches the GHG and BP pulses counted by the PIO
+ *      controller and sends a report if there were any, so a pulse train
+ *      costs one wake-up and one report per interval however fast it is.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void htPulsePoll(void)
+{
+    if(PulseCtrlrFetch())
+    {
+        APP_PERF_KEY_EVENT(TimeGet32());
+
+        /* The pulses are already batched over the poll interval */
+        htSendReport(0xFF);     /* No switch change */
+    }
+
+    AppSchedStart(app_sched_job_pulse_poll, PULSE_POLL_INTERVAL,
+                  htPulsePoll);
+}
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
+
+
+#ifdef ENABLE_THROTTLE
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      htThrottlePoll
+ *
+ *  DESCRIPTION
+ *      This function is run by the low priority scheduler to sample the
+ *      throttle, and sends a report at once if its position is due, which
+ *      also counts as a key event for the power ladder.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void htThrottlePoll(void)
+{
+    if(ThrottleSample())
+    {
+        APP_PERF_KEY_EVENT(TimeGet32());
+
+        htQueueReport(0xFF, input_prio_normal);     /* No switch change */
+    }
+
+    AppSchedStart(app_sched_job_throttle, ThrottleSampleInterval(),
+                  htThrottlePoll);
+}
+#endif /* ENABLE_THROTTLE */
+
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HtInitHardware
+ *
+ *  DESCRIPTION
+ *      This function is called to initialise Health Thermometer hardware
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void HtInitHardware(void)
+{
+    /* All the keys start with PIO changed events, and no report is held */
+    MemSet(&g_input, 0, sizeof(g_input));
+    g_input.window_start = TimeGet32();
+
+    /* Setup PIOs
+     * PIO3  - Buzzer
+     * PIO11 - Button
+     */
+    
+    PioSetModes(BUTTON_LEFT_MASK, pio_mode_user);
+    PioSetDir(BUTTON_LEFT, PIO_DIRECTION_INPUT);
+    PioSetPullModes(BUTTON_LEFT_MASK, pio_mode_strong_pull_up);
+    /* Setup button on PIO2 */
+    PioSetEventMask(BUTTON_LEFT_MASK, pio_event_mode_both);
+    
+    PioSetModes(BUTTON_RIGHT_MASK, pio_mode_user);
+    PioSetDir(BUTTON_RIGHT, PIO_DIRECTION_INPUT);
+    PioSetPullModes(BUTTON_RIGHT_MASK, pio_mode_strong_pull_up);
+    /* Setup button on PIO3 */
+    PioSetEventMask(BUTTON_RIGHT_MASK, pio_event_mode_both);
+  
+    PioSetModes(BUTTON_FASTER_MASK, pio_mode_user);
+    PioSetDir(BUTTON_FASTER, PIO_DIRECTION_INPUT);
+    PioSetPullModes(BUTTON_FASTER_MASK, pio_mode_strong_pull_up);
+    /* Setup button on PIO4 */
+    PioSetEventMask(BUTTON_FASTER_MASK, pio_event_mode_both);
+    
+    PioSetModes(BUTTON_BRAKE_MASK, pio_mode_user);
+    PioSetDir(BUTTON_BRAKE, PIO_DIRECTION_INPUT);
+    PioSetPullModes(BUTTON_BRAKE_MASK, pio_mode_strong_pull_up);
+    /* Setup button on PIO9 */
+    PioSetEventMask(BUTTON_BRAKE_MASK, pio_event_mode_both);    
+    
+    PioSetModes(BUTTON_GHG_MASK, pio_mode_user);
+    PioSetDir(BUTTON_GHG, PIO_DIRECTION_INPUT);
+    PioSetPullModes(BUTTON_GHG_MASK, pio_mode_strong_pull_up);
+#ifdef ENABLE_PIO_CTRLR_COUNTING
+    /* GHG pulses on PIO10 are counted by the PIO controller */
+    PioSetEventMask(BUTTON_GHG_MASK, pio_event_mode_disable);
+#else
+    /* Setup button on PIO10 */
+    PioSetEventMask(BUTTON_GHG_MASK, pio_event_mode_both);    
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
+
+    PioSetModes(BUTTON_BP_MASK, pio_mode_user);
+    PioSetDir(BUTTON_BP, PIO_DIRECTION_INPUT);
+    PioSetPullModes(BUTTON_BP_MASK, pio_mode_strong_pull_up);
+#ifdef ENABLE_PIO_CTRLR_COUNTING
+    /* BP pulses on PIO11 are counted by the PIO controller */
+    PioSetEventMask(BUTTON_BP_MASK, pio_event_mode_disable);
+
+    PulseCtrlrStart();
+    AppSchedStart(app_sched_job_pulse_poll, PULSE_POLL_INTERVAL,
+                  htPulsePoll);
+#else
+    /* Setup button on PIO11 */
+    PioSetEventMask(BUTTON_BP_MASK, pio_event_mode_both);      
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
+#ifdef ENABLE_THROTTLE
+    /* The throttle on THROTTLE_AIO is sampled by the scheduler */
+    ThrottleInit();
+    AppSchedStart(app_sched_job_throttle, ThrottleSampleInterval(),
+                  htThrottlePoll);
+#endif /* ENABLE_THROTTLE */
+#ifdef ENABLE_BUZZER
+    /* The buzzer on PIO14 is driven by PWM unit 0 */
+    PioSetModes(BUZZER_PIO_MASK, pio_mode_pwm0);
+
+    SignalSeqInit();
+#endif /* ENABLE_BUZZER */
+
+    /* Save power by changing the I2C pull mode to pull down */
+    PioSetI2CPullMode(pio_i2c_pull_mode_strong_pull_down);
+
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HtHwDataInit
+ *
+ *  DESCRIPTION
+ *      This function initialises Health Thermometer hardware data structure
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void HtHwDataInit(void)
+{
+
+    /* Delete button press timer */
+    TimerDelete(g_app_hw_data.button_press_tid);
+    g_app_hw_data.button_press_tid = TIMER_INVALID;
+    g_app_hw_data.pairing_hold = FALSE;
+
+    /* Drop any report held back */
+    AppSchedStop(app_sched_job_report_flush);
+    g_input.report_pending = FALSE;
+
+    /* The next host starts with the default report mode */
+    g_input.mode = report_mode_coalesced;
+
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SoundBuzzer
+ *
+ *  DESCRIPTION
+ *      This function is called to trigger beeps of different types 
+ *      'buzzer_beep_type'. Any pattern being played, including one written
+ *      by the host, is cut short.
+ *
+ *  RETURNS/MODIFIES
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void SoundBuzzer(buzzer_beep_type beep_type)
+{
+#ifdef ENABLE_BUZZER
+    const BEEP_PATTERN_T *p_pattern;
+
+    if((uint16)beep_type >=
+                        (sizeof(beep_patterns) / sizeof(beep_patterns[0])))
+    {
+        /* No such beep type defined */
+        ReportPanic(app_panic_unexpected_beep_type);
+        return;
+    }
+
+    p_pattern = &beep_patterns[beep_type];
+
+    if(p_pattern->num_steps == 0)
+    {
+        SignalSeqStop();
+    }
+    else
+    {
+        /* The steps are played by the sequencer from the scheduler timer, so
+         * this returns straight away
+         */
+        SignalSeqPlay(p_pattern->p_steps, p_pattern->num_steps);
+    }
+#endif /* ENABLE_BUZZER */
+}
+
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HandlePIOChangedEvent
+ *
+ *  DESCRIPTION
+ *      This function handles PIO Changed event. Keys sampled by the input
+ *      poll do not raise the event.
+ *
+ *      The event is only queued here and decoded by inputRunQueue(), so 
+ *      the handler returns quickly and the next event is not held up by the
+ *      notification. Should the queue be full, the event is merged into the
+ *      newest one queued, losing any edge the two have in common. The GHG
+ *      and BP presses lost that way are counted and added back when the
+ *      queue is decoded.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void HandlePIOChangedEvent(void *data)
+{
+    const pio_changed_data *pPioData = (const pio_changed_data *)data;
+    uint32 now = TimeGet32();
+    INPUT_EVENT_T *p_event;
+#ifndef ENABLE_PIO_CTRLR_COUNTING
+    uint32 toggles = pPioData->pio_cause & COUNTER_KEYS_MASK;
+    uint32 lost;
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
+
+    APP_TRACE(app_trace_pio_event, pPioData->pio_cause & 0xffff);
+    APP_PERF_INC(app_perf_pio_events);
+
+    if(g_input.queue_count < INPUT_QUEUE_SIZE)
+    {
+        p_event = &g_input.queue[(g_input.queue_head + g_input.queue_count) &
+                                 INPUT_QUEUE_MASK];
+        ++ g_input.queue_count;
+
+        p_event->cause = pPioData->pio_cause;
+        p_event->time = now;
+
+#ifndef ENABLE_PIO_CTRLR_COUNTING
+        g_input.merged_toggles = toggles;
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
+
+        if(g_input.queue_count == 1)
+        {
+            AppSchedStart(app_sched_job_input_events, 0, inputRunQueue);
+        }
+    }
+    else
+    {
+        /* The merged event keeps the time of the older one */
+        p_event = &g_input.queue[(g_input.queue_head + INPUT_QUEUE_SIZE - 1) &
+                                 INPUT_QUEUE_MASK];
+
+        p_event->cause |= pPioData->pio_cause;
+
+#ifndef ENABLE_PIO_CTRLR_COUNTING
+        /* A key changing an even number of times shows no change, which
+         * hides one of its presses
+         */
+        lost = g_input.merged_toggles & toggles;
+        g_input.merged_toggles ^= toggles;
+
+        if(lost & BUTTON_GHG_MASK)
+        {
+            ++ g_input.lost_ghg;
+        }
+        if(lost & BUTTON_BP_MASK)
+        {
+            ++ g_input.lost_bp;
+        }
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
+
+        APP_PERF_INC(app_perf_input_queue_full);
+    }
+
+    p_event->state = pPioData->pio_state;
+
+    APP_PERF_EVENT_QUEUED(now, g_input.queue_count);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HtHwSendSnapshot
+ *
+ *  DESCRIPTION
+ *      This function sends a key report with the current counts and battery
+ *      level at once, along with any change held back, at the request of the
+ *      host.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void HtHwSendSnapshot(void)
+{
+    htSendReport(0xFF);     /* No switch change */
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HtHwSetReportMode
+ *
+ *  DESCRIPTION
+ *      This function sets the report mode at the request of the host. In
+ *      report_mode_immediate, counter changes are no longer held back, and
+ *      any held back already are sent at once. The mode goes back to
+ *      report_mode_coalesced when the host disconnects.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void HtHwSetReportMode(report_mode mode)
+{
+    g_input.mode = mode;
+
+    if(mode == report_mode_immediate && g_input.report_pending)
+    {
+        htSendReport(0xFF);     /* No switch change */
+    }
+}
+
+
+#ifdef ENABLE_POWER_LADDER
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HtHwSendHeldReport
+ *
+ *  DESCRIPTION
+ *      This function sends the report held since the key events made while
+ *      not connected, once the link to the host is encrypted. A key pressed
+ *      again after its release shows both in the held report, so a report
+ *      of the keys held down now follows it.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void HtHwSendHeldReport(void)
+{
+    uint8 down;
+
+    if(!g_input.report_held)
+    {
+        return;
+    }
+
+    g_input.report_held = FALSE;
+
+    htSendReport(g_input.held_switchs);
+
+    /* Keys held down whose release was reported as well. The press bits
+     * are the low bit of each pair.
+     */
+    down = htSwitchsDown(PioGets());
+    if((~down & (~g_input.held_switchs >> 1) & 0x55) != 0)
+    {
+        htSendReport(down);
+    }
+}
+
+
+#ifdef LADDER_DORMANT
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HtHwReplayWakeKeys
+ *
+ *  DESCRIPTION
+ *      This function is called on waking from dormant, after the hardware
+ *      has been initialised. The key which woke the device raised no PIO
+ *      changed event, so the keys still held down are reported as pressed
+ *      now and the report is held until the host is back. A key released
+ *      before the application started is not reported.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void HtHwReplayWakeKeys(void)
+{
+    pio_changed_data change;
+
+    change.pio_state = PioGets();
+    change.pio_cause = ~change.pio_state & WAKE_KEYS_MASK;
+
+    if(change.pio_cause != 0)
+    {
+        htProcessPioChange(&change, TimeGet32());
+    }
+}
+#endif /* LADDER_DORMANT */
+#endif /* ENABLE_POWER_LADDER */
+
@@ -28,7 +28,13 @@
  *============================================================================*/
 #include "user_config.h"
 
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
 
+/* Extra long button press timer, from the button press */
+#define EXTRA_LONG_BUTTON_PRESS_TIMER \
+                                (4*SECOND)
 
 
 /*============================================================================*
@@ -55,26 +61,31 @@ typedef enum
 
 }buzzer_beep_type;
 
-typedef struct
+/* Report modes */
+typedef enum
 {
+    /* Counter changes are held back and merged, see REPORT_COALESCE_DELAY */
+    report_mode_coalesced = 0,
 
-#ifdef ENABLE_BUZZER
-    /* Buzzer timer id */
-    timer_id                    buzzer_tid;
+    /* Every change is reported at once */
+    report_mode_immediate,
 
-    /* Variable for storing beep type.*/
-    buzzer_beep_type            beep_type;
+    /* Number of report modes. This must always be the last entry. */
+    report_mode_max
 
-    /* Variable for keeping track of beep counts. This variable will be 
-     * initialized to 0 on beep start and will incremented at every beep 
-     * sound
-     */
-    uint16                      beep_count;
-#endif /* ENABLE_BUZZER */
+}report_mode;
+
+typedef struct
+{
 
     /* Timer for button press */
     timer_id                    button_press_tid;
 
+    /* Boolean flag set once the button has been held long enough to open
+     * the pairing window, so that its release is not a short press
+     */
+    bool                        pairing_hold;
+
 }APP_HW_DATA_T;
 
 /*============================================================================*
@@ -84,6 +95,10 @@ typedef struct
 /* Blood pressure application hardware data instance */
 extern APP_HW_DATA_T                   g_app_hw_data;
 
+/* GHG and BP counters reported to the host */
+extern uint8                           ghg_count;
+extern uint8                           bp_count;
+
 /*============================================================================*
  *  Public Function Prototypes
  *============================================================================*/
@@ -102,4 +117,20 @@ extern void HandlePIOChangedEvent(void *data);
  */
 extern void SoundBuzzer(buzzer_beep_type beep_type);
 
+/* This function sends a key report with the current counts at once */
+extern void HtHwSendSnapshot(void);
+
+/* This function sets the report mode until the host disconnects */
+extern void HtHwSetReportMode(report_mode mode);
+
+#ifdef ENABLE_POWER_LADDER
+/* This function sends the report held while the host was away */
+extern void HtHwSendHeldReport(void);
+
+#ifdef LADDER_DORMANT
+/* This function reports the keys held down on waking from dormant */
+extern void HtHwReplayWakeKeys(void);
+#endif /* LADDER_DORMANT */
+#endif /* ENABLE_POWER_LADDER */
+
 #endif /* __HT_HW_H__ */
@@ -9,6 +9,31 @@
  *  DESCRIPTION
  *      This file defines routines used by application to access NVM.
  *
+ *      On SPI flash builds (NVM_TYPE_FLASH) the NVM store is used as an 
+ *      append-only log of records. Each Nvm_Write() appends a record holding 
+ *      the logical offset, the words written and a commit marker; the latest 
+ *      committed record for a word wins. The log is replayed into the RAM 
+ *      shadow at start-up.
+ *
+ *      The store is split into two log areas, one SPI flash block each. The 
+ *      live log fills one of them; when it fills up, it is compacted by 
+ *      writing the shadow as a single record into the other area and then 
+ *      committing that area, with a header holding a generation number one 
+ *      more than the live area's and a commit marker. The area with the 
+ *      newer committed header holds the log, so a power failure at any 
+ *      point of the compaction leaves one complete log. The superseded area 
+ *      is only erased once the new one is committed, at a quiet point 
+ *      rather than in the middle of a GATT write, so that a compaction 
+ *      forced by a full log in the write path does not erase anything 
+ *      either.
+ *
+ *      The start of the NVM, which holds the application and services data,
+ *      is shadowed in RAM on both NVM types. Reads within the shadow are 
+ *      served from RAM, and the words of a write which already hold the 
+ *      value written are not written again. Centrals which rewrite their 
+ *      client configurations on every reconnection thus cause no NVM 
+ *      access at all.
+ *
  *****************************************************************************/
 
 /*============================================================================*
@@ -19,6 +44,7 @@
 #include <nvm.h>
 #include <i2c.h>
 #include <panic.h>
+#include <mem.h>
 
 /*============================================================================*
  *  Local Header Files
@@ -26,151 +52,1294 @@
 
 #include "nvm_access.h"
 #include "app_gatt.h"
+#include "app_perf.h"
 
 /*============================================================================*
- *  Public Function Implementations
+ *  Private Definitions
+ *============================================================================*/
+
+/* Maximum number of words collected by a write batch before it has to be 
+ * committed
+ */
+#define NVM_BATCH_MAX_WORDS                 (32)
+
+/* Maximum number of contiguous NVM regions collected by a write batch */
+#define NVM_BATCH_MAX_RUNS                  (4)
+
+/* CRC16 used to protect the record groups: CRC-CCITT, polynomial 
+ * x^16 + x^12 + x^5 + 1, computed over the 16 bits of each word, most 
+ * significant bit first
+ */
+#define NVM_CRC16_POLYNOMIAL                (0x1021)
+#define NVM_CRC16_INIT                      (0xffff)
+
+/* Number of words checked or copied at a time by Nvm_CheckGroup() and 
+ * Nvm_CopyToGroup()
+ */
+#define NVM_GROUP_CHUNK_WORDS               (8)
+
+#ifdef NVM_TYPE_FLASH
+
+/* Size in words of a log area: one SPI flash block, the unit NvmEraseBlock() 
+ * erases. The NVM store holds two of them, so the nvm_size set in the .keyr 
+ * file for SPI flash must be twice this, over two SPI flash blocks.
+ */
+#define NVM_LOG_AREA_WORDS                  (0x800)
+#define NVM_LOG_AREAS                       (2)
+
+/* NVM offset of the start of a log area, and the other area */
+#define NVM_LOG_AREA_START(area)            ((area) * NVM_LOG_AREA_WORDS)
+#define NVM_LOG_OTHER_AREA(area)            (NVM_LOG_AREAS - 1 - (area))
+
+/* A log area starts with a header: its generation number, then the commit 
+ * marker. It is written once the compacted record behind it is committed, 
+ * so a log area without the commit marker does not hold a log.
+ */
+#define NVM_LOG_AREA_HEADER_WORDS           (2)
+#define NVM_LOG_GENERATION_MASK             (0x7fff)
+
+/* Area usage above which compaction is requested at the next quiet point */
+#define NVM_LOG_COMPACT_THRESHOLD           ((NVM_LOG_AREA_WORDS * 3) / 4)
+
+/* A record is a header word holding the logical offset (low octet) and the 
+ * number of words (high octet), the words themselves and a commit marker 
+ * written last. A record without the commit marker was interrupted by a 
+ * power failure and is ignored. An erased header marks the end of the log.
+ */
+#define NVM_LOG_HEADER(offset, length)      (((length) << 8) | (offset))
+#define NVM_LOG_HEADER_OFFSET(header)       ((header) & 0xff)
+#define NVM_LOG_HEADER_LENGTH(header)       ((header) >> 8)
+#define NVM_LOG_ERASED                      (0xffff)
+#define NVM_LOG_COMMIT                      (0xc0de)
+
+/* Number of words added by a record around the words written */
+#define NVM_LOG_RECORD_OVERHEAD             (2)
+
+#endif /* NVM_TYPE_FLASH */
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Contiguous NVM region collected by a write batch */
+typedef struct
+{
+    /* NVM offset of the region */
+    uint16                  offset;
+
+    /* Number of words in the region */
+    uint16                  length;
+
+    /* Index of the first word of the region in the batch buffer */
+    uint16                  index;
+
+} NVM_BATCH_RUN_T;
+
+/* Write batch data type */
+typedef struct
+{
+    /* Nesting depth of Nvm_BeginBatch() calls. The batch is committed when 
+     * it gets back to zero.
+     */
+    uint16                  depth;
+
+    /* Words to be written, in the order in which they were collected */
+    uint16                  words[NVM_BATCH_MAX_WORDS];
+
+    /* Number of words used in the buffer */
+    uint16                  used;
+
+    /* Contiguous regions to be written */
+    NVM_BATCH_RUN_T         runs[NVM_BATCH_MAX_RUNS];
+
+    /* Number of regions collected */
+    uint16                  num_runs;
+
+} NVM_BATCH_T;
+
+#ifdef NVM_TYPE_FLASH
+/* Record log data type */
+typedef struct
+{
+    /* Log area holding the live log */
+    uint16                  area;
+
+    /* Generation number of the live area */
+    uint16                  generation;
+
+    /* Offset of the first free word of the log, from the start of its area */
+    uint16                  write_pos;
+
+    /* Boolean flag set when the log should be compacted */
+    bool                    compact_pending;
+
+    /* Boolean flag set when the other area is not erased: it holds the log 
+     * the live one was compacted from, or a compaction cut short
+     */
+    bool                    erase_pending;
+
+} NVM_LOG_T;
+#endif /* NVM_TYPE_FLASH */
+
+/* RAM shadow of the NVM data type */
+typedef struct
+{
+    /* Boolean flag set once the shadow holds the NVM contents */
+    bool                    loaded;
+
+    /* Words at the start of the NVM. On SPI flash, the logical NVM contents 
+     * as replayed from the log.
+     */
+    uint16                  words[NVM_SHADOW_WORDS];
+
+} NVM_SHADOW_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Write batch instance */
+static NVM_BATCH_T g_nvm_batch;
+
+/* RAM shadow instance */
+static NVM_SHADOW_T g_nvm_shadow;
+
+#ifdef NVM_TYPE_FLASH
+/* Record log instance */
+static NVM_LOG_T g_nvm_log;
+#endif /* NVM_TYPE_FLASH */
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void nvmHandleWriteResult(sys_status result);
+static sys_status nvmWriteWords(uint16* buffer, uint16 length, uint16 offset);
+#ifdef NVM_TYPE_FLASH
+static sys_status nvmLogEraseArea(uint16 area);
+static sys_status nvmLogWriteRecordAt(uint16 pos, uint16* buffer, 
+                                      uint16 length, uint16 offset);
+static sys_status nvmLogCompact(void);
+static sys_status nvmLogWriteRecord(uint16* buffer, uint16 length, 
+                                    uint16 offset);
+static sys_status nvmLogAppend(uint16* buffer, uint16 length, uint16 offset);
+#endif /* NVM_TYPE_FLASH */
+static void nvmBatchFlush(void);
+static void nvmBatchAdd(uint16* buffer, uint16 length, uint16 offset);
+static bool nvmShadowCovers(uint16 length, uint16 offset);
+static uint16 nvmCrc16(uint16 crc, const uint16* buffer, uint16 length);
+
+/*============================================================================*
+ *  Private Function Implementations
  *============================================================================*/
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      Nvm_Disable
+ *      nvmHandleWriteResult
  *
  *  DESCRIPTION
- *      This function is used to perform things necessary to save power on NVM 
- *      once the read/write operations are done.
+ *      This function handles the status returned by NvmWrite().
  *
  *  RETURNS
- *      Nothing.
+ *      Nothing
  *
  *---------------------------------------------------------------------------*/
 
-extern void Nvm_Disable(void)
+static void nvmHandleWriteResult(sys_status result)
 {
-    NvmDisable();
-    PioSetI2CPullMode(pio_i2c_pull_mode_strong_pull_down);
+    /* If NvmWrite was a success, return */
+    if(sys_status_success == result)
+    {
+        /* Write was successful. */
+        return;
+    }
+    else
+    {
+        /* Irrecoverable error. Reset the chip. */
+        ReportPanic(app_panic_nvm_write);
+    }
 }
 
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      Nvm_Read
+ *      nvmWriteWords
  *
  *  DESCRIPTION
- *      Read words from the NVM Store after preparing the NVM to be readable. 
- *      After the read operation, perform things necessary in slave 
- *      application to save power on NVM.
+ *      This function writes words to the NVM store: directly on EEPROM, as 
+ *      a log record on SPI flash.
  *
- *      Read words starting at the word offset, and store them in the supplied
- *      buffer.
+ *  RETURNS
+ *      Status of the write.
+ *
+ *---------------------------------------------------------------------------*/
+
+static sys_status nvmWriteWords(uint16* buffer, uint16 length, uint16 offset)
+{
+#ifdef NVM_TYPE_FLASH
+    return nvmLogAppend(buffer, length, offset);
+#else
+    APP_PERF_INC(app_perf_nvm_writes);
+
+    return NvmWrite(buffer, length, offset);
+#endif /* NVM_TYPE_FLASH */
+}
+
+
+#ifdef NVM_TYPE_FLASH
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmLogEraseArea
+ *
+ *  DESCRIPTION
+ *      This function erases a log area, which must not hold the live log.
  *
  *  RETURNS
- *      Nothing
+ *      Status of the erase.
  *
  *---------------------------------------------------------------------------*/
 
-extern void Nvm_Read(uint16* buffer, uint16 length, uint16 offset)
+static sys_status nvmLogEraseArea(uint16 area)
 {
     sys_status result;
 
-    /* Read from NVM. Firmware re-enables the NVM if it is disabled */
-    result = NvmRead(buffer, length, offset);
+    APP_PERF_INC(app_perf_nvm_erases);
 
-    /* Disable NVM to save power after read operation */
-    Nvm_Disable();
+    result = NvmEraseBlock(NVM_LOG_AREA_START(area));
 
-    /* Report panic is NVM read is not successful */
-    if(sys_status_success != result)
+    if(result == sys_status_success)
     {
-        ReportPanic(app_panic_nvm_read);
+        g_nvm_log.erase_pending = FALSE;
     }
 
+    return result;
 }
 
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      Nvm_Write
+ *      nvmLogWriteRecordAt
  *
  *  DESCRIPTION
- *      Write words to the NVM store after preparing the NVM to be writable. 
- *      After the write operation, perform things necessary in slave 
- *      application to save power on NVM.
+ *      This function writes a record at the given NVM offset. The header and 
+ *      the words are written first and the commit marker last, so a record 
+ *      cut short by a power failure is never replayed.
  *
- *      Write words from the supplied buffer into the NVM Store, starting at the
- *      given word offset.
+ *  RETURNS
+ *      Status of the write.
+ *
+ *---------------------------------------------------------------------------*/
+
+static sys_status nvmLogWriteRecordAt(uint16 pos, uint16* buffer, 
+                                      uint16 length, uint16 offset)
+{
+    sys_status result;
+    uint16 word;
+
+    APP_PERF_INC(app_perf_nvm_writes);
+
+    word = NVM_LOG_HEADER(offset, length);
+    result = NvmWrite(&word, 1, pos);
+
+    if(result == sys_status_success)
+    {
+        result = NvmWrite(buffer, length, pos + 1);
+    }
+
+    if(result == sys_status_success)
+    {
+        word = NVM_LOG_COMMIT;
+        result = NvmWrite(&word, 1, pos + 1 + length);
+    }
+
+    return result;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmLogCompact
+ *
+ *  DESCRIPTION
+ *      This function compacts the record log: the RAM shadow is written as a 
+ *      single record into the other log area, which then becomes the live 
+ *      one once its header is committed. Until then the live area still 
+ *      holds the log, so a power failure loses nothing. The area compacted 
+ *      from is left to be erased at the next quiet point; the other area is 
+ *      only erased here if it has not been yet, which is safe as it does not
+ *      hold the log.
  *
  *  RETURNS
- *      Nothing
+ *      Status of the compaction.
  *
  *---------------------------------------------------------------------------*/
 
-extern void Nvm_Write(uint16* buffer, uint16 length, uint16 offset)
+static sys_status nvmLogCompact(void)
+{
+    uint16 area = NVM_LOG_OTHER_AREA(g_nvm_log.area);
+    uint16 start = NVM_LOG_AREA_START(area);
+    uint16 header[NVM_LOG_AREA_HEADER_WORDS];
+    sys_status result = sys_status_success;
+
+    if(g_nvm_log.erase_pending)
+    {
+        result = nvmLogEraseArea(area);
+    }
+
+    if(result == sys_status_success)
+    {
+        result = nvmLogWriteRecordAt(start + NVM_LOG_AREA_HEADER_WORDS, 
+                                     g_nvm_shadow.words, NVM_SHADOW_WORDS, 
+                                     0);
+    }
+
+    if(result == nvm_status_needs_erase)
+    {
+        /* A compaction cut short left words behind after all */
+        result = nvmLogEraseArea(area);
+
+        if(result == sys_status_success)
+        {
+            result = nvmLogWriteRecordAt(start + NVM_LOG_AREA_HEADER_WORDS,
+                                         g_nvm_shadow.words, 
+                                         NVM_SHADOW_WORDS, 0);
+        }
+    }
+
+    if(result == sys_status_success)
+    {
+        /* Commit the area */
+        header[0] = (g_nvm_log.generation + 1) & NVM_LOG_GENERATION_MASK;
+        header[1] = NVM_LOG_COMMIT;
+        result = NvmWrite(header, NVM_LOG_AREA_HEADER_WORDS, start);
+    }
+
+    if(result != sys_status_success)
+    {
+        /* The log is still in the live area */
+        g_nvm_log.erase_pending = TRUE;
+        return result;
+    }
+
+    /* The area compacted from is superseded */
+    g_nvm_log.area = area;
+    g_nvm_log.generation = header[0];
+    g_nvm_log.write_pos = NVM_LOG_AREA_HEADER_WORDS + NVM_SHADOW_WORDS + 
+                          NVM_LOG_RECORD_OVERHEAD;
+    g_nvm_log.compact_pending = FALSE;
+    g_nvm_log.erase_pending = TRUE;
+
+    return sys_status_success;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmLogWriteRecord
+ *
+ *  DESCRIPTION
+ *      This function writes a record at the end of the live log. The log is 
+ *      not compacted, nvm_status_needs_erase is returned if there is no room 
+ *      left.
+ *
+ *  RETURNS
+ *      Status of the write.
+ *
+ *---------------------------------------------------------------------------*/
+
+static sys_status nvmLogWriteRecord(uint16* buffer, uint16 length, 
+                                    uint16 offset)
 {
     sys_status result;
+    uint16 pos = g_nvm_log.write_pos;
 
-    /* Write to NVM. Firmware re-enables the NVM if it is disabled */
-    result = NvmWrite(buffer, length, offset);
+    if(pos + length + NVM_LOG_RECORD_OVERHEAD > NVM_LOG_AREA_WORDS)
+    {
+        /* No room left */
+        return nvm_status_needs_erase;
+    }
 
-    /* Disable NVM to save power after write operation */
-    Nvm_Disable();
+    result = nvmLogWriteRecordAt(NVM_LOG_AREA_START(g_nvm_log.area) + pos, 
+                                 buffer, length, offset);
 
-    /* If NvmWrite was a success, return */
-    if(sys_status_success == result)
+    if(result != sys_status_success)
     {
-        /* Write was successful. */
-        return;
+        return result;
     }
-#ifdef NVM_TYPE_FLASH
-    else if(nvm_status_needs_erase == result)
+
+    g_nvm_log.write_pos = pos + length + NVM_LOG_RECORD_OVERHEAD;
+
+    if(g_nvm_log.write_pos > NVM_LOG_COMPACT_THRESHOLD)
     {
-        /* The application already has a copy of NVM data in its variables,
-         * so we can erase the NVM 
-         */
-        Nvm_Erase();
-    
-        /* Write back the NVM data. 
-         * Please note that the following function writes data into NVM and 
-         * should not fail. 
+        g_nvm_log.compact_pending = TRUE;
+    }
+
+    return sys_status_success;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmLogAppend
+ *
+ *  DESCRIPTION
+ *      This function appends a record to the log, compacting the log if the 
+ *      record cannot be written. The words must already be in the RAM 
+ *      shadow, so if the log has to be compacted the record is not needed 
+ *      any more.
+ *
+ *  RETURNS
+ *      Status of the write.
+ *
+ *---------------------------------------------------------------------------*/
+
+static sys_status nvmLogAppend(uint16* buffer, uint16 length, uint16 offset)
+{
+    sys_status result = nvmLogWriteRecord(buffer, length, offset);
+
+    if(result == nvm_status_needs_erase)
+    {
+        /* No room left, or the log area is not erased, which may happen 
+         * after a power failure in the middle of a record. Compaction 
+         * normally runs from Nvm_CompactLog(); here it only erases if the 
+         * other area has not been erased since the last compaction.
          */
-        WriteApplicationAndServiceDataToNVM();
+        result = nvmLogCompact();
     }
+
+    return result;
+}
 #endif /* NVM_TYPE_FLASH */
-    else
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmBatchFlush
+ *
+ *  DESCRIPTION
+ *      This function writes the regions collected by the write batch to the 
+ *      NVM and empties the batch. The NVM is left enabled.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *---------------------------------------------------------------------------*/
+
+static void nvmBatchFlush(void)
+{
+    sys_status result = sys_status_success;
+    NVM_BATCH_RUN_T *p_run = g_nvm_batch.runs;
+    uint16 num_runs = g_nvm_batch.num_runs;
+
+    /* Empty the batch first, as handling a write failure may write to the 
+     * NVM again
+     */
+    g_nvm_batch.num_runs = 0;
+    g_nvm_batch.used = 0;
+
+    while(num_runs != 0 && result == sys_status_success)
     {
-        /* Irrecoverable error. Reset the chip. */
-        ReportPanic(app_panic_nvm_write);
+        result = nvmWriteWords(&g_nvm_batch.words[p_run->index], 
+                               p_run->length, p_run->offset);
+
+        ++ p_run;
+        -- num_runs;
     }
+
+    nvmHandleWriteResult(result);
 }
 
 
-#ifdef NVM_TYPE_FLASH
 /*----------------------------------------------------------------------------*
  *  NAME
- *      Nvm_Write
+ *      nvmBatchAdd
  *
  *  DESCRIPTION
- *      Erases the NVM memory.
+ *      This function copies words to be written into the write batch. Words 
+ *      following on from the last collected region are merged into it, so 
+ *      that they are committed with a single write. The batch is 
+ *      flushed first if it is full.
  *
  *  RETURNS
  *      Nothing
  *
- 
-*----------------------------------------------------------------------------*/
-extern void Nvm_Erase(void)
+ *---------------------------------------------------------------------------*/
+
+static void nvmBatchAdd(uint16* buffer, uint16 length, uint16 offset)
 {
-    sys_status result;
+    NVM_BATCH_RUN_T *p_run = NULL;
 
-    /* NvmErase automatically enables the NVM before erasing */
-    result = NvmErase(TRUE);
+    if(length > NVM_BATCH_MAX_WORDS)
+    {
+        /* Too big to be collected, write it straight away after what has 
+         * been collected so far
+         */
+        nvmBatchFlush();
 
-    /* Disable NVM after erasing */
-    Nvm_Disable();
+        nvmHandleWriteResult(nvmWriteWords(buffer, length, offset));
 
-    /* If NvmErase fails, report panic */
-    if(sys_status_success != result)
+        return;
+    }
+
+    if(g_nvm_batch.num_runs != 0)
     {
-        ReportPanic(app_panic_nvm_erase);
+        p_run = &g_nvm_batch.runs[g_nvm_batch.num_runs - 1];
+
+        if(p_run->offset + p_run->length != offset)
+        {
+            /* Not contiguous with the last region */
+            p_run = NULL;
+        }
+    }
+
+    if((g_nvm_batch.used + length > NVM_BATCH_MAX_WORDS) ||
+       (p_run == NULL && g_nvm_batch.num_runs == NVM_BATCH_MAX_RUNS))
+    {
+        nvmBatchFlush();
+        p_run = NULL;
+    }
+
+    if(p_run == NULL)
+    {
+        /* Start a new region */
+        p_run = &g_nvm_batch.runs[g_nvm_batch.num_runs ++];
+        p_run->offset = offset;
+        p_run->length = 0;
+        p_run->index = g_nvm_batch.used;
     }
+
+    MemCopy(&g_nvm_batch.words[g_nvm_batch.used], buffer, length);
+
+    p_run->length += length;
+    g_nvm_batch.used += length;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmShadowCovers
+ *
+ *  DESCRIPTION
+ *      This function checks whether the RAM shadow of the NVM is loaded and 
+ *      holds the given words.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if the words are held in the RAM shadow.
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool nvmShadowCovers(uint16 length, uint16 offset)
+{
+    return g_nvm_shadow.loaded &&
+           (offset < NVM_SHADOW_WORDS) &&
+           (length <= NVM_SHADOW_WORDS - offset);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmCrc16
+ *
+ *  DESCRIPTION
+ *      This function adds words of a record group to its CRC16, which 
+ *      starts from NVM_CRC16_INIT.
+ *
+ *  RETURNS
+ *      CRC16 of the words so far.
+ *
+ *---------------------------------------------------------------------------*/
+
+static uint16 nvmCrc16(uint16 crc, const uint16* buffer, uint16 length)
+{
+    uint16 bit;
+
+    while(length -- != 0)
+    {
+        crc ^= *buffer ++;
+
+        for(bit = 0; bit < 16; bit ++)
+        {
+            if(crc & 0x8000)
+            {
+                crc = (crc << 1) ^ NVM_CRC16_POLYNOMIAL;
+            }
+            else
+            {
+                crc <<= 1;
+            }
+        }
+    }
+
+    return crc;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_Disable
+ *
+ *  DESCRIPTION
+ *      This function is used to perform things necessary to save power on NVM 
+ *      once the read/write operations are done.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void Nvm_Disable(void)
+{
+    NvmDisable();
+    PioSetI2CPullMode(pio_i2c_pull_mode_strong_pull_down);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_Read
+ *
+ *  DESCRIPTION
+ *      Read words from the NVM Store after preparing the NVM to be readable. 
+ *      After the read operation, perform things necessary in slave 
+ *      application to save power on NVM.
+ *
+ *      Read words starting at the word offset, and store them in the supplied
+ *      buffer.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void Nvm_Read(uint16* buffer, uint16 length, uint16 offset)
+{
+#ifndef NVM_TYPE_FLASH
+    sys_status result;
+#endif /* !NVM_TYPE_FLASH */
+
+    if(nvmShadowCovers(length, offset))
+    {
+        /* Serve the read from the RAM shadow */
+        MemCopy(buffer, &g_nvm_shadow.words[offset], length);
+        return;
+    }
+
+#ifdef NVM_TYPE_FLASH
+    /* The record log only holds the words within the shadow */
+    ReportPanic(app_panic_nvm_read);
+#else
+    APP_PERF_INC(app_perf_nvm_reads);
+
+    /* Make sure words collected by a write batch are read back */
+    if(g_nvm_batch.num_runs != 0)
+    {
+        nvmBatchFlush();
+    }
+
+    /* Read from NVM. Firmware re-enables the NVM if it is disabled */
+    result = NvmRead(buffer, length, offset);
+
+    /* Disable NVM to save power after read operation, unless a write batch 
+     * is on-going
+     */
+    if(g_nvm_batch.depth == 0)
+    {
+        Nvm_Disable();
+    }
+
+    /* Report panic is NVM read is not successful */
+    if(sys_status_success != result)
+    {
+        ReportPanic(app_panic_nvm_read);
+    }
+#endif /* NVM_TYPE_FLASH */
+
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_Write
+ *
+ *  DESCRIPTION
+ *      Write words to the NVM store after preparing the NVM to be writable. 
+ *      After the write operation, perform things necessary in slave 
+ *      application to save power on NVM.
+ *
+ *      Write words from the supplied buffer into the NVM Store, starting at the
+ *      given word offset. Within the RAM shadow, the leading and trailing 
+ *      words which already hold the value written are skipped, and nothing 
+ *      is written if all of them do.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void Nvm_Write(uint16* buffer, uint16 length, uint16 offset)
+{
+    sys_status result;
+
+    if(nvmShadowCovers(length, offset))
+    {
+        /* Trim the words the NVM already holds */
+        while(length != 0 && g_nvm_shadow.words[offset] == *buffer)
+        {
+            ++ buffer;
+            ++ offset;
+            -- length;
+        }
+
+        while(length != 0 &&
+              g_nvm_shadow.words[offset + length - 1] == buffer[length - 1])
+        {
+            -- length;
+        }
+
+        if(length == 0)
+        {
+            /* Unchanged, no NVM access needed */
+            APP_PERF_INC(app_perf_nvm_writes_skipped);
+            return;
+        }
+
+        /* The shadow always holds the latest contents */
+        MemCopy(&g_nvm_shadow.words[offset], buffer, length);
+    }
+#ifdef NVM_TYPE_FLASH
+    else
+    {
+        /* The record log only holds the words within the shadow */
+        ReportPanic(app_panic_nvm_write);
+    }
+#endif /* NVM_TYPE_FLASH */
+
+    if(g_nvm_batch.depth != 0)
+    {
+        /* Collect the words, they will be written by Nvm_EndBatch() */
+        nvmBatchAdd(buffer, length, offset);
+        return;
+    }
+
+    /* Write to NVM. Firmware re-enables the NVM if it is disabled */
+    result = nvmWriteWords(buffer, length, offset);
+
+    /* Disable NVM to save power after write operation */
+    Nvm_Disable();
+
+    nvmHandleWriteResult(result);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_WriteDirect
+ *
+ *  DESCRIPTION
+ *      This function writes words to the NVM store straight away, bypassing 
+ *      any write batch in progress, and reports failure to the caller 
+ *      instead of raising a panic. It is meant for the panic path, where the 
+ *      chip is about to be reset.
+ *
+ *      On SPI flash the words are appended to the record log with a commit 
+ *      marker like any other write, so they must be within the RAM shadow. 
+ *      The log is not compacted: if it is full the write fails.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if the words were written.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool Nvm_WriteDirect(uint16* buffer, uint16 length, uint16 offset)
+{
+    sys_status result;
+
+    if(nvmShadowCovers(length, offset))
+    {
+        MemCopy(&g_nvm_shadow.words[offset], buffer, length);
+    }
+#ifdef NVM_TYPE_FLASH
+    else
+    {
+        /* The record log only holds the words within the shadow */
+        return FALSE;
+    }
+
+    result = nvmLogWriteRecord(buffer, length, offset);
+#else
+    APP_PERF_INC(app_perf_nvm_writes);
+
+    result = NvmWrite(buffer, length, offset);
+#endif /* NVM_TYPE_FLASH */
+
+    Nvm_Disable();
+
+    return (result == sys_status_success);
+}
+
+
+#ifndef NVM_TYPE_FLASH
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_LoadShadow
+ *
+ *  DESCRIPTION
+ *      This function reads the start of the NVM into the RAM shadow with a 
+ *      single NvmRead() and enable/disable cycle. From then on, Nvm_Read() 
+ *      requests falling within the shadow are served from it and 
+ *      Nvm_Write() keeps it up to date. It must be called once the EEPROM 
+ *      has been configured and before any other NVM access.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void Nvm_LoadShadow(void)
+{
+    g_nvm_shadow.loaded = FALSE;
+
+    Nvm_Read(g_nvm_shadow.words, NVM_SHADOW_WORDS, 0);
+
+    g_nvm_shadow.loaded = TRUE;
+}
+#endif /* !NVM_TYPE_FLASH */
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_ReadGroup
+ *
+ *  DESCRIPTION
+ *      This function reads a record group written by Nvm_WriteGroup(). The 
+ *      group is valid if its header holds the expected layout version and 
+ *      number of words and the CRC16 of the words matches. The buffer 
+ *      contents are undefined if the group is not valid.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if the group is valid.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool Nvm_ReadGroup(uint16* buffer, uint16 length, uint16 offset,
+                          uint16 version)
+{
+    uint16 header[NVM_GROUP_HEADER_WORDS];
+
+    Nvm_Read(header, NVM_GROUP_HEADER_WORDS, offset);
+
+    if(header[0] != NVM_GROUP_HEADER(version, length))
+    {
+        /* Written by another layout, or not written at all */
+        return FALSE;
+    }
+
+    Nvm_Read(buffer, length, offset + NVM_GROUP_HEADER_WORDS);
+
+    return (header[1] == nvmCrc16(NVM_CRC16_INIT, buffer, length));
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_WriteGroup
+ *
+ *  DESCRIPTION
+ *      This function writes a record group: a header holding the layout 
+ *      version, the number of words and their CRC16, followed by the words. 
+ *      The header and the words are contiguous, so they are committed with 
+ *      a single write. A write cut short leaves a CRC mismatch which 
+ *      Nvm_ReadGroup() detects.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void Nvm_WriteGroup(uint16* buffer, uint16 length, uint16 offset,
+                           uint16 version)
+{
+    uint16 header[NVM_GROUP_HEADER_WORDS];
+
+    header[0] = NVM_GROUP_HEADER(version, length);
+    header[1] = nvmCrc16(NVM_CRC16_INIT, buffer, length);
+
+    Nvm_BeginBatch();
+
+    Nvm_Write(header, NVM_GROUP_HEADER_WORDS, offset);
+    Nvm_Write(buffer, length, offset + NVM_GROUP_HEADER_WORDS);
+
+    Nvm_EndBatch();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_CheckGroup
+ *
+ *  DESCRIPTION
+ *      This function checks a record group like Nvm_ReadGroup() does, a few 
+ *      words at a time, for groups too big to be read onto the stack.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if the group is valid.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool Nvm_CheckGroup(uint16 length, uint16 offset, uint16 version)
+{
+    uint16 header[NVM_GROUP_HEADER_WORDS];
+    uint16 words[NVM_GROUP_CHUNK_WORDS];
+    uint16 crc = NVM_CRC16_INIT;
+    uint16 chunk;
+
+    Nvm_Read(header, NVM_GROUP_HEADER_WORDS, offset);
+
+    if(header[0] != NVM_GROUP_HEADER(version, length))
+    {
+        /* Written by another layout, or not written at all */
+        return FALSE;
+    }
+
+    offset += NVM_GROUP_HEADER_WORDS;
+
+    while(length != 0)
+    {
+        chunk = (length > NVM_GROUP_CHUNK_WORDS) ? NVM_GROUP_CHUNK_WORDS : 
+                                                   length;
+
+        Nvm_Read(words, chunk, offset);
+        crc = nvmCrc16(crc, words, chunk);
+
+        offset += chunk;
+        length -= chunk;
+    }
+
+    return (header[1] == crc);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_CopyToGroup
+ *
+ *  DESCRIPTION
+ *      This function copies words of the NVM into a record group at another 
+ *      offset, a few words at a time. The regions must not overlap. The 
+ *      header is written last, so the group is only valid once all the 
+ *      words have been copied.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void Nvm_CopyToGroup(uint16 length, uint16 from, uint16 offset,
+                            uint16 version)
+{
+    uint16 header[NVM_GROUP_HEADER_WORDS];
+    uint16 words[NVM_GROUP_CHUNK_WORDS];
+    uint16 crc = NVM_CRC16_INIT;
+    uint16 index;
+    uint16 chunk;
+
+    for(index = 0; index < length; index += chunk)
+    {
+        chunk = (length - index > NVM_GROUP_CHUNK_WORDS) ? 
+                                    NVM_GROUP_CHUNK_WORDS : length - index;
+
+        Nvm_Read(words, chunk, from + index);
+        crc = nvmCrc16(crc, words, chunk);
+
+        Nvm_Write(words, chunk, offset + NVM_GROUP_HEADER_WORDS + index);
+    }
+
+    header[0] = NVM_GROUP_HEADER(version, length);
+    header[1] = crc;
+
+    Nvm_Write(header, NVM_GROUP_HEADER_WORDS, offset);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_BeginBatch
+ *
+ *  DESCRIPTION
+ *      This function starts a write batch. Until the matching 
+ *      Nvm_EndBatch(), Nvm_Write() copies the words into a RAM buffer, 
+ *      merging writes to contiguous NVM regions, instead of writing them. 
+ *      Batches may be nested, only the outermost one is committed.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void Nvm_BeginBatch(void)
+{
+    ++ g_nvm_batch.depth;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_EndBatch
+ *
+ *  DESCRIPTION
+ *      This function ends a write batch. When the outermost batch ends, the 
+ *      collected regions are written, one NvmWrite() per contiguous region, 
+ *      and the NVM is disabled once for the whole batch.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void Nvm_EndBatch(void)
+{
+    if(-- g_nvm_batch.depth == 0)
+    {
+        nvmBatchFlush();
+
+        /* Disable NVM to save power after the batch */
+        Nvm_Disable();
+    }
+}
+
+
+#ifdef NVM_TYPE_FLASH
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_LoadLog
+ *
+ *  DESCRIPTION
+ *      This function replays the record log of the committed log area with 
+ *      the newer generation into the RAM shadow. It must be called once the 
+ *      SPI flash has been configured and before any other NVM access. Words 
+ *      never written read as erased (0xffff), so a blank store fails the 
+ *      application sanity check as before.
+ *
+ *      If neither area is committed, the store is blank or holds the plain 
+ *      words written by an application without the record log, which are 
+ *      read into the shadow as they are so that the application can migrate
+ *      them. The first write then compacts them into area 1, leaving area 0 
+ *      as it is until area 1 is committed.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void Nvm_LoadLog(void)
+{
+    uint16 headers[NVM_LOG_AREAS][NVM_LOG_AREA_HEADER_WORDS + 1];
+    bool committed[NVM_LOG_AREAS];
+    uint16 area;
+    uint16 start;
+    uint16 pos;
+    uint16 header;
+    uint16 length;
+    uint16 offset;
+    uint16 commit;
+    sys_status result = sys_status_success;
+
+    MemSet(g_nvm_shadow.words, NVM_LOG_ERASED, NVM_SHADOW_WORDS);
+
+    /* Read the area headers, and the word following them, which is erased 
+     * unless a compaction into the area was started
+     */
+    for(area = 0; area < NVM_LOG_AREAS && result == sys_status_success; 
+        area ++)
+    {
+        result = NvmRead(headers[area], NVM_LOG_AREA_HEADER_WORDS + 1, 
+                         NVM_LOG_AREA_START(area));
+
+        committed[area] = (headers[area][1] == NVM_LOG_COMMIT &&
+                           headers[area][0] <= NVM_LOG_GENERATION_MASK);
+    }
+
+    if(committed[0] && committed[1])
+    {
+        /* A power failure came before the superseded area was erased. The 
+         * live area is one generation on.
+         */
+        area = (((headers[0][0] - headers[1][0]) & NVM_LOG_GENERATION_MASK) 
+                == 1) ? 0 : 1;
+    }
+    else
+    {
+        area = committed[0] ? 0 : 1;
+    }
+
+    g_nvm_log.area = area;
+    g_nvm_log.generation = headers[area][0];
+    g_nvm_log.compact_pending = FALSE;
+
+    if(committed[area])
+    {
+        pos = NVM_LOG_AREA_HEADER_WORDS;
+    }
+    else
+    {
+        /* No log yet. Take the plain words at the start of the store, and 
+         * treat area 0 as a full log so that the first write compacts into 
+         * area 1.
+         */
+        if(result == sys_status_success)
+        {
+            result = NvmRead(g_nvm_shadow.words, NVM_SHADOW_WORDS, 0);
+        }
+
+        area = 0;
+        g_nvm_log.area = area;
+        g_nvm_log.generation = NVM_LOG_GENERATION_MASK;
+        pos = NVM_LOG_AREA_WORDS;
+    }
+
+    start = NVM_LOG_AREA_START(area);
+
+    while(pos + NVM_LOG_RECORD_OVERHEAD <= NVM_LOG_AREA_WORDS &&
+          result == sys_status_success)
+    {
+        result = NvmRead(&header, 1, start + pos);
+
+        if(result != sys_status_success || header == NVM_LOG_ERASED)
+        {
+            /* End of the log */
+            break;
+        }
+
+        length = NVM_LOG_HEADER_LENGTH(header);
+        offset = NVM_LOG_HEADER_OFFSET(header);
+
+        if(offset + length > NVM_SHADOW_WORDS ||
+           pos + length + NVM_LOG_RECORD_OVERHEAD > NVM_LOG_AREA_WORDS)
+        {
+            /* Not a record. Treat the log as full so that it gets compacted 
+             * before the next write.
+             */
+            pos = NVM_LOG_AREA_WORDS;
+            break;
+        }
+
+        result = NvmRead(&commit, 1, start + pos + 1 + length);
+
+        if(result == sys_status_success && commit == NVM_LOG_COMMIT)
+        {
+            /* Committed record, its words supersede older ones */
+            result = NvmRead(&g_nvm_shadow.words[offset], length, 
+                             start + pos + 1);
+        }
+
+        pos += length + NVM_LOG_RECORD_OVERHEAD;
+    }
+
+    Nvm_Disable();
+
+    if(result != sys_status_success)
+    {
+        ReportPanic(app_panic_nvm_read);
+    }
+
+    g_nvm_shadow.loaded = TRUE;
+    g_nvm_log.write_pos = pos;
+
+    if(pos > NVM_LOG_COMPACT_THRESHOLD)
+    {
+        g_nvm_log.compact_pending = TRUE;
+    }
+
+    /* The other area needs erasing before the next compaction unless it is 
+     * blank
+     */
+    area = NVM_LOG_OTHER_AREA(area);
+    g_nvm_log.erase_pending = (headers[area][0] != NVM_LOG_ERASED ||
+                               headers[area][1] != NVM_LOG_ERASED ||
+                               headers[area][2] != NVM_LOG_ERASED);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_CompactLog
+ *
+ *  DESCRIPTION
+ *      This function compacts the record log if it is getting full, and 
+ *      erases the log area superseded by the last compaction. It is called 
+ *      by the application at quiet points, when the time taken by the erase 
+ *      does not delay a GATT procedure.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void Nvm_CompactLog(void)
+{
+    sys_status result = sys_status_success;
+
+    if(g_nvm_batch.depth != 0)
+    {
+        return;
+    }
+
+    if(g_nvm_log.compact_pending)
+    {
+        result = nvmLogCompact();
+    }
+
+    if(result == sys_status_success && g_nvm_log.erase_pending)
+    {
+        result = nvmLogEraseArea(NVM_LOG_OTHER_AREA(g_nvm_log.area));
+    }
+
+    Nvm_Disable();
+
+    nvmHandleWriteResult(result);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_Erase
+ *
+ *  DESCRIPTION
+ *      Erases the NVM memory. Both log areas are erased, so the next write 
+ *      starts a new log in area 1 with the contents of the RAM shadow.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void Nvm_Erase(void)
+{
+    sys_status result;
+
+    APP_PERF_INC(app_perf_nvm_erases);
+
+    /* NvmErase automatically enables the NVM before erasing */
+    result = NvmErase(TRUE);
+
+    /* Disable NVM after erasing */
+    Nvm_Disable();
+
+    /* If NvmErase fails, report panic */
+    if(sys_status_success != result)
+    {
+        ReportPanic(app_panic_nvm_erase);
+    }
+
+    /* No log left: the next write compacts into area 1 */
+    g_nvm_log.area = 0;
+    g_nvm_log.generation = NVM_LOG_GENERATION_MASK;
+    g_nvm_log.write_pos = NVM_LOG_AREA_WORDS;
+    g_nvm_log.compact_pending = TRUE;
+    g_nvm_log.erase_pending = FALSE;
 }
 #endif /* NVM_TYPE_FLASH */
 
@@ -21,6 +21,34 @@
 #include <types.h>
 #include <status.h>
 
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Number of words of the header written in front of a record group: the 
+ * layout version and number of words of the group, then the CRC16 of the 
+ * words
+ */
+#define NVM_GROUP_HEADER_WORDS              (2)
+
+/* First word of the header of a record group */
+#define NVM_GROUP_HEADER(version, length)   (((version) << 8) | (length))
+
+/* Layout version held in the first word of the header of a record group */
+#define NVM_GROUP_HEADER_VERSION(header)    ((header) >> 8)
+
+/* Size in words of the RAM shadow of the NVM. It covers the application, all 
+ * the supported services and the bond table. On SPI flash it is also the 
+ * size of the logical NVM the record log is replayed into.
+ */
+#define NVM_SHADOW_WORDS                    (0xa0)
+
+/* Fails the build unless 'cond' holds, the array type 'name' then having a
+ * negative size. Used to check at compile time that the NVM layout fits the
+ * RAM shadow.
+ */
+#define NVM_STATIC_ASSERT(cond, name)       typedef char name[(cond) ? 1 : -1]
+
 /*============================================================================*
  *  Public Function Prototypes
  *============================================================================*/
@@ -36,9 +64,48 @@ extern void Nvm_Read(uint16* buffer, uint16 length, uint16 offset);
 /* Write words to the NVM store after preparing the NVM to be writable */
 extern void Nvm_Write(uint16* buffer, uint16 length, uint16 offset);
 
+/* Write words to the NVM store straight away, without raising a panic on 
+ * failure
+ */
+extern bool Nvm_WriteDirect(uint16* buffer, uint16 length, uint16 offset);
+
+/* Read a record group and check its header and CRC */
+extern bool Nvm_ReadGroup(uint16* buffer, uint16 length, uint16 offset,
+                          uint16 version);
+
+/* Write a record group behind a header holding its layout version and CRC */
+extern void Nvm_WriteGroup(uint16* buffer, uint16 length, uint16 offset,
+                           uint16 version);
+
+/* Check a record group a few words at a time */
+extern bool Nvm_CheckGroup(uint16 length, uint16 offset, uint16 version);
+
+/* Copy words of the NVM into a record group, writing its header last */
+extern void Nvm_CopyToGroup(uint16 length, uint16 from, uint16 offset,
+                            uint16 version);
+
+/* Start collecting NVM writes into a single batch */
+extern void Nvm_BeginBatch(void);
+
+/* Write the NVM writes collected since Nvm_BeginBatch() */
+extern void Nvm_EndBatch(void);
+
 #ifdef NVM_TYPE_FLASH
 /* Erases the NVM memory.*/
 extern void Nvm_Erase(void);
+
+/* Replay the NVM record log into RAM. Must be called once at start-up before
+ * any other NVM access.
+ */
+extern void Nvm_LoadLog(void);
+
+/* Compact the NVM record log if it is filling up */
+extern void Nvm_CompactLog(void);
+#else
+/* Read the start of the NVM into the RAM shadow. Must be called once at 
+ * start-up before any other NVM access.
+ */
+extern void Nvm_LoadShadow(void);
 #endif /* NVM_TYPE_FLASH */
 
 #endif /* __NVM_ACCESS_H__ */
\ No newline at end of file
@@ -0,0 +1,119 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      packed_buf.c
+ *
+ *  DESCRIPTION
+ *      This file defines routines used to pack octet strings two octets per
+ *      word, halving the words the strings themselves take on the XAP, and
+ *      to unpack them into the uint8 arrays the firmware works on.
+ *
+ *      The words saved in the statics are offset by the code of these
+ *      routines and by the arrays unpacked into on the stack, so the net
+ *      saving is only known from the .map of a build for the chip. The
+ *      host build, where a uint8 also takes a word, gives 11 words for the
+ *      device name and 3 for the last report, against 22 and 5 unpacked.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "packed_buf.h"
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      PackedBufSet
+ *
+ *  DESCRIPTION
+ *      This function sets the octet at 'index' in the packed buffer 'p_buf',
+ *      leaving the other octet of its word as it is.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void PackedBufSet(uint16 *p_buf, uint16 index, uint8 value)
+{
+    uint16 *p_word = &p_buf[index >> 1];
+
+    if(index & 1)
+    {
+        *p_word = (*p_word & 0x00ff) | ((uint16)value << 8);
+    }
+    else
+    {
+        *p_word = (*p_word & 0xff00) | (value & 0x00ff);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      PackedBufPack
+ *
+ *  DESCRIPTION
+ *      This function packs 'num_octets' octets from 'p_src' into the packed
+ *      buffer 'p_buf', starting at its first octet. With an odd number of
+ *      octets, the high half of the last word is left as it is.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void PackedBufPack(uint16 *p_buf, const uint8 *p_src,
+                          uint16 num_octets)
+{
+    uint16 words = num_octets >> 1;
+
+    while(words -- != 0)
+    {
+        *p_buf ++ = PACKED_OCTETS(p_src[0] & 0x00ff, p_src[1] & 0x00ff);
+        p_src += 2;
+    }
+
+    if(num_octets & 1)
+    {
+        *p_buf = (*p_buf & 0xff00) | (*p_src & 0x00ff);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      PackedBufUnpack
+ *
+ *  DESCRIPTION
+ *      This function unpacks 'num_octets' octets of the packed buffer 
+ *      'p_buf', starting at the octet at 'offset', into 'p_dst'.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void PackedBufUnpack(uint8 *p_dst, const uint16 *p_buf, uint16 offset,
+                            uint16 num_octets)
+{
+    while(num_octets -- != 0)
+    {
+        *p_dst ++ = PACKED_BUF_GET(p_buf, offset);
+        ++ offset;
+    }
+}
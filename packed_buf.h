@@ -0,0 +1,65 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      packed_buf.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the octet buffers packed two octets per word
+ *
+ *****************************************************************************/
+
+#ifndef __PACKED_BUF_H__
+#define __PACKED_BUF_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* On the XAP a uint8 takes a whole word. Octet strings kept in RAM are
+ * therefore packed two octets per word, the first octet in the low half,
+ * and unpacked into a uint8 array only when handed to the firmware.
+ */
+
+/* Number of words needed to hold 'octets' packed octets */
+#define PACKED_BUF_WORDS(octets)    (((octets) + 1) >> 1)
+
+/* Word holding the two octets 'first' and 'second', used to initialise a
+ * packed buffer
+ */
+#define PACKED_OCTETS(first, second) \
+                                    ((uint16)(first) | ((uint16)(second) << 8))
+
+/* Octet at 'index' in the packed buffer 'p_buf' */
+#define PACKED_BUF_GET(p_buf, index) \
+                                    ((uint8)(((p_buf)[(index) >> 1] >> \
+                                              (((index) & 1) << 3)) & 0xff))
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* This function sets the octet at 'index' in a packed buffer */
+extern void PackedBufSet(uint16 *p_buf, uint16 index, uint8 value);
+
+/* This function packs 'num_octets' octets into a packed buffer, from its
+ * first octet
+ */
+extern void PackedBufPack(uint16 *p_buf, const uint8 *p_src,
+                          uint16 num_octets);
+
+/* This function unpacks 'num_octets' octets of a packed buffer, from the
+ * octet at 'offset'
+ */
+extern void PackedBufUnpack(uint8 *p_dst, const uint16 *p_buf, uint16 offset,
+                            uint16 num_octets);
+
+#endif /* __PACKED_BUF_H__ */
@@ -0,0 +1,117 @@
+;******************************************************************************
+;  Copyright Cambridge Silicon Radio Limited 2012-2014
+;  Part of CSR uEnergy SDK 2.3.0
+;  Application version 2.3.0.0
+;
+;  FILE
+;      pio_ctrlr_code.asm
+;
+;  DESCRIPTION
+;      PIO controller program counting the GHG (PIO10) and BP (PIO11)
+;      pulses. Both inputs are pulled up and pulled low while pressed. An
+;      input only changes state once it has read the new level on
+;      DEBOUNCE_SAMPLES samples in a row, and each change to the pressed
+;      state increments the counter of the input.
+;
+;      The counters are free running octets in the memory shared with the
+;      application (see pulse_ctrlr.c): the GHG counter at SHARED_GHG and
+;      the BP counter at SHARED_BP. The application only ever reads them.
+;
+;******************************************************************************
+
+;============================================================================
+;  Definitions
+;============================================================================
+
+; PIO8 to PIO15 are read through port 1
+GHG_MASK            equ     04h     ; PIO10
+BP_MASK             equ     08h     ; PIO11
+
+; Number of samples in a row an input must read its new level for
+DEBOUNCE_SAMPLES    equ     2
+
+; Loop count of the delay between two samples. Running from the slow clock
+; the sampling loop takes about 8ms, so a level must last about 16ms to be
+; taken, which still follows pulse trains of 20Hz.
+SAMPLE_DELAY        equ     1
+
+; Offsets of the counters in the shared memory
+SHARED_GHG          equ     00h
+SHARED_BP           equ     01h
+
+; Register usage
+;   R2  debounced state of the inputs, a bit set while released
+;   R3  samples in a row the GHG input has read a new level for
+;   R4  samples in a row the BP input has read a new level for
+;   R6  current sample of port 1
+;   R7  delay loop count
+
+;============================================================================
+;  Program
+;============================================================================
+
+            org     0000h
+
+start:
+            ; Clear the counters
+            clr     a
+            mov     dptr, #SHARED_GHG
+            movx    @dptr, a
+            mov     dptr, #SHARED_BP
+            movx    @dptr, a
+
+            ; Both inputs start released
+            mov     r2, #(GHG_MASK OR BP_MASK)
+            mov     r3, #0
+            mov     r4, #0
+
+sample:
+            mov     a, P1
+            mov     r6, a
+
+            ; GHG input
+            xrl     a, r2
+            anl     a, #GHG_MASK
+            jz      ghg_steady
+            inc     r3
+            cjne    r3, #DEBOUNCE_SAMPLES, ghg_done
+            mov     a, r2
+            xrl     a, #GHG_MASK
+            mov     r2, a
+            anl     a, #GHG_MASK
+            jnz     ghg_steady              ; released, nothing to count
+            mov     dptr, #SHARED_GHG
+            movx    a, @dptr
+            inc     a
+            movx    @dptr, a
+ghg_steady:
+            mov     r3, #0
+ghg_done:
+
+            ; BP input
+            mov     a, r6
+            xrl     a, r2
+            anl     a, #BP_MASK
+            jz      bp_steady
+            inc     r4
+            cjne    r4, #DEBOUNCE_SAMPLES, bp_done
+            mov     a, r2
+            xrl     a, #BP_MASK
+            mov     r2, a
+            anl     a, #BP_MASK
+            jnz     bp_steady               ; released, nothing to count
+            mov     dptr, #SHARED_BP
+            movx    a, @dptr
+            inc     a
+            movx    @dptr, a
+bp_steady:
+            mov     r4, #0
+bp_done:
+
+            ; Wait for the next sample
+            mov     r7, #SAMPLE_DELAY
+delay:
+            djnz    r7, delay
+            sjmp    sample
+
+            end
@@ -0,0 +1,146 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      pulse_ctrlr.c
+ *
+ *  DESCRIPTION
+ *      This file defines routines used to count the GHG (PIO10) and BP
+ *      (PIO11) pulses on the PIO controller instead of the application.
+ *
+ *      The program in pio_ctrlr_code.asm samples both inputs, debounces
+ *      them and counts the presses in free running 8-bit counters held in
+ *      the memory it shares with the application. No PIO changed event is
+ *      raised for these inputs, so the pulses no longer wake the chip. The
+ *      application fetches the counters when a report is due and adds the
+ *      difference since the previous fetch to the GHG and BP counts.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <pio_ctrlr.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+#include "pulse_ctrlr.h"
+#include "ht_hw.h"
+#include "counter_store.h"
+
+#ifdef ENABLE_PIO_CTRLR_COUNTING
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Word of the PIO controller memory holding the counters, as seen by the
+ * application. The GHG counter is the low octet and the BP counter the high
+ * octet. Each counter is a single octet written by the controller in one
+ * go, so it can be read at any time.
+ */
+#define PULSE_CTRLR_COUNTS      (*(volatile const uint16 *) \
+                                 (PIO_CTRLR_SHARED_RAM + 0))
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Pulse counting data type */
+typedef struct
+{
+    /* Counters read at the previous fetch */
+    uint8                   ghg_last;
+    uint8                   bp_last;
+
+} PULSE_CTRLR_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Pulse counting data instance */
+static PULSE_CTRLR_DATA_T g_pulse_ctrlr;
+
+/* Program image of the PIO controller, built from pio_ctrlr_code.asm */
+extern uint16 pio_ctrlr_code;
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      PulseCtrlrStart
+ *
+ *  DESCRIPTION
+ *      This function loads the pulse counting program into the PIO
+ *      controller and starts it. The program clears its counters when it
+ *      starts. It runs from the slow clock, which is enough to sample pulses
+ *      of up to a few tens of Hz.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void PulseCtrlrStart(void)
+{
+    PioCtrlrStop();
+
+    g_pulse_ctrlr.ghg_last = 0;
+    g_pulse_ctrlr.bp_last = 0;
+
+    PioCtrlrInit(&pio_ctrlr_code);
+    PioCtrlrClock(FALSE);
+    PioCtrlrStart();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      PulseCtrlrFetch
+ *
+ *  DESCRIPTION
+ *      This function adds the pulses counted by the PIO controller since the
+ *      last call to the GHG and BP counts, which wrap at 0xFF like the ones
+ *      counted by the application. Up to 255 pulses of each input can be
+ *      counted between two calls.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if any pulse has been counted since the last call.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool PulseCtrlrFetch(void)
+{
+    uint16 counts = PULSE_CTRLR_COUNTS;
+    uint8 ghg = (uint8)(counts & 0xff);
+    uint8 bp = (uint8)(counts >> 8);
+    uint8 ghg_new = (uint8)(ghg - g_pulse_ctrlr.ghg_last);
+    uint8 bp_new = (uint8)(bp - g_pulse_ctrlr.bp_last);
+
+    if((ghg_new == 0) && (bp_new == 0))
+    {
+        return FALSE;
+    }
+
+    g_pulse_ctrlr.ghg_last = ghg;
+    g_pulse_ctrlr.bp_last = bp;
+
+    ghg_count = (uint8)(ghg_count + ghg_new);
+    bp_count = (uint8)(bp_count + bp_new);
+
+    CounterStoreAdd(ghg_new + bp_new);
+
+    return TRUE;
+}
+
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
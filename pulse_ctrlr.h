@@ -0,0 +1,48 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      pulse_ctrlr.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the GHG and BP pulse counting offloaded to the
+ *      PIO controller
+ *
+ *****************************************************************************/
+
+#ifndef __PULSE_CTRLR_H__
+#define __PULSE_CTRLR_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+
+#ifdef ENABLE_PIO_CTRLR_COUNTING
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* This function loads the pulse counting program into the PIO controller
+ * and starts it
+ */
+extern void PulseCtrlrStart(void);
+
+/* This function adds the pulses counted by the PIO controller since the
+ * last call to the GHG and BP counts. It returns TRUE if there were any.
+ */
+extern bool PulseCtrlrFetch(void);
+
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
+
+#endif /* __PULSE_CTRLR_H__ */
@@ -0,0 +1,286 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      signal_seq.c
+ *
+ *  DESCRIPTION
+ *      This file defines routines used to play signal patterns on the
+ *      buzzer driven by PWM unit 0 on PIO 14. A pattern is a table of steps,
+ *      each holding a PWM level and a duration, so new signals are added as
+ *      data rather than code. The beeps are played from tables held in ROM,
+ *      and the host can play its own pattern through the Diagnostics
+ *      service.
+ *
+ *      Steps are advanced by the low priority scheduler, so starting a
+ *      pattern only configures the PWM unit and returns.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <pio.h>
+#include <pio_ctrlr.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+#include "signal_seq.h"
+#include "app_sched.h"
+
+#ifdef ENABLE_BUZZER
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* The index (0-3) of the PWM unit driving the buzzer */
+#define SIGNAL_PWM_INDEX        (0)
+
+/* PWM period, in 30us slots. 17 slots give a tone of about 2kHz. */
+#define SIGNAL_PWM_PERIOD       (SIGNAL_LEVEL_MAX + 1)
+
+/* PWM hold times and ramp rate. The dull and bright phases are configured
+ * alike, so the level is steady for the whole step.
+ */
+#define SIGNAL_PWM_HOLD_TIME    (0)
+#define SIGNAL_PWM_RAMP_RATE    (0xFF)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Sequencer data type */
+typedef struct
+{
+    /* Steps of the pattern being played, NULL if none */
+    const SIGNAL_STEP_T     *p_steps;
+
+    /* Number of steps of the pattern being played */
+    uint16                  num_steps;
+
+    /* Index of the next step to play */
+    uint16                  step;
+
+    /* Level the PWM unit is currently configured for */
+    uint8                   level;
+
+    /* Pattern written by the host */
+    SIGNAL_STEP_T           host_steps[SIGNAL_HOST_STEPS_MAX];
+
+} SIGNAL_SEQ_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Sequencer data instance */
+static SIGNAL_SEQ_DATA_T g_signal_seq;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void signalSetLevel(uint8 level);
+static void signalSeqNextStep(void);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      signalSetLevel
+ *
+ *  DESCRIPTION
+ *      This function sets the PWM level of the buzzer. The PWM unit is only
+ *      reconfigured when the level changes.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void signalSetLevel(uint8 level)
+{
+    if(level == g_signal_seq.level)
+    {
+        return;
+    }
+
+    g_signal_seq.level = level;
+
+    if(level == SIGNAL_LEVEL_OFF)
+    {
+        PioEnablePWM(SIGNAL_PWM_INDEX, FALSE);
+    }
+    else
+    {
+        PioConfigPWM(SIGNAL_PWM_INDEX, pio_pwm_mode_push_pull,
+                     level, SIGNAL_PWM_PERIOD - level, SIGNAL_PWM_HOLD_TIME,
+                     level, SIGNAL_PWM_PERIOD - level, SIGNAL_PWM_HOLD_TIME,
+                     SIGNAL_PWM_RAMP_RATE);
+
+        PioEnablePWM(SIGNAL_PWM_INDEX, TRUE);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      signalSeqNextStep
+ *
+ *  DESCRIPTION
+ *      This function plays the next step of the pattern and schedules the
+ *      one after it. The buzzer is silenced once the last step has been
+ *      played.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void signalSeqNextStep(void)
+{
+    const SIGNAL_STEP_T *p_step;
+
+    if((g_signal_seq.p_steps == NULL) ||
+       (g_signal_seq.step >= g_signal_seq.num_steps))
+    {
+        g_signal_seq.p_steps = NULL;
+        signalSetLevel(SIGNAL_LEVEL_OFF);
+        return;
+    }
+
+    p_step = &g_signal_seq.p_steps[g_signal_seq.step ++];
+
+    signalSetLevel(p_step->level);
+
+    AppSchedStart(app_sched_job_signal,
+                  (uint32)p_step->duration * SIGNAL_STEP_UNIT,
+                  signalSeqNextStep);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SignalSeqInit
+ *
+ *  DESCRIPTION
+ *      This function initialises the sequencer and silences the buzzer. The
+ *      buzzer PIO must already be in PWM mode.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void SignalSeqInit(void)
+{
+    g_signal_seq.p_steps = NULL;
+    g_signal_seq.num_steps = 0;
+    g_signal_seq.step = 0;
+
+    g_signal_seq.level = SIGNAL_LEVEL_OFF;
+    PioEnablePWM(SIGNAL_PWM_INDEX, FALSE);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SignalSeqPlay
+ *
+ *  DESCRIPTION
+ *      This function starts playing a pattern, stopping any pattern being
+ *      played. The first step is played straight away.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void SignalSeqPlay(const SIGNAL_STEP_T *p_steps, uint16 num_steps)
+{
+    g_signal_seq.p_steps = p_steps;
+    g_signal_seq.num_steps = num_steps;
+    g_signal_seq.step = 0;
+
+    signalSeqNextStep();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SignalSeqPlayHost
+ *
+ *  DESCRIPTION
+ *      This function starts playing a pattern written by the host, made of
+ *      'num_steps' steps of SIGNAL_STEP_OCTETS octets each. The caller
+ *      checks that the pattern fits SIGNAL_HOST_STEPS_MAX steps. Nothing is
+ *      played if a level is above SIGNAL_LEVEL_MAX or a duration is zero.
+ *
+ *  RETURNS
+ *      Boolean - FALSE if a step is out of range.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool SignalSeqPlayHost(const uint8 *p_value, uint16 num_steps)
+{
+    uint16 step;
+
+    for(step = 0; step < num_steps; step ++)
+    {
+        if((p_value[step * SIGNAL_STEP_OCTETS] > SIGNAL_LEVEL_MAX) ||
+           (p_value[step * SIGNAL_STEP_OCTETS + 1] == 0))
+        {
+            return FALSE;
+        }
+    }
+
+    /* The host pattern may be playing, stop it before overwriting it */
+    SignalSeqStop();
+
+    for(step = 0; step < num_steps; step ++)
+    {
+        g_signal_seq.host_steps[step].level = *p_value ++;
+        g_signal_seq.host_steps[step].duration = *p_value ++;
+    }
+
+    SignalSeqPlay(g_signal_seq.host_steps, num_steps);
+
+    return TRUE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SignalSeqStop
+ *
+ *  DESCRIPTION
+ *      This function stops the pattern being played and silences the
+ *      buzzer.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void SignalSeqStop(void)
+{
+    AppSchedStop(app_sched_job_signal);
+
+    g_signal_seq.p_steps = NULL;
+    signalSetLevel(SIGNAL_LEVEL_OFF);
+}
+
+#endif /* ENABLE_BUZZER */
@@ -0,0 +1,96 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      signal_seq.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the buzzer signal pattern sequencer
+ *
+ *****************************************************************************/
+
+#ifndef __SIGNAL_SEQ_H__
+#define __SIGNAL_SEQ_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <time.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+
+#ifdef ENABLE_BUZZER
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Unit of the duration of a pattern step */
+#define SIGNAL_STEP_UNIT        (5 * MILLISECOND)
+
+/* Converts a time in microseconds into a pattern step duration */
+#define SIGNAL_DURATION(time)   ((uint8)((time) / SIGNAL_STEP_UNIT))
+
+/* Level at which the buzzer is silent */
+#define SIGNAL_LEVEL_OFF        (0)
+
+/* Highest level. The level is the number of 30us slots, out of each PWM
+ * period of 17 slots, for which PIO 14 is driven high.
+ */
+#define SIGNAL_LEVEL_MAX        (16)
+
+/* Level at which the beeps are sounded */
+#define SIGNAL_LEVEL_BEEP       (2)
+
+/* Size of a pattern step written by the host: level (1 octet) and duration
+ * (1 octet)
+ */
+#define SIGNAL_STEP_OCTETS      (2)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Pattern step */
+typedef struct
+{
+    /* PWM level, SIGNAL_LEVEL_OFF to SIGNAL_LEVEL_MAX */
+    uint8                   level;
+
+    /* Duration of the step, in units of SIGNAL_STEP_UNIT */
+    uint8                   duration;
+
+} SIGNAL_STEP_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* This function initialises the sequencer and silences the buzzer */
+extern void SignalSeqInit(void);
+
+/* This function starts playing a pattern, stopping any pattern being
+ * played. The steps are not copied and must stay valid until the pattern
+ * has been played.
+ */
+extern void SignalSeqPlay(const SIGNAL_STEP_T *p_steps, uint16 num_steps);
+
+/* This function starts playing a pattern written by the host. It returns
+ * FALSE if a step is out of range.
+ */
+extern bool SignalSeqPlayHost(const uint8 *p_value, uint16 num_steps);
+
+/* This function stops the pattern being played and silences the buzzer */
+extern void SignalSeqStop(void);
+
+#endif /* ENABLE_BUZZER */
+
+#endif /* __SIGNAL_SEQ_H__ */
@@ -0,0 +1,284 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      throttle.c
+ *
+ *  DESCRIPTION
+ *      This file defines routines used to read the hall-effect throttle on
+ *      THROTTLE_AIO. Each sample is a burst of THROTTLE_OVERSAMPLE ADC reads
+ *      averaged into one voltage, which is scaled to a position from
+ *      THROTTLE_POSITION_REST to THROTTLE_POSITION_FULL with a deadband at
+ *      either end. A new position is only reported when it moves
+ *      THROTTLE_REPORT_STEP or more from the one last reported, when it
+ *      reaches either end, or every THROTTLE_KEEPALIVE while the throttle
+ *      is open.
+ *
+ *      The battery voltage is read on the same ADC. Both are read from the
+ *      application only, and a burst is taken within one run of the low
+ *      priority scheduler, so a battery read never falls inside a burst.
+ *      The first read of a burst follows the ADC input being switched and
+ *      is discarded.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <aio.h>
+#include <time.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+#include "throttle.h"
+#include "app_trace.h"
+#include "app_perf.h"
+
+#ifdef ENABLE_THROTTLE
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Span of the throttle voltage, in mV */
+#define THROTTLE_SPAN_MV        (THROTTLE_MAX_MV - THROTTLE_MIN_MV)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Throttle data type */
+typedef struct
+{
+    /* Position last reported */
+    uint8                   reported;
+
+    /* Time the position was last reported */
+    uint32                  report_time;
+
+    /* Boolean flag set while the throttle is open, and sampled every
+     * THROTTLE_SAMPLE_INTERVAL
+     */
+    bool                    open;
+
+} THROTTLE_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Throttle data instance */
+static THROTTLE_DATA_T g_throttle;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static uint16 throttleReadVoltage(void);
+static uint8 throttlePosition(uint16 voltage);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      throttleReadVoltage
+ *
+ *  DESCRIPTION
+ *      This function reads the throttle voltage THROTTLE_OVERSAMPLE times,
+ *      after a first read which is discarded, and returns the average of
+ *      the reads.
+ *
+ *  RETURNS
+ *      uint16 - Throttle voltage in mV
+ *
+ *---------------------------------------------------------------------------*/
+
+static uint16 throttleReadVoltage(void)
+{
+    uint32 sum = 0;
+    uint16 index;
+
+    (void)AioRead(THROTTLE_AIO);
+
+    for(index = 0; index < THROTTLE_OVERSAMPLE; index ++)
+    {
+        sum += AioRead(THROTTLE_AIO);
+    }
+
+    return (uint16)(sum / THROTTLE_OVERSAMPLE);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      throttlePosition
+ *
+ *  DESCRIPTION
+ *      This function converts a throttle voltage to a position. Positions
+ *      within THROTTLE_DEADBAND of either end are taken to be that end, so
+ *      the throttle reads exactly at rest and fully open despite the
+ *      tolerances of the sensor.
+ *
+ *  RETURNS
+ *      uint8 - Throttle position
+ *
+ *---------------------------------------------------------------------------*/
+
+static uint8 throttlePosition(uint16 voltage)
+{
+    uint16 position;
+
+    if(voltage <= THROTTLE_MIN_MV)
+    {
+        return THROTTLE_POSITION_REST;
+    }
+
+    if(voltage >= THROTTLE_MAX_MV)
+    {
+        return THROTTLE_POSITION_FULL;
+    }
+
+    position = (uint16)(((uint32)(voltage - THROTTLE_MIN_MV) *
+                         THROTTLE_POSITION_FULL) / THROTTLE_SPAN_MV);
+
+    if(position <= THROTTLE_DEADBAND)
+    {
+        return THROTTLE_POSITION_REST;
+    }
+
+    if(position >= THROTTLE_POSITION_FULL - THROTTLE_DEADBAND)
+    {
+        return THROTTLE_POSITION_FULL;
+    }
+
+    return (uint8)position;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ThrottleInit
+ *
+ *  DESCRIPTION
+ *      This function initialises the throttle input. The throttle is taken
+ *      to be at rest until it has been sampled.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void ThrottleInit(void)
+{
+    g_throttle.reported = THROTTLE_POSITION_REST;
+    g_throttle.report_time = TimeGet32();
+    g_throttle.open = FALSE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ThrottleSample
+ *
+ *  DESCRIPTION
+ *      This function samples the throttle and decides whether its position
+ *      is to be reported. The new position becomes the one reported if so.
+ *
+ *  RETURNS
+ *      Boolean - TRUE if the position is to be reported.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool ThrottleSample(void)
+{
+    uint8 position;
+    uint16 moved;
+    uint32 now = TimeGet32();
+
+    APP_PERF_INC(app_perf_throttle_samples);
+
+    position = throttlePosition(throttleReadVoltage());
+
+    g_throttle.open = (position != THROTTLE_POSITION_REST);
+
+    moved = (position > g_throttle.reported) ?
+                            (position - g_throttle.reported) :
+                            (g_throttle.reported - position);
+
+    /* Small moves are not reported, except onto either end */
+    if(moved < THROTTLE_REPORT_STEP &&
+       (moved == 0 || (position != THROTTLE_POSITION_REST &&
+                       position != THROTTLE_POSITION_FULL)))
+    {
+        /* An open throttle is repeated, so the host knows that the rider
+         * is holding it
+         */
+        if(!g_throttle.open ||
+           (int32)(now - g_throttle.report_time) < (int32)THROTTLE_KEEPALIVE)
+        {
+            return FALSE;
+        }
+    }
+
+    g_throttle.reported = position;
+    g_throttle.report_time = now;
+
+    APP_TRACE(app_trace_throttle, position);
+    APP_PERF_INC(app_perf_throttle_reports);
+
+    return TRUE;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ThrottleGetPosition
+ *
+ *  DESCRIPTION
+ *      This function returns the position of the throttle last reported.
+ *
+ *  RETURNS
+ *      uint8 - Throttle position
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint8 ThrottleGetPosition(void)
+{
+    return g_throttle.reported;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ThrottleSampleInterval
+ *
+ *  DESCRIPTION
+ *      This function returns the interval to the next sample. An open
+ *      throttle is sampled every THROTTLE_SAMPLE_INTERVAL, one at rest only
+ *      every THROTTLE_REST_INTERVAL, which delays the first report when it
+ *      opens by up to that much.
+ *
+ *  RETURNS
+ *      uint32 - Sample interval in microseconds
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint32 ThrottleSampleInterval(void)
+{
+    return g_throttle.open ? THROTTLE_SAMPLE_INTERVAL :
+                             THROTTLE_REST_INTERVAL;
+}
+
+#endif /* ENABLE_THROTTLE */
@@ -0,0 +1,61 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      throttle.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the analog throttle input
+ *
+ *****************************************************************************/
+
+#ifndef __THROTTLE_H__
+#define __THROTTLE_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+
+#ifdef ENABLE_THROTTLE
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Throttle position at rest and fully open */
+#define THROTTLE_POSITION_REST  (0)
+#define THROTTLE_POSITION_FULL  (255)
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* This function initialises the throttle input, at rest */
+extern void ThrottleInit(void);
+
+/* This function samples the throttle. It returns TRUE if its position is to
+ * be reported.
+ */
+extern bool ThrottleSample(void);
+
+/* This function returns the position of the throttle last reported */
+extern uint8 ThrottleGetPosition(void);
+
+/* This function returns the interval at which the throttle is to be
+ * sampled
+ */
+extern uint32 ThrottleSampleInterval(void);
+
+#endif /* ENABLE_THROTTLE */
+
+#endif /* __THROTTLE_H__ */
@@ -0,0 +1,421 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      tx_power.c
+ *
+ *  DESCRIPTION
+ *      This file defines routines used to control the transmit power while
+ *      connected. The RSSI of the link is sampled by the low priority
+ *      scheduler and the lowest power level which keeps TX_POWER_MARGIN dB
+ *      above TX_POWER_TARGET_RSSI at the host is used.
+ *
+ *      Changing the transmit power does not change the RSSI measured here,
+ *      which depends on the power of the host. The controller therefore
+ *      works out the level the link needs directly rather than stepping
+ *      until the RSSI moves: it steps down one level at a time while the
+ *      samples agree, and jumps straight to the level needed when a sample
+ *      falls short.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <ls_app_if.h>
+#include <mem.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+#include "tx_power.h"
+#include "app_sched.h"
+#include "app_trace.h"
+#include "app_perf.h"
+#include "health_thermo_service.h"
+
+#ifdef ENABLE_TX_POWER_CONTROL
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Highest transmit power level, used while advertising */
+#define TX_POWER_LEVEL_MAX      (7)
+
+/* Weight of a new sample in the smoothed RSSI, 1 / TX_POWER_RSSI_WEIGHT. The
+ * smoothed RSSI is held scaled by TX_POWER_RSSI_WEIGHT.
+ */
+#define TX_POWER_RSSI_WEIGHT    (4)
+
+/* Supply voltage used for the energy estimate, in mV */
+#define TX_POWER_SUPPLY_MV      (3000)
+
+/* Time on air of a key report notification, in us: preamble (1 octet),
+ * access address (4), header (2), L2CAP header (4), ATT opcode and handle
+ * (3), the report, MIC (4) and CRC (3), at 1 Mbps
+ */
+#define TX_POWER_REPORT_AIR_TIME \
+                    ((1 + 4 + 2 + 4 + 3 + MAX_TEMP_MEAS_SIZE + 4 + 3) * 8)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Transmit power level */
+typedef struct
+{
+    /* Transmit power, in dBm */
+    int8                    dbm;
+
+    /* Current drawn while transmitting, in units of 0.1mA */
+    uint16                  current;
+
+} TX_POWER_LEVEL_T;
+
+/* Transmit power control data type */
+typedef struct
+{
+    /* Address of the connected host, used to read the RSSI of the link */
+    TYPED_BD_ADDR_T         addr;
+
+    /* Transmit power level in use */
+    uint8                   level;
+
+    /* Smoothed RSSI, scaled by TX_POWER_RSSI_WEIGHT */
+    int16                   rssi_avg;
+
+    /* Boolean flag set once the RSSI has been sampled */
+    bool                    rssi_valid;
+
+    /* Samples in a row which allowed a lower level */
+    uint16                  down_samples;
+
+} TX_POWER_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Transmit power control data instance */
+static TX_POWER_DATA_T g_tx_power;
+
+/* Transmit power levels of the CSR101x, indexed by level. The currents are
+ * approximate and should be measured on the board for a better estimate.
+ */
+static const TX_POWER_LEVEL_T tx_power_levels[TX_POWER_LEVEL_MAX + 1] =
+{
+    {-18,   110},
+    {-14,   115},
+    {-10,   120},
+    {-6,    127},
+    {-2,    136},
+    {2,     150},
+    {6,     166},
+    {8,     180}
+};
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static uint8 txPowerLevelFor(int16 rssi);
+static void txPowerSetLevel(uint8 level);
+static void txPowerSample(void);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      txPowerLevelFor
+ *
+ *  DESCRIPTION
+ *      This function works out the lowest level at which the host would see
+ *      TX_POWER_TARGET_RSSI plus TX_POWER_MARGIN, given the RSSI of the link
+ *      seen here. The path loss is taken to be the same both ways.
+ *
+ *  RETURNS
+ *      Transmit power level.
+ *
+ *---------------------------------------------------------------------------*/
+
+static uint8 txPowerLevelFor(int16 rssi)
+{
+    int16 needed = TX_POWER_TARGET_RSSI + TX_POWER_MARGIN +
+                   (TX_POWER_HOST_TX_POWER - rssi);
+    uint8 level;
+
+    for(level = 0; level < TX_POWER_LEVEL_MAX; level ++)
+    {
+        if(tx_power_levels[level].dbm >= needed)
+        {
+            break;
+        }
+    }
+
+    return level;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      txPowerSetLevel
+ *
+ *  DESCRIPTION
+ *      This function sets the transmit power level. The level in use is kept
+ *      if the firmware refuses it.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void txPowerSetLevel(uint8 level)
+{
+    if(LsSetTransmitPowerLevel(level) != ls_err_none)
+    {
+        return;
+    }
+
+    g_tx_power.level = level;
+    g_tx_power.down_samples = 0;
+
+    APP_TRACE(app_trace_tx_power,
+              ((uint16)level << 8) | (uint8)TxPowerGetRssi());
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      txPowerSample
+ *
+ *  DESCRIPTION
+ *      This function is run by the low priority scheduler every
+ *      TX_POWER_SAMPLE_INTERVAL while connected. It samples the RSSI of the
+ *      link and adjusts the transmit power level. The worse of the sample
+ *      and the smoothed RSSI is used, so a fade raises the power straight
+ *      away while lowering it takes TX_POWER_DOWN_SAMPLES samples per level.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+static void txPowerSample(void)
+{
+    int8 rssi;
+    int16 smoothed;
+    uint8 wanted;
+
+    AppSchedStart(app_sched_job_tx_power, TX_POWER_SAMPLE_INTERVAL,
+                  txPowerSample);
+
+    if(LsReadRssi(&g_tx_power.addr, &rssi) != ls_err_none)
+    {
+        return;
+    }
+
+    if(!g_tx_power.rssi_valid)
+    {
+        g_tx_power.rssi_avg = rssi * TX_POWER_RSSI_WEIGHT;
+        g_tx_power.rssi_valid = TRUE;
+    }
+    else
+    {
+        g_tx_power.rssi_avg += rssi -
+                               g_tx_power.rssi_avg / TX_POWER_RSSI_WEIGHT;
+    }
+
+    smoothed = g_tx_power.rssi_avg / TX_POWER_RSSI_WEIGHT;
+
+    wanted = txPowerLevelFor((rssi < smoothed) ? rssi : smoothed);
+
+    if(wanted > g_tx_power.level)
+    {
+        APP_PERF_INC(app_perf_tx_power_ups);
+        txPowerSetLevel(wanted);
+    }
+    else if(wanted == g_tx_power.level)
+    {
+        g_tx_power.down_samples = 0;
+    }
+    else if(++ g_tx_power.down_samples >= TX_POWER_DOWN_SAMPLES)
+    {
+        APP_PERF_INC(app_perf_tx_power_downs);
+        txPowerSetLevel(g_tx_power.level - 1);
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TxPowerStart
+ *
+ *  DESCRIPTION
+ *      This function starts the transmit power control of the link to the
+ *      given host. The link starts at full power, which is lowered once the
+ *      RSSI has been sampled.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void TxPowerStart(TYPED_BD_ADDR_T *p_addr)
+{
+    MemCopy(&g_tx_power.addr, p_addr, sizeof(TYPED_BD_ADDR_T));
+
+    g_tx_power.level = TX_POWER_LEVEL_MAX;
+    g_tx_power.rssi_valid = FALSE;
+    g_tx_power.down_samples = 0;
+
+    AppSchedStart(app_sched_job_tx_power, TX_POWER_SAMPLE_INTERVAL,
+                  txPowerSample);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TxPowerStop
+ *
+ *  DESCRIPTION
+ *      This function stops the transmit power control and restores full
+ *      power for advertising.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void TxPowerStop(void)
+{
+    AppSchedStop(app_sched_job_tx_power);
+
+    if(g_tx_power.level != TX_POWER_LEVEL_MAX)
+    {
+        txPowerSetLevel(TX_POWER_LEVEL_MAX);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TxPowerLinkDegraded
+ *
+ *  DESCRIPTION
+ *      This function is called when a notification fails. Full power is
+ *      restored at once, and lowered again by the next samples if the RSSI
+ *      allows it.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void TxPowerLinkDegraded(void)
+{
+    g_tx_power.down_samples = 0;
+
+    if(g_tx_power.level != TX_POWER_LEVEL_MAX)
+    {
+        APP_PERF_INC(app_perf_tx_power_degraded);
+        txPowerSetLevel(TX_POWER_LEVEL_MAX);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TxPowerGetLevel
+ *
+ *  DESCRIPTION
+ *      This function returns the transmit power level in use.
+ *
+ *  RETURNS
+ *      Transmit power level, 0 to 7.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint8 TxPowerGetLevel(void)
+{
+    return g_tx_power.level;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TxPowerGetDbm
+ *
+ *  DESCRIPTION
+ *      This function returns the transmit power in use.
+ *
+ *  RETURNS
+ *      Transmit power, in dBm.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern int8 TxPowerGetDbm(void)
+{
+    return tx_power_levels[g_tx_power.level].dbm;
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TxPowerGetRssi
+ *
+ *  DESCRIPTION
+ *      This function returns the smoothed RSSI of the link.
+ *
+ *  RETURNS
+ *      RSSI in dBm, 0 if it has not been sampled yet.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern int8 TxPowerGetRssi(void)
+{
+    if(!g_tx_power.rssi_valid)
+    {
+        return 0;
+    }
+
+    return (int8)(g_tx_power.rssi_avg / TX_POWER_RSSI_WEIGHT);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TxPowerReportEnergy
+ *
+ *  DESCRIPTION
+ *      This function estimates the energy taken to transmit a key report
+ *      notification at the transmit power in use, from the transmit current
+ *      of the level, the supply voltage and the time on air. Receiving the
+ *      acknowledgement and waking up take the same energy at every level and
+ *      are left out.
+ *
+ *  RETURNS
+ *      Energy in nJ.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern uint16 TxPowerReportEnergy(void)
+{
+    /* 0.1mA x mV x us is 1e-4 nJ */
+    return (uint16)(((uint32)tx_power_levels[g_tx_power.level].current *
+                     TX_POWER_SUPPLY_MV * TX_POWER_REPORT_AIR_TIME) /
+                    10000UL);
+}
+
+#endif /* ENABLE_TX_POWER_CONTROL */
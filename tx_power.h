@@ -0,0 +1,63 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2012-2014
+ *  Part of CSR uEnergy SDK 2.3.0
+ *  Application version 2.3.0.0
+ *
+ *  FILE
+ *      tx_power.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the transmit power control
+ *
+ *****************************************************************************/
+
+#ifndef __TX_POWER_H__
+#define __TX_POWER_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <bluetooth.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"
+
+#ifdef ENABLE_TX_POWER_CONTROL
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* This function starts the transmit power control of the link to the given
+ * host, at full power
+ */
+extern void TxPowerStart(TYPED_BD_ADDR_T *p_addr);
+
+/* This function stops the transmit power control and restores full power */
+extern void TxPowerStop(void);
+
+/* This function restores full power at once, as the link has degraded */
+extern void TxPowerLinkDegraded(void);
+
+/* This function returns the transmit power level in use, 0 to 7 */
+extern uint8 TxPowerGetLevel(void);
+
+/* This function returns the transmit power in use, in dBm */
+extern int8 TxPowerGetDbm(void);
+
+/* This function returns the smoothed RSSI of the link, in dBm */
+extern int8 TxPowerGetRssi(void);
+
+/* This function returns the estimated energy taken to transmit a key
+ * report at the transmit power in use, in nJ
+ */
+extern uint16 TxPowerReportEnergy(void);
+
+#endif /* ENABLE_TX_POWER_CONTROL */
+
+#endif /* __TX_POWER_H__ */
@@ -30,6 +30,212 @@
 #define SHORT_BEEP_TIMER_VALUE  (100* MILLISECOND)
 #define LONG_BEEP_TIMER_VALUE   (500* MILLISECOND)
 #define BEEP_GAP_TIMER_VALUE    (25* MILLISECOND)
+
+/* Maximum number of steps of a signal pattern written by the host */
+#define SIGNAL_HOST_STEPS_MAX   (8)
 #endif /* ENABLE_BUZZER */
 
+/* Application event tracing has been put under compiler flag
+ * ENABLE_APP_TRACE. When enabled, state transitions, LM events, PIO events,
+ * notifications and connection parameter updates are logged with a time
+ * stamp into a RAM ring which can be read out over the Diagnostics service.
+ * Disable this flag to remove the ring and all the trace points.
+ */
+#define ENABLE_APP_TRACE
+
+#ifdef ENABLE_APP_TRACE
+/* Number of records held in the trace ring. Must be a power of two. */
+#define APP_TRACE_RING_SIZE     (16)
+#endif /* ENABLE_APP_TRACE */
+
+/* Firmware performance counters have been put under compiler flag
+ * ENABLE_PERF_COUNTERS. When enabled, PIO events, reports, notifications,
+ * battery reads, NVM accesses, connection parameter updates, reconnections
+ * and disconnections are counted in RAM and can be read (and reset) over the
+ * Diagnostics service. The latency of key reports, from the PIO changed
+ * event to the confirmation of the notification, is kept as a histogram
+ * alongside.
+ */
+#define ENABLE_PERF_COUNTERS
+
+/* The GHG, BP and send counters are checkpointed to NVM so that they resume
+ * from where they were after a reset. A checkpoint is written every
+ * COUNTER_CHECKPOINT_INTERVAL increments (and on disconnection or low
+ * battery) to one of COUNTER_CHECKPOINT_SLOTS NVM slots in turn. A larger
+ * interval lowers the NVM wear but loses more counts on a reset.
+ */
+#define COUNTER_CHECKPOINT_INTERVAL     (16)
+#define COUNTER_CHECKPOINT_SLOTS        (4)
+
+/* GHG and BP pulse counting has been put under compiler flag
+ * ENABLE_PIO_CTRLR_COUNTING. When enabled, the pulses on PIO10 and PIO11 are
+ * debounced and counted by the PIO controller (see pio_ctrlr_code.asm)
+ * instead of waking the chip on every edge, and the counts are fetched every
+ * PULSE_POLL_INTERVAL or on any other key event. PIO_CTRLR_SHARED_RAM is
+ * the address at which the application sees the memory of the PIO
+ * controller.
+ */
+#undef ENABLE_PIO_CTRLR_COUNTING
+
+#ifdef ENABLE_PIO_CTRLR_COUNTING
+#define PULSE_POLL_INTERVAL     (250 * MILLISECOND)
+#define PIO_CTRLR_SHARED_RAM    (0xc000)
+#endif /* ENABLE_PIO_CTRLR_COUNTING */
+
+/* Keys with INPUT_STORM_EDGES edges or more within INPUT_STORM_WINDOW, such
+ * as a bouncing contact, stop raising PIO changed events and are sampled
+ * every INPUT_POLL_INTERVAL instead. They go back to events once they show
+ * fewer than INPUT_QUIET_EDGES edges in a window. host/input_bench finds 
+ * polling cheaper from about 80 edges/s while connected (2 wake-ups per 
+ * edge, 1.6 per poll), between the 40 and 120 edges/s these give, and 
+ * fails if that stops being so.
+ */
+#define INPUT_STORM_WINDOW      (100 * MILLISECOND)
+#define INPUT_STORM_EDGES       (12)
+#define INPUT_QUIET_EDGES       (4)
+#define INPUT_POLL_INTERVAL     (10 * MILLISECOND)
+
+/* PIO changed events are only queued by the event handler, and decoded into
+ * key reports by the low priority scheduler once the handler has returned.
+ * Number of events the queue holds. Must be a power of two. Events arriving
+ * while it is full are merged into the newest one; the GHG and BP presses
+ * this hides are still counted.
+ */
+#define INPUT_QUEUE_SIZE        (8)
+
+/* Keys are reported by priority. Changes of low priority keys (the GHG and
+ * BP counters) are held back for up to REPORT_COALESCE_DELAY and merged into
+ * one report, while any other key is reported at once along with them. High
+ * priority keys (the brake) also switch the connection to the low latency
+ * parameters (see gap_conn_params.h) until LOW_LATENCY_HOLD_TIME after the
+ * last of their events.
+ */
+#define REPORT_COALESCE_DELAY   (50 * MILLISECOND)
+#define LOW_LATENCY_HOLD_TIME   (5 * SECOND)
+
+/* The analog throttle has been put under compiler flag ENABLE_THROTTLE, for
+ * boards with a hall-effect throttle on THROTTLE_AIO. Each sample averages
+ * THROTTLE_OVERSAMPLE ADC reads, and is scaled to a position from 0 at
+ * THROTTLE_MIN_MV to 255 at THROTTLE_MAX_MV, within the 0 to 1.3V range of
+ * the AIO. Positions within THROTTLE_DEADBAND of either end read as that
+ * end. The position is carried as the sixth octet of the key report, sent
+ * when it moves THROTTLE_REPORT_STEP or more and every THROTTLE_KEEPALIVE
+ * while the throttle is open. An open throttle is sampled every
+ * THROTTLE_SAMPLE_INTERVAL, one at rest every THROTTLE_REST_INTERVAL.
+ */
+#undef ENABLE_THROTTLE
+
+#ifdef ENABLE_THROTTLE
+#define THROTTLE_AIO                (aio0)
+#define THROTTLE_OVERSAMPLE         (16)
+#define THROTTLE_MIN_MV             (250)
+#define THROTTLE_MAX_MV             (1150)
+#define THROTTLE_DEADBAND           (4)
+#define THROTTLE_REPORT_STEP        (3)
+#define THROTTLE_KEEPALIVE          (1 * SECOND)
+#define THROTTLE_SAMPLE_INTERVAL    (20 * MILLISECOND)
+#define THROTTLE_REST_INTERVAL      (250 * MILLISECOND)
+#endif /* ENABLE_THROTTLE */
+
+/* HID over GATT has been put under compiler flag ENABLE_HID_MODE. When
+ * enabled, the HID service presents the keys as a keyboard (the arrow keys,
+ * 'G' and 'B') and the GHG and BP counts as vendor usages, in the boot and
+ * report protocols, so that the host operating system takes the key events
+ * straight from its HID driver. The key reports are still notified on the
+ * Health Thermometer service to hosts which enable them.
+ */
+#undef ENABLE_HID_MODE
+
+/* Transmit power control has been put under compiler flag
+ * ENABLE_TX_POWER_CONTROL. When enabled, the RSSI of the link is sampled
+ * every TX_POWER_SAMPLE_INTERVAL while connected. The RSSI the host sees is
+ * estimated from it, assuming that the host transmits at
+ * TX_POWER_HOST_TX_POWER dBm over the same path loss. The transmit power is
+ * stepped down one level after TX_POWER_DOWN_SAMPLES samples in a row show
+ * that the host would still see TX_POWER_TARGET_RSSI plus TX_POWER_MARGIN
+ * dBm, and stepped up at once when a sample falls short of it or a
+ * notification fails. Full power is used while advertising. The control is
+ * disabled by default until it has been tried against hosts on the board;
+ * host/tx_power_bench checks that the levels converge on RSSI traces.
+ */
+#undef ENABLE_TX_POWER_CONTROL
+
+#ifdef ENABLE_TX_POWER_CONTROL
+#define TX_POWER_SAMPLE_INTERVAL        (1 * SECOND)
+#define TX_POWER_HOST_TX_POWER          (0)
+#define TX_POWER_TARGET_RSSI            (-80)
+#define TX_POWER_MARGIN                 (10)
+#define TX_POWER_DOWN_SAMPLES           (5)
+#endif /* ENABLE_TX_POWER_CONTROL */
+
+/* The inactivity power ladder has been put under compiler flag
+ * ENABLE_POWER_LADDER. When enabled, a connection without key events for
+ * LADDER_RELAX_TIME asks for the relaxed connection parameters (see
+ * gap_conn_params.h), and is closed LADDER_DISCONNECT_TIME after the last key
+ * event, after which the device advertises slowly for
+ * SLOW_CONNECTION_ADVERT_TIMEOUT_VALUE and then goes idle. Any key event
+ * while idle or advertising slowly starts fast advertising, and the key
+ * events made meanwhile are reported together once the host has reconnected.
+ * LADDER_DISCONNECT_TIME must stay below 35 minutes. The ladder is disabled
+ * by default until the figures below have been measured.
+ *
+ * With LADDER_DORMANT, the chip also goes dormant LADDER_DORMANT_DELAY after
+ * going idle. The CSR101x only wakes from dormant on its WAKE pin, so the
+ * keys must be wired to it as well; the key held down on waking is then
+ * reported once the host has reconnected.
+ *
+ * Estimated average current of each stage, as worked out by
+ * host/power_model.py from the parameters in gap_conn_params.h. Its inputs,
+ * about 15uC per connection event, 25uC per advertising event, 5uA in deep
+ * sleep and 0.6uA dormant, are unverified estimates still to be measured on
+ * the board:
+ *
+ *  Connected, preferred parameters (168.75ms per event)    ~94uA
+ *  Connected, relaxed parameters (1s per event)            ~20uA
+ *  Fast advertising (60ms)                                 ~420uA
+ *  Slow advertising (1280ms)                               ~25uA
+ *  Idle, deep sleep                                        ~5uA
+ *  Dormant                                                 ~0.6uA
+ */
+#undef ENABLE_POWER_LADDER
+
+#ifdef ENABLE_POWER_LADDER
+#define LADDER_RELAX_TIME               (30 * SECOND)
+#define LADDER_DISCONNECT_TIME          (5 * MINUTE)
+#undef LADDER_DORMANT
+
+#ifdef LADDER_DORMANT
+#define LADDER_DORMANT_DELAY            (2 * SECOND)
+#endif /* LADDER_DORMANT */
+#endif /* ENABLE_POWER_LADDER */
+
+/* The Command characteristic of the Diagnostics service has been put under
+ * compiler flag ENABLE_HOST_COMMANDS. When enabled, the host can sound a
+ * beep or play a pattern on the buzzer, reset the GHG, BP and send counts,
+ * ask for a key report straight away and switch the report mode, with a
+ * write command which takes no ATT response.
+ */
+#define ENABLE_HOST_COMMANDS
+
+/* Number of central devices the application can be bonded with. When a
+ * further device bonds, the least recently used bond is evicted. Each bond
+ * takes BOND_TABLE_ENTRY_NVM_WORDS, 19 words of NVM (22 with
+ * ENABLE_HID_MODE). The build fails unless the whole NVM layout stays within
+ * NVM_SHADOW_WORDS, 0xa0 words (see health_thermometer.c). With the default
+ * features the layout ends at 0x8c with 4 bonds, leaving room for a fifth
+ * bond but not for a fifth one with ENABLE_HID_MODE.
+ */
+#define MAX_BONDED_DEVICES              (4)
+
+/* Once a central has bonded, a further one can only bond in a pairing
+ * window, opened by holding the LEFT key for PAIRING_BUTTON_PRESS_TIME (two
+ * beeps) and closed once a central has bonded or after PAIRING_WINDOW_TIME.
+ * Outside the window the device advertises to its white list only and
+ * rejects pairing, so that no central in range can evict a bond. Holding
+ * the key on until EXTRA_LONG_BUTTON_PRESS_TIMER (three beeps) removes all
+ * the bonds instead.
+ */
+#define PAIRING_BUTTON_PRESS_TIME       (2 * SECOND)
+#define PAIRING_WINDOW_TIME             (60 * SECOND)
+
 #endif /* __USER_CONFIG_H__ */